@@ -64,6 +64,22 @@ internal class Tracker.Bus.ArrayCursor : Tracker.Sparql.Cursor {
 		return true;
 	}
 
+	public override int next_n (string?[] values, Sparql.ValueType[] types, int n_rows, Cancellable? cancellable = null) throws GLib.Error
+	requires (n_rows >= 0 && values.length >= n_rows * cols && types.length >= n_rows * cols) {
+		int row;
+
+		for (row = 0; row < n_rows && current_row < rows - 1; row++) {
+			current_row++;
+
+			for (int column = 0; column < cols; column++) {
+				types[column * n_rows + row] = this.types[column];
+				values[column * n_rows + row] = results[current_row, column];
+			}
+		}
+
+		return row;
+	}
+
 	public override async bool next_async (Cancellable? cancellable = null) throws GLib.Error {
 		/* This cursor isn't blocking, it's fine to just call next here */
 		return next (cancellable);
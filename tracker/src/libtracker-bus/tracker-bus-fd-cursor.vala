@@ -115,6 +115,37 @@ class Tracker.Bus.FDCursor : Tracker.Sparql.Cursor {
 		return true;
 	}
 
+	public override int next_n (string?[] values, Sparql.ValueType[] types, int n_rows, Cancellable? cancellable = null) throws GLib.Error
+	requires (n_rows >= 0 && values.length >= n_rows * _n_columns && types.length >= n_rows * _n_columns) {
+		int n_cols = _n_columns;
+		int row;
+
+		for (row = 0; row < n_rows; row++) {
+			if (!next (cancellable)) {
+				break;
+			}
+
+			// read the cells straight from the buffer
+			for (int column = 0; column < n_cols; column++) {
+				int i = column * n_rows + row;
+
+				if (column >= _n_columns || this.types[column] == Sparql.ValueType.UNBOUND) {
+					types[i] = Sparql.ValueType.UNBOUND;
+					values[i] = null;
+				} else {
+					types[i] = (Sparql.ValueType) this.types[column];
+					if (column == 0) {
+						values[i] = (string) data;
+					} else {
+						values[i] = (string) (data + offsets[column - 1] + 1);
+					}
+				}
+			}
+		}
+
+		return row;
+	}
+
 	public override async bool next_async (Cancellable? cancellable = null) throws GLib.Error {
 		// next never blocks
 		return next (cancellable);
@@ -221,6 +221,81 @@ public class Tracker.Bus.Connection : Tracker.Sparql.Connection {
 		return result;
 	}
 
+	public async override GenericArray<Error?>? update_array_with_triples_async (string[] sparql, Variant triples, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		UnixInputStream input;
+		UnixOutputStream output;
+		pipe (out input, out output);
+
+		// send D-Bus request
+		AsyncResult dbus_res = null;
+		bool sent_update = false;
+		send_update ("UpdateArrayWithTriples", input, cancellable, (o, res) => {
+			dbus_res = res;
+			if (sent_update) {
+				update_array_with_triples_async.callback ();
+			}
+		});
+
+		// send sparql strings, each followed by its triples, via fd
+		var data_stream = new DataOutputStream (output);
+		data_stream.set_byte_order (DataStreamByteOrder.HOST_ENDIAN);
+		data_stream.put_int32 ((int32) sparql.length);
+		for (int i = 0; i < sparql.length; i++) {
+			data_stream.put_int32 ((int32) sparql[i].length);
+			data_stream.put_string (sparql[i]);
+
+			Variant? update_triples = null;
+			if (i < triples.n_children ()) {
+				update_triples = triples.get_child_value (i);
+			}
+
+			int n_triples = (update_triples != null) ? (int) update_triples.n_children () : 0;
+			data_stream.put_int32 ((int32) n_triples);
+			for (int j = 0; j < n_triples; j++) {
+				var triple = update_triples.get_child_value (j);
+
+				for (int k = 0; k < 4; k++) {
+					unowned string value = triple.get_child_value (k).get_string ();
+					data_stream.put_int32 ((int32) value.length);
+					data_stream.put_string (value);
+				}
+
+				data_stream.put_byte (triple.get_child_value (4).get_boolean () ? (uchar) 1 : (uchar) 0);
+			}
+		}
+		data_stream = null;
+
+		// wait for D-Bus reply
+		sent_update = true;
+		if (dbus_res == null) {
+			yield;
+		}
+
+		var reply = bus.send_message_with_reply.end (dbus_res);
+		handle_error_reply (reply);
+
+		// process results (errors)
+		var result = new GenericArray<Error?> ();
+		Variant resultv;
+		resultv = reply.get_body ().get_child_value (0);
+		var iter = resultv.iterator ();
+		string code, message;
+		while (iter.next ("s", out code)) {
+			if (iter.next ("s", out message)) {
+				if (code != "" && message != "") {
+					result.add (new Sparql.Error.INTERNAL (message));
+				} else {
+					result.add (null);
+				}
+
+				message = null;
+			}
+
+			code = null;
+		}
+		return result;
+	}
+
 	public override GLib.Variant? update_blank (string sparql, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
 		// use separate main context for sync operation
 		var context = new MainContext ();
@@ -328,4 +403,41 @@ public class Tracker.Bus.Connection : Tracker.Sparql.Connection {
 		                                    var_names,
 		                                    types);
 	}
+
+	Sparql.Cursor explain_reply_to_cursor (DBusMessage reply) {
+		string[,] results = (string[,]) reply.get_body ().get_child_value (0);
+		Sparql.ValueType[] types = new Sparql.ValueType[2];
+		string[] var_names = new string[2];
+
+		var_names[0] = "name";
+		var_names[1] = "value";
+		types[0] = Sparql.ValueType.STRING;
+		types[1] = Sparql.ValueType.STRING;
+
+		return new Tracker.Bus.ArrayCursor ((owned) results,
+		                                    results.length[0],
+		                                    results.length[1],
+		                                    var_names,
+		                                    types);
+	}
+
+	public override Sparql.Cursor? explain (string sparql, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		var message = new DBusMessage.method_call (TRACKER_DBUS_SERVICE, TRACKER_DBUS_OBJECT_RESOURCES, TRACKER_DBUS_INTERFACE_RESOURCES, "SparqlExplain");
+		message.set_body (new Variant ("(s)", sparql));
+
+		var reply = bus.send_message_with_reply_sync (message, DBusSendMessageFlags.NONE, int.MAX, null, cancellable);
+		handle_error_reply (reply);
+
+		return explain_reply_to_cursor (reply);
+	}
+
+	public async override Sparql.Cursor? explain_async (string sparql, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		var message = new DBusMessage.method_call (TRACKER_DBUS_SERVICE, TRACKER_DBUS_OBJECT_RESOURCES, TRACKER_DBUS_INTERFACE_RESOURCES, "SparqlExplain");
+		message.set_body (new Variant ("(s)", sparql));
+
+		var reply = yield bus.send_message_with_reply (message, DBusSendMessageFlags.NONE, int.MAX, null, cancellable);
+		handle_error_reply (reply);
+
+		return explain_reply_to_cursor (reply);
+	}
 }
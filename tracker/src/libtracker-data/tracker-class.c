@@ -42,6 +42,7 @@ struct _TrackerClassPrivate {
 	gboolean notify;
 
 	gboolean use_gvdb;
+	gboolean loading_gvdb;
 
 	GArray *super_classes;
 	GArray *domain_indexes;
@@ -72,6 +73,9 @@ struct _TrackerClassPrivate {
 
 static void class_finalize     (GObject      *object);
 
+/* Guards the lazy gvdb loads, see tracker-property.c */
+static GStaticRecMutex gvdb_mutex = G_STATIC_REC_MUTEX_INIT;
+
 G_DEFINE_TYPE (TrackerClass, tracker_class, G_TYPE_OBJECT);
 
 static void
@@ -161,6 +165,45 @@ tracker_class_new (gboolean use_gvdb)
 	return service;
 }
 
+/* Reads the class from the mmapped ontology image once, on first use */
+static void
+class_load_gvdb (TrackerClass *service)
+{
+	TrackerClassPrivate *priv;
+	GVariant *variant;
+
+	priv = GET_PRIV (service);
+
+	g_static_rec_mutex_lock (&gvdb_mutex);
+
+	if (!priv->use_gvdb || priv->loading_gvdb) {
+		g_static_rec_mutex_unlock (&gvdb_mutex);
+		return;
+	}
+
+	priv->loading_gvdb = TRUE;
+
+	variant = tracker_ontologies_get_class_value_gvdb (priv->uri, "super-classes");
+	if (variant) {
+		GVariantIter iter;
+		const gchar *uri;
+
+		g_variant_iter_init (&iter, variant);
+		while (g_variant_iter_loop (&iter, "&s", &uri)) {
+			tracker_class_add_super_class (service,
+			                               tracker_ontologies_get_class_by_uri (uri));
+		}
+
+		g_variant_unref (variant);
+	}
+
+	/* Only published once the super classes are set */
+	priv->loading_gvdb = FALSE;
+	g_atomic_int_set (&priv->use_gvdb, FALSE);
+
+	g_static_rec_mutex_unlock (&gvdb_mutex);
+}
+
 const gchar *
 tracker_class_get_uri (TrackerClass *service)
 {
@@ -218,26 +261,8 @@ tracker_class_get_super_classes (TrackerClass *service)
 
 	priv = GET_PRIV (service);
 
-	if (priv->use_gvdb) {
-		TrackerClass *super_class;
-		GVariant *variant;
-
-		tracker_class_reset_super_classes (service);
-
-		variant = tracker_ontologies_get_class_value_gvdb (priv->uri, "super-classes");
-		if (variant) {
-			GVariantIter iter;
-			const gchar *uri;
-
-			g_variant_iter_init (&iter, variant);
-			while (g_variant_iter_loop (&iter, "&s", &uri)) {
-				super_class = tracker_ontologies_get_class_by_uri (uri);
-
-				tracker_class_add_super_class (service, super_class);
-			}
-
-			g_variant_unref (variant);
-		}
+	if (g_atomic_int_get (&priv->use_gvdb)) {
+		class_load_gvdb (service);
 	}
 
 	return (TrackerClass **) priv->super_classes->data;
@@ -45,6 +45,28 @@
 /* If string lenth less than this value, allocating from the stack */
 #define MAX_STACK_STR_SIZE 8192
 
+/* Sort keys are stored as hexadecimal text, which keeps the byte order
+ * of the key and is safe to pass around as a string */
+static gchar *
+collation_key_to_hex (const guchar *key,
+                      gsize         len)
+{
+	static const gchar hex_digits[] = "0123456789abcdef";
+	gchar *result;
+	gsize i;
+
+	result = g_malloc (2 * len + 1);
+
+	for (i = 0; i < len; i++) {
+		result[2 * i] = hex_digits[key[i] >> 4];
+		result[2 * i + 1] = hex_digits[key[i] & 0xf];
+	}
+
+	result[2 * len] = '\0';
+
+	return result;
+}
+
 #ifdef HAVE_LIBUNISTRING /* ---- GNU libunistring based collation ---- */
 
 gpointer
@@ -96,6 +118,31 @@ tracker_collation_utf8 (gpointer      collator,
 	return result;
 }
 
+gchar *
+tracker_collation_key (gpointer     collator,
+                       const gchar *str,
+                       gint         len)
+{
+	gchar *aux;
+	gchar *xfrm;
+	gsize n;
+	gchar *result;
+
+	/* u8_strcoll() ends up in strcoll(), which orders like the
+	 * strxfrm() result in UTF-8 locales */
+	aux = g_strndup (str, len);
+	n = strxfrm (NULL, aux, 0);
+	xfrm = g_malloc (n + 1);
+	strxfrm (xfrm, aux, n + 1);
+
+	result = collation_key_to_hex ((const guchar *) xfrm, n);
+
+	g_free (xfrm);
+	g_free (aux);
+
+	return result;
+}
+
 #elif HAVE_LIBICU /* ---- ICU based collation (UTF-16) ----*/
 
 gpointer
@@ -192,6 +239,50 @@ tracker_collation_utf8 (gpointer      collator,
 	return 0;
 }
 
+gchar *
+tracker_collation_key (gpointer     collator,
+                       const gchar *str,
+                       gint         len)
+{
+	UErrorCode status = U_ZERO_ERROR;
+	UCharIterator iter;
+	uint32_t state[2] = { 0, 0 };
+	guchar buffer[256];
+	GByteArray *key;
+	gint32 n;
+	gchar *result;
+
+	/* Collator must be created before trying to collate */
+	g_return_val_if_fail (collator, NULL);
+
+	uiter_setUTF8 (&iter, str, len);
+	key = g_byte_array_sized_new (len + 16);
+
+	/* The sort key is computed in parts, without converting the
+	 * whole string to UTF-16 first */
+	do {
+		n = ucol_nextSortKeyPart ((UCollator *) collator,
+		                          &iter,
+		                          state,
+		                          buffer,
+		                          sizeof (buffer),
+		                          &status);
+
+		if (U_FAILURE (status)) {
+			g_critical ("Error getting sort key: %s", u_errorName (status));
+			g_byte_array_free (key, TRUE);
+			return NULL;
+		}
+
+		g_byte_array_append (key, buffer, n);
+	} while (n == sizeof (buffer));
+
+	result = collation_key_to_hex (key->data, key->len);
+	g_byte_array_free (key, TRUE);
+
+	return result;
+}
+
 #else /* ---- GLib based collation ---- */
 
 gpointer
@@ -243,4 +334,19 @@ tracker_collation_utf8 (gpointer      collator,
 	return result;
 }
 
+gchar *
+tracker_collation_key (gpointer     collator,
+                       const gchar *str,
+                       gint         len)
+{
+	gchar *xfrm;
+	gchar *result;
+
+	xfrm = g_utf8_collate_key (str, len);
+	result = collation_key_to_hex ((const guchar *) xfrm, strlen (xfrm));
+	g_free (xfrm);
+
+	return result;
+}
+
 #endif
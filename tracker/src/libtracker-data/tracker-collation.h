@@ -33,6 +33,9 @@ gint     tracker_collation_utf8     (gpointer      collator,
                                      gconstpointer str1,
                                      gint          len2,
                                      gconstpointer str2);
+gchar   *tracker_collation_key      (gpointer      collator,
+                                     const gchar  *str,
+                                     gint          len);
 
 #ifdef HAVE_LIBICU
 #define TRACKER_COLLATION_LAST_CHAR ((gunichar) 0x10fffd)
@@ -21,6 +21,10 @@
 
 #include <errno.h>
 #include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #include <glib.h>
 #include <glib/gstdio.h>
@@ -35,24 +39,38 @@
 
 typedef struct {
 	GFile *destination, *journal;
+	TrackerDataBackupProgress progress_callback;
+	gpointer progress_user_data;
 	TrackerDataBackupFinished callback;
 	gpointer user_data;
 	GDestroyNotify destroy;
 	GError *error;
+	GPtrArray *chunks;
 } BackupSaveInfo;
 
 #ifndef DISABLE_JOURNAL
 
+/* Backups are gzipped tar archives of the journal files */
+#define TAR_BLOCK_SIZE   512
+#define COPY_BLOCK_SIZE  (64 * 1024)
+
 typedef struct {
-	GPid pid;
-	guint stdout_watch_id;
-	guint stderr_watch_id;
-	GIOChannel *stdin_channel;
-	GIOChannel *stdout_channel;
-	GIOChannel *stderr_channel;
-	gpointer data;
-	GString *lines;
-} ProcessContext;
+	gchar *name;
+	gint fd;
+	goffset size;
+	gint64 mtime;
+} JournalChunk;
+
+static void
+journal_chunk_free (JournalChunk *chunk)
+{
+	if (chunk->fd != -1) {
+		close (chunk->fd);
+	}
+
+	g_free (chunk->name);
+	g_slice_free (JournalChunk, chunk);
+}
 
 #endif /* DISABLE_JOURNAL */
 
@@ -67,6 +85,10 @@ free_backup_save_info (BackupSaveInfo *info)
 		g_object_unref (info->journal);
 	}
 
+	if (info->chunks) {
+		g_ptr_array_free (info->chunks, TRUE);
+	}
+
 	if (info->destroy) {
 		info->destroy (info->user_data);
 	}
@@ -85,138 +107,281 @@ tracker_data_backup_error_quark (void)
 
 #ifndef DISABLE_JOURNAL
 
-static void
-on_journal_copied (BackupSaveInfo *info, GError *error)
+static gboolean
+perform_callback (gpointer user_data)
 {
+	BackupSaveInfo *info = user_data;
+
 	if (info->callback) {
-		info->callback (error, info->user_data);
+		info->callback (info->error, info->user_data);
 	}
 
-	free_backup_save_info (info);
+	return FALSE;
 }
 
+/* Opens the journal file and remembers its current size. Only this
+ * part of the file goes into the backup: everything appended later
+ * belongs to transactions committed after the backup was requested.
+ * Keeping the file descriptor open means a concurrent rotation
+ * (rename and deletion after compression) doesn't affect us. */
+static gboolean
+journal_chunk_add (BackupSaveInfo  *info,
+                   const gchar     *directory,
+                   const gchar     *name,
+                   gboolean         optional,
+                   GError         **error)
+{
+	JournalChunk *chunk;
+	struct stat st;
+	gchar *path;
+	gint fd;
 
+	path = g_build_filename (directory, name, NULL);
+	fd = g_open (path, O_RDONLY, 0);
 
-static void
-process_context_destroy (ProcessContext *context, GError *error)
-{
-	on_journal_copied (context->data, error);
+	if (fd == -1) {
+		gint err = errno;
 
-	if (context->lines) {
-		g_string_free (context->lines, TRUE);
-	}
+		if (!optional || err != ENOENT) {
+			g_set_error (error, TRACKER_DATA_BACKUP_ERROR,
+			             TRACKER_DATA_BACKUP_ERROR_UNKNOWN,
+			             "Could not open journal file '%s': %s",
+			             path, g_strerror (err));
+		}
 
-	if (context->stdin_channel) {
-		g_io_channel_shutdown (context->stdin_channel, FALSE, NULL);
-		g_io_channel_unref (context->stdin_channel);
-		context->stdin_channel = NULL;
-	}
+		g_free (path);
 
-	if (context->stdout_watch_id != 0) {
-		g_source_remove (context->stdout_watch_id);
-		context->stdout_watch_id = 0;
+		return optional && err == ENOENT;
 	}
 
-	if (context->stdout_channel) {
-		g_io_channel_shutdown (context->stdout_channel, FALSE, NULL);
-		g_io_channel_unref (context->stdout_channel);
-		context->stdout_channel = NULL;
-	}
+	if (fstat (fd, &st) == -1) {
+		g_set_error (error, TRACKER_DATA_BACKUP_ERROR,
+		             TRACKER_DATA_BACKUP_ERROR_UNKNOWN,
+		             "Could not stat journal file '%s': %s",
+		             path, g_strerror (errno));
+		close (fd);
+		g_free (path);
 
-	if (context->stderr_watch_id != 0) {
-		g_source_remove (context->stderr_watch_id);
-		context->stderr_watch_id = 0;
+		return FALSE;
 	}
 
-	if (context->stderr_channel) {
-		g_io_channel_shutdown (context->stderr_channel, FALSE, NULL);
-		g_io_channel_unref (context->stderr_channel);
-		context->stderr_channel = NULL;
-	}
+#ifdef HAVE_POSIX_FADVISE
+	posix_fadvise (fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif /* HAVE_POSIX_FADVISE */
 
-	if (context->pid != 0) {
-		g_spawn_close_pid (context->pid);
-		context->pid = 0;
-	}
+	chunk = g_slice_new0 (JournalChunk);
+	chunk->name = g_strdup (name);
+	chunk->fd = fd;
+	chunk->size = st.st_size;
+	chunk->mtime = st.st_mtime;
 
-	g_free (context);
+	g_ptr_array_add (info->chunks, chunk);
+	g_free (path);
+
+	return TRUE;
 }
 
 static gboolean
-read_line_of_tar_output (GIOChannel  *channel,
-                         GIOCondition condition,
-                         gpointer     user_data)
+write_tar_header (GOutputStream  *ostream,
+                  JournalChunk   *chunk,
+                  GError        **error)
 {
-	if (condition & G_IO_ERR || condition & G_IO_HUP) {
-		return FALSE;
+	gchar header[TAR_BLOCK_SIZE] = { 0 };
+	guint checksum = 0;
+	guint i;
+
+	/* ustar header, see tar(5) */
+	g_strlcpy (header, chunk->name, 100);
+	g_snprintf (header + 100, 8, "%07o", 0644);
+	g_snprintf (header + 108, 8, "%07o", 0);
+	g_snprintf (header + 116, 8, "%07o", 0);
+	g_snprintf (header + 124, 12, "%011" G_GINT64_MODIFIER "o", (gint64) chunk->size);
+	g_snprintf (header + 136, 12, "%011" G_GINT64_MODIFIER "o", chunk->mtime);
+	header[156] = '0';
+	memcpy (header + 257, "ustar", 6);
+	memcpy (header + 263, "00", 2);
+
+	/* Checksum is calculated with the checksum field filled with spaces */
+	memset (header + 148, ' ', 8);
+
+	for (i = 0; i < TAR_BLOCK_SIZE; i++) {
+		checksum += (guchar) header[i];
 	}
 
-	/* TODO: progress support */
-	return TRUE;
+	g_snprintf (header + 148, 8, "%06o", checksum);
+	header[155] = ' ';
+
+	return g_output_stream_write_all (ostream, header, TAR_BLOCK_SIZE,
+	                                  NULL, NULL, error);
 }
 
 static gboolean
-read_error_of_tar_output (GIOChannel  *channel,
-                          GIOCondition condition,
-                          gpointer     user_data)
+write_tar_chunk (BackupSaveInfo  *info,
+                 GOutputStream   *ostream,
+                 JournalChunk    *chunk,
+                 gchar           *buffer,
+                 GTimer          *timer,
+                 guint64         *bytes_done,
+                 guint64          bytes_total,
+                 gdouble         *last_progress,
+                 GError         **error)
 {
-	ProcessContext *context;
-	GIOStatus status;
-	gchar *line;
-
-	context = user_data;
-	status = G_IO_STATUS_NORMAL;
-
-	if (condition & G_IO_IN || condition & G_IO_PRI) {
-		do {
-			GError *error = NULL;
-
-			status = g_io_channel_read_line (channel, &line, NULL, NULL, &error);
-
-			if (status == G_IO_STATUS_NORMAL) {
-				if (context->lines == NULL)
-					context->lines = g_string_new (NULL);
-				g_string_append (context->lines, line);
-				g_free (line);
-			} else if (error) {
-				g_warning ("%s", error->message);
-				g_error_free (error);
-			}
-		} while (status == G_IO_STATUS_NORMAL);
+	goffset offset = 0;
+	gsize padding;
+
+	if (!write_tar_header (ostream, chunk, error)) {
+		return FALSE;
+	}
 
-		if (status == G_IO_STATUS_EOF ||
-		    status == G_IO_STATUS_ERROR) {
+	while (offset < chunk->size) {
+		gssize n_read;
+
+		n_read = pread (chunk->fd, buffer,
+		                MIN (COPY_BLOCK_SIZE, chunk->size - offset),
+		                offset);
+
+		if (n_read < 0 && errno == EINTR) {
+			continue;
+		} else if (n_read <= 0) {
+			g_set_error (error, TRACKER_DATA_BACKUP_ERROR,
+			             TRACKER_DATA_BACKUP_ERROR_UNKNOWN,
+			             "Could not read journal file '%s': %s",
+			             chunk->name,
+			             n_read < 0 ? g_strerror (errno) : "unexpected end of file");
+			return FALSE;
+		}
+
+		if (!g_output_stream_write_all (ostream, buffer, n_read, NULL, NULL, error)) {
 			return FALSE;
 		}
+
+		offset += n_read;
+		*bytes_done += n_read;
+
+		/* Don't flood the main loop, report by 1% steps */
+		if (bytes_total > 0 &&
+		    (gdouble) *bytes_done / bytes_total - *last_progress >= 0.01) {
+			*last_progress = (gdouble) *bytes_done / bytes_total;
+			tracker_db_backup_notify_progress (info->progress_callback,
+			                                   info->progress_user_data,
+			                                   *last_progress);
+		}
+
+		tracker_db_backup_throttle (timer, *bytes_done);
 	}
 
-	if (condition & G_IO_ERR || condition & G_IO_HUP) {
-		return FALSE;
+	padding = (TAR_BLOCK_SIZE - chunk->size % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE;
+
+	if (padding > 0) {
+		memset (buffer, 0, padding);
+
+		if (!g_output_stream_write_all (ostream, buffer, padding, NULL, NULL, error)) {
+			return FALSE;
+		}
 	}
 
 	return TRUE;
 }
 
-static void
-process_context_child_watch_cb (GPid     pid,
-                                gint     status,
-                                gpointer user_data)
+static gboolean
+backup_save_job (GIOSchedulerJob *job,
+                 GCancellable    *cancellable,
+                 gpointer         user_data)
 {
-	ProcessContext *context;
-	GError *error = NULL;
+	BackupSaveInfo *info = user_data;
+	GFileOutputStream *ostream;
+	GOutputStream *cstream;
+	GConverter *converter;
+	GFile *parent, *temp_file;
+	GTimer *timer;
+	gchar *buffer, *basename, *temp_name;
+	guint64 bytes_done = 0, bytes_total = 0;
+	gdouble last_progress = 0;
+	guint i;
 
-	g_debug ("Process '%d' exited with code %d", pid, status);
+	parent = g_file_get_parent (info->destination);
+	basename = g_file_get_basename (info->destination);
+	temp_name = g_strconcat (basename, ".tmp", NULL);
+	temp_file = g_file_get_child (parent, temp_name);
+	g_free (temp_name);
+	g_free (basename);
+	g_object_unref (parent);
 
-	context = (ProcessContext *) user_data;
+	ostream = g_file_replace (temp_file, NULL, FALSE,
+	                          G_FILE_CREATE_NONE,
+	                          NULL, &info->error);
 
-	if (context->lines) {
-		g_set_error (&error, TRACKER_DATA_BACKUP_ERROR,
-		             TRACKER_DATA_BACKUP_ERROR_UNKNOWN,
-		             "%s", context->lines->str);
+	if (!ostream) {
+		g_object_unref (temp_file);
+		g_idle_add_full (G_PRIORITY_DEFAULT, perform_callback, info,
+		                 (GDestroyNotify) free_backup_save_info);
+		return FALSE;
+	}
+
+	converter = G_CONVERTER (g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP, -1));
+	cstream = g_converter_output_stream_new (G_OUTPUT_STREAM (ostream), converter);
+	g_object_unref (converter);
+	g_object_unref (ostream);
+
+	for (i = 0; i < info->chunks->len; i++) {
+		JournalChunk *chunk = g_ptr_array_index (info->chunks, i);
+
+		bytes_total += chunk->size;
+	}
+
+	buffer = g_malloc (COPY_BLOCK_SIZE);
+	timer = g_timer_new ();
+
+	for (i = 0; !info->error && i < info->chunks->len; i++) {
+		write_tar_chunk (info, cstream,
+		                 g_ptr_array_index (info->chunks, i),
+		                 buffer, timer,
+		                 &bytes_done, bytes_total,
+		                 &last_progress,
+		                 &info->error);
+	}
+
+	/* End of archive is marked by two zero-filled blocks */
+	if (!info->error) {
+		memset (buffer, 0, 2 * TAR_BLOCK_SIZE);
+		g_output_stream_write_all (cstream, buffer, 2 * TAR_BLOCK_SIZE,
+		                           NULL, NULL, &info->error);
+	}
+
+	g_timer_destroy (timer);
+	g_free (buffer);
+
+	if (!info->error) {
+		g_output_stream_close (cstream, NULL, &info->error);
+	} else {
+		g_output_stream_close (cstream, NULL, NULL);
+	}
+
+	g_object_unref (cstream);
+
+	if (!info->error) {
+		g_file_move (temp_file, info->destination,
+		             G_FILE_COPY_OVERWRITE,
+		             NULL, NULL, NULL,
+		             &info->error);
+	} else {
+		g_file_delete (temp_file, NULL, NULL);
+	}
+
+	g_object_unref (temp_file);
+
+	if (!info->error) {
+		tracker_db_backup_notify_progress (info->progress_callback,
+		                                   info->progress_user_data,
+		                                   1.0);
 	}
 
-	process_context_destroy (context, error);
+	g_idle_add_full (G_PRIORITY_DEFAULT, perform_callback, info,
+	                 (GDestroyNotify) free_backup_save_info);
+
+	return FALSE;
 }
+
 #endif /* DISABLE_JOURNAL */
 
 
@@ -407,107 +572,74 @@ restore_from_temp (void)
 }
 
 void
-tracker_data_backup_save (GFile *destination,
-                          TrackerDataBackupFinished callback,
-                          gpointer user_data,
-                          GDestroyNotify destroy)
+tracker_data_backup_set_pacing (guint pages_per_step,
+                                guint io_budget)
+{
+	tracker_db_backup_set_pacing (pages_per_step, io_budget);
+}
+
+void
+tracker_data_backup_save (GFile                     *destination,
+                          TrackerDataBackupProgress  progress_callback,
+                          gpointer                   progress_user_data,
+                          TrackerDataBackupFinished  callback,
+                          gpointer                   user_data,
+                          GDestroyNotify             destroy)
 {
 #ifndef DISABLE_JOURNAL
 	BackupSaveInfo *info;
-	ProcessContext *context;
-	gchar **argv;
-	gchar *path, *directory;
+	gchar *directory;
 	GDir *journal_dir;
 	GFile *parent;
-	GIOChannel *stdin_channel, *stdout_channel, *stderr_channel;
-	GPid pid;
-	GPtrArray *files;
 	const gchar *f_name;
-	guint i;
 
 	info = g_new0 (BackupSaveInfo, 1);
 	info->destination = g_object_ref (destination);
 	info->journal = g_file_new_for_path (tracker_db_journal_get_filename ());
+	info->progress_callback = progress_callback;
+	info->progress_user_data = progress_user_data;
 	info->callback = callback;
 	info->user_data = user_data;
 	info->destroy = destroy;
+	info->chunks = g_ptr_array_new_with_free_func ((GDestroyNotify) journal_chunk_free);
 
 	parent = g_file_get_parent (info->journal);
 	directory = g_file_get_path (parent);
 	g_object_unref (parent);
-	path = g_file_get_path (destination);
 
-	journal_dir = g_dir_open (directory, 0, NULL);
-	f_name = g_dir_read_name (journal_dir);
-	files = g_ptr_array_new ();
+	/* Snapshot the set of journal files and their sizes synchronously,
+	 * the caller only needs to keep updates from happening until we
+	 * return. Copying is done in a thread, paced according to the
+	 * configured I/O budget, while the store keeps running. */
+	if (journal_chunk_add (info, directory, TRACKER_DB_JOURNAL_FILENAME, FALSE, &info->error) &&
+	    journal_chunk_add (info, directory, TRACKER_DB_JOURNAL_ONTOLOGY_FILENAME, FALSE, &info->error)) {
+		journal_dir = g_dir_open (directory, 0, &info->error);
 
-	while (f_name) {
-		if (f_name) {
+		while (journal_dir && (f_name = g_dir_read_name (journal_dir)) != NULL) {
 			if (!g_str_has_prefix (f_name, TRACKER_DB_JOURNAL_FILENAME ".")) {
-				f_name = g_dir_read_name (journal_dir);
 				continue;
 			}
-			g_ptr_array_add (files, g_strdup (f_name));
-		}
-		f_name = g_dir_read_name (journal_dir);
-	}
 
-	g_dir_close (journal_dir);
-
-	argv = g_new0 (gchar*, files->len + 8);
-
-	argv[0] = g_strdup ("tar");
-	argv[1] = g_strdup ("-zcf");
-	argv[2] = path;
-	argv[3] = g_strdup ("-C");
-	argv[4] = directory;
-	argv[5] = g_strdup (TRACKER_DB_JOURNAL_FILENAME);
-	argv[6] = g_strdup (TRACKER_DB_JOURNAL_ONTOLOGY_FILENAME);
+			/* Rotated chunks may get compressed and removed meanwhile */
+			if (!journal_chunk_add (info, directory, f_name, TRUE, &info->error)) {
+				break;
+			}
+		}
 
-	for (i = 0; i < files->len; i++) {
-		argv[i+7] = g_ptr_array_index (files, i);
+		if (journal_dir) {
+			g_dir_close (journal_dir);
+		}
 	}
 
-	/* It's fine to untar this asynchronous: the journal replay code can or
-	 * should cope with unfinished entries at the end of the file, while
-	 * restoring a backup made this way. */
-
-	if (!tracker_spawn_async_with_channels ((const gchar **) argv,
-	                                        0, &pid,
-	                                        &stdin_channel,
-	                                        &stdout_channel,
-	                                        &stderr_channel)) {
-		GError *error = NULL;
-		g_set_error (&error, TRACKER_DATA_BACKUP_ERROR,
-		             TRACKER_DATA_BACKUP_ERROR_UNKNOWN,
-		             "Error starting tar program");
-		on_journal_copied (info, error);
-		g_strfreev (argv);
-		g_error_free (error);
+	g_free (directory);
+
+	if (info->error) {
+		g_idle_add_full (G_PRIORITY_DEFAULT, perform_callback, info,
+		                 (GDestroyNotify) free_backup_save_info);
 		return;
 	}
 
-	context = g_new0 (ProcessContext, 1);
-	context->lines = NULL;
-	context->data = info;
-	context->pid = pid;
-	context->stdin_channel = stdin_channel;
-	context->stderr_channel = stderr_channel;
-	context->stdout_watch_id = g_io_add_watch (stdout_channel,
-	                                           G_IO_IN | G_IO_PRI | G_IO_ERR | G_IO_HUP,
-	                                           read_line_of_tar_output,
-	                                           context);
-	context->stderr_watch_id = g_io_add_watch (stderr_channel,
-	                                           G_IO_IN | G_IO_PRI | G_IO_ERR | G_IO_HUP,
-	                                           read_error_of_tar_output,
-	                                           context);
-
-	g_child_watch_add (context->pid, process_context_child_watch_cb, context);
-
-	g_debug ("Process '%d' spawned for command:'%s %s %s'",
-	         pid, argv[0], argv[1], argv[2]);
-
-	g_strfreev (argv);
+	g_io_scheduler_push_job (backup_save_job, info, NULL, 0, NULL);
 #else
 	BackupSaveInfo *info;
 
@@ -518,6 +650,8 @@ tracker_data_backup_save (GFile *destination,
 	info->destroy = destroy;
 
 	tracker_db_backup_save (destination,
+	                        progress_callback,
+	                        progress_user_data,
 	                        on_backup_finished, 
 	                        info,
 	                        NULL);
@@ -41,9 +41,14 @@ typedef enum {
 } TrackerDataBackupError;
 
 typedef void (*TrackerDataBackupFinished) (GError *error, gpointer user_data);
+typedef void (*TrackerDataBackupProgress) (gdouble progress, gpointer user_data);
 
 GQuark tracker_data_backup_error_quark (void);
+void   tracker_data_backup_set_pacing  (guint                      pages_per_step,
+                                        guint                      io_budget);
 void   tracker_data_backup_save        (GFile                     *destination,
+                                        TrackerDataBackupProgress  progress_callback,
+                                        gpointer                   progress_user_data,
                                         TrackerDataBackupFinished  callback,
                                         gpointer                   user_data,
                                         GDestroyNotify             destroy);
@@ -48,6 +48,7 @@
 #include "tracker-property.h"
 #include "tracker-sparql-query.h"
 #include "tracker-data-query.h"
+#include "tracker-trigram.h"
 
 #define XSD_PREFIX TRACKER_XSD_PREFIX
 #define RDF_PREFIX TRACKER_RDF_PREFIX
@@ -219,6 +220,187 @@ set_index_for_single_value_property (TrackerDBInterface  *iface,
 	}
 }
 
+/* Collation keys are only stored in the table of the domain class */
+static gboolean
+has_collation_key_column (TrackerProperty *property,
+                          TrackerClass    *service)
+{
+	return tracker_property_get_collation_key (property) &&
+	       tracker_property_get_domain (property) == service;
+}
+
+static void
+set_index_for_collation_key (TrackerDBInterface  *iface,
+                             const gchar         *service_name,
+                             const gchar         *field_name,
+                             GError             **error)
+{
+	g_debug ("Creating index (collation key): "
+	         "CREATE INDEX IF NOT EXISTS \"%s_%s_collationKey\" ON \"%s\" (\"%s:collationKey\")",
+	         service_name, field_name, service_name, field_name);
+
+	tracker_db_interface_execute_query (iface, error,
+	                                    "CREATE INDEX IF NOT EXISTS \"%s_%s_collationKey\" ON \"%s\" (\"%s:collationKey\")",
+	                                    service_name,
+	                                    field_name,
+	                                    service_name,
+	                                    field_name);
+}
+
+/* Computes the collation keys of all properties of the class, or of
+ * all classes if class is NULL, with the current locale */
+static void
+update_collation_keys (TrackerDBInterface  *iface,
+                       TrackerClass        *class,
+                       GError             **error)
+{
+	TrackerProperty **properties;
+	guint n_properties, i;
+	GError *internal_error = NULL;
+
+	properties = tracker_ontologies_get_properties (&n_properties);
+
+	for (i = 0; i < n_properties; i++) {
+		TrackerClass *domain;
+
+		domain = tracker_property_get_domain (properties[i]);
+
+		if ((class != NULL && domain != class) ||
+		    !has_collation_key_column (properties[i], domain)) {
+			continue;
+		}
+
+		g_debug ("Updating collation keys of '%s'", tracker_property_get_name (properties[i]));
+
+		tracker_db_interface_execute_query (iface, &internal_error,
+		                                    "UPDATE \"%s\" SET \"%s:collationKey\" = SparqlCollationKey (\"%s\")",
+		                                    tracker_class_get_name (domain),
+		                                    tracker_property_get_name (properties[i]),
+		                                    tracker_property_get_name (properties[i]));
+
+		if (internal_error) {
+			g_propagate_error (error, internal_error);
+			return;
+		}
+	}
+}
+
+/* Creates the trigram tables of the properties of the class and the
+ * triggers removing the trigrams of old values, tables of properties
+ * that are no longer indexed are dropped. If fill is set, the tables
+ * are filled from the values in the class table. */
+static void
+update_trigram_indexes (TrackerDBInterface  *iface,
+                        TrackerClass        *class,
+                        gboolean             fill,
+                        GError             **error)
+{
+	TrackerProperty **properties;
+	guint n_properties, i;
+	GError *internal_error = NULL;
+
+	properties = tracker_ontologies_get_properties (&n_properties);
+
+	for (i = 0; i < n_properties; i++) {
+		TrackerProperty *property = properties[i];
+		const gchar *service_name, *field_name;
+		gchar *table_name;
+
+		if (tracker_property_get_domain (property) != class ||
+		    tracker_property_get_multiple_values (property) ||
+		    tracker_property_get_data_type (property) != TRACKER_PROPERTY_TYPE_STRING) {
+			continue;
+		}
+
+		service_name = tracker_class_get_name (class);
+		field_name = tracker_property_get_name (property);
+		table_name = tracker_trigram_get_table_name (service_name, field_name);
+
+		if (!tracker_property_get_trigram_indexed (property)) {
+			tracker_db_interface_execute_query (iface, &internal_error,
+			                                    "DROP TABLE IF EXISTS \"%s\"",
+			                                    table_name);
+			g_free (table_name);
+
+			if (internal_error) {
+				g_propagate_error (error, internal_error);
+				return;
+			}
+
+			continue;
+		}
+
+		g_debug ("Creating trigram index for '%s'", field_name);
+
+		tracker_db_interface_execute_query (iface, &internal_error,
+		                                    "CREATE TABLE IF NOT EXISTS \"%s\" ("
+		                                    "ID INTEGER NOT NULL, "
+		                                    "Trigram TEXT NOT NULL, "
+		                                    "UNIQUE (Trigram, ID))",
+		                                    table_name);
+
+		if (!internal_error) {
+			tracker_db_interface_execute_query (iface, &internal_error,
+			                                    "CREATE INDEX IF NOT EXISTS \"%s_ID\" ON \"%s\" (ID)",
+			                                    table_name, table_name);
+		}
+
+		if (!internal_error) {
+			tracker_db_interface_execute_query (iface, &internal_error,
+			                                    "CREATE TRIGGER IF NOT EXISTS \"%s:delete\" "
+			                                    "AFTER DELETE ON \"%s\" "
+			                                    "BEGIN DELETE FROM \"%s\" WHERE ID = old.ID; END",
+			                                    table_name, service_name, table_name);
+		}
+
+		if (!internal_error) {
+			tracker_db_interface_execute_query (iface, &internal_error,
+			                                    "CREATE TRIGGER IF NOT EXISTS \"%s:update\" "
+			                                    "AFTER UPDATE OF \"%s\" ON \"%s\" "
+			                                    "BEGIN DELETE FROM \"%s\" WHERE ID = old.ID; END",
+			                                    table_name, field_name, service_name, table_name);
+		}
+
+		if (!internal_error && fill) {
+			tracker_db_interface_execute_query (iface, &internal_error,
+			                                    "DELETE FROM \"%s\"", table_name);
+		}
+
+		if (!internal_error && fill) {
+			TrackerDBStatement *stmt;
+			TrackerDBCursor *cursor = NULL;
+
+			stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, &internal_error,
+			                                              "SELECT ID, \"%s\" FROM \"%s\" WHERE \"%s\" IS NOT NULL",
+			                                              field_name, service_name, field_name);
+
+			if (stmt) {
+				cursor = tracker_db_statement_start_cursor (stmt, &internal_error);
+				g_object_unref (stmt);
+			}
+
+			if (cursor) {
+				while (!internal_error &&
+				       tracker_db_cursor_iter_next (cursor, NULL, &internal_error)) {
+					tracker_trigram_insert (iface, table_name,
+					                        tracker_db_cursor_get_int (cursor, 0),
+					                        tracker_db_cursor_get_string (cursor, 1, NULL),
+					                        &internal_error);
+				}
+
+				g_object_unref (cursor);
+			}
+		}
+
+		g_free (table_name);
+
+		if (internal_error) {
+			g_propagate_error (error, internal_error);
+			return;
+		}
+	}
+}
+
 static void
 set_index_for_multi_value_property (TrackerDBInterface  *iface,
                                     const gchar         *service_name,
@@ -898,6 +1080,28 @@ tracker_data_ontology_load_statement (const gchar *ontology_path,
 		}
 
 		tracker_property_set_writeback (property, (strcmp (object, "true") == 0));
+	} else if (g_strcmp0 (predicate, TRACKER_PREFIX "collationKey") == 0) {
+		TrackerProperty *property;
+
+		property = tracker_ontologies_get_property_by_uri (subject);
+
+		if (property == NULL) {
+			g_critical ("%s: Unknown property %s", ontology_path, subject);
+			return;
+		}
+
+		tracker_property_set_collation_key (property, (strcmp (object, "true") == 0));
+	} else if (g_strcmp0 (predicate, TRACKER_PREFIX "trigramIndexed") == 0) {
+		TrackerProperty *property;
+
+		property = tracker_ontologies_get_property_by_uri (subject);
+
+		if (property == NULL) {
+			g_critical ("%s: Unknown property %s", ontology_path, subject);
+			return;
+		}
+
+		tracker_property_set_trigram_indexed (property, (strcmp (object, "true") == 0));
 	} else if (g_strcmp0 (predicate, TRACKER_PREFIX "forceJournal") == 0) {
 		TrackerProperty *property;
 
@@ -1474,6 +1678,44 @@ check_for_deleted_super_properties (TrackerProperty  *property,
 	}
 }
 
+/* Whether a boolean annotation of an existing property changed that
+ * affects the layout of the table of its domain */
+static gboolean
+layout_annotation_changed (TrackerProperty  *property,
+                           const gchar      *name,
+                           gboolean          value,
+                           GError          **error)
+{
+	TrackerProperty *annotation;
+	gchar *predicate, *kind;
+	gboolean changed;
+
+	predicate = g_strconcat (TRACKER_PREFIX, name, NULL);
+	annotation = tracker_ontologies_get_property_by_uri (predicate);
+
+	if (annotation == NULL || tracker_property_get_is_new (property)) {
+		/* New properties get the layout when their table is altered */
+		changed = FALSE;
+	} else if (tracker_property_get_is_new (annotation)) {
+		/* No property has the annotation in the database yet */
+		changed = value;
+	} else {
+		kind = g_strconcat ("tracker:", name, NULL);
+		changed = update_property_value ("Unknown",
+		                                 kind,
+		                                 tracker_property_get_uri (property),
+		                                 predicate,
+		                                 value ? "true" : "false",
+		                                 allowed_boolean_conversions,
+		                                 NULL, property, error);
+		g_free (kind);
+	}
+
+	g_free (predicate);
+
+	return changed;
+}
+
 static void
 tracker_data_ontology_process_changes_pre_db (GPtrArray  *seen_classes,
                                               GPtrArray  *seen_properties,
@@ -1501,6 +1743,7 @@ tracker_data_ontology_process_changes_pre_db (GPtrArray  *seen_classes,
 
 			TrackerProperty *property = g_ptr_array_index (seen_properties, i);
 			gboolean last_multiple_values = tracker_property_get_last_multiple_values (property);
+			gboolean layout_changed;
 
 			check_for_deleted_super_properties (property, &n_error);
 
@@ -1520,6 +1763,31 @@ tracker_data_ontology_process_changes_pre_db (GPtrArray  *seen_classes,
 				                                    error);
 				return;
 			}
+
+			/* The collation key column and the trigram table are
+			 * maintained along with the class table */
+			layout_changed = layout_annotation_changed (property, "collationKey",
+			                                            tracker_property_get_collation_key (property),
+			                                            &n_error);
+
+			if (!n_error) {
+				layout_changed |= layout_annotation_changed (property, "trigramIndexed",
+				                                             tracker_property_get_trigram_indexed (property),
+				                                             &n_error);
+			}
+
+			if (layout_changed) {
+				TrackerClass *class;
+
+				class = tracker_property_get_domain (property);
+				tracker_class_set_db_schema_changed (class, TRUE);
+				tracker_property_set_db_schema_changed (property, TRUE);
+			}
+
+			if (n_error) {
+				g_propagate_error (error, n_error);
+				return;
+			}
 		}
 	}
 }
@@ -2126,6 +2394,46 @@ class_add_domain_indexes_from_db (TrackerDBInterface *iface,
 	}
 }
 
+static void
+properties_set_flag_from_db (TrackerDBInterface *iface,
+                             const gchar        *column,
+                             void              (*set_flag) (TrackerProperty *, gboolean))
+{
+	TrackerDBStatement *stmt;
+	TrackerDBCursor *cursor;
+	GError *error = NULL;
+
+	/* Databases created before the annotation existed lack the
+	 * column until the ontology is updated, no property has it then */
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, &error,
+	                                              "SELECT (SELECT Uri FROM Resource WHERE ID = \"rdf:Property\".ID) "
+	                                              "FROM \"rdf:Property\" "
+	                                              "WHERE \"%s\" = 1",
+	                                              column);
+
+	if (!stmt) {
+		g_debug ("Could not load %s: %s", column, error->message);
+		g_error_free (error);
+		return;
+	}
+
+	cursor = tracker_db_statement_start_cursor (stmt, NULL);
+	g_object_unref (stmt);
+
+	if (cursor) {
+		while (tracker_db_cursor_iter_next (cursor, NULL, NULL)) {
+			TrackerProperty *property;
+
+			property = tracker_ontologies_get_property_by_uri (tracker_db_cursor_get_string (cursor, 0, NULL));
+			if (property) {
+				set_flag (property, TRUE);
+			}
+		}
+
+		g_object_unref (cursor);
+	}
+}
+
 static void
 property_add_super_properties_from_db (TrackerDBInterface *iface,
                                        TrackerProperty *property)
@@ -2481,6 +2789,9 @@ db_get_static_data (TrackerDBInterface  *iface,
 		class_add_domain_indexes_from_db (iface, classes[i]);
 	}
 
+	properties_set_flag_from_db (iface, "tracker:collationKey", tracker_property_set_collation_key);
+	properties_set_flag_from_db (iface, "tracker:trigramIndexed", tracker_property_set_trigram_indexed);
+
 	if (internal_error) {
 		g_propagate_error (error, internal_error);
 		return;
@@ -2901,6 +3212,11 @@ create_decomposed_metadata_tables (TrackerDBInterface  *iface,
 				g_propagate_error (error, internal_error);
 				goto error_out;
 			}
+			tracker_db_interface_execute_query (iface, &internal_error, "CREATE TABLE ClassCount (ID INTEGER NOT NULL PRIMARY KEY, Count INTEGER NOT NULL)");
+			if (internal_error) {
+				g_propagate_error (error, internal_error);
+				goto error_out;
+			}
 			g_string_append (create_sql, ", Available INTEGER NOT NULL");
 		}
 	}
@@ -3000,6 +3316,12 @@ create_decomposed_metadata_tables (TrackerDBInterface  *iface,
 
 					}
 
+					if (has_collation_key_column (property, service)) {
+						/* filled after copying the table, see below */
+						g_string_append_printf (create_sql, ", \"%s:collationKey\" TEXT",
+						                        field_name);
+					}
+
 				} else if ((!is_domain_index && tracker_property_get_is_new (property)) ||
 				           (is_domain_index && tracker_property_get_is_new_domain_index (property, service))) {
 					GString *alter_sql = NULL;
@@ -3133,6 +3455,23 @@ create_decomposed_metadata_tables (TrackerDBInterface  *iface,
 						}
 						g_string_free (alter_sql, TRUE);
 					}
+
+					if (has_collation_key_column (property, service)) {
+						/* a new property has no values yet */
+						alter_sql = g_string_new ("ALTER TABLE ");
+						g_string_append_printf (alter_sql, "\"%s\" ADD COLUMN \"%s:collationKey\" TEXT",
+						                        service_name,
+						                        field_name);
+						g_debug ("Altering: '%s'", alter_sql->str);
+						tracker_db_interface_execute_query (iface, &internal_error,
+						                                    "%s", alter_sql->str);
+						g_string_free (alter_sql, TRUE);
+
+						if (internal_error) {
+							g_propagate_error (error, internal_error);
+							goto error_out;
+						}
+					}
 				} else {
 					put_change = TRUE;
 				}
@@ -3164,6 +3503,16 @@ create_decomposed_metadata_tables (TrackerDBInterface  *iface,
 
 		field = field_it->data;
 
+		if (has_collation_key_column (field, service)) {
+			set_index_for_collation_key (iface, service_name,
+			                             tracker_property_get_name (field),
+			                             &internal_error);
+			if (internal_error) {
+				g_propagate_error (error, internal_error);
+				goto error_out;
+			}
+		}
+
 		/* This is implicit for all domain-specific-indices */
 		is_domain_index = is_a_domain_index (domain_indexes, field);
 
@@ -3219,6 +3568,22 @@ create_decomposed_metadata_tables (TrackerDBInterface  *iface,
 			g_propagate_error (error, internal_error);
 			goto error_out;
 		}
+
+		/* Collation keys are not copied, compute them again */
+		update_collation_keys (iface, service, &internal_error);
+
+		if (internal_error) {
+			g_propagate_error (error, internal_error);
+			goto error_out;
+		}
+	}
+
+	/* The triggers of a copied table were dropped with it */
+	update_trigram_indexes (iface, service, in_change, &internal_error);
+
+	if (internal_error) {
+		g_propagate_error (error, internal_error);
+		goto error_out;
 	}
 
 	if (copy_schedule) {
@@ -3505,6 +3870,337 @@ tracker_data_manager_recreate_indexes (TrackerBusyCallback    busy_callback,
 	g_debug ("  Finished index re-creation...");
 }
 
+static gboolean
+load_class_counts (TrackerDBInterface  *iface,
+                   GError             **error)
+{
+	TrackerDBStatement *stmt;
+	TrackerDBCursor *cursor = NULL;
+	TrackerClass **classes;
+	guint n_classes, i;
+	GError *internal_error = NULL;
+
+	classes = tracker_ontologies_get_classes (&n_classes);
+	for (i = 0; i < n_classes; i++) {
+		tracker_class_set_count (classes[i], 0);
+	}
+
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, &internal_error,
+	                                              "SELECT (SELECT Uri FROM Resource WHERE ID = ClassCount.ID), Count "
+	                                              "FROM ClassCount");
+
+	if (stmt) {
+		cursor = tracker_db_statement_start_cursor (stmt, &internal_error);
+		g_object_unref (stmt);
+	}
+
+	if (cursor) {
+		while (tracker_db_cursor_iter_next (cursor, NULL, &internal_error)) {
+			TrackerClass *class;
+			const gchar *uri;
+
+			uri = tracker_db_cursor_get_string (cursor, 0, NULL);
+			class = uri ? tracker_ontologies_get_class_by_uri (uri) : NULL;
+
+			if (class) {
+				tracker_class_set_count (class, tracker_db_cursor_get_int (cursor, 1));
+			}
+		}
+
+		g_object_unref (cursor);
+	}
+
+	if (internal_error) {
+		g_propagate_error (error, internal_error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * tracker_data_manager_check_class_counts:
+ *
+ * Cheap consistency check of the in-memory class counts loaded from
+ * the ClassCount table. No class table is scanned, only invariants
+ * that always hold are verified: counts are never negative and no
+ * class has more instances than any of its super classes.
+ *
+ * Returns: %TRUE if the counts look consistent.
+ **/
+gboolean
+tracker_data_manager_check_class_counts (void)
+{
+	TrackerClass **classes;
+	guint n_classes, i;
+
+	classes = tracker_ontologies_get_classes (&n_classes);
+
+	for (i = 0; i < n_classes; i++) {
+		TrackerClass **super_classes;
+		gint count;
+
+		count = tracker_class_get_count (classes[i]);
+
+		if (count < 0) {
+			g_debug ("Class count for '%s' is negative (%d)",
+			         tracker_class_get_name (classes[i]), count);
+			return FALSE;
+		}
+
+		for (super_classes = tracker_class_get_super_classes (classes[i]);
+		     super_classes && *super_classes; super_classes++) {
+			if (tracker_class_get_count (*super_classes) < count) {
+				g_debug ("Class count for '%s' (%d) exceeds super class '%s' (%d)",
+				         tracker_class_get_name (classes[i]), count,
+				         tracker_class_get_name (*super_classes),
+				         tracker_class_get_count (*super_classes));
+				return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+static gboolean
+get_stat_column (GHashTable  *stats,
+                 const gchar *index_name,
+                 gint         column,
+                 gdouble     *value)
+{
+	const gchar *stat;
+	gchar **columns;
+	gboolean found = FALSE;
+
+	stat = g_hash_table_lookup (stats, index_name);
+	if (stat == NULL) {
+		return FALSE;
+	}
+
+	/* "rows avg-rows-per-first-column avg-rows-per-first-two-columns..." */
+	columns = g_strsplit (stat, " ", -1);
+	if (g_strv_length (columns) > (guint) column) {
+		*value = g_ascii_strtod (columns[column], NULL);
+		found = *value > 0;
+	}
+	g_strfreev (columns);
+
+	return found;
+}
+
+/* Loads per-property cardinality statistics from the sqlite_stat1
+ * table that ANALYZE fills in, properties keep their defaults if the
+ * database has not been analyzed yet */
+static gboolean
+load_property_stats (TrackerDBInterface  *iface,
+                     GError             **error)
+{
+	TrackerDBStatement *stmt;
+	TrackerDBCursor *cursor = NULL;
+	TrackerProperty **properties;
+	GHashTable *stats;
+	guint n_properties, i;
+	gboolean has_stats = FALSE;
+	GError *internal_error = NULL;
+
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, &internal_error,
+	                                              "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'sqlite_stat1'");
+
+	if (stmt) {
+		cursor = tracker_db_statement_start_cursor (stmt, &internal_error);
+		g_object_unref (stmt);
+	}
+
+	if (cursor) {
+		has_stats = tracker_db_cursor_iter_next (cursor, NULL, &internal_error);
+		g_object_unref (cursor);
+		cursor = NULL;
+	}
+
+	if (internal_error) {
+		g_propagate_error (error, internal_error);
+		return FALSE;
+	}
+
+	if (!has_stats) {
+		return TRUE;
+	}
+
+	stats = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, &internal_error,
+	                                              "SELECT idx, stat FROM sqlite_stat1 WHERE idx IS NOT NULL");
+
+	if (stmt) {
+		cursor = tracker_db_statement_start_cursor (stmt, &internal_error);
+		g_object_unref (stmt);
+	}
+
+	if (cursor) {
+		while (tracker_db_cursor_iter_next (cursor, NULL, &internal_error)) {
+			g_hash_table_insert (stats,
+			                     g_strdup (tracker_db_cursor_get_string (cursor, 0, NULL)),
+			                     g_strdup (tracker_db_cursor_get_string (cursor, 1, NULL)));
+		}
+
+		g_object_unref (cursor);
+	}
+
+	if (internal_error) {
+		g_hash_table_unref (stats);
+		g_propagate_error (error, internal_error);
+		return FALSE;
+	}
+
+	properties = tracker_ontologies_get_properties (&n_properties);
+	for (i = 0; i < n_properties; i++) {
+		TrackerProperty *property = properties[i];
+		const gchar *service_name, *field_name;
+		gchar *index_name;
+		gdouble value;
+
+		if (tracker_property_get_domain (property) == NULL) {
+			continue;
+		}
+
+		service_name = tracker_class_get_name (tracker_property_get_domain (property));
+		field_name = tracker_property_get_name (property);
+
+		if (tracker_property_get_multiple_values (property)) {
+			/* (ID) index */
+			index_name = g_strdup_printf ("%s_%s_ID", service_name, field_name);
+			if (get_stat_column (stats, index_name, 1, &value)) {
+				tracker_property_set_values_per_resource (property, value);
+			}
+			g_free (index_name);
+
+			/* (value, ID) index if indexed, (ID, value) otherwise */
+			index_name = g_strdup_printf ("%s_%s_ID_ID", service_name, field_name);
+			if (get_stat_column (stats, index_name, 1, &value)) {
+				if (tracker_property_get_indexed (property)) {
+					tracker_property_set_resources_per_value (property, value);
+				} else {
+					tracker_property_set_values_per_resource (property, value);
+				}
+			}
+			g_free (index_name);
+		} else if (tracker_property_get_indexed (property)) {
+			/* (value) or (value, secondary) index */
+			index_name = g_strdup_printf ("%s_%s", service_name, field_name);
+			if (get_stat_column (stats, index_name, 1, &value)) {
+				tracker_property_set_resources_per_value (property, value);
+			}
+			g_free (index_name);
+		}
+	}
+
+	g_hash_table_unref (stats);
+
+	return TRUE;
+}
+
+/**
+ * tracker_data_manager_rebuild_class_counts:
+ * @busy_callback: callback reporting progress, or %NULL
+ * @busy_user_data: user data for @busy_callback
+ * @busy_status: status string for @busy_callback
+ * @error: return location for errors
+ *
+ * Recounts the instances of every class with a full scan of the class
+ * tables and stores the result in the ClassCount table. This is only
+ * needed for databases created before class counts were persisted or
+ * when tracker_data_manager_check_class_counts() failed.
+ **/
+void
+tracker_data_manager_rebuild_class_counts (TrackerBusyCallback    busy_callback,
+                                           gpointer               busy_user_data,
+                                           const gchar           *busy_status,
+                                           GError               **error)
+{
+	TrackerDBInterface *iface;
+	TrackerClass **classes;
+	guint n_classes, i;
+	GError *internal_error = NULL;
+
+	iface = tracker_db_manager_get_db_interface ();
+	classes = tracker_ontologies_get_classes (&n_classes);
+
+	g_debug ("Rebuilding class counts...");
+
+	tracker_db_interface_start_transaction (iface);
+
+	tracker_db_interface_execute_query (iface, &internal_error,
+	                                    "CREATE TABLE IF NOT EXISTS ClassCount (ID INTEGER NOT NULL PRIMARY KEY, Count INTEGER NOT NULL)");
+
+	if (!internal_error) {
+		tracker_db_interface_execute_query (iface, &internal_error,
+		                                    "DELETE FROM ClassCount");
+	}
+
+	for (i = 0; i < n_classes && !internal_error; i++) {
+		TrackerDBStatement *stmt;
+		TrackerDBCursor *cursor = NULL;
+		const gchar *class_name;
+		gint count = 0;
+
+		class_name = tracker_class_get_name (classes[i]);
+
+		/* xsd classes do not derive from rdfs:Resource and do not use separate tables */
+		if (g_str_has_prefix (class_name, "xsd:")) {
+			continue;
+		}
+
+		stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, &internal_error,
+		                                              "SELECT COUNT(1) FROM \"%s\"", class_name);
+
+		if (stmt) {
+			cursor = tracker_db_statement_start_cursor (stmt, &internal_error);
+			g_object_unref (stmt);
+		}
+
+		if (cursor) {
+			if (tracker_db_cursor_iter_next (cursor, NULL, &internal_error)) {
+				count = tracker_db_cursor_get_int (cursor, 0);
+			}
+			g_object_unref (cursor);
+		}
+
+		if (internal_error) {
+			break;
+		}
+
+		tracker_class_set_count (classes[i], count);
+
+		if (count > 0) {
+			tracker_db_interface_execute_query (iface, &internal_error,
+			                                    "INSERT INTO ClassCount (ID, Count) VALUES (%d, %d)",
+			                                    tracker_class_get_id (classes[i]), count);
+		}
+
+		if (busy_callback) {
+			busy_callback (busy_status,
+			               (gdouble) ((gdouble) i / (gdouble) n_classes),
+			               busy_user_data);
+		}
+	}
+
+	if (internal_error) {
+		tracker_db_interface_execute_query (iface, NULL, "ROLLBACK");
+		g_propagate_error (error, internal_error);
+		return;
+	}
+
+	tracker_db_interface_end_db_transaction (iface, &internal_error);
+
+	if (internal_error) {
+		g_propagate_error (error, internal_error);
+		return;
+	}
+
+	g_debug ("  Finished class count rebuild");
+}
+
 gboolean
 tracker_data_manager_reload (TrackerBusyCallback   busy_callback,
                              gpointer              busy_user_data,
@@ -3551,8 +4247,7 @@ tracker_data_manager_reload (TrackerBusyCallback   busy_callback,
 }
 
 static void
-write_ontologies_gvdb (gboolean   overwrite,
-                       GError   **error)
+write_ontologies_gvdb (GError **error)
 {
 	gchar *filename;
 
@@ -3561,9 +4256,7 @@ write_ontologies_gvdb (gboolean   overwrite,
 	                             "ontologies.gvdb",
 	                             NULL);
 
-	if (overwrite || !g_file_test (filename, G_FILE_TEST_EXISTS)) {
-		tracker_ontologies_write_gvdb (filename, error);
-	}
+	tracker_ontologies_write_gvdb (filename, error);
 
 	g_free (filename);
 }
@@ -3604,7 +4297,7 @@ tracker_data_manager_init (TrackerDBManagerFlags   flags,
 	GList *sorted = NULL, *l;
 	const gchar *env_path;
 	gint max_id = 0;
-	gboolean read_only;
+	gboolean read_only, loaded_gvdb = FALSE;
 	GHashTable *uri_id_map = NULL;
 	gchar *busy_status;
 	GError *internal_error = NULL;
@@ -3928,8 +4621,6 @@ tracker_data_manager_init (TrackerDBManagerFlags   flags,
 			return FALSE;
 		}
 
-		write_ontologies_gvdb (TRUE /* overwrite */, NULL);
-
 		g_list_foreach (sorted, (GFunc) g_free, NULL);
 		g_list_free (sorted);
 		sorted = NULL;
@@ -3965,8 +4656,6 @@ tracker_data_manager_init (TrackerDBManagerFlags   flags,
 				return FALSE;
 			}
 
-			write_ontologies_gvdb (FALSE /* overwrite */, NULL);
-
 			/* Skipped in the read-only case as it can't work with direct access and
 			   it reduces initialization time */
 			clean_decomposed_transient_metadata (iface);
@@ -3976,9 +4665,11 @@ tracker_data_manager_init (TrackerDBManagerFlags   flags,
 			load_ontologies_gvdb (&gvdb_error);
 			check_ontology = FALSE;
 
-			if (gvdb_error) {
-				g_critical ("Error loading ontology cache: %s",
-				            gvdb_error->message);
+			if (!gvdb_error) {
+				loaded_gvdb = TRUE;
+			} else {
+				g_message ("Could not load ontology cache: %s",
+				           gvdb_error->message);
 				g_clear_error (&gvdb_error);
 
 				/* fall back to loading ontology from database into memory */
@@ -4393,8 +5084,6 @@ tracker_data_manager_init (TrackerDBManagerFlags   flags,
 			g_list_free (to_reload);
 
 			tracker_data_ontology_process_changes_post_import (seen_classes, seen_properties);
-
-			write_ontologies_gvdb (TRUE /* overwrite */, NULL);
 		}
 
 		tracker_data_ontology_free_seen (seen_classes);
@@ -4510,6 +5199,11 @@ tracker_data_manager_init (TrackerDBManagerFlags   flags,
 		                                       &internal_error);
 		g_free (busy_status);
 
+		if (!internal_error) {
+			/* Stored sort keys depend on the locale as well */
+			update_collation_keys (iface, NULL, &internal_error);
+		}
+
 		if (internal_error) {
 			g_propagate_error (error, internal_error);
 
@@ -4529,8 +5223,58 @@ tracker_data_manager_init (TrackerDBManagerFlags   flags,
 		tracker_db_manager_set_current_locale ();
 	}
 
+	/* Load persisted class counts, a rebuild is only needed for databases
+	 * created before they were kept up to date on every commit */
+	if (!load_class_counts (iface, &internal_error) ||
+	    !tracker_data_manager_check_class_counts ()) {
+		if (internal_error) {
+			g_debug ("Could not load class counts: %s", internal_error->message);
+			g_clear_error (&internal_error);
+		}
+
+		if (!read_only) {
+			/* Report OPERATION - STATUS */
+			busy_status = g_strdup_printf ("%s - %s",
+			                               busy_operation,
+			                               "Counting resources");
+
+			tracker_data_manager_rebuild_class_counts (busy_callback,
+			                                           busy_user_data,
+			                                           busy_status,
+			                                           &internal_error);
+			g_free (busy_status);
+
+			if (internal_error) {
+				/* Not fatal, statistics will just be inaccurate */
+				g_critical ("Could not rebuild class counts: %s", internal_error->message);
+				g_clear_error (&internal_error);
+			}
+
+			/* All tables were just scanned anyway, refresh the
+			 * index statistics used for query planning */
+			tracker_db_interface_execute_query (iface, &internal_error, "ANALYZE");
+
+			if (internal_error) {
+				g_debug ("Could not analyze database: %s", internal_error->message);
+				g_clear_error (&internal_error);
+			}
+		}
+	}
+
+	/* The ontology cache carries the statistics, loading them here
+	 * would create every property of the lazily loaded ontology */
+	if (!loaded_gvdb && !load_property_stats (iface, &internal_error)) {
+		/* Not fatal, queries are planned with default estimates */
+		g_debug ("Could not load property statistics: %s", internal_error->message);
+		g_clear_error (&internal_error);
+	}
+
 	if (!read_only) {
 		tracker_ontologies_sort ();
+
+		/* Rewritten on every start so read-only clients see the
+		 * current ontology and statistics */
+		write_ontologies_gvdb (NULL);
 	}
 
 	initialized = TRUE;
@@ -62,6 +62,11 @@ gboolean tracker_data_manager_reload                 (TrackerBusyCallback     bu
                                                       gpointer                busy_user_data,
                                                       const gchar            *busy_operation,
                                                       GError                **error);
+gboolean tracker_data_manager_check_class_counts     (void);
+void     tracker_data_manager_rebuild_class_counts   (TrackerBusyCallback     busy_callback,
+                                                      gpointer                busy_user_data,
+                                                      const gchar            *busy_status,
+                                                      GError                **error);
 
 G_END_DECLS
 
@@ -33,6 +33,252 @@
 #include "tracker-ontologies.h"
 #include "tracker-sparql-query.h"
 
+/* Number of resources kept in each of the caches */
+#define RESOURCE_CACHE_SIZE 10000
+
+typedef struct {
+	gpointer key;
+	gpointer value;
+} CacheEntry;
+
+typedef struct {
+	/* key -> GList link in queue */
+	GHashTable *links;
+	/* CacheEntry, most recently used first */
+	GQueue queue;
+	GDestroyNotify key_destroy;
+	GDestroyNotify value_destroy;
+} Cache;
+
+/* URI -> ID and ID -> rdf:type caches, kept across transactions and
+ * shared by the update and query paths. They only ever hold committed
+ * data: the update path publishes what a transaction wrote once it is
+ * committed, and lookups done by the thread running the transaction
+ * don't fill them as that connection also sees uncommitted rows.
+ */
+static Cache *resource_ids = NULL;
+static Cache *rdf_types = NULL;
+static GThread *transaction_thread = NULL;
+G_LOCK_DEFINE_STATIC (caches);
+
+static Cache *
+cache_new (GHashFunc      hash_func,
+           GEqualFunc     equal_func,
+           GDestroyNotify key_destroy,
+           GDestroyNotify value_destroy)
+{
+	Cache *cache;
+
+	cache = g_slice_new0 (Cache);
+	cache->links = g_hash_table_new (hash_func, equal_func);
+	g_queue_init (&cache->queue);
+	cache->key_destroy = key_destroy;
+	cache->value_destroy = value_destroy;
+
+	return cache;
+}
+
+static void
+cache_entry_free (Cache      *cache,
+                  CacheEntry *entry)
+{
+	if (cache->key_destroy) {
+		cache->key_destroy (entry->key);
+	}
+
+	if (cache->value_destroy) {
+		cache->value_destroy (entry->value);
+	}
+
+	g_slice_free (CacheEntry, entry);
+}
+
+static gboolean
+cache_lookup (Cache         *cache,
+              gconstpointer  key,
+              gpointer      *value)
+{
+	GList *link;
+
+	if (!cache) {
+		return FALSE;
+	}
+
+	link = g_hash_table_lookup (cache->links, key);
+
+	if (!link) {
+		return FALSE;
+	}
+
+	g_queue_unlink (&cache->queue, link);
+	g_queue_push_head_link (&cache->queue, link);
+
+	*value = ((CacheEntry *) link->data)->value;
+
+	return TRUE;
+}
+
+static void
+cache_remove (Cache         *cache,
+              gconstpointer  key)
+{
+	CacheEntry *entry;
+	GList *link;
+
+	if (!cache) {
+		return;
+	}
+
+	link = g_hash_table_lookup (cache->links, key);
+
+	if (!link) {
+		return;
+	}
+
+	entry = link->data;
+	g_hash_table_remove (cache->links, key);
+	g_queue_delete_link (&cache->queue, link);
+	cache_entry_free (cache, entry);
+}
+
+static void
+cache_insert (Cache    *cache,
+              gpointer  key,
+              gpointer  value)
+{
+	CacheEntry *entry;
+
+	cache_remove (cache, key);
+
+	if (g_queue_get_length (&cache->queue) >= RESOURCE_CACHE_SIZE) {
+		/* evict least recently used entry */
+		entry = g_queue_pop_tail (&cache->queue);
+		g_hash_table_remove (cache->links, entry->key);
+		cache_entry_free (cache, entry);
+	}
+
+	entry = g_slice_new (CacheEntry);
+	entry->key = key;
+	entry->value = value;
+
+	g_queue_push_head (&cache->queue, entry);
+	g_hash_table_insert (cache->links, entry->key, cache->queue.head);
+}
+
+static void
+cache_free (Cache *cache)
+{
+	CacheEntry *entry;
+
+	if (!cache) {
+		return;
+	}
+
+	while ((entry = g_queue_pop_head (&cache->queue)) != NULL) {
+		cache_entry_free (cache, entry);
+	}
+
+	g_hash_table_unref (cache->links);
+	g_slice_free (Cache, cache);
+}
+
+static void
+rdf_types_free (GPtrArray *types)
+{
+	g_ptr_array_free (types, TRUE);
+}
+
+static GPtrArray *
+rdf_types_copy (GPtrArray *types)
+{
+	GPtrArray *copy;
+	guint i;
+
+	copy = g_ptr_array_sized_new (MAX (types->len, 20));
+	for (i = 0; i < types->len; i++) {
+		g_ptr_array_add (copy, g_ptr_array_index (types, i));
+	}
+
+	return copy;
+}
+
+static void
+cache_resource_id (const gchar *uri,
+                   gint         id)
+{
+	if (!resource_ids) {
+		resource_ids = cache_new (g_str_hash, g_str_equal, g_free, NULL);
+	}
+
+	cache_insert (resource_ids, g_strdup (uri), GINT_TO_POINTER (id));
+}
+
+static void
+cache_rdf_type (gint       id,
+                GPtrArray *types)
+{
+	if (!rdf_types) {
+		rdf_types = cache_new (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) rdf_types_free);
+	}
+
+	cache_insert (rdf_types, GINT_TO_POINTER (id), rdf_types_copy (types));
+}
+
+void
+tracker_data_query_cache_resource_id (const gchar *uri,
+                                      gint         id)
+{
+	g_return_if_fail (uri != NULL);
+	g_return_if_fail (id > 0);
+
+	G_LOCK (caches);
+	cache_resource_id (uri, id);
+	G_UNLOCK (caches);
+}
+
+void
+tracker_data_query_cache_rdf_type (gint       id,
+                                   GPtrArray *types)
+{
+	g_return_if_fail (types != NULL);
+
+	G_LOCK (caches);
+	cache_rdf_type (id, types);
+	G_UNLOCK (caches);
+}
+
+/* Lookups from the calling thread won't fill the caches until
+ * tracker_data_query_end_transaction() */
+void
+tracker_data_query_begin_transaction (void)
+{
+	G_LOCK (caches);
+	transaction_thread = g_thread_self ();
+	G_UNLOCK (caches);
+}
+
+void
+tracker_data_query_end_transaction (void)
+{
+	G_LOCK (caches);
+	transaction_thread = NULL;
+	G_UNLOCK (caches);
+}
+
+void
+tracker_data_query_clear_cache (void)
+{
+	G_LOCK (caches);
+
+	cache_free (resource_ids);
+	resource_ids = NULL;
+
+	cache_free (rdf_types);
+	rdf_types = NULL;
+
+	G_UNLOCK (caches);
+}
+
 GPtrArray*
 tracker_data_query_rdf_type (gint id)
 {
@@ -41,6 +287,17 @@ tracker_data_query_rdf_type (gint id)
 	TrackerDBStatement *stmt;
 	GPtrArray *ret = NULL;
 	GError *error = NULL;
+	gpointer cached;
+
+	G_LOCK (caches);
+	if (cache_lookup (rdf_types, GINT_TO_POINTER (id), &cached)) {
+		ret = rdf_types_copy (cached);
+	}
+	G_UNLOCK (caches);
+
+	if (ret) {
+		return ret;
+	}
 
 	iface = tracker_db_manager_get_db_interface ();
 
@@ -87,6 +344,14 @@ tracker_data_query_rdf_type (gint id)
 		}
 	}
 
+	if (ret) {
+		G_LOCK (caches);
+		if (transaction_thread != g_thread_self ()) {
+			cache_rdf_type (id, ret);
+		}
+		G_UNLOCK (caches);
+	}
+
 	return ret;
 }
 
@@ -97,10 +362,21 @@ tracker_data_query_resource_id (const gchar *uri)
 	TrackerDBInterface *iface;
 	TrackerDBStatement *stmt;
 	GError *error = NULL;
+	gpointer cached;
 	gint id = 0;
 
 	g_return_val_if_fail (uri != NULL, 0);
 
+	G_LOCK (caches);
+	if (cache_lookup (resource_ids, uri, &cached)) {
+		id = GPOINTER_TO_INT (cached);
+	}
+	G_UNLOCK (caches);
+
+	if (id) {
+		return id;
+	}
+
 	iface = tracker_db_manager_get_db_interface ();
 
 	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_SELECT, &error,
@@ -125,6 +401,14 @@ tracker_data_query_resource_id (const gchar *uri)
 		g_error_free (error);
 	}
 
+	if (id) {
+		G_LOCK (caches);
+		if (transaction_thread != g_thread_self ()) {
+			cache_resource_id (uri, id);
+		}
+		G_UNLOCK (caches);
+	}
+
 	return id;
 }
 
@@ -147,3 +431,20 @@ tracker_data_query_sparql_cursor (const gchar  *query,
 	return cursor;
 }
 
+gchar *
+tracker_data_query_explain (const gchar  *query,
+                            GError      **error)
+{
+	TrackerSparqlQuery *sparql_query;
+	gchar *plan;
+
+	g_return_val_if_fail (query != NULL, NULL);
+
+	sparql_query = tracker_sparql_query_new (query);
+
+	plan = tracker_sparql_query_explain (sparql_query, error);
+
+	g_object_unref (sparql_query);
+
+	return plan;
+}
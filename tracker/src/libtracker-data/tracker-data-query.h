@@ -36,9 +36,19 @@ G_BEGIN_DECLS
 gint                 tracker_data_query_resource_id   (const gchar  *uri);
 TrackerDBCursor     *tracker_data_query_sparql_cursor (const gchar  *query,
                                                        GError      **error);
+gchar               *tracker_data_query_explain       (const gchar  *query,
+                                                       GError      **error);
 
 GPtrArray*           tracker_data_query_rdf_type      (gint          id);
 
+void                 tracker_data_query_cache_resource_id   (const gchar *uri,
+                                                             gint         id);
+void                 tracker_data_query_cache_rdf_type      (gint         id,
+                                                             GPtrArray   *types);
+void                 tracker_data_query_clear_cache         (void);
+void                 tracker_data_query_begin_transaction   (void);
+void                 tracker_data_query_end_transaction     (void);
+
 G_END_DECLS
 
 #endif /* __LIBTRACKER_DATA_QUERY_H__ */
@@ -25,6 +25,8 @@
 #include <math.h>
 #include <time.h>
 
+#include <uuid/uuid.h>
+
 #include <libtracker-common/tracker-date-time.h>
 #include <libtracker-common/tracker-file-utils.h>
 #include <libtracker-common/tracker-ontologies.h>
@@ -41,6 +43,7 @@
 #include "tracker-ontologies.h"
 #include "tracker-property.h"
 #include "tracker-sparql-query.h"
+#include "tracker-trigram.h"
 
 #define RDF_PREFIX TRACKER_RDF_PREFIX
 #define RDFS_PREFIX TRACKER_RDFS_PREFIX
@@ -61,8 +64,11 @@ typedef struct _TrackerStatementDelegate TrackerStatementDelegate;
 typedef struct _TrackerCommitDelegate TrackerCommitDelegate;
 
 struct _TrackerDataUpdateBuffer {
-	/* string -> integer */
+	/* string -> integer, resources created in this transaction */
 	GHashTable *resource_cache;
+	/* integer -> GPtrArray, rdf:type of resources updated in this
+	 * transaction, published to the query caches on commit */
+	GHashTable *rdf_types_cached;
 	/* string -> TrackerDataUpdateBufferResource */
 	GHashTable *resources;
 	/* integer -> TrackerDataUpdateBufferResource */
@@ -91,6 +97,8 @@ struct _TrackerDataUpdateBufferResource {
 
 #if HAVE_TRACKER_FTS
 	gboolean fts_updated;
+	/* TrackerProperty -> indexed text before the update */
+	GHashTable *fts_old_texts;
 #endif
 };
 
@@ -99,6 +107,8 @@ struct _TrackerDataUpdateBufferProperty {
 	GValue value;
 	gint graph;
 	gboolean date_time : 1;
+	gboolean collation_key : 1;
+	gboolean trigram_indexed : 1;
 
 #if HAVE_TRACKER_FTS
 	gboolean fts : 1;
@@ -163,6 +173,8 @@ static GPtrArray *commit_callbacks = NULL;
 static GPtrArray *rollback_callbacks = NULL;
 static gint max_service_id = 0;
 static gint max_ontology_id = 0;
+/* TrackerClass -> GPtrArray of single-valued TrackerProperty */
+static GHashTable *class_table_properties = NULL;
 
 static gint         ensure_resource_id         (const gchar      *uri,
                                                 gboolean         *create);
@@ -173,9 +185,14 @@ static void         cache_insert_value         (const gchar      *table_name,
                                                 gint              graph,
                                                 gboolean          multiple_values,
                                                 gboolean          fts,
-                                                gboolean          date_time);
+                                                gboolean          date_time,
+                                                gboolean          collation_key,
+                                                gboolean          trigram_indexed);
 static GValueArray *get_old_property_values    (TrackerProperty  *property,
                                                 GError          **error);
+#if HAVE_TRACKER_FTS
+static void         resource_buffer_fts_update_delta (TrackerDBInterface *iface);
+#endif
 static gchar*       gvalue_to_string           (TrackerPropertyType  type,
                                                 GValue           *gvalue);
 static gboolean     delete_metadata_decomposed (TrackerProperty  *property,
@@ -468,6 +485,13 @@ tracker_data_update_shutdown (void)
 	max_service_id = 0;
 	max_ontology_id = 0;
 	transaction_modseq = 0;
+
+	if (class_table_properties) {
+		g_hash_table_unref (class_table_properties);
+		class_table_properties = NULL;
+	}
+
+	tracker_data_query_clear_cache ();
 }
 
 static gint
@@ -530,7 +554,7 @@ cache_ensure_table (const gchar *table_name,
 		g_value_set_int64 (&gvalue, get_transaction_modseq ());
 		cache_insert_value ("rdfs:Resource", "tracker:modified", TRUE, &gvalue,
 		                    0,
-		                    FALSE, FALSE, FALSE);
+		                    FALSE, FALSE, FALSE, FALSE, FALSE);
 	}
 
 	table = g_hash_table_lookup (resource_buffer->tables, table_name);
@@ -561,7 +585,9 @@ cache_insert_value (const gchar            *table_name,
                     gint                    graph,
                     gboolean                multiple_values,
                     gboolean                fts,
-                    gboolean                date_time)
+                    gboolean                date_time,
+                    gboolean                collation_key,
+                    gboolean                trigram_indexed)
 {
 	TrackerDataUpdateBufferTable    *table;
 	TrackerDataUpdateBufferProperty  property;
@@ -576,6 +602,8 @@ cache_insert_value (const gchar            *table_name,
 	property.fts = fts;
 #endif
 	property.date_time = date_time;
+	property.collation_key = collation_key;
+	property.trigram_indexed = trigram_indexed;
 
 	table = cache_ensure_table (table_name, multiple_values, transient);
 	g_array_append_val (table->properties, property);
@@ -598,7 +626,8 @@ cache_delete_value (const gchar            *table_name,
                     GValue                 *value,
                     gboolean                multiple_values,
                     gboolean                fts,
-                    gboolean                date_time)
+                    gboolean                date_time,
+                    gboolean                collation_key)
 {
 	TrackerDataUpdateBufferTable    *table;
 	TrackerDataUpdateBufferProperty  property;
@@ -610,6 +639,9 @@ cache_delete_value (const gchar            *table_name,
 	property.fts = fts;
 #endif
 	property.date_time = date_time;
+	property.collation_key = collation_key;
+	/* the trigrams are deleted by a trigger */
+	property.trigram_indexed = FALSE;
 
 	table = cache_ensure_table (table_name, multiple_values, transient);
 	table->delete_value = TRUE;
@@ -625,10 +657,6 @@ query_resource_id (const gchar *uri)
 
 	if (id == 0) {
 		id = tracker_data_query_resource_id (uri);
-
-		if (id) {
-			g_hash_table_insert (update_buffer.resource_cache, g_strdup (uri), GINT_TO_POINTER (id));
-		}
 	}
 
 	return id;
@@ -728,6 +756,66 @@ add_class_count (TrackerClass *class,
 	                     GINT_TO_POINTER (old_count_entry + count));
 }
 
+static void
+class_counts_flush (GError **error)
+{
+	TrackerDBInterface *iface;
+	GHashTableIter iter;
+	TrackerClass *class;
+	gpointer count_ptr;
+
+	if (!update_buffer.class_counts) {
+		return;
+	}
+
+	iface = tracker_db_manager_get_db_interface ();
+
+	/* persist the new absolute counts in the same sqlite transaction
+	   so that they can never diverge from the class tables */
+	g_hash_table_iter_init (&iter, update_buffer.class_counts);
+	while (g_hash_table_iter_next (&iter, (gpointer*) &class, &count_ptr)) {
+		TrackerDBStatement *stmt;
+		GError *actual_error = NULL;
+
+		if (GPOINTER_TO_INT (count_ptr) == 0) {
+			/* inserts and deletes cancelled each other out */
+			continue;
+		}
+
+		stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &actual_error,
+		                                              "INSERT OR REPLACE INTO ClassCount (ID, Count) VALUES (?, ?)");
+
+		if (stmt) {
+			tracker_db_statement_bind_int (stmt, 0, tracker_class_get_id (class));
+			tracker_db_statement_bind_int (stmt, 1, tracker_class_get_count (class));
+			tracker_db_statement_execute (stmt, &actual_error);
+			g_object_unref (stmt);
+		}
+
+		if (actual_error) {
+			g_propagate_error (error, actual_error);
+			return;
+		}
+	}
+}
+
+#if HAVE_TRACKER_FTS
+static gchar *
+fts_values_to_text (GValueArray *values)
+{
+	GString *fts;
+	guint i;
+
+	fts = g_string_new ("");
+	for (i = 0; i < values->n_values; i++) {
+		g_string_append (fts, g_value_get_string (g_value_array_get_nth (values, i)));
+		g_string_append_c (fts, ' ');
+	}
+
+	return g_string_free (fts, FALSE);
+}
+#endif
+
 static void
 tracker_data_resource_buffer_flush (GError **error)
 {
@@ -742,6 +830,21 @@ tracker_data_resource_buffer_flush (GError **error)
 
 	iface = tracker_db_manager_get_db_interface ();
 
+	if (!in_ontology_transaction && resource_buffer->types) {
+		GPtrArray *types;
+
+		/* spare the rdf:type query when the resource is updated
+		   again in a later transaction */
+		types = g_ptr_array_sized_new (resource_buffer->types->len);
+		for (i = 0; i < resource_buffer->types->len; i++) {
+			g_ptr_array_add (types, g_ptr_array_index (resource_buffer->types, i));
+		}
+
+		g_hash_table_insert (update_buffer.rdf_types_cached,
+		                     GINT_TO_POINTER (resource_buffer->id),
+		                     types);
+	}
+
 	g_hash_table_iter_init (&iter, resource_buffer->tables);
 	while (g_hash_table_iter_next (&iter, (gpointer*) &table_name, (gpointer*) &table)) {
 		if (table->multiple_values) {
@@ -870,6 +973,11 @@ tracker_data_resource_buffer_flush (GError **error)
 						g_string_append (values_sql, ", ?, ?");
 					}
 
+					if (property->collation_key) {
+						g_string_append_printf (sql, ", \"%s:collationKey\"", property->name);
+						g_string_append (values_sql, ", SparqlCollationKey (?)");
+					}
+
 					g_string_append_printf (sql, ", \"%s:graph\"", property->name);
 					g_string_append (values_sql, ", ?");
 				} else {
@@ -883,6 +991,10 @@ tracker_data_resource_buffer_flush (GError **error)
 						g_string_append_printf (sql, ", \"%s:localTime\" = ?", property->name);
 					}
 
+					if (property->collation_key) {
+						g_string_append_printf (sql, ", \"%s:collationKey\" = SparqlCollationKey (?)", property->name);
+					}
+
 					g_string_append_printf (sql, ", \"%s:graph\" = ?", property->name);
 				}
 			}
@@ -933,8 +1045,15 @@ tracker_data_resource_buffer_flush (GError **error)
 						tracker_db_statement_bind_null (stmt, param++);
 						tracker_db_statement_bind_null (stmt, param++);
 					}
+					if (property->collation_key) {
+						tracker_db_statement_bind_null (stmt, param++);
+					}
 				} else {
 					statement_bind_gvalue (stmt, &param, &property->value);
+					if (property->collation_key) {
+						/* the key is computed from the value in SQLite */
+						tracker_db_statement_bind_text (stmt, param++, g_value_get_string (&property->value));
+					}
 				}
 				if (property->graph != 0) {
 					tracker_db_statement_bind_int (stmt, param++, property->graph);
@@ -954,6 +1073,26 @@ tracker_data_resource_buffer_flush (GError **error)
 				g_propagate_error (error, actual_error);
 				return;
 			}
+
+			for (i = 0; i < table->properties->len; i++) {
+				gchar *trigram_table;
+
+				property = &g_array_index (table->properties, TrackerDataUpdateBufferProperty, i);
+				if (!property->trigram_indexed || table->delete_value) {
+					continue;
+				}
+
+				trigram_table = tracker_trigram_get_table_name (table_name, property->name);
+				tracker_trigram_insert (iface, trigram_table, resource_buffer->id,
+				                        g_value_get_string (&property->value),
+				                        &actual_error);
+				g_free (trigram_table);
+
+				if (actual_error) {
+					g_propagate_error (error, actual_error);
+					return;
+				}
+			}
 		}
 	}
 
@@ -964,22 +1103,24 @@ tracker_data_resource_buffer_flush (GError **error)
 
 		tracker_db_interface_sqlite_fts_update_init (iface, resource_buffer->id);
 
+		if (!resource_buffer->create) {
+			/* only update terms of changed properties */
+			resource_buffer_fts_update_delta (iface);
+			return;
+		}
+
 		g_hash_table_iter_init (&iter, resource_buffer->predicates);
 		while (g_hash_table_iter_next (&iter, (gpointer*) &prop, (gpointer*) &values)) {
 			if (tracker_property_get_fulltext_indexed (prop)) {
-				GString *fts;
+				gchar *fts;
 
-				fts = g_string_new ("");
-				for (i = 0; i < values->n_values; i++) {
-					g_string_append (fts, g_value_get_string (g_value_array_get_nth (values, i)));
-					g_string_append_c (fts, ' ');
-				}
+				fts = fts_values_to_text (values);
 				tracker_db_interface_sqlite_fts_update_text (iface,
 					resource_buffer->id,
 					tracker_data_query_resource_id (tracker_property_get_uri (prop)),
-					fts->str,
+					fts,
 					!tracker_property_get_fulltext_no_limit (prop));
-				g_string_free (fts, TRUE);
+				g_free (fts);
 
 				/* Set that we ever updated FTS, so that tracker_db_interface_sqlite_fts_update_commit()
 				 * gets called */
@@ -996,6 +1137,12 @@ static void resource_buffer_free (TrackerDataUpdateBufferResource *resource)
 	g_hash_table_unref (resource->tables);
 	resource->subject = NULL;
 
+#if HAVE_TRACKER_FTS
+	if (resource->fts_old_texts) {
+		g_hash_table_unref (resource->fts_old_texts);
+	}
+#endif
+
 	g_ptr_array_free (resource->types, TRUE);
 	resource->types = NULL;
 
@@ -1044,6 +1191,25 @@ tracker_data_update_buffer_might_flush (GError **error)
 	}
 }
 
+/* Makes what the committed transaction wrote visible to lookups
+ * from other threads */
+static void
+update_buffer_publish_caches (void)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_hash_table_iter_init (&iter, update_buffer.resource_cache);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		tracker_data_query_cache_resource_id (key, GPOINTER_TO_INT (value));
+	}
+
+	g_hash_table_iter_init (&iter, update_buffer.rdf_types_cached);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		tracker_data_query_cache_rdf_type (GPOINTER_TO_INT (key), value);
+	}
+}
+
 static void
 tracker_data_update_buffer_clear (void)
 {
@@ -1055,7 +1221,10 @@ tracker_data_update_buffer_clear (void)
 
 	g_hash_table_remove_all (update_buffer.resources);
 	g_hash_table_remove_all (update_buffer.resources_by_id);
+
+	/* nothing of the rolled back transaction was published */
 	g_hash_table_remove_all (update_buffer.resource_cache);
+	g_hash_table_remove_all (update_buffer.rdf_types_cached);
 	resource_buffer = NULL;
 
 #if HAVE_TRACKER_FTS
@@ -1194,7 +1363,7 @@ cache_create_service_decomposed (TrackerClass *cl,
 	g_value_set_int64 (&gvalue, class_id);
 	cache_insert_value ("rdfs:Resource_rdf:type", "rdf:type", FALSE, &gvalue,
 	                    final_graph_id,
-	                    TRUE, FALSE, FALSE);
+	                    TRUE, FALSE, FALSE, FALSE, FALSE);
 
 	add_class_count (cl, 1);
 
@@ -1259,7 +1428,9 @@ cache_create_service_decomposed (TrackerClass *cl,
 			                    graph != NULL ? ensure_resource_id (graph, NULL) : graph_id,
 			                    tracker_property_get_multiple_values (*domain_indexes),
 			                    tracker_property_get_fulltext_indexed (*domain_indexes),
-			                    tracker_property_get_data_type (*domain_indexes) == TRACKER_PROPERTY_TYPE_DATETIME);
+			                    tracker_property_get_data_type (*domain_indexes) == TRACKER_PROPERTY_TYPE_DATETIME,
+			                    FALSE,
+			                    FALSE);
 		}
 
 		domain_indexes++;
@@ -1351,6 +1522,173 @@ check_property_domain (TrackerProperty *property)
 	return FALSE;
 }
 
+static void
+append_property_value (TrackerProperty *property,
+                       GValueArray     *values,
+                       TrackerDBCursor *cursor,
+                       guint            column)
+{
+	GValue gvalue = { 0 };
+
+	tracker_db_cursor_get_value (cursor, column, &gvalue);
+	if (G_VALUE_TYPE (&gvalue)) {
+		if (tracker_property_get_data_type (property) == TRACKER_PROPERTY_TYPE_DATETIME) {
+			gdouble time;
+
+			if (G_VALUE_TYPE (&gvalue) == G_TYPE_INT64) {
+				time = g_value_get_int64 (&gvalue);
+			} else {
+				time = g_value_get_double (&gvalue);
+			}
+			g_value_unset (&gvalue);
+			g_value_init (&gvalue, TRACKER_TYPE_DATE_TIME);
+			/* UTC offset is irrelevant for comparison */
+			tracker_date_time_set (&gvalue, time, 0);
+		}
+		g_value_array_append (values, &gvalue);
+		g_value_unset (&gvalue);
+	}
+}
+
+static GPtrArray *
+get_class_table_properties (TrackerClass *class)
+{
+	GPtrArray *table_properties;
+
+	if (G_UNLIKELY (!class_table_properties)) {
+		class_table_properties = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+		                                                g_object_unref,
+		                                                (GDestroyNotify) g_ptr_array_unref);
+	}
+
+	table_properties = g_hash_table_lookup (class_table_properties, class);
+
+	if (!table_properties) {
+		TrackerProperty **properties;
+		guint i, n_props;
+
+		/* Single-valued properties are columns of the domain table */
+		table_properties = g_ptr_array_new ();
+		properties = tracker_ontologies_get_properties (&n_props);
+
+		for (i = 0; i < n_props; i++) {
+			if (tracker_property_get_domain (properties[i]) == class &&
+			    !tracker_property_get_multiple_values (properties[i])) {
+				g_ptr_array_add (table_properties, properties[i]);
+			}
+		}
+
+		g_hash_table_insert (class_table_properties, g_object_ref (class), table_properties);
+	}
+
+	return table_properties;
+}
+
+static GValueArray *
+get_table_property_values (TrackerProperty *property)
+{
+	TrackerDBInterface *iface;
+	TrackerDBStatement *stmt;
+	TrackerDBCursor    *cursor = NULL;
+	GPtrArray          *table_properties, *columns;
+	GValueArray        *old_values = NULL;
+	GString            *sql;
+	GError             *error = NULL;
+	guint               i;
+
+	/* Fetch the whole row of the class table at once, the values of
+	 * all its properties not yet in the resource buffer are kept there,
+	 * so modifying further properties of the same class doesn't need
+	 * additional queries.
+	 */
+	table_properties = get_class_table_properties (tracker_property_get_domain (property));
+
+	sql = g_string_new ("SELECT ");
+
+	for (i = 0; i < table_properties->len; i++) {
+		if (i > 0) {
+			g_string_append (sql, ", ");
+		}
+
+		g_string_append_printf (sql, "\"%s\"",
+		                        tracker_property_get_name (g_ptr_array_index (table_properties, i)));
+	}
+
+	g_string_append_printf (sql, " FROM \"%s\" WHERE ID = ?",
+	                        tracker_property_get_table_name (property));
+
+	/* Columns that get new values, properties already in the buffer
+	 * may have been modified, and values of fulltext indexed properties
+	 * are retrieved when updating the FTS index, see
+	 * get_old_property_values().
+	 */
+	columns = g_ptr_array_sized_new (table_properties->len);
+
+	for (i = 0; i < table_properties->len; i++) {
+		TrackerProperty *prop;
+		GValueArray *values = NULL;
+		gboolean fetch;
+
+		prop = g_ptr_array_index (table_properties, i);
+		fetch = (prop == property ||
+		         !g_hash_table_lookup (resource_buffer->predicates, prop));
+
+#if HAVE_TRACKER_FTS
+		if (prop != property && tracker_property_get_fulltext_indexed (prop)) {
+			fetch = FALSE;
+		}
+#endif
+
+		if (fetch) {
+			values = g_value_array_new (1);
+			g_hash_table_insert (resource_buffer->predicates, g_object_ref (prop), values);
+
+			if (prop == property) {
+				old_values = values;
+			}
+		}
+
+		g_ptr_array_add (columns, values);
+	}
+
+	iface = tracker_db_manager_get_db_interface ();
+
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_SELECT, &error,
+	                                              "%s", sql->str);
+	g_string_free (sql, TRUE);
+
+	if (stmt) {
+		tracker_db_statement_bind_int (stmt, 0, resource_buffer->id);
+		cursor = tracker_db_statement_start_cursor (stmt, &error);
+		g_object_unref (stmt);
+	}
+
+	if (error) {
+		g_warning ("Could not get property values: %s\n", error->message);
+		g_error_free (error);
+	}
+
+	if (cursor) {
+		while (tracker_db_cursor_iter_next (cursor, NULL, &error)) {
+			for (i = 0; i < columns->len; i++) {
+				GValueArray *values;
+
+				values = g_ptr_array_index (columns, i);
+
+				if (values) {
+					append_property_value (g_ptr_array_index (table_properties, i),
+					                       values, cursor, i);
+				}
+			}
+		}
+		g_object_unref (cursor);
+	}
+
+	g_ptr_array_free (columns, TRUE);
+
+	return old_values;
+}
+
 static GValueArray *
 get_property_values (TrackerProperty *property)
 {
@@ -1359,6 +1697,10 @@ get_property_values (TrackerProperty *property)
 
 	multiple_values = tracker_property_get_multiple_values (property);
 
+	if (!multiple_values && !resource_buffer->create && !in_ontology_transaction) {
+		return get_table_property_values (property);
+	}
+
 	old_values = g_value_array_new (multiple_values ? 4 : 1);
 	g_hash_table_insert (resource_buffer->predicates, g_object_ref (property), old_values);
 
@@ -1392,25 +1734,7 @@ get_property_values (TrackerProperty *property)
 
 		if (cursor) {
 			while (tracker_db_cursor_iter_next (cursor, NULL, &error)) {
-				GValue gvalue = { 0 };
-				tracker_db_cursor_get_value (cursor, 0, &gvalue);
-				if (G_VALUE_TYPE (&gvalue)) {
-					if (tracker_property_get_data_type (property) == TRACKER_PROPERTY_TYPE_DATETIME) {
-						gdouble time;
-
-						if (G_VALUE_TYPE (&gvalue) == G_TYPE_INT64) {
-							time = g_value_get_int64 (&gvalue);
-						} else {
-							time = g_value_get_double (&gvalue);
-						}
-						g_value_unset (&gvalue);
-						g_value_init (&gvalue, TRACKER_TYPE_DATE_TIME);
-						/* UTC offset is irrelevant for comparison */
-						tracker_date_time_set (&gvalue, time, 0);
-					}
-					g_value_array_append (old_values, &gvalue);
-					g_value_unset (&gvalue);
-				}
+				append_property_value (property, old_values, cursor, 0);
 			}
 			g_object_unref (cursor);
 		}
@@ -1437,61 +1761,109 @@ get_old_property_values (TrackerProperty  *property,
 			return NULL;
 		}
 
+		old_values = get_property_values (property);
+
 #if HAVE_TRACKER_FTS
 		if (tracker_property_get_fulltext_indexed (property)) {
-			TrackerDBInterface *iface;
+			if (!resource_buffer->create) {
+				/* keep the indexed text, the FTS index is
+				 * updated with the difference on flush
+				 */
+				if (!resource_buffer->fts_old_texts) {
+					resource_buffer->fts_old_texts =
+						g_hash_table_new_full (g_direct_hash, g_direct_equal,
+						                       g_object_unref, g_free);
+				}
 
-			iface = tracker_db_manager_get_db_interface ();
+				g_hash_table_insert (resource_buffer->fts_old_texts,
+				                     g_object_ref (property),
+				                     fts_values_to_text (old_values));
+			}
 
-			if (!resource_buffer->fts_updated && !resource_buffer->create) {
-				guint i, n_props;
-				TrackerProperty   **properties, *prop;
+			resource_buffer->fts_updated = TRUE;
+		}
+#endif
+	}
 
-				/* first fulltext indexed property to be modified
-				 * retrieve values of all fulltext indexed properties
-				 */
-				tracker_db_interface_sqlite_fts_update_init (iface, resource_buffer->id);
+	return old_values;
+}
+
+#if HAVE_TRACKER_FTS
+static void
+resource_buffer_fts_update_delta (TrackerDBInterface *iface)
+{
+	TrackerProperty **properties, *prop;
+	GHashTableIter iter;
+	GValueArray *values;
+	const gchar *old_text;
+	gboolean changed = FALSE;
+	guint i, n_props;
 
-				properties = tracker_ontologies_get_properties (&n_props);
+	if (!resource_buffer->fts_old_texts) {
+		return;
+	}
 
-				for (i = 0; i < n_props; i++) {
-					prop = properties[i];
+	g_hash_table_iter_init (&iter, resource_buffer->fts_old_texts);
+	while (g_hash_table_iter_next (&iter, (gpointer*) &prop, (gpointer*) &old_text)) {
+		gchar *text;
 
-					if (tracker_property_get_fulltext_indexed (prop)
-					    && check_property_domain (prop)) {
-						gint i;
+		values = g_hash_table_lookup (resource_buffer->predicates, prop);
+		text = fts_values_to_text (values);
 
-						old_values = get_property_values (prop);
+		if (strcmp (old_text, text) != 0) {
+			tracker_db_interface_sqlite_fts_update_delta_column (iface,
+				tracker_data_query_resource_id (tracker_property_get_uri (prop)),
+				old_text,
+				text,
+				!tracker_property_get_fulltext_no_limit (prop));
+			changed = TRUE;
+		}
 
-						/* delete old fts entries */
-						for (i = 0; i < old_values->n_values; i++) {
-							tracker_db_interface_sqlite_fts_update_text (iface,
-								resource_buffer->id,
-								-1,
-								g_value_get_string (g_value_array_get_nth (old_values, i)),
-								!tracker_property_get_fulltext_no_limit (prop));
-						}
-					}
-				}
+		g_free (text);
+	}
 
-				update_buffer.fts_ever_updated = TRUE;
+	if (!changed) {
+		return;
+	}
 
-				old_values = g_hash_table_lookup (resource_buffer->predicates, property);
-			} else {
-				old_values = get_property_values (property);
+	if (tracker_db_interface_sqlite_fts_update_delta_needs_text (iface)) {
+		/* Rewritten terms need their positions in the
+		 * other fulltext indexed properties too
+		 */
+		properties = tracker_ontologies_get_properties (&n_props);
+
+		for (i = 0; i < n_props; i++) {
+			gchar *text;
+
+			prop = properties[i];
+
+			if (!tracker_property_get_fulltext_indexed (prop) ||
+			    g_hash_table_lookup (resource_buffer->fts_old_texts, prop) ||
+			    !check_property_domain (prop)) {
+				continue;
 			}
 
-			resource_buffer->fts_updated = TRUE;
-		} else {
-			old_values = get_property_values (property);
+			values = g_hash_table_lookup (resource_buffer->predicates, prop);
+			if (!values) {
+				values = get_property_values (prop);
+			}
+
+			text = fts_values_to_text (values);
+			tracker_db_interface_sqlite_fts_update_delta_text (iface,
+				tracker_data_query_resource_id (tracker_property_get_uri (prop)),
+				text,
+				!tracker_property_get_fulltext_no_limit (prop));
+			g_free (text);
 		}
-#else
-		old_values = get_property_values (property);
-#endif
 	}
 
-	return old_values;
+	tracker_db_interface_sqlite_fts_update_delta_finish (iface, resource_buffer->id);
+
+	/* Set that we ever updated FTS, so that tracker_db_interface_sqlite_fts_update_commit()
+	 * gets called */
+	update_buffer.fts_ever_updated = TRUE;
 }
+#endif
 
 static void
 string_to_gvalue (const gchar         *value,
@@ -1617,7 +1989,9 @@ process_domain_indexes (TrackerProperty *property,
 			                    graph != NULL ? ensure_resource_id (graph, NULL) : graph_id,
 			                    FALSE,
 			                    tracker_property_get_fulltext_indexed (property),
-			                    tracker_property_get_data_type (property) == TRACKER_PROPERTY_TYPE_DATETIME);
+			                    tracker_property_get_data_type (property) == TRACKER_PROPERTY_TYPE_DATETIME,
+			                    FALSE,
+			                    FALSE);
 		}
 		domain_index_classes++;
 	}
@@ -1715,7 +2089,9 @@ cache_insert_metadata_decomposed (TrackerProperty  *property,
 		                    graph != NULL ? ensure_resource_id (graph, NULL) : graph_id,
 		                    multiple_values,
 		                    tracker_property_get_fulltext_indexed (property),
-		                    tracker_property_get_data_type (property) == TRACKER_PROPERTY_TYPE_DATETIME);
+		                    tracker_property_get_data_type (property) == TRACKER_PROPERTY_TYPE_DATETIME,
+		                    tracker_property_get_collation_key (property),
+		                    tracker_property_get_trigram_indexed (property));
 
 		if (!multiple_values) {
 			process_domain_indexes (property, &gvalue, field_name, graph, graph_id);
@@ -1920,7 +2296,9 @@ cache_update_metadata_decomposed (TrackerProperty  *property,
 	                    graph != NULL ? ensure_resource_id (graph, NULL) : graph_id,
 	                    multiple_values,
 	                    tracker_property_get_fulltext_indexed (property),
-	                    tracker_property_get_data_type (property) == TRACKER_PROPERTY_TYPE_DATETIME);
+	                    tracker_property_get_data_type (property) == TRACKER_PROPERTY_TYPE_DATETIME,
+	                    tracker_property_get_collation_key (property),
+	                    tracker_property_get_trigram_indexed (property));
 
 	if (!multiple_values) {
 		process_domain_indexes (property, &gvalue, field_name, graph, graph_id);
@@ -1975,7 +2353,8 @@ delete_metadata_decomposed (TrackerProperty  *property,
 		                    tracker_property_get_transient (property),
 		                    &gvalue, multiple_values,
 		                    tracker_property_get_fulltext_indexed (property),
-		                    tracker_property_get_data_type (property) == TRACKER_PROPERTY_TYPE_DATETIME);
+		                    tracker_property_get_data_type (property) == TRACKER_PROPERTY_TYPE_DATETIME,
+		                    tracker_property_get_collation_key (property));
 
 		if (!multiple_values) {
 			TrackerClass **domain_index_classes;
@@ -1992,7 +2371,8 @@ delete_metadata_decomposed (TrackerProperty  *property,
 					                    tracker_property_get_transient (property),
 					                    &gvalue_copy, multiple_values,
 					                    tracker_property_get_fulltext_indexed (property),
-					                    tracker_property_get_data_type (property) == TRACKER_PROPERTY_TYPE_DATETIME);
+					                    tracker_property_get_data_type (property) == TRACKER_PROPERTY_TYPE_DATETIME,
+					                    FALSE);
 				}
 				domain_index_classes++;
 			}
@@ -2149,6 +2529,8 @@ cache_delete_resource_type_full (TrackerClass *class,
 			if (multiple_values) {
 				db_delete_row (iface, table_name, resource_buffer->id);
 			}
+			/* values might have been prefetched with the class row */
+			g_hash_table_remove (resource_buffer->predicates, prop);
 			/* single-valued property values are deleted right after the loop by deleting the row in the class table */
 			continue;
 		}
@@ -2168,7 +2550,8 @@ cache_delete_resource_type_full (TrackerClass *class,
 			                    tracker_property_get_transient (prop),
 			                    &gvalue, multiple_values,
 			                    tracker_property_get_fulltext_indexed (prop),
-			                    tracker_property_get_data_type (prop) == TRACKER_PROPERTY_TYPE_DATETIME);
+			                    tracker_property_get_data_type (prop) == TRACKER_PROPERTY_TYPE_DATETIME,
+			                    tracker_property_get_collation_key (prop));
 
 
 			if (!multiple_values) {
@@ -2185,7 +2568,8 @@ cache_delete_resource_type_full (TrackerClass *class,
 						                    tracker_property_get_transient (prop),
 						                    &gvalue_copy, multiple_values,
 						                    tracker_property_get_fulltext_indexed (prop),
-						                    tracker_property_get_data_type (prop) == TRACKER_PROPERTY_TYPE_DATETIME);
+						                    tracker_property_get_data_type (prop) == TRACKER_PROPERTY_TYPE_DATETIME,
+						                    FALSE);
 					}
 					domain_index_classes++;
 				}
@@ -3261,6 +3645,7 @@ tracker_data_begin_transaction (GError **error)
 
 	if (update_buffer.resource_cache == NULL) {
 		update_buffer.resource_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+		update_buffer.rdf_types_cached = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) g_ptr_array_unref);
 		/* used for normal transactions */
 		update_buffer.resources = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) resource_buffer_free);
 		/* used for journal replay */
@@ -3299,12 +3684,21 @@ tracker_data_begin_transaction (GError **error)
 
 	iface = tracker_db_manager_get_db_interface ();
 
+	tracker_data_query_begin_transaction ();
 	in_transaction = TRUE;
 }
 
 void
 tracker_data_begin_ontology_transaction (GError **error)
 {
+	/* The set of properties of classes may change */
+	if (class_table_properties) {
+		g_hash_table_remove_all (class_table_properties);
+	}
+
+	/* and so may the classes of resources */
+	tracker_data_query_clear_cache ();
+
 	in_ontology_transaction = TRUE;
 	tracker_data_begin_transaction (error);
 }
@@ -3334,6 +3728,13 @@ tracker_data_commit_transaction (GError **error)
 		return;
 	}
 
+	class_counts_flush (&actual_error);
+	if (actual_error) {
+		tracker_data_rollback_transaction ();
+		g_propagate_error (error, actual_error);
+		return;
+	}
+
 	tracker_db_interface_end_db_transaction (iface,
 	                                         &actual_error);
 
@@ -3369,7 +3770,15 @@ tracker_data_commit_transaction (GError **error)
 
 	resource_time = 0;
 	in_transaction = FALSE;
-	in_ontology_transaction = FALSE;
+	tracker_data_query_end_transaction ();
+
+	if (in_ontology_transaction) {
+		/* drop rdf:type of resources read in the middle of ontology changes */
+		tracker_data_query_clear_cache ();
+		in_ontology_transaction = FALSE;
+	} else {
+		update_buffer_publish_caches ();
+	}
 
 	if (update_buffer.class_counts) {
 		/* successful transaction, no need to rollback class counts,
@@ -3389,6 +3798,7 @@ tracker_data_commit_transaction (GError **error)
 	g_hash_table_remove_all (update_buffer.resources);
 	g_hash_table_remove_all (update_buffer.resources_by_id);
 	g_hash_table_remove_all (update_buffer.resource_cache);
+	g_hash_table_remove_all (update_buffer.rdf_types_cached);
 
 	in_journal_replay = FALSE;
 }
@@ -3415,7 +3825,12 @@ tracker_data_rollback_transaction (void)
 	g_return_if_fail (in_transaction);
 
 	in_transaction = FALSE;
-	in_ontology_transaction = FALSE;
+	tracker_data_query_end_transaction ();
+
+	if (in_ontology_transaction) {
+		tracker_data_query_clear_cache ();
+		in_ontology_transaction = FALSE;
+	}
 
 	iface = tracker_db_manager_get_db_interface ();
 
@@ -3506,6 +3921,234 @@ tracker_data_update_sparql_blank (const gchar  *update,
 	return update_sparql (update, TRUE, error);
 }
 
+static gchar *
+expand_triple_iri (const gchar *iri)
+{
+	TrackerNamespace **namespaces;
+	const gchar *colon;
+	guint i, n_namespaces;
+
+	if (iri[0] == '<') {
+		gsize len = strlen (iri);
+
+		return g_strndup (iri + 1, len >= 2 ? len - 2 : 0);
+	}
+
+	if (strcmp (iri, "a") == 0) {
+		return g_strdup (RDF_PREFIX "type");
+	}
+
+	colon = strchr (iri, ':');
+
+	if (colon && colon != iri) {
+		/* Prefixed name */
+		namespaces = tracker_ontologies_get_namespaces (&n_namespaces);
+
+		for (i = 0; i < n_namespaces; i++) {
+			const gchar *prefix;
+
+			prefix = tracker_namespace_get_prefix (namespaces[i]);
+
+			if (strncmp (prefix, iri, colon - iri) == 0 &&
+			    prefix[colon - iri] == '\0') {
+				return g_strconcat (tracker_namespace_get_uri (namespaces[i]),
+				                    colon + 1, NULL);
+			}
+		}
+	}
+
+	return g_strdup (iri);
+}
+
+/* Anonymous blank nodes (":1", ":2"...) are numbered per builder,
+ * each of them is a new resource.
+ */
+static gchar *
+expand_anonymous_blank_node (GHashTable  *anonymous_nodes,
+                             const gchar *name)
+{
+	gchar *uri;
+
+	uri = g_hash_table_lookup (anonymous_nodes, name);
+
+	if (!uri) {
+		uuid_t base_uuid;
+		gchar uuid_str[37];
+
+		uuid_generate (base_uuid);
+		uuid_unparse_lower (base_uuid, uuid_str);
+
+		uri = g_strconcat ("urn:uuid:", uuid_str, NULL);
+		g_hash_table_insert (anonymous_nodes, g_strdup (name), uri);
+	}
+
+	return g_strdup (uri);
+}
+
+static gchar *
+lookup_blank_node (GVariant    *blank_nodes,
+                   const gchar *name)
+{
+	GVariantIter iter, solutions;
+	GVariant *operation, *solution;
+	gchar *urn = NULL;
+
+	if (!blank_nodes) {
+		return NULL;
+	}
+
+	/* aaa{ss}, per operation, per solution */
+	g_variant_iter_init (&iter, blank_nodes);
+
+	while (!urn && (operation = g_variant_iter_next_value (&iter)) != NULL) {
+		g_variant_iter_init (&solutions, operation);
+
+		while (!urn && (solution = g_variant_iter_next_value (&solutions)) != NULL) {
+			g_variant_lookup (solution, name, "s", &urn);
+			g_variant_unref (solution);
+		}
+
+		g_variant_unref (operation);
+	}
+
+	return urn;
+}
+
+static void
+insert_triples (GVariant  *triples,
+                GVariant  *blank_nodes,
+                GError   **error)
+{
+	GVariantIter iter;
+	GHashTable *anonymous_nodes;
+	const gchar *graph, *subject, *predicate, *object;
+	gboolean object_is_iri;
+
+	anonymous_nodes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	g_variant_iter_init (&iter, triples);
+
+	while (g_variant_iter_next (&iter, "(&s&s&s&sb)",
+	                            &graph, &subject, &predicate, &object, &object_is_iri)) {
+		gchar *subject_uri, *predicate_uri;
+		GError *actual_error = NULL;
+
+		if (g_str_has_prefix (subject, "_:")) {
+			/* Named blank node of the update */
+			subject_uri = lookup_blank_node (blank_nodes, subject + 2);
+
+			if (!subject_uri) {
+				continue;
+			}
+		} else if (subject[0] == ':') {
+			subject_uri = expand_anonymous_blank_node (anonymous_nodes, subject);
+		} else {
+			subject_uri = expand_triple_iri (subject);
+		}
+
+		predicate_uri = expand_triple_iri (predicate);
+
+		if (object_is_iri) {
+			gchar *object_uri;
+
+			if (object[0] == ':') {
+				object_uri = expand_anonymous_blank_node (anonymous_nodes, object);
+			} else {
+				object_uri = expand_triple_iri (object);
+			}
+
+			tracker_data_insert_statement_with_uri (*graph ? graph : NULL,
+			                                        subject_uri, predicate_uri, object_uri,
+			                                        &actual_error);
+			g_free (object_uri);
+		} else {
+			tracker_data_insert_statement_with_string (*graph ? graph : NULL,
+			                                           subject_uri, predicate_uri, object,
+			                                           &actual_error);
+		}
+
+		g_free (subject_uri);
+		g_free (predicate_uri);
+
+		if (actual_error) {
+			/* Triples are inserted as with INSERT SILENT */
+			if (actual_error->domain == TRACKER_SPARQL_ERROR ||
+			    actual_error->domain == TRACKER_DATE_ERROR) {
+				g_clear_error (&actual_error);
+			} else {
+				g_propagate_error (error, actual_error);
+				break;
+			}
+		}
+	}
+
+	g_hash_table_unref (anonymous_nodes);
+}
+
+void
+tracker_data_update_array_with_triples (gchar    **updates,
+                                        gint       n_updates,
+                                        GVariant  *triples,
+                                        GError   **error)
+{
+	GError *actual_error = NULL;
+	gint i;
+
+	g_return_if_fail (updates != NULL || n_updates == 0);
+	g_return_if_fail (g_variant_is_of_type (triples, G_VARIANT_TYPE ("aa(ssssb)")));
+
+	tracker_data_begin_transaction (&actual_error);
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		return;
+	}
+
+	for (i = 0; i < n_updates && !actual_error; i++) {
+		GVariant *blank_nodes = NULL, *update_triples = NULL;
+
+		if ((gsize) i < g_variant_n_children (triples)) {
+			update_triples = g_variant_get_child_value (triples, i);
+		}
+
+		if (updates[i] && *updates[i]) {
+			TrackerSparqlQuery *sparql_query;
+			gboolean blank;
+
+			/* Blank node names are only needed to resolve
+			 * the subjects of the triples.
+			 */
+			blank = (update_triples && g_variant_n_children (update_triples) > 0);
+
+			sparql_query = tracker_sparql_query_new_update (updates[i]);
+			blank_nodes = tracker_sparql_query_execute_update (sparql_query, blank, &actual_error);
+			g_object_unref (sparql_query);
+		}
+
+		if (update_triples) {
+			if (!actual_error) {
+				insert_triples (update_triples, blank_nodes, &actual_error);
+			}
+
+			g_variant_unref (update_triples);
+		}
+
+		if (blank_nodes) {
+			g_variant_unref (blank_nodes);
+		}
+
+		if (!actual_error) {
+			tracker_data_update_buffer_might_flush (&actual_error);
+		}
+	}
+
+	if (actual_error) {
+		tracker_data_rollback_transaction ();
+		g_propagate_error (error, actual_error);
+		return;
+	}
+
+	tracker_data_commit_transaction (error);
+}
+
 void
 tracker_data_load_turtle_file (GFile   *file,
                                GError **error)
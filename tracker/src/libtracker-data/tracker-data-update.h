@@ -92,6 +92,10 @@ void     tracker_data_update_sparql                 (const gchar               *
 GVariant *
          tracker_data_update_sparql_blank           (const gchar               *update,
                                                      GError                   **error);
+void     tracker_data_update_array_with_triples     (gchar                    **updates,
+                                                     gint                       n_updates,
+                                                     GVariant                  *triples,
+                                                     GError                   **error);
 void     tracker_data_update_buffer_flush           (GError                   **error);
 void     tracker_data_update_buffer_might_flush     (GError                   **error);
 void     tracker_data_load_turtle_file              (GFile                     *file,
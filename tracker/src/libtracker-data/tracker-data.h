@@ -41,6 +41,7 @@
 #include "tracker-ontologies.h"
 #include "tracker-property.h"
 #include "tracker-sparql-query.h"
+#include "tracker-trigram.h"
 
 #undef __LIBTRACKER_DATA_INSIDE__
 
@@ -36,20 +36,112 @@
 
 #define TRACKER_DB_BACKUP_META_FILENAME_T	"meta-backup.db.tmp"
 
+/* Default pacing: copy 100 pages per step and stay below 8MB/s, so
+ * every step holds the source read lock for a few milliseconds only. */
+#define DEFAULT_PAGES_PER_STEP            100
+#define DEFAULT_IO_BUDGET                 8192
+
+/* Time slept between steps even when the I/O budget is not exceeded,
+ * gives the update thread a chance to take its write lock. */
+#define STEP_YIELD_USEC                   1000
+
+/* Time slept when the source database is busy or locked */
+#define BUSY_SLEEP_MSEC                   10
+
+/* If the source database keeps being modified from another connection
+ * the backup restarts from the beginning, after that many restarts we
+ * keep a read transaction open on the source so the remaining steps
+ * copy from a stable snapshot. */
+#define MAX_RESTARTS                      5
+
 typedef struct {
 	GFile *destination;
+	TrackerDBBackupProgress progress_callback;
+	gpointer progress_user_data;
 	TrackerDBBackupFinished callback;
 	gpointer user_data;
 	GDestroyNotify destroy;
 	GError *error;
 } BackupInfo;
 
+typedef struct {
+	TrackerDBBackupProgress callback;
+	gpointer user_data;
+	gdouble progress;
+} ProgressInfo;
+
+static struct {
+	guint pages_per_step;
+	guint io_budget;
+} pacing = { DEFAULT_PAGES_PER_STEP, DEFAULT_IO_BUDGET };
+
 GQuark
 tracker_db_backup_error_quark (void)
 {
 	return g_quark_from_static_string ("tracker-db-backup-error-quark");
 }
 
+void
+tracker_db_backup_set_pacing (guint pages_per_step,
+                              guint io_budget)
+{
+	pacing.pages_per_step = pages_per_step > 0 ? pages_per_step : DEFAULT_PAGES_PER_STEP;
+	pacing.io_budget = io_budget;
+}
+
+/* Sleeps as long as needed for @bytes_done since @timer was started
+ * to fit in the configured I/O budget (in KB/s, 0 meaning unlimited),
+ * and yields at least STEP_YIELD_USEC in any case. */
+void
+tracker_db_backup_throttle (GTimer  *timer,
+                            guint64  bytes_done)
+{
+	gdouble elapsed, expected;
+	gulong sleep_usec = STEP_YIELD_USEC;
+
+	if (pacing.io_budget > 0) {
+		elapsed = g_timer_elapsed (timer, NULL);
+		expected = (gdouble) bytes_done / (pacing.io_budget * 1024.0);
+
+		if (expected > elapsed) {
+			sleep_usec = MAX (sleep_usec, (gulong) ((expected - elapsed) * G_USEC_PER_SEC));
+		}
+	}
+
+	g_usleep (sleep_usec);
+}
+
+static gboolean
+perform_progress_callback (gpointer user_data)
+{
+	ProgressInfo *info = user_data;
+
+	info->callback (info->progress, info->user_data);
+
+	return FALSE;
+}
+
+/* Progress is reported from the I/O thread, dispatch it in the main
+ * loop, where the callback is also going to be called once finished. */
+void
+tracker_db_backup_notify_progress (TrackerDBBackupProgress callback,
+                                   gpointer                user_data,
+                                   gdouble                 progress)
+{
+	ProgressInfo *info;
+
+	if (!callback) {
+		return;
+	}
+
+	info = g_new0 (ProgressInfo, 1);
+	info->callback = callback;
+	info->user_data = user_data;
+	info->progress = CLAMP (progress, 0.0, 1.0);
+
+	g_idle_add_full (G_PRIORITY_DEFAULT, perform_progress_callback, info, g_free);
+}
+
 static gboolean
 perform_callback (gpointer user_data)
 {
@@ -80,6 +172,117 @@ backup_info_free (gpointer user_data)
 	g_free (info);
 }
 
+static gint
+get_page_size (sqlite3 *db)
+{
+	sqlite3_stmt *stmt;
+	gint page_size = 0;
+
+	if (sqlite3_prepare_v2 (db, "PRAGMA page_size", -1, &stmt, NULL) != SQLITE_OK) {
+		return 0;
+	}
+
+	if (sqlite3_step (stmt) == SQLITE_ROW) {
+		page_size = sqlite3_column_int (stmt, 0);
+	}
+
+	sqlite3_finalize (stmt);
+
+	return page_size;
+}
+
+/* Starts a read transaction on @db, in WAL mode writers carry on
+ * appending to the WAL file, only checkpoints are held off until the
+ * transaction is finished. */
+static gboolean
+begin_snapshot (sqlite3 *db)
+{
+	if (sqlite3_exec (db, "BEGIN", NULL, NULL, NULL) != SQLITE_OK) {
+		return FALSE;
+	}
+
+	if (sqlite3_exec (db, "SELECT COUNT(*) FROM sqlite_master", NULL, NULL, NULL) != SQLITE_OK) {
+		sqlite3_exec (db, "ROLLBACK", NULL, NULL, NULL);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+backup_step_all (BackupInfo     *info,
+                 sqlite3        *src_db,
+                 sqlite3_backup *backup,
+                 gint            page_size)
+{
+	GTimer *timer;
+	guint64 bytes_done = 0;
+	gint pages_per_step, rc;
+	gint remaining, pagecount;
+	gint last_remaining = G_MAXINT;
+	guint restarts = 0;
+	gboolean in_snapshot = FALSE;
+	gdouble last_progress = 0;
+
+	pages_per_step = pacing.pages_per_step;
+	timer = g_timer_new ();
+
+	do {
+		rc = sqlite3_backup_step (backup, pages_per_step);
+
+		if (rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+			sqlite3_sleep (BUSY_SLEEP_MSEC);
+			continue;
+		} else if (rc != SQLITE_OK && rc != SQLITE_DONE) {
+			break;
+		}
+
+		remaining = sqlite3_backup_remaining (backup);
+		pagecount = sqlite3_backup_pagecount (backup);
+
+		if (remaining > last_remaining && !in_snapshot && ++restarts >= MAX_RESTARTS) {
+			in_snapshot = begin_snapshot (src_db);
+
+			if (in_snapshot) {
+				g_message ("Backup restarted %d times due to concurrent writes, "
+				           "holding off checkpoints until it is finished", restarts);
+			} else {
+				/* Try again after the next restarts */
+				g_message ("Backup restarted %d times due to concurrent writes, "
+				           "could not start a read transaction on the source: %s",
+				           restarts, sqlite3_errmsg (src_db));
+				restarts = 0;
+			}
+		}
+		last_remaining = remaining;
+
+		if (pagecount > 0) {
+			gdouble progress = (gdouble) (pagecount - remaining) / pagecount;
+
+			/* Don't flood the main loop, report by 1% steps */
+			if (progress - last_progress >= 0.01 || rc == SQLITE_DONE) {
+				tracker_db_backup_notify_progress (info->progress_callback,
+				                                   info->progress_user_data,
+				                                   progress);
+				last_progress = progress;
+			}
+		}
+
+		if (rc == SQLITE_OK) {
+			bytes_done += (guint64) pages_per_step * page_size;
+			tracker_db_backup_throttle (timer, bytes_done);
+		}
+	} while (rc != SQLITE_DONE);
+
+	if (in_snapshot) {
+		sqlite3_exec (src_db, "COMMIT", NULL, NULL, NULL);
+	}
+
+	g_timer_destroy (timer);
+
+	return rc == SQLITE_DONE;
+}
+
 static gboolean
 backup_job (GIOSchedulerJob *job,
             GCancellable    *cancellable,
@@ -120,7 +323,7 @@ backup_job (GIOSchedulerJob *job,
 		}
 	}
 
-	if (!info->error && sqlite3_backup_step (backup, -1) != SQLITE_DONE) {
+	if (!info->error && !backup_step_all (info, src_db, backup, get_page_size (src_db))) {
 		g_set_error (&info->error, TRACKER_DB_BACKUP_ERROR, TRACKER_DB_BACKUP_ERROR_UNKNOWN,
 		             "Unable to complete sqlite3 backup");
 	}
@@ -169,6 +372,8 @@ backup_job (GIOSchedulerJob *job,
 
 void
 tracker_db_backup_save (GFile                   *destination,
+                        TrackerDBBackupProgress  progress_callback,
+                        gpointer                 progress_user_data,
                         TrackerDBBackupFinished  callback,
                         gpointer                 user_data,
                         GDestroyNotify           destroy)
@@ -177,6 +382,9 @@ tracker_db_backup_save (GFile                   *destination,
 
 	info->destination = g_object_ref (destination);
 
+	info->progress_callback = progress_callback;
+	info->progress_user_data = progress_user_data;
+
 	info->callback = callback;
 	info->user_data = user_data;
 	info->destroy = destroy;
@@ -36,13 +36,25 @@ typedef enum {
 } TrackerDBBackupError;
 
 typedef void (*TrackerDBBackupFinished)   (GError *error, gpointer user_data);
+typedef void (*TrackerDBBackupProgress)   (gdouble progress, gpointer user_data);
 
-GQuark    tracker_db_backup_error_quark (void);
+GQuark    tracker_db_backup_error_quark      (void);
 
-void      tracker_db_backup_save        (GFile                   *destination,
-                                         TrackerDBBackupFinished  callback,
-                                         gpointer                 user_data,
-                                         GDestroyNotify           destroy);
+void      tracker_db_backup_set_pacing       (guint                    pages_per_step,
+                                              guint                    io_budget);
+
+void      tracker_db_backup_throttle         (GTimer                  *timer,
+                                              guint64                  bytes_done);
+void      tracker_db_backup_notify_progress  (TrackerDBBackupProgress  callback,
+                                              gpointer                 user_data,
+                                              gdouble                  progress);
+
+void      tracker_db_backup_save             (GFile                   *destination,
+                                              TrackerDBBackupProgress  progress_callback,
+                                              gpointer                 progress_user_data,
+                                              TrackerDBBackupFinished  callback,
+                                              gpointer                 user_data,
+                                              GDestroyNotify           destroy);
 
 G_END_DECLS
 
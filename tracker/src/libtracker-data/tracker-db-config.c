@@ -31,10 +31,13 @@
 
 /* GKeyFile defines */
 #define GROUP_JOURNAL     "Journal"
+#define GROUP_BACKUP      "Backup"
 
 /* Default values */
 #define DEFAULT_JOURNAL_CHUNK_SIZE           50
 #define DEFAULT_JOURNAL_ROTATE_DESTINATION   ""
+#define DEFAULT_BACKUP_PAGES_PER_STEP        100
+#define DEFAULT_BACKUP_IO_BUDGET             8192
 
 static void config_set_property (GObject      *object,
                                  guint         param_id,
@@ -52,12 +55,18 @@ enum {
 
 	/* Journal */
 	PROP_JOURNAL_CHUNK_SIZE,
-	PROP_JOURNAL_ROTATE_DESTINATION
+	PROP_JOURNAL_ROTATE_DESTINATION,
+
+	/* Backup */
+	PROP_BACKUP_PAGES_PER_STEP,
+	PROP_BACKUP_IO_BUDGET
 };
 
 static TrackerConfigMigrationEntry migration[] = {
 	{ G_TYPE_INT, GROUP_JOURNAL, "JournalChunkSize", "journal-chunk-size" },
 	{ G_TYPE_STRING, GROUP_JOURNAL, "JournalRotateDestination", "journal-rotate-destination" },
+	{ G_TYPE_INT, GROUP_BACKUP, "BackupPagesPerStep", "backup-pages-per-step" },
+	{ G_TYPE_INT, GROUP_BACKUP, "BackupIOBudget", "backup-io-budget" },
 };
 
 G_DEFINE_TYPE (TrackerDBConfig, tracker_db_config, G_TYPE_SETTINGS);
@@ -90,6 +99,25 @@ tracker_db_config_class_init (TrackerDBConfigClass *klass)
 	                                                      DEFAULT_JOURNAL_ROTATE_DESTINATION,
 	                                                      G_PARAM_READWRITE));
 
+	g_object_class_install_property (object_class,
+	                                 PROP_BACKUP_PAGES_PER_STEP,
+	                                 g_param_spec_int ("backup-pages-per-step",
+	                                                   "Backup pages per step",
+	                                                   " Number of database pages copied at once while backing up",
+	                                                   1,
+	                                                   100000,
+	                                                   DEFAULT_BACKUP_PAGES_PER_STEP,
+	                                                   G_PARAM_READWRITE));
+
+	g_object_class_install_property (object_class,
+	                                 PROP_BACKUP_IO_BUDGET,
+	                                 g_param_spec_int ("backup-io-budget",
+	                                                   "Backup I/O budget",
+	                                                   " Maximum backup throughput in KB/s. Use 0 for no limit",
+	                                                   0,
+	                                                   1048576,
+	                                                   DEFAULT_BACKUP_IO_BUDGET,
+	                                                   G_PARAM_READWRITE));
 }
 
 static void
@@ -113,6 +141,16 @@ config_set_property (GObject      *object,
 		tracker_db_config_set_journal_rotate_destination (TRACKER_DB_CONFIG (object),
 		                                                  g_value_get_string(value));
 		break;
+
+		/* Backup */
+	case PROP_BACKUP_PAGES_PER_STEP:
+		tracker_db_config_set_backup_pages_per_step (TRACKER_DB_CONFIG (object),
+		                                             g_value_get_int (value));
+		break;
+	case PROP_BACKUP_IO_BUDGET:
+		tracker_db_config_set_backup_io_budget (TRACKER_DB_CONFIG (object),
+		                                        g_value_get_int (value));
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
 		break;
@@ -134,6 +172,12 @@ config_get_property (GObject    *object,
 	case PROP_JOURNAL_ROTATE_DESTINATION:
 		g_value_take_string (value, tracker_db_config_get_journal_rotate_destination (config));
 		break;
+	case PROP_BACKUP_PAGES_PER_STEP:
+		g_value_set_int (value, tracker_db_config_get_backup_pages_per_step (config));
+		break;
+	case PROP_BACKUP_IO_BUDGET:
+		g_value_set_int (value, tracker_db_config_get_backup_io_budget (config));
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
 		break;
@@ -201,6 +245,22 @@ tracker_db_config_get_journal_rotate_destination (TrackerDBConfig *config)
 	return g_settings_get_string (G_SETTINGS (config), "journal-rotate-destination");
 }
 
+gint
+tracker_db_config_get_backup_pages_per_step (TrackerDBConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_DB_CONFIG (config), DEFAULT_BACKUP_PAGES_PER_STEP);
+
+	return g_settings_get_int (G_SETTINGS (config), "backup-pages-per-step");
+}
+
+gint
+tracker_db_config_get_backup_io_budget (TrackerDBConfig *config)
+{
+	g_return_val_if_fail (TRACKER_IS_DB_CONFIG (config), DEFAULT_BACKUP_IO_BUDGET);
+
+	return g_settings_get_int (G_SETTINGS (config), "backup-io-budget");
+}
+
 void
 tracker_db_config_set_journal_chunk_size (TrackerDBConfig *config,
                                           gint             value)
@@ -220,3 +280,23 @@ tracker_db_config_set_journal_rotate_destination (TrackerDBConfig *config,
 	g_settings_set_string (G_SETTINGS (config), "journal-rotate-destination", value);
 	g_object_notify (G_OBJECT (config), "journal-rotate-destination");
 }
+
+void
+tracker_db_config_set_backup_pages_per_step (TrackerDBConfig *config,
+                                             gint             value)
+{
+	g_return_if_fail (TRACKER_IS_DB_CONFIG (config));
+
+	g_settings_set_int (G_SETTINGS (config), "backup-pages-per-step", value);
+	g_object_notify (G_OBJECT (config), "backup-pages-per-step");
+}
+
+void
+tracker_db_config_set_backup_io_budget (TrackerDBConfig *config,
+                                        gint             value)
+{
+	g_return_if_fail (TRACKER_IS_DB_CONFIG (config));
+
+	g_settings_set_int (G_SETTINGS (config), "backup-io-budget", value);
+	g_object_notify (G_OBJECT (config), "backup-io-budget");
+}
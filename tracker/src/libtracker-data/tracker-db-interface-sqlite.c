@@ -81,6 +81,9 @@ struct TrackerDBInterface {
 	/* Collation and locale change */
 	gpointer locale_notification_id;
 	gint collator_reset_requested;
+	/* Collator used for SparqlCollationKey, the one of the collation
+	 * itself is owned by SQLite */
+	gpointer collator;
 
 	/* Number of active cursors */
 	gint n_active_cursors;
@@ -151,6 +154,8 @@ static gboolean            tracker_db_cursor_get_boolean            (TrackerSpar
 static gboolean            db_cursor_iter_next                      (TrackerDBCursor       *cursor,
                                                                      GCancellable          *cancellable,
                                                                      GError               **error);
+static TrackerSparqlValueType db_cursor_get_value_type             (TrackerDBCursor       *cursor,
+                                                                     guint                  column);
 
 enum {
 	PROP_0,
@@ -433,6 +438,39 @@ function_sparql_format_time (sqlite3_context *context,
 	sqlite3_result_text (context, str, -1, g_free);
 }
 
+static void
+function_sparql_collation_key (sqlite3_context *context,
+                               int              argc,
+                               sqlite3_value   *argv[])
+{
+	TrackerDBInterface *db_interface;
+	const gchar *str;
+	gchar *key;
+
+	if (argc != 1) {
+		sqlite3_result_error (context, "Invalid argument count", -1);
+		return;
+	}
+
+	if (sqlite3_value_type (argv[0]) == SQLITE_NULL) {
+		sqlite3_result_null (context);
+		return;
+	}
+
+	db_interface = sqlite3_user_data (context);
+
+	str = (const gchar *) sqlite3_value_text (argv[0]);
+	key = tracker_collation_key (db_interface->collator, str,
+	                             sqlite3_value_bytes (argv[0]));
+
+	if (!key) {
+		sqlite3_result_error (context, "Could not get collation key", -1);
+		return;
+	}
+
+	sqlite3_result_text (context, key, -1, g_free);
+}
+
 static void
 function_sparql_cartesian_distance (sqlite3_context *context,
                                     int              argc,
@@ -898,6 +936,10 @@ open_database (TrackerDBInterface  *db_interface,
 	                         db_interface, &function_sparql_format_time,
 	                         NULL, NULL);
 
+	sqlite3_create_function (db_interface->db, "SparqlCollationKey", 1, SQLITE_ANY,
+	                         db_interface, &function_sparql_collation_key,
+	                         NULL, NULL);
+
 	sqlite3_extended_result_codes (db_interface->db, 0);
 	sqlite3_busy_timeout (db_interface->db, 100000);
 }
@@ -998,6 +1040,11 @@ close_database (TrackerDBInterface *db_interface)
 		rc = sqlite3_close (db_interface->db);
 		g_warn_if_fail (rc == SQLITE_OK);
 	}
+
+	if (db_interface->collator) {
+		tracker_collation_shutdown (db_interface->collator);
+		db_interface->collator = NULL;
+	}
 }
 
 void
@@ -1029,6 +1076,38 @@ tracker_db_interface_sqlite_fts_update_text (TrackerDBInterface *db_interface,
 	return tracker_fts_update_text (db_interface->fts, id, column_id, text, limit_word_length);
 }
 
+int
+tracker_db_interface_sqlite_fts_update_delta_column (TrackerDBInterface *db_interface,
+                                                     int                 column_id,
+                                                     const char         *old_text,
+                                                     const char         *new_text,
+                                                     gboolean            limit_word_length)
+{
+	return tracker_fts_update_delta_column (db_interface->fts, column_id, old_text, new_text, limit_word_length);
+}
+
+gboolean
+tracker_db_interface_sqlite_fts_update_delta_needs_text (TrackerDBInterface *db_interface)
+{
+	return tracker_fts_update_delta_needs_text (db_interface->fts);
+}
+
+int
+tracker_db_interface_sqlite_fts_update_delta_text (TrackerDBInterface *db_interface,
+                                                   int                 column_id,
+                                                   const char         *text,
+                                                   gboolean            limit_word_length)
+{
+	return tracker_fts_update_delta_text (db_interface->fts, column_id, text, limit_word_length);
+}
+
+int
+tracker_db_interface_sqlite_fts_update_delta_finish (TrackerDBInterface *db_interface,
+                                                     int                 id)
+{
+	return tracker_fts_update_delta_finish (db_interface->fts, id);
+}
+
 void
 tracker_db_interface_sqlite_fts_update_commit (TrackerDBInterface *db_interface)
 {
@@ -1058,6 +1137,12 @@ tracker_db_interface_sqlite_reset_collator (TrackerDBInterface *db_interface)
 		g_critical ("Couldn't set collation function: %s",
 		            sqlite3_errmsg (db_interface->db));
 	}
+
+	/* Sort keys need to follow the same locale as the collation */
+	if (db_interface->collator) {
+		tracker_collation_shutdown (db_interface->collator);
+	}
+	db_interface->collator = tracker_collation_init ();
 }
 
 static gint
@@ -1712,6 +1797,7 @@ tracker_db_cursor_class_init (TrackerDBCursorClass *class)
 	sparql_cursor_class->get_n_columns = (gint (*) (TrackerSparqlCursor *)) tracker_db_cursor_get_n_columns;
 	sparql_cursor_class->get_string = (const gchar * (*) (TrackerSparqlCursor *, gint, glong*)) tracker_db_cursor_get_string;
 	sparql_cursor_class->next = (gboolean (*) (TrackerSparqlCursor *, GCancellable *, GError **)) tracker_db_cursor_iter_next;
+	sparql_cursor_class->next_n = (gint (*) (TrackerSparqlCursor *, gchar **, gint, TrackerSparqlValueType *, gint, gint, GCancellable *, GError **)) tracker_db_cursor_next_n;
 	sparql_cursor_class->next_async = (void (*) (TrackerSparqlCursor *, GCancellable *, GAsyncReadyCallback, gpointer)) tracker_db_cursor_iter_next_async;
 	sparql_cursor_class->next_finish = (gboolean (*) (TrackerSparqlCursor *, GAsyncResult *, GError **)) tracker_db_cursor_iter_next_finish;
 	sparql_cursor_class->rewind = (void (*) (TrackerSparqlCursor *)) tracker_db_cursor_rewind;
@@ -1852,10 +1938,11 @@ tracker_db_cursor_iter_next (TrackerDBCursor *cursor,
 }
 
 
+/* Must be called with the db manager lock held for threadsafe cursors */
 static gboolean
-db_cursor_iter_next (TrackerDBCursor *cursor,
-                     GCancellable    *cancellable,
-                     GError         **error)
+db_cursor_step (TrackerDBCursor *cursor,
+                GCancellable    *cancellable,
+                GError         **error)
 {
 	TrackerDBStatement *stmt = cursor->ref_stmt;
 	TrackerDBInterface *iface = stmt->db_interface;
@@ -1863,10 +1950,6 @@ db_cursor_iter_next (TrackerDBCursor *cursor,
 	if (!cursor->finished) {
 		guint result;
 
-		if (cursor->threadsafe) {
-			tracker_db_manager_lock ();
-		}
-
 		if (g_cancellable_is_cancelled (cancellable)) {
 			result = SQLITE_INTERRUPT;
 			sqlite3_reset (cursor->stmt);
@@ -1890,13 +1973,79 @@ db_cursor_iter_next (TrackerDBCursor *cursor,
 		}
 
 		cursor->finished = (result != SQLITE_ROW);
+	}
 
-		if (cursor->threadsafe) {
-			tracker_db_manager_unlock ();
+	return (!cursor->finished);
+}
+
+static gboolean
+db_cursor_iter_next (TrackerDBCursor *cursor,
+                     GCancellable    *cancellable,
+                     GError         **error)
+{
+	gboolean result;
+
+	if (cursor->threadsafe) {
+		tracker_db_manager_lock ();
+	}
+
+	result = db_cursor_step (cursor, cancellable, error);
+
+	if (cursor->threadsafe) {
+		tracker_db_manager_unlock ();
+	}
+
+	return result;
+}
+
+gint
+tracker_db_cursor_next_n (TrackerDBCursor         *cursor,
+                          gchar                  **values,
+                          gint                     values_length,
+                          TrackerSparqlValueType  *types,
+                          gint                     types_length,
+                          gint                     n_rows,
+                          GCancellable            *cancellable,
+                          GError                 **error)
+{
+	gint n_columns;
+	gint row = 0;
+
+	g_return_val_if_fail (TRACKER_IS_DB_CURSOR (cursor), 0);
+
+	n_columns = sqlite3_column_count (cursor->stmt);
+
+	g_return_val_if_fail (n_rows >= 0, 0);
+	g_return_val_if_fail (values_length >= n_rows * n_columns, 0);
+	g_return_val_if_fail (types_length >= n_rows * n_columns, 0);
+
+	/* The whole batch is fetched with the lock held once,
+	 * instead of once per row and cell.
+	 */
+	if (cursor->threadsafe) {
+		tracker_db_manager_lock ();
+	}
+
+	while (row < n_rows && db_cursor_step (cursor, cancellable, error)) {
+		gint column;
+
+		for (column = 0; column < n_columns; column++) {
+			gint i = column * n_rows + row;
+
+			types[i] = db_cursor_get_value_type (cursor, column);
+
+			g_free (values[i]);
+			values[i] = g_strdup ((const gchar *) sqlite3_column_text (cursor->stmt, column));
 		}
+
+		row++;
 	}
 
-	return (!cursor->finished);
+	if (cursor->threadsafe) {
+		tracker_db_manager_unlock ();
+	}
+
+	return row;
 }
 
 guint
@@ -1986,7 +2135,7 @@ TrackerSparqlValueType
 tracker_db_cursor_get_value_type (TrackerDBCursor *cursor,
                                   guint            column)
 {
-	gint column_type;
+	TrackerSparqlValueType result;
 	gint n_columns = sqlite3_column_count (cursor->stmt);
 
 	g_return_val_if_fail (column < n_columns, TRACKER_SPARQL_VALUE_TYPE_UNBOUND);
@@ -1995,12 +2144,24 @@ tracker_db_cursor_get_value_type (TrackerDBCursor *cursor,
 		tracker_db_manager_lock ();
 	}
 
-	column_type = sqlite3_column_type (cursor->stmt, column);
+	result = db_cursor_get_value_type (cursor, column);
 
 	if (cursor->threadsafe) {
 		tracker_db_manager_unlock ();
 	}
 
+	return result;
+}
+
+/* Must be called with the db manager lock held for threadsafe cursors */
+static TrackerSparqlValueType
+db_cursor_get_value_type (TrackerDBCursor *cursor,
+                          guint            column)
+{
+	gint column_type;
+
+	column_type = sqlite3_column_type (cursor->stmt, column);
+
 	if (column_type == SQLITE_NULL) {
 		return TRACKER_SPARQL_VALUE_TYPE_UNBOUND;
 	} else if (column < cursor->n_types) {
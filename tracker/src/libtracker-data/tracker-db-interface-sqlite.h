@@ -54,6 +54,18 @@ int                 tracker_db_interface_sqlite_fts_update_text        (TrackerD
                                                                         int                       column_id,
                                                                         const char               *text,
                                                                         gboolean                  limit_word_length);
+int                 tracker_db_interface_sqlite_fts_update_delta_column (TrackerDBInterface      *interface,
+                                                                         int                      column_id,
+                                                                         const char              *old_text,
+                                                                         const char              *new_text,
+                                                                         gboolean                 limit_word_length);
+gboolean            tracker_db_interface_sqlite_fts_update_delta_needs_text (TrackerDBInterface  *interface);
+int                 tracker_db_interface_sqlite_fts_update_delta_text  (TrackerDBInterface       *interface,
+                                                                        int                       column_id,
+                                                                        const char               *text,
+                                                                        gboolean                  limit_word_length);
+int                 tracker_db_interface_sqlite_fts_update_delta_finish (TrackerDBInterface      *interface,
+                                                                         int                      id);
 void                tracker_db_interface_sqlite_fts_update_commit      (TrackerDBInterface       *interface);
 void                tracker_db_interface_sqlite_fts_update_rollback    (TrackerDBInterface       *interface);
 #endif
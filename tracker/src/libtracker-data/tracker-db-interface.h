@@ -141,6 +141,14 @@ void                    tracker_db_cursor_rewind                     (TrackerDBC
 gboolean                tracker_db_cursor_iter_next                  (TrackerDBCursor            *cursor,
                                                                       GCancellable               *cancellable,
                                                                       GError                    **error);
+gint                    tracker_db_cursor_next_n                     (TrackerDBCursor            *cursor,
+                                                                      gchar                     **values,
+                                                                      gint                        values_length,
+                                                                      TrackerSparqlValueType     *types,
+                                                                      gint                        types_length,
+                                                                      gint                        n_rows,
+                                                                      GCancellable               *cancellable,
+                                                                      GError                    **error);
 guint                   tracker_db_cursor_get_n_columns              (TrackerDBCursor            *cursor);
 const gchar*            tracker_db_cursor_get_variable_name          (TrackerDBCursor            *cursor,
                                                                       guint                       column);
@@ -705,7 +705,7 @@ db_manager_analyze (TrackerDB           db,
 
 	if (current_mtime > dbs[db].mtime) {
 		g_message ("  Analyzing DB:'%s'", dbs[db].name);
-		db_exec_no_reply (iface, "ANALYZE %s.Services", dbs[db].name);
+		db_exec_no_reply (iface, "ANALYZE %s", dbs[db].name);
 
 		/* Remember current mtime for future */
 		dbs[db].mtime = current_mtime;
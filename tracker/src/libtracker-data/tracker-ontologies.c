@@ -66,6 +66,10 @@ static GHashTable *id_uri_pairs;
 /* rdf:type */
 static TrackerProperty *rdf_type = NULL;
 
+/* Bump whenever the set of keys written to the ontology image changes,
+ * older images are then ignored by read-only clients */
+#define GVDB_VERSION 3
+
 static GvdbTable *gvdb_table;
 static GvdbTable *gvdb_namespaces_table;
 static GvdbTable *gvdb_classes_table;
@@ -490,6 +494,9 @@ tracker_ontologies_write_gvdb (const gchar  *filename,
 
 	root_table = gvdb_hash_table_new (NULL, NULL);
 
+	item = gvdb_hash_table_insert (root_table, "version");
+	gvdb_item_set_value (item, g_variant_new_int32 (GVDB_VERSION));
+
 	table = gvdb_hash_table_new (root_table, "namespaces");
 	root = gvdb_hash_table_insert (table, "");
 	for (i = 0; i < namespaces->len; i++) {
@@ -536,6 +543,7 @@ tracker_ontologies_write_gvdb (const gchar  *filename,
 	root = gvdb_hash_table_insert (table, "");
 	for (i = 0; i < properties->len; i++) {
 		TrackerProperty *property;
+		TrackerProperty **super_properties;
 		TrackerClass **domain_indexes;
 		GVariantBuilder builder;
 
@@ -556,6 +564,35 @@ tracker_ontologies_write_gvdb (const gchar  *filename,
 			gvdb_hash_table_insert_variant (table, item, uri, "inverse-functional", g_variant_new_boolean (TRUE));
 		}
 
+		if (tracker_property_get_collation_key (property)) {
+			gvdb_hash_table_insert_variant (table, item, uri, "collation-key", g_variant_new_boolean (TRUE));
+		}
+
+		if (tracker_property_get_trigram_indexed (property)) {
+			gvdb_hash_table_insert_variant (table, item, uri, "trigram-indexed", g_variant_new_boolean (TRUE));
+		}
+
+		if (tracker_property_get_indexed (property)) {
+			gvdb_hash_table_insert_variant (table, item, uri, "indexed", g_variant_new_boolean (TRUE));
+		}
+
+		if (tracker_property_get_secondary_index (property)) {
+			gvdb_hash_table_insert_statement (table, item, uri, "secondary-index", tracker_property_get_uri (tracker_property_get_secondary_index (property)));
+		}
+
+		if (tracker_property_get_fulltext_indexed (property)) {
+			gvdb_hash_table_insert_variant (table, item, uri, "fulltext-indexed", g_variant_new_boolean (TRUE));
+			gvdb_hash_table_insert_variant (table, item, uri, "weight", g_variant_new_int32 (tracker_property_get_weight (property)));
+		}
+
+		if (tracker_property_get_fulltext_no_limit (property)) {
+			gvdb_hash_table_insert_variant (table, item, uri, "fulltext-no-limit", g_variant_new_boolean (TRUE));
+		}
+
+		/* Index statistics, saves read-only clients from querying them */
+		gvdb_hash_table_insert_variant (table, item, uri, "values-per-resource", g_variant_new_double (tracker_property_get_values_per_resource (property)));
+		gvdb_hash_table_insert_variant (table, item, uri, "resources-per-value", g_variant_new_double (tracker_property_get_resources_per_value (property)));
+
 		domain_indexes = tracker_property_get_domain_indexes (property);
 		if (domain_indexes) {
 			g_variant_builder_init (&builder, G_VARIANT_TYPE ("as"));
@@ -567,6 +604,18 @@ tracker_ontologies_write_gvdb (const gchar  *filename,
 
 			gvdb_hash_table_insert_variant (table, item, uri, "domain-indexes", g_variant_builder_end (&builder));
 		}
+
+		super_properties = tracker_property_get_super_properties (property);
+		if (super_properties && *super_properties) {
+			g_variant_builder_init (&builder, G_VARIANT_TYPE ("as"));
+
+			while (*super_properties) {
+				g_variant_builder_add (&builder, "s", tracker_property_get_uri (*super_properties));
+				super_properties++;
+			}
+
+			gvdb_hash_table_insert_variant (table, item, uri, "super-properties", g_variant_builder_end (&builder));
+		}
 	}
 	g_hash_table_unref (table);
 
@@ -579,6 +628,8 @@ void
 tracker_ontologies_load_gvdb (const gchar  *filename,
                               GError      **error)
 {
+	GVariant *version;
+
 	tracker_ontologies_shutdown ();
 
 	tracker_ontologies_init ();
@@ -588,6 +639,24 @@ tracker_ontologies_load_gvdb (const gchar  *filename,
 		return;
 	}
 
+	version = gvdb_table_get_value (gvdb_table, "version");
+	if (!version || g_variant_get_int32 (version) != GVDB_VERSION) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+		             "Ontology cache '%s' was written by an incompatible version",
+		             filename);
+
+		gvdb_table_unref (gvdb_table);
+		gvdb_table = NULL;
+	}
+
+	if (version) {
+		g_variant_unref (version);
+	}
+
+	if (!gvdb_table) {
+		return;
+	}
+
 	gvdb_namespaces_table = gvdb_table_get_table (gvdb_table, "namespaces");
 	gvdb_classes_table = gvdb_table_get_table (gvdb_table, "classes");
 	gvdb_properties_table = gvdb_table_get_table (gvdb_table, "properties");
@@ -46,6 +46,7 @@ struct _TrackerPropertyPrivate {
 	gchar         *table_name;
 
 	gboolean       use_gvdb;
+	gboolean       loading_gvdb;
 
 	TrackerPropertyType  data_type;
 	TrackerClass   *domain;
@@ -64,6 +65,10 @@ struct _TrackerPropertyPrivate {
 	gboolean       is_new;
 	gboolean       db_schema_changed;
 	gboolean       writeback;
+	gboolean       collation_key;
+	gboolean       trigram_indexed;
+	gdouble        values_per_resource;
+	gdouble        resources_per_value;
 	gchar         *default_value;
 	GPtrArray     *is_new_domain_index;
 	gboolean       force_journal;
@@ -75,6 +80,10 @@ struct _TrackerPropertyPrivate {
 
 static void property_finalize     (GObject      *object);
 
+/* Guards the lazy gvdb loads, getters may be called from the
+ * update thread and the query threads at once. */
+static GStaticRecMutex gvdb_mutex = G_STATIC_REC_MUTEX_INIT;
+
 GType
 tracker_property_type_get_type (void)
 {
@@ -139,6 +148,8 @@ tracker_property_init (TrackerProperty *property)
 	priv->transient = FALSE;
 	priv->multiple_values = TRUE;
 	priv->force_journal = TRUE;
+	priv->values_per_resource = 1;
+	priv->resources_per_value = 0;
 	priv->super_properties = g_array_new (TRUE, TRUE, sizeof (TrackerProperty *));
 	priv->domain_indexes = g_array_new (TRUE, TRUE, sizeof (TrackerClass *));
 	priv->last_super_properties = NULL;
@@ -209,6 +220,156 @@ tracker_property_new (gboolean use_gvdb)
 	return property;
 }
 
+static gboolean
+property_get_boolean_gvdb (TrackerPropertyPrivate *priv,
+                           const gchar            *predicate)
+{
+	GVariant *value;
+	gboolean result;
+
+	value = tracker_ontologies_get_property_value_gvdb (priv->uri, predicate);
+	result = (value != NULL) && g_variant_get_boolean (value);
+
+	if (value) {
+		g_variant_unref (value);
+	}
+
+	return result;
+}
+
+static gdouble
+property_get_double_gvdb (TrackerPropertyPrivate *priv,
+                          const gchar            *predicate,
+                          gdouble                 default_value)
+{
+	GVariant *value;
+	gdouble result;
+
+	value = tracker_ontologies_get_property_value_gvdb (priv->uri, predicate);
+	if (!value) {
+		return default_value;
+	}
+
+	result = g_variant_get_double (value);
+	g_variant_unref (value);
+
+	return result;
+}
+
+/* Reads all attributes of a property from the mmapped ontology image
+ * the first time any of them is needed, afterwards the property is
+ * served like one loaded from the database. */
+static void
+property_load_gvdb (TrackerProperty *property)
+{
+	TrackerPropertyPrivate *priv;
+	const gchar *range_uri;
+	const gchar *uri;
+	GVariant *value;
+
+	priv = GET_PRIV (property);
+
+	g_static_rec_mutex_lock (&gvdb_mutex);
+
+	/* Loaded by another thread meanwhile, or the lookups below
+	 * recursed into a getter of this property */
+	if (!priv->use_gvdb || priv->loading_gvdb) {
+		g_static_rec_mutex_unlock (&gvdb_mutex);
+		return;
+	}
+
+	priv->loading_gvdb = TRUE;
+
+	if (!priv->domain) {
+		uri = tracker_ontologies_get_property_string_gvdb (priv->uri, "domain");
+		priv->domain = g_object_ref (tracker_ontologies_get_class_by_uri (uri));
+	}
+
+	range_uri = tracker_ontologies_get_property_string_gvdb (priv->uri, "range");
+	if (!priv->range) {
+		priv->range = g_object_ref (tracker_ontologies_get_class_by_uri (range_uri));
+	}
+
+	if (strcmp (range_uri, XSD_STRING) == 0) {
+		priv->data_type = TRACKER_PROPERTY_TYPE_STRING;
+	} else if (strcmp (range_uri, XSD_BOOLEAN) == 0) {
+		priv->data_type = TRACKER_PROPERTY_TYPE_BOOLEAN;
+	} else if (strcmp (range_uri, XSD_INTEGER) == 0) {
+		priv->data_type = TRACKER_PROPERTY_TYPE_INTEGER;
+	} else if (strcmp (range_uri, XSD_DOUBLE) == 0) {
+		priv->data_type = TRACKER_PROPERTY_TYPE_DOUBLE;
+	} else if (strcmp (range_uri, XSD_DATE) == 0) {
+		priv->data_type = TRACKER_PROPERTY_TYPE_DATE;
+	} else if (strcmp (range_uri, XSD_DATETIME) == 0) {
+		priv->data_type = TRACKER_PROPERTY_TYPE_DATETIME;
+	} else {
+		priv->data_type = TRACKER_PROPERTY_TYPE_RESOURCE;
+	}
+
+	value = tracker_ontologies_get_property_value_gvdb (priv->uri, "max-cardinality");
+	if (value) {
+		priv->multiple_values = FALSE;
+		g_variant_unref (value);
+	} else {
+		priv->multiple_values = TRUE;
+	}
+
+	value = tracker_ontologies_get_property_value_gvdb (priv->uri, "weight");
+	if (value) {
+		priv->weight = g_variant_get_int32 (value);
+		g_variant_unref (value);
+	}
+
+	priv->is_inverse_functional_property = property_get_boolean_gvdb (priv, "inverse-functional");
+	priv->indexed = property_get_boolean_gvdb (priv, "indexed");
+	priv->fulltext_indexed = property_get_boolean_gvdb (priv, "fulltext-indexed");
+	priv->fulltext_no_limit = property_get_boolean_gvdb (priv, "fulltext-no-limit");
+
+	/* Only stored where the column or table exists */
+	priv->collation_key = property_get_boolean_gvdb (priv, "collation-key");
+	priv->trigram_indexed = property_get_boolean_gvdb (priv, "trigram-indexed");
+
+	priv->values_per_resource = property_get_double_gvdb (priv, "values-per-resource", 1);
+	priv->resources_per_value = property_get_double_gvdb (priv, "resources-per-value", 0);
+
+	uri = tracker_ontologies_get_property_string_gvdb (priv->uri, "secondary-index");
+	if (uri && !priv->secondary_index) {
+		priv->secondary_index = g_object_ref (tracker_ontologies_get_property_by_uri (uri));
+	}
+
+	value = tracker_ontologies_get_property_value_gvdb (priv->uri, "domain-indexes");
+	if (value) {
+		GVariantIter iter;
+
+		g_variant_iter_init (&iter, value);
+		while (g_variant_iter_loop (&iter, "&s", &uri)) {
+			tracker_property_add_domain_index (property,
+			                                   tracker_ontologies_get_class_by_uri (uri));
+		}
+
+		g_variant_unref (value);
+	}
+
+	value = tracker_ontologies_get_property_value_gvdb (priv->uri, "super-properties");
+	if (value) {
+		GVariantIter iter;
+
+		g_variant_iter_init (&iter, value);
+		while (g_variant_iter_loop (&iter, "&s", &uri)) {
+			tracker_property_add_super_property (property,
+			                                     tracker_ontologies_get_property_by_uri (uri));
+		}
+
+		g_variant_unref (value);
+	}
+
+	/* Only published once all fields are set */
+	priv->loading_gvdb = FALSE;
+	g_atomic_int_set (&priv->use_gvdb, FALSE);
+
+	g_static_rec_mutex_unlock (&gvdb_mutex);
+}
+
 const gchar *
 tracker_property_get_uri (TrackerProperty *property)
 {
@@ -277,25 +438,8 @@ tracker_property_get_data_type (TrackerProperty *property)
 
 	priv = GET_PRIV (property);
 
-	if (priv->use_gvdb) {
-		const gchar *range_uri;
-
-		range_uri = tracker_ontologies_get_property_string_gvdb (priv->uri, "range");
-		if (strcmp (range_uri, XSD_STRING) == 0) {
-			priv->data_type = TRACKER_PROPERTY_TYPE_STRING;
-		} else if (strcmp (range_uri, XSD_BOOLEAN) == 0) {
-			priv->data_type = TRACKER_PROPERTY_TYPE_BOOLEAN;
-		} else if (strcmp (range_uri, XSD_INTEGER) == 0) {
-			priv->data_type = TRACKER_PROPERTY_TYPE_INTEGER;
-		} else if (strcmp (range_uri, XSD_DOUBLE) == 0) {
-			priv->data_type = TRACKER_PROPERTY_TYPE_DOUBLE;
-		} else if (strcmp (range_uri, XSD_DATE) == 0) {
-			priv->data_type = TRACKER_PROPERTY_TYPE_DATE;
-		} else if (strcmp (range_uri, XSD_DATETIME) == 0) {
-			priv->data_type = TRACKER_PROPERTY_TYPE_DATETIME;
-		} else {
-			priv->data_type = TRACKER_PROPERTY_TYPE_RESOURCE;
-		}
+	if (g_atomic_int_get (&priv->use_gvdb)) {
+		property_load_gvdb (property);
 	}
 
 	return priv->data_type;
@@ -313,11 +457,8 @@ tracker_property_get_domain (TrackerProperty *property)
 
 	priv = GET_PRIV (property);
 
-	if (!priv->domain && priv->use_gvdb) {
-		const gchar *domain_uri;
-
-		domain_uri = tracker_ontologies_get_property_string_gvdb (priv->uri, "domain");
-		priv->domain = g_object_ref (tracker_ontologies_get_class_by_uri (domain_uri));
+	if (g_atomic_int_get (&priv->use_gvdb)) {
+		property_load_gvdb (property);
 	}
 
 	return priv->domain;
@@ -335,26 +476,8 @@ tracker_property_get_domain_indexes (TrackerProperty *property)
 
 	priv = GET_PRIV (property);
 
-	if (priv->use_gvdb) {
-		TrackerClass *domain_index;
-		GVariant *variant;
-
-		tracker_property_reset_domain_indexes (property);
-
-		variant = tracker_ontologies_get_property_value_gvdb (priv->uri, "domain-indexes");
-		if (variant) {
-			GVariantIter iter;
-			const gchar *uri;
-
-			g_variant_iter_init (&iter, variant);
-			while (g_variant_iter_loop (&iter, "&s", &uri)) {
-				domain_index = tracker_ontologies_get_class_by_uri (uri);
-
-				tracker_property_add_domain_index (property, domain_index);
-			}
-
-			g_variant_unref (variant);
-		}
+	if (g_atomic_int_get (&priv->use_gvdb)) {
+		property_load_gvdb (property);
 	}
 
 	return (TrackerClass ** ) priv->domain_indexes->data;
@@ -400,11 +523,8 @@ tracker_property_get_range (TrackerProperty *property)
 
 	priv = GET_PRIV (property);
 
-	if (!priv->range && priv->use_gvdb) {
-		const gchar *range_uri;
-
-		range_uri = tracker_ontologies_get_property_string_gvdb (priv->uri, "range");
-		priv->range = g_object_ref (tracker_ontologies_get_class_by_uri (range_uri));
+	if (g_atomic_int_get (&priv->use_gvdb)) {
+		property_load_gvdb (property);
 	}
 
 	return priv->range;
@@ -419,6 +539,10 @@ tracker_property_get_weight (TrackerProperty *property)
 
 	priv = GET_PRIV (property);
 
+	if (g_atomic_int_get (&priv->use_gvdb)) {
+		property_load_gvdb (property);
+	}
+
 	return priv->weight;
 }
 
@@ -443,6 +567,10 @@ tracker_property_get_indexed (TrackerProperty *property)
 
 	priv = GET_PRIV (property);
 
+	if (g_atomic_int_get (&priv->use_gvdb)) {
+		property_load_gvdb (property);
+	}
+
 	return priv->indexed;
 }
 
@@ -455,6 +583,10 @@ tracker_property_get_secondary_index (TrackerProperty *property)
 
 	priv = GET_PRIV (property);
 
+	if (g_atomic_int_get (&priv->use_gvdb)) {
+		property_load_gvdb (property);
+	}
+
 	return priv->secondary_index;
 }
 
@@ -470,6 +602,10 @@ tracker_property_get_fulltext_indexed (TrackerProperty *property)
 
 	priv = GET_PRIV (property);
 
+	if (g_atomic_int_get (&priv->use_gvdb)) {
+		property_load_gvdb (property);
+	}
+
 	return priv->fulltext_indexed;
 }
 
@@ -482,6 +618,10 @@ tracker_property_get_fulltext_no_limit (TrackerProperty *property)
 
 	priv = GET_PRIV (property);
 
+	if (g_atomic_int_get (&priv->use_gvdb)) {
+		property_load_gvdb (property);
+	}
+
 	return priv->fulltext_no_limit;
 }
 
@@ -534,6 +674,44 @@ tracker_property_get_writeback (TrackerProperty *property)
 	return priv->writeback;
 }
 
+/* Only single valued string properties have a collation key column */
+gboolean
+tracker_property_get_collation_key (TrackerProperty *property)
+{
+	TrackerPropertyPrivate *priv;
+
+	g_return_val_if_fail (TRACKER_IS_PROPERTY (property), FALSE);
+
+	priv = GET_PRIV (property);
+
+	if (g_atomic_int_get (&priv->use_gvdb)) {
+		property_load_gvdb (property);
+	}
+
+	return priv->collation_key &&
+	       !priv->multiple_values &&
+	       tracker_property_get_data_type (property) == TRACKER_PROPERTY_TYPE_STRING;
+}
+
+/* Only single valued string properties have a trigram table */
+gboolean
+tracker_property_get_trigram_indexed (TrackerProperty *property)
+{
+	TrackerPropertyPrivate *priv;
+
+	g_return_val_if_fail (TRACKER_IS_PROPERTY (property), FALSE);
+
+	priv = GET_PRIV (property);
+
+	if (g_atomic_int_get (&priv->use_gvdb)) {
+		property_load_gvdb (property);
+	}
+
+	return priv->trigram_indexed &&
+	       !priv->multiple_values &&
+	       tracker_property_get_data_type (property) == TRACKER_PROPERTY_TYPE_STRING;
+}
+
 gboolean
 tracker_property_get_db_schema_changed (TrackerProperty *property)
 {
@@ -555,19 +733,8 @@ tracker_property_get_multiple_values (TrackerProperty *property)
 
 	priv = GET_PRIV (property);
 
-	if (priv->use_gvdb) {
-		GVariant *value;
-		gboolean result;
-
-		value = tracker_ontologies_get_property_value_gvdb (priv->uri, "max-cardinality");
-		if (value != NULL) {
-			result = FALSE;
-			g_variant_unref (value);
-		} else {
-			result = TRUE;
-		}
-
-		return result;
+	if (g_atomic_int_get (&priv->use_gvdb)) {
+		property_load_gvdb (property);
 	}
 
 	return priv->multiple_values;
@@ -594,19 +761,8 @@ tracker_property_get_is_inverse_functional_property (TrackerProperty *property)
 
 	priv = GET_PRIV (property);
 
-	if (priv->use_gvdb) {
-		GVariant *value;
-		gboolean result;
-
-		value = tracker_ontologies_get_property_value_gvdb (priv->uri, "inverse-functional");
-		if (value != NULL) {
-			result = g_variant_get_boolean (value);
-			g_variant_unref (value);
-		} else {
-			result = FALSE;
-		}
-
-		return result;
+	if (g_atomic_int_get (&priv->use_gvdb)) {
+		property_load_gvdb (property);
 	}
 
 	return priv->is_inverse_functional_property;
@@ -633,9 +789,49 @@ tracker_property_get_super_properties (TrackerProperty *property)
 
 	priv = GET_PRIV (property);
 
+	if (g_atomic_int_get (&priv->use_gvdb)) {
+		property_load_gvdb (property);
+	}
+
 	return (TrackerProperty **) priv->super_properties->data;
 }
 
+/* Average number of values per resource, from the index statistics of
+ * multi-valued properties, 1 if unknown */
+gdouble
+tracker_property_get_values_per_resource (TrackerProperty *property)
+{
+	TrackerPropertyPrivate *priv;
+
+	g_return_val_if_fail (TRACKER_IS_PROPERTY (property), 1);
+
+	priv = GET_PRIV (property);
+
+	if (g_atomic_int_get (&priv->use_gvdb)) {
+		property_load_gvdb (property);
+	}
+
+	return priv->values_per_resource;
+}
+
+/* Average number of resources per value, from the index statistics of
+ * indexed properties, 0 if unknown */
+gdouble
+tracker_property_get_resources_per_value (TrackerProperty *property)
+{
+	TrackerPropertyPrivate *priv;
+
+	g_return_val_if_fail (TRACKER_IS_PROPERTY (property), 0);
+
+	priv = GET_PRIV (property);
+
+	if (g_atomic_int_get (&priv->use_gvdb)) {
+		property_load_gvdb (property);
+	}
+
+	return priv->resources_per_value;
+}
+
 const gchar *
 tracker_property_get_default_value (TrackerProperty *property)
 {
@@ -943,6 +1139,58 @@ tracker_property_set_writeback (TrackerProperty *property,
 	priv->writeback = value;
 }
 
+void
+tracker_property_set_collation_key (TrackerProperty *property,
+                                    gboolean         value)
+{
+	TrackerPropertyPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_PROPERTY (property));
+
+	priv = GET_PRIV (property);
+
+	priv->collation_key = value;
+}
+
+void
+tracker_property_set_trigram_indexed (TrackerProperty *property,
+                                      gboolean         value)
+{
+	TrackerPropertyPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_PROPERTY (property));
+
+	priv = GET_PRIV (property);
+
+	priv->trigram_indexed = value;
+}
+
+void
+tracker_property_set_values_per_resource (TrackerProperty *property,
+                                          gdouble          value)
+{
+	TrackerPropertyPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_PROPERTY (property));
+
+	priv = GET_PRIV (property);
+
+	priv->values_per_resource = value;
+}
+
+void
+tracker_property_set_resources_per_value (TrackerProperty *property,
+                                          gdouble          value)
+{
+	TrackerPropertyPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_PROPERTY (property));
+
+	priv = GET_PRIV (property);
+
+	priv->resources_per_value = value;
+}
+
 void
 tracker_property_set_db_schema_changed (TrackerProperty *property,
                                         gboolean         value)
@@ -94,6 +94,10 @@ gboolean            tracker_property_get_is_new              (TrackerProperty
 gboolean            tracker_property_get_is_new_domain_index (TrackerProperty      *property,
                                                               TrackerClass         *class);
 gboolean            tracker_property_get_writeback           (TrackerProperty      *property);
+gboolean            tracker_property_get_collation_key       (TrackerProperty      *property);
+gboolean            tracker_property_get_trigram_indexed     (TrackerProperty      *property);
+gdouble             tracker_property_get_values_per_resource (TrackerProperty      *property);
+gdouble             tracker_property_get_resources_per_value (TrackerProperty      *property);
 const gchar *       tracker_property_get_default_value       (TrackerProperty      *property);
 gboolean            tracker_property_get_db_schema_changed   (TrackerProperty      *property);
 gboolean            tracker_property_get_is_inverse_functional_property
@@ -136,6 +140,14 @@ void                tracker_property_set_is_new_domain_index (TrackerProperty
                                                               gboolean              value);
 void                tracker_property_set_writeback           (TrackerProperty      *property,
                                                                gboolean              value);
+void                tracker_property_set_collation_key       (TrackerProperty      *property,
+                                                              gboolean              value);
+void                tracker_property_set_trigram_indexed     (TrackerProperty      *property,
+                                                              gboolean              value);
+void                tracker_property_set_values_per_resource (TrackerProperty      *property,
+                                                              gdouble               value);
+void                tracker_property_set_resources_per_value (TrackerProperty      *property,
+                                                              gdouble               value);
 void                tracker_property_set_default_value       (TrackerProperty      *property,
                                                               const gchar          *value);
 void                tracker_property_set_db_schema_changed   (TrackerProperty      *property,
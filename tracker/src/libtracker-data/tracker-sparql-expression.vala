@@ -21,11 +21,20 @@ class Tracker.Sparql.Expression : Object {
 	weak Query query;
 
 	const int MAX_VARIABLES_FOR_IN = 20;
+	// more trigrams rarely narrow down the candidates any further
+	const int MAX_TRIGRAMS = 8;
 	const string XSD_NS = "http://www.w3.org/2001/XMLSchema#";
 	const string FN_NS = "http://www.w3.org/2005/xpath-functions#";
 	const string FTS_NS = "http://www.tracker-project.org/ontologies/fts#";
 	const string TRACKER_NS = "http://www.tracker-project.org/ontologies/tracker#";
 
+	// last variable translated as a primary expression and the SQL it
+	// was translated to, see get_string_variable ()
+	Variable? plain_variable;
+	unowned StringBuilder? plain_variable_sql;
+	long plain_variable_begin;
+	long plain_variable_end;
+
 	public Expression (Query query) {
 		this.query = query;
 	}
@@ -209,23 +218,184 @@ class Tracker.Sparql.Expression : Object {
 
 	void translate_expression_as_order_condition (StringBuilder sql) throws Sparql.Error {
 		long begin = sql.len;
-		if (translate_expression (sql) == PropertyType.RESOURCE) {
+		var type = translate_expression (sql);
+		if (type == PropertyType.RESOURCE) {
 			// ID => Uri
 			sql.insert (begin, "(SELECT Uri FROM Resource WHERE ID = ");
 			sql.append (")");
+		} else if (type == PropertyType.STRING) {
+			var variable = get_string_variable (sql, begin);
+			if (variable != null && variable.collation_key) {
+				// plain variable with a stored collation key, compare
+				// the keys to avoid calling the collation function
+				sql.truncate (begin);
+				sql.append (variable.get_extra_sql_expression ("collationKey"));
+			}
+		}
+	}
+
+	// returns the variable if the string expression translated since begin
+	// consists of just that variable
+	Variable? get_string_variable (StringBuilder sql, long begin) {
+		if (last () != SparqlTokenType.VAR || plain_variable == null ||
+		    plain_variable.name != get_last_string ().substring (1) ||
+		    plain_variable_sql != sql ||
+		    plain_variable_begin != begin || plain_variable_end != sql.len ||
+		    plain_variable.binding.data_type != PropertyType.STRING) {
+			return null;
+		}
+
+		return plain_variable;
+	}
+
+	// appends a condition matching the rows that contain all trigrams of
+	// the given strings, a superset of the rows containing the strings
+	void append_trigram_filter (StringBuilder sql, Variable variable, string[] substrings) {
+		string[] trigrams = { };
+		foreach (string substring in substrings) {
+			foreach (string trigram in Trigram.split (substring)) {
+				if (!(trigram in trigrams)) {
+					trigrams += trigram;
+				}
+			}
+		}
+
+		if (trigrams.length == 0) {
+			// too short to use the index
+			return;
+		}
+
+		sql.append_printf (" AND %s IN (", variable.get_extra_sql_expression ("trigramId"));
+		for (int i = 0; i < trigrams.length && i < MAX_TRIGRAMS; i++) {
+			if (i > 0) {
+				sql.append (" INTERSECT ");
+			}
+			sql.append_printf ("SELECT ID FROM \"%s\" WHERE Trigram = ?", variable.trigram_table);
+
+			var binding = new LiteralBinding ();
+			binding.literal = trigrams[i];
+			query.bindings.append (binding);
+		}
+		sql.append (")");
+	}
+
+	static bool is_glob_literal (string str) {
+		return str.index_of_char ('*') < 0 && str.index_of_char ('?') < 0 && str.index_of_char ('[') < 0;
+	}
+
+	// returns literal substrings every match of the regular expression
+	// contains, or an empty array if the expression is too complex
+	static string[] get_regex_substrings (string regex, string flags) {
+		string[] substrings = { };
+
+		if ("x" in flags || "|" in regex) {
+			return substrings;
+		}
+
+		var literal = new StringBuilder ();
+		int depth = 0;
+		char* p = (char*) regex;
+
+		while (*p != '\0') {
+			char c = *p;
+			bool end_run = false;
+			bool drop_last = false;
+
+			if (c == '\\') {
+				char next = *(p + 1);
+				if (next == '\0') {
+					break;
+				} else if (next.isalnum ()) {
+					if ("dDwWsSbBAzZG".index_of_char (next) < 0) {
+						// \x41, \012, \cX, \p{..}, back references...
+						// span more characters, don't try to parse them
+						return { };
+					}
+					// character class or anchor
+					end_run = true;
+				} else if (depth == 0) {
+					literal.append_c (next);
+				}
+				p += 2;
+			} else if (c == '*' || c == '?') {
+				drop_last = true;
+				end_run = true;
+				p++;
+			} else if (c == '{') {
+				// {0,n} makes the previous character optional
+				drop_last = true;
+				end_run = true;
+				while (*p != '\0' && *p != '}') {
+					p++;
+				}
+				if (*p == '}') {
+					p++;
+				}
+			} else if (c == '[') {
+				end_run = true;
+				p++;
+				if (*p == '^') {
+					p++;
+				}
+				if (*p == ']') {
+					p++;
+				}
+				while (*p != '\0' && *p != ']') {
+					p++;
+				}
+				if (*p == ']') {
+					p++;
+				}
+			} else if (c == '(') {
+				depth++;
+				end_run = true;
+				p++;
+			} else if (c == ')') {
+				depth--;
+				end_run = true;
+				p++;
+			} else if (c == '.' || c == '^' || c == '$' || c == '+') {
+				// the character before + is required, keep it
+				end_run = true;
+				p++;
+			} else {
+				if (depth == 0) {
+					literal.append_c (c);
+				}
+				p++;
+			}
+
+			if (drop_last && literal.len > 0) {
+				// remove the last UTF-8 character
+				long last_char = literal.len - 1;
+				while (last_char > 0 && (((uchar) literal.str[last_char]) & 0xc0) == 0x80) {
+					last_char--;
+				}
+				literal.truncate (last_char);
+			}
+
+			if (end_run && literal.len > 0) {
+				substrings += literal.str;
+				literal.truncate (0);
+			}
 		}
+
+		if (literal.len > 0) {
+			substrings += literal.str;
+		}
+
+		return substrings;
 	}
 
-	internal void translate_order_condition (StringBuilder sql) throws Sparql.Error {
+	// returns whether the condition is descending, the direction is left to the caller
+	internal bool translate_order_condition (StringBuilder sql) throws Sparql.Error {
+		bool descending = false;
 		if (accept (SparqlTokenType.ASC)) {
-			translate_expression_as_order_condition (sql);
-			sql.append (" ASC");
 		} else if (accept (SparqlTokenType.DESC)) {
-			translate_expression_as_order_condition (sql);
-			sql.append (" DESC");
-		} else {
-			translate_expression_as_order_condition (sql);
+			descending = true;
 		}
+		translate_expression_as_order_condition (sql);
+		return descending;
 	}
 
 	void translate_bound_call (StringBuilder sql) throws Sparql.Error {
@@ -265,23 +435,32 @@ class Tracker.Sparql.Expression : Object {
 	void translate_regex (StringBuilder sql) throws Sparql.Error {
 		expect (SparqlTokenType.REGEX);
 		expect (SparqlTokenType.OPEN_PARENS);
-		sql.append ("SparqlRegex(");
+		sql.append ("(SparqlRegex(");
+		long begin = sql.len;
 		translate_expression_as_string (sql);
+		var variable = get_string_variable (sql, begin);
 		sql.append (", ");
 		expect (SparqlTokenType.COMMA);
 		// SQLite's sqlite3_set_auxdata doesn't work correctly with bound
 		// strings for the regex in function_sparql_regex.
 		// translate_expression (sql);
-		sql.append (escape_sql_string_literal (parse_string_literal ()));
+		string regex = parse_string_literal ();
+		sql.append (escape_sql_string_literal (regex));
 		sql.append (", ");
+		string flags = "";
 		if (accept (SparqlTokenType.COMMA)) {
 			// Same as above
 			// translate_expression (sql);
-			sql.append (escape_sql_string_literal (parse_string_literal ()));
+			flags = parse_string_literal ();
+			sql.append (escape_sql_string_literal (flags));
 		} else {
 			sql.append ("''");
 		}
 		sql.append (")");
+		if (variable != null && variable.trigram_table != null) {
+			append_trigram_filter (sql, variable, get_regex_substrings (regex, flags));
+		}
+		sql.append (")");
 		expect (SparqlTokenType.CLOSE_PARENS);
 	}
 
@@ -465,15 +644,22 @@ class Tracker.Sparql.Expression : Object {
 		} else if (uri == FN_NS + "contains") {
 			// fn:contains('A','B') => 'A' GLOB '*B*'
 			sql.append ("(");
+			long begin = sql.len;
 			translate_expression_as_string (sql);
+			var variable = get_string_variable (sql, begin);
 			sql.append (" GLOB ");
 			expect (SparqlTokenType.COMMA);
 
 			sql.append ("?");
+			string substring = parse_string_literal ();
 			var binding = new LiteralBinding ();
-			binding.literal = "*%s*".printf (parse_string_literal ());
+			binding.literal = "*%s*".printf (substring);
 			query.bindings.append (binding);
 
+			if (variable != null && variable.trigram_table != null && is_glob_literal (substring)) {
+				append_trigram_filter (sql, variable, { substring });
+			}
+
 			sql.append (")");
 
 			return PropertyType.BOOLEAN;
@@ -503,15 +689,22 @@ class Tracker.Sparql.Expression : Object {
 		} else if (uri == FN_NS + "ends-with") {
 			// fn:ends-with('A','B') => 'A' GLOB '*B'
 			sql.append ("(");
+			long begin = sql.len;
 			translate_expression_as_string (sql);
+			var variable = get_string_variable (sql, begin);
 			sql.append (" GLOB ");
 			expect (SparqlTokenType.COMMA);
 
 			sql.append ("?");
+			string suffix = parse_string_literal ();
 			var binding = new LiteralBinding ();
-			binding.literal = "*%s".printf (parse_string_literal ());
+			binding.literal = "*%s".printf (suffix);
 			query.bindings.append (binding);
 
+			if (variable != null && variable.trigram_table != null && is_glob_literal (suffix)) {
+				append_trigram_filter (sql, variable, { suffix });
+			}
+
 			sql.append (")");
 
 			return PropertyType.BOOLEAN;
@@ -1035,6 +1228,7 @@ class Tracker.Sparql.Expression : Object {
 			next ();
 			string variable_name = get_last_string ().substring (1);
 			var variable = context.get_variable (variable_name);
+			long begin = sql.len;
 			sql.append (variable.sql_expression);
 
 			if (variable.binding == null) {
@@ -1043,6 +1237,12 @@ class Tracker.Sparql.Expression : Object {
 				if (variable.binding.data_type == PropertyType.STRING) {
 					append_collate (sql);
 				}
+
+				plain_variable = variable;
+				plain_variable_sql = sql;
+				plain_variable_begin = begin;
+				plain_variable_end = sql.len;
+
 				return variable.binding.data_type;
 			}
 		case SparqlTokenType.STR:
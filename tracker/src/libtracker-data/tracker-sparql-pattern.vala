@@ -163,6 +163,16 @@ class Tracker.Sparql.Pattern : Object {
 
 	int next_table_index;
 
+	// row estimates for tables without class counts
+	const double FTS_MATCH_ROWS = 100;
+	const double PROPERTIES_PER_RESOURCE = 20;
+	// fraction of rows expected to match a literal object
+	const double INDEXED_SELECTIVITY = 0.01;
+	const double UNINDEXED_SELECTIVITY = 0.1;
+
+	// set by UNION and subqueries, which may yield the same solution twice
+	bool pattern_has_duplicates;
+
 	internal string current_graph;
 	bool current_graph_is_var;
 	string current_subject;
@@ -254,8 +264,10 @@ class Tracker.Sparql.Pattern : Object {
 
 		expect (SparqlTokenType.SELECT);
 
+		bool distinct = false;
 		if (accept (SparqlTokenType.DISTINCT)) {
 			sql.append ("DISTINCT ");
+			distinct = true;
 		} else if (accept (SparqlTokenType.REDUCED)) {
 		}
 
@@ -270,6 +282,10 @@ class Tracker.Sparql.Pattern : Object {
 
 		accept (SparqlTokenType.WHERE);
 
+		if (!subquery && !scalar_subquery) {
+			pattern_has_duplicates = false;
+		}
+
 		var pattern = translate_group_graph_pattern (pattern_sql);
 		foreach (var key in pattern.var_set.get_keys ()) {
 			context.var_set.insert (key, VariableState.BOUND);
@@ -344,14 +360,20 @@ class Tracker.Sparql.Pattern : Object {
 			sql.append ("NULL");
 		}
 
+		long select_end = sql.len;
+
 		// select from results of WHERE clause
 		sql.append (" FROM (");
 		sql.append (pattern_sql.str);
 		sql.append (")");
 
+		long from_end = sql.len;
+
 		set_location (after_where);
 
+		bool grouped = false;
 		if (accept (SparqlTokenType.GROUP)) {
+			grouped = true;
 			expect (SparqlTokenType.BY);
 			sql.append (" GROUP BY ");
 			bool first_group = true;
@@ -370,6 +392,11 @@ class Tracker.Sparql.Pattern : Object {
 			}
 		}
 
+		// sort keys are needed again for keyset pagination
+		string[] order_expressions = {};
+		bool[] order_descending = {};
+		uint n_order_bindings = query.bindings.length ();
+
 		if (accept (SparqlTokenType.ORDER)) {
 			expect (SparqlTokenType.BY);
 			sql.append (" ORDER BY ");
@@ -380,29 +407,52 @@ class Tracker.Sparql.Pattern : Object {
 				} else {
 					sql.append (", ");
 				}
-				expression.translate_order_condition (sql);
+				var order_sql = new StringBuilder ();
+				bool descending = expression.translate_order_condition (order_sql);
+				sql.append (order_sql.str);
+				if (descending) {
+					sql.append (" DESC");
+				}
+				order_expressions += order_sql.str;
+				order_descending += descending;
 			} while (current () != SparqlTokenType.LIMIT && current () != SparqlTokenType.OFFSET && current () != SparqlTokenType.CLOSE_BRACE && current () != SparqlTokenType.CLOSE_PARENS && current () != SparqlTokenType.EOF);
 		}
 
+		n_order_bindings = query.bindings.length () - n_order_bindings;
+
 		int limit = -1;
 		int offset = -1;
+		string? continuation = null;
 
 		if (accept (SparqlTokenType.LIMIT)) {
 			expect (SparqlTokenType.INTEGER);
 			limit = int.parse (get_last_string ());
 			if (accept (SparqlTokenType.OFFSET)) {
-				expect (SparqlTokenType.INTEGER);
-				offset = int.parse (get_last_string ());
+				offset = parse_offset (out continuation);
 			}
 		} else if (accept (SparqlTokenType.OFFSET)) {
-			expect (SparqlTokenType.INTEGER);
-			offset = int.parse (get_last_string ());
+			offset = parse_offset (out continuation);
 			if (accept (SparqlTokenType.LIMIT)) {
 				expect (SparqlTokenType.INTEGER);
 				limit = int.parse (get_last_string ());
 			}
 		}
 
+		if (continuation != null) {
+			if (subquery || scalar_subquery) {
+				throw get_error ("continuation tokens are only supported in the outermost SELECT");
+			}
+			if (distinct || grouped) {
+				throw get_error ("continuation tokens cannot be used with DISTINCT or GROUP BY");
+			}
+			if (n_order_bindings > 0) {
+				// the sort keys are repeated in the seek condition and the token column
+				throw get_error ("continuation tokens cannot be used with literals in ORDER BY");
+			}
+
+			translate_keyset_pagination (sql, result, pattern, select_end, from_end, order_expressions, order_descending, continuation);
+		}
+
 		// LIMIT and OFFSET
 		if (limit >= 0) {
 			sql.append (" LIMIT ?");
@@ -436,6 +486,195 @@ class Tracker.Sparql.Pattern : Object {
 		return result;
 	}
 
+	// OFFSET takes either a number of rows or a continuation token
+	int parse_offset (out string? continuation) throws Sparql.Error {
+		continuation = null;
+
+		switch (current ()) {
+		case SparqlTokenType.STRING_LITERAL1:
+		case SparqlTokenType.STRING_LITERAL2:
+			continuation = expression.parse_string_literal ();
+			return -1;
+		default:
+			expect (SparqlTokenType.INTEGER);
+			return int.parse (get_last_string ());
+		}
+	}
+
+	/*
+	 * Keyset pagination: instead of skipping rows, OFFSET "token" seeks past
+	 * the last row of the previous page. Every row gets an extra column with
+	 * the token that resumes after it, made of its seek key: the sort keys,
+	 * followed by every selected variable of the WHERE pattern, which break
+	 * ties. OFFSET "" starts at the first row.
+	 *
+	 * The seek key must be unique, or rows sharing it with the last row of a
+	 * page would be skipped, so all variables of the pattern need to be
+	 * selected, and patterns that may repeat solutions are rejected.
+	 */
+	void translate_keyset_pagination (StringBuilder sql, SelectContext result, Context where_context, long select_end, long from_end, string[] order_expressions, bool[] order_descending, string continuation) throws Sparql.Error {
+		string[] keys = order_expressions;
+		bool[] descending = order_descending;
+		var key_var_set = new HashTable<Variable,int>.full (Variable.hash, Variable.equal, g_object_unref, null);
+
+		foreach (unowned string name in result.variable_names) {
+			unowned Variable? variable = context.var_map.lookup (name);
+			if (variable == null || where_context.var_set.lookup (variable) == 0 ||
+			    key_var_set.lookup (variable) != 0) {
+				continue;
+			}
+
+			// resource IDs for resources, values for literals
+			keys += variable.sql_expression;
+			descending += false;
+			key_var_set.insert (variable, VariableState.BOUND);
+		}
+
+		if (key_var_set.size () == 0) {
+			throw get_error ("continuation tokens require a selected variable of the WHERE pattern");
+		}
+
+		foreach (var variable in where_context.var_set.get_keys ()) {
+			if (key_var_set.lookup (variable) == 0) {
+				throw get_error ("continuation tokens require variable `%s' to be selected".printf (variable.name));
+			}
+		}
+
+		if (pattern_has_duplicates) {
+			throw get_error ("continuation tokens cannot be used with UNION or subqueries");
+		}
+
+		// seek past the last row of the previous page, NULL sorts first
+		if (continuation != "") {
+			var values = parse_continuation (continuation, keys.length);
+			var seek = new StringBuilder (" WHERE ");
+			int last = keys.length - 1;
+
+			for (int i = 0; i < last; i++) {
+				unowned string key = keys[i];
+				var value = values[i];
+
+				if (value == null && !descending[i]) {
+					seek.append_printf ("(%s IS NOT NULL OR (%s IS NULL AND ", key, key);
+				} else if (value == null) {
+					seek.append_printf ("((%s IS NULL AND ", key);
+				} else if (!descending[i]) {
+					seek.append_printf ("(%s > ? OR (%s = ? AND ", key, key);
+					query.bindings.append (value);
+					query.bindings.append (value);
+				} else {
+					seek.append_printf ("(%s < ? OR %s IS NULL OR (%s = ? AND ", key, key, key);
+					query.bindings.append (value);
+					query.bindings.append (value);
+				}
+			}
+
+			// selected variables are always ascending
+			if (values[last] == null) {
+				seek.append_printf ("%s IS NOT NULL", keys[last]);
+			} else {
+				seek.append_printf ("%s > ?", keys[last]);
+				query.bindings.append (values[last]);
+			}
+
+			for (int i = 0; i < last; i++) {
+				seek.append ("))");
+			}
+
+			sql.insert (from_end, seek.str);
+		}
+
+		// order by the selected variables last to make the order total
+		var order = new StringBuilder ();
+		for (int i = order_expressions.length; i < keys.length; i++) {
+			order.append_printf (", %s", keys[i]);
+		}
+		if (order_expressions.length > 0) {
+			sql.append (order.str);
+		} else {
+			sql.append_printf (" ORDER BY %s", order.str.substring (2));
+		}
+
+		var token = new StringBuilder (", ");
+		for (int i = 0; i < keys.length; i++) {
+			if (i > 0) {
+				token.append (" || ',' || ");
+			}
+			token.append_printf ("quote(%s)", keys[i]);
+		}
+		token.append (" AS \"continuation\"");
+		sql.insert (select_end, token.str);
+
+		result.types += PropertyType.STRING;
+		result.variable_names += "continuation";
+	}
+
+	// splits a continuation token into bindings, in the format written by
+	// SQLite quote (), NULL values are returned as null
+	LiteralBinding?[] parse_continuation (string continuation, int n_values) throws Sparql.Error {
+		LiteralBinding?[] values = {};
+		int i = 0;
+
+		while (true) {
+			LiteralBinding? value = null;
+
+			if (continuation[i] == '\'') {
+				var literal = new StringBuilder ();
+				for (i++; ; i++) {
+					if (continuation[i] == '\0') {
+						throw get_error ("invalid continuation token");
+					} else if (continuation[i] == '\'') {
+						if (continuation[i + 1] != '\'') {
+							break;
+						}
+						i++;
+					}
+					literal.append_c (continuation[i]);
+				}
+				i++;
+
+				value = new LiteralBinding ();
+				value.literal = literal.str;
+				value.data_type = PropertyType.STRING;
+			} else if (continuation.substring (i).has_prefix ("NULL")) {
+				i += 4;
+			} else {
+				int begin = i;
+				bool is_integer = true;
+				while (continuation[i].isdigit () || continuation[i] == '-' || continuation[i] == '+' ||
+				       continuation[i] == '.' || continuation[i] == 'e' || continuation[i] == 'E') {
+					if (!continuation[i].isdigit () && continuation[i] != '-') {
+						is_integer = false;
+					}
+					i++;
+				}
+				if (i == begin) {
+					throw get_error ("invalid continuation token");
+				}
+
+				value = new LiteralBinding ();
+				value.literal = continuation.substring (begin, i - begin);
+				// bound as 64-bit, IDs and sort keys may not fit into int
+				value.data_type = is_integer ? PropertyType.INTEGER : PropertyType.DOUBLE;
+			}
+
+			values += value;
+
+			if (continuation[i] == '\0') {
+				break;
+			} else if (continuation[i] != ',') {
+				throw get_error ("invalid continuation token");
+			}
+			i++;
+		}
+
+		if (values.length != n_values) {
+			throw get_error ("invalid continuation token");
+		}
+
+		return values;
+	}
+
 	internal void translate_exists (StringBuilder sql) throws Sparql.Error {
 		bool not = accept (SparqlTokenType.NOT);
 		expect (SparqlTokenType.EXISTS);
@@ -647,9 +886,13 @@ class Tracker.Sparql.Pattern : Object {
 
 		sql.append (" FROM ");
 		bool first = true;
-		foreach (DataTable table in triple_context.tables) {
+		if (query.plan != null) {
+			query.plan.append ("Triples block:\n");
+		}
+		foreach (DataTable table in order_tables ()) {
 			if (!first) {
-				sql.append (", ");
+				// SQLite keeps the table order of a CROSS JOIN
+				sql.append (" CROSS JOIN ");
 			} else {
 				first = false;
 			}
@@ -659,6 +902,13 @@ class Tracker.Sparql.Pattern : Object {
 				sql.append_printf ("(%s)", table.predicate_variable.get_sql_query (query));
 			}
 			sql.append_printf (" AS \"%s\"", table.sql_query_tablename);
+
+			if (query.plan != null) {
+				query.plan.append_printf ("  %s (%s): ~%.0f rows\n",
+				                          table.sql_query_tablename,
+				                          table.sql_db_tablename ?? "predicate variable",
+				                          table.estimated_rows);
+			}
 		}
 
 		foreach (var variable in triple_context.variables) {
@@ -753,6 +1003,102 @@ class Tracker.Sparql.Pattern : Object {
 		context = context.parent_context;
 	}
 
+	// Orders the tables of the current triples block by estimated size,
+	// starting with the smallest and preferring tables that join with an
+	// already ordered table to avoid cartesian products
+	List<DataTable> order_tables () {
+		DataTable[] tables = { };
+		foreach (DataTable table in triple_context.tables) {
+			tables += table;
+		}
+
+		var joined = new bool[tables.length];
+		var ordered_flags = new bool[tables.length];
+		var ordered = new List<DataTable> ();
+
+		for (int n = 0; n < tables.length; n++) {
+			int best = -1;
+			for (int i = 0; i < tables.length; i++) {
+				if (ordered_flags[i]) {
+					continue;
+				}
+				if (best == -1
+				    || (joined[i] && !joined[best])
+				    || (joined[i] == joined[best] && tables[i].estimated_rows < tables[best].estimated_rows)) {
+					best = i;
+				}
+			}
+
+			ordered_flags[best] = true;
+			ordered.append (tables[best]);
+
+			// tables sharing a variable with the chosen table can be joined next
+			foreach (var variable in triple_context.variables) {
+				unowned List<VariableBinding> list = triple_context.var_bindings.lookup (variable).list;
+
+				bool uses_table = false;
+				foreach (VariableBinding binding in list) {
+					if (binding.table == tables[best]) {
+						uses_table = true;
+						break;
+					}
+				}
+				if (!uses_table) {
+					continue;
+				}
+
+				foreach (VariableBinding binding in list) {
+					for (int i = 0; i < tables.length; i++) {
+						if (binding.table == tables[i]) {
+							joined[i] = true;
+						}
+					}
+				}
+			}
+		}
+
+		return ordered;
+	}
+
+	double estimate_table_rows (Class? table_class, Property? prop) {
+		if (table_class == null) {
+			// fts:match
+			return FTS_MATCH_ROWS;
+		}
+
+		double rows = double.max (table_class.count, 1);
+		if (prop != null && prop.multiple_values) {
+			rows *= prop.values_per_resource;
+		}
+		return rows;
+	}
+
+	double estimate_literal_rows (DataTable table, Property prop, string object) {
+		if (prop.uri == "http://www.w3.org/1999/02/22-rdf-syntax-ns#type") {
+			// rdf:type within GRAPH, the class count is exact
+			var cl = Ontologies.get_class_by_uri (object);
+			if (cl != null) {
+				return double.max (cl.count, 1);
+			}
+		}
+
+		if (prop.is_inverse_functional_property) {
+			return 1;
+		} else if (prop.resources_per_value > 0) {
+			return prop.resources_per_value;
+		} else if (prop.indexed) {
+			return table.estimated_rows * INDEXED_SELECTIVITY;
+		} else {
+			return table.estimated_rows * UNINDEXED_SELECTIVITY;
+		}
+	}
+
+	void restrict_rows (DataTable table, double rows) {
+		if (rows < table.estimated_rows) {
+			table.estimated_rows = rows;
+		}
+	}
+
 	void parse_triples (StringBuilder sql, long group_graph_pattern_start, ref bool in_triples_block, ref bool first_where, ref bool in_group_graph_pattern, bool found_simple_optional) throws Sparql.Error {
 		while (true) {
 			if (current () != SparqlTokenType.VAR &&
@@ -890,11 +1236,18 @@ class Tracker.Sparql.Pattern : Object {
 		if (current () == SparqlTokenType.SELECT) {
 			var result = translate_select (sql, true);
 			context = result;
+			pattern_has_duplicates = true;
 
 			// only export selected variables
 			context.var_set = context.select_var_set;
 			context.select_var_set = new HashTable<Variable,int>.full (Variable.hash, Variable.equal, g_object_unref, null);
 
+			// extra columns are not selected by subqueries
+			foreach (var v in context.var_set.get_keys ()) {
+				v.collation_key = false;
+				v.trigram_table = null;
+			}
+
 			expect (SparqlTokenType.CLOSE_BRACE);
 
 			context = context.parent_context;
@@ -967,9 +1320,8 @@ class Tracker.Sparql.Pattern : Object {
 							context.parent_context.var_set.insert (v, VariableState.OPTIONAL);
 							select.append_printf ("t%d_g.%s", right_index, v.sql_expression);
 
-							if (v.binding.data_type == PropertyType.DATETIME) {
-								select.append_printf (", t%d_g.%s", right_index, v.get_extra_sql_expression ("localDate"));
-								select.append_printf (", t%d_g.%s", right_index, v.get_extra_sql_expression ("localTime"));
+							foreach (var suffix in v.get_extra_suffixes ()) {
+								select.append_printf (", t%d_g.%s", right_index, v.get_extra_sql_expression (suffix));
 							}
 						} else {
 							if (first_common) {
@@ -984,18 +1336,16 @@ class Tracker.Sparql.Pattern : Object {
 								sql.append_printf ("t%d_g.%s = t%d_g.%s", left_index, v.sql_expression, right_index, v.sql_expression);
 								select.append_printf ("t%d_g.%s", left_index, v.sql_expression);
 
-								if (v.binding.data_type == PropertyType.DATETIME) {
-									select.append_printf (", t%d_g.%s", left_index, v.get_extra_sql_expression ("localDate"));
-									select.append_printf (", t%d_g.%s", left_index, v.get_extra_sql_expression ("localTime"));
+								foreach (var suffix in v.get_extra_suffixes ()) {
+									select.append_printf (", t%d_g.%s", left_index, v.get_extra_sql_expression (suffix));
 								}
 							} else if (old_state == VariableState.OPTIONAL) {
 								// variable maybe bound in non-optional part
 								sql.append_printf ("(t%d_g.%s IS NULL OR t%d_g.%s = t%d_g.%s)", left_index, v.sql_expression, left_index, v.sql_expression, right_index, v.sql_expression);
 								select.append_printf ("COALESCE (t%d_g.%s, t%d_g.%s) AS %s", left_index, v.sql_expression, right_index, v.sql_expression, v.sql_expression);
 
-								if (v.binding.data_type == PropertyType.DATETIME) {
-									select.append_printf (", COALESCE (t%d_g.%s, t%d_g.%s) AS %s", left_index, v.get_extra_sql_expression ("localDate"), right_index, v.get_extra_sql_expression ("localDate"), v.get_extra_sql_expression ("localDate"));
-									select.append_printf (", COALESCE (t%d_g.%s, t%d_g.%s) AS %s", left_index, v.get_extra_sql_expression ("localTime"), right_index, v.get_extra_sql_expression ("localTime"), v.get_extra_sql_expression ("localTime"));
+								foreach (var suffix in v.get_extra_suffixes ()) {
+									select.append_printf (", COALESCE (t%d_g.%s, t%d_g.%s) AS %s", left_index, v.get_extra_sql_expression (suffix), right_index, v.get_extra_sql_expression (suffix), v.get_extra_sql_expression (suffix));
 								}
 							}
 						}
@@ -1011,9 +1361,8 @@ class Tracker.Sparql.Pattern : Object {
 
 							select.append_printf ("t%d_g.%s", left_index, v.sql_expression);
 
-							if (v.binding.data_type == PropertyType.DATETIME) {
-								select.append_printf (", t%d_g.%s", left_index, v.get_extra_sql_expression ("localDate"));
-								select.append_printf (", t%d_g.%s", left_index, v.get_extra_sql_expression ("localTime"));
+							foreach (var suffix in v.get_extra_suffixes ()) {
+								select.append_printf (", t%d_g.%s", left_index, v.get_extra_sql_expression (suffix));
 							}
 						}
 					}
@@ -1145,6 +1494,7 @@ class Tracker.Sparql.Pattern : Object {
 
 		if (contexts.length > 1) {
 			// union graph pattern
+			pattern_has_duplicates = true;
 
 			// create union of all variables
 			foreach (var sub_context in contexts) {
@@ -1153,6 +1503,9 @@ class Tracker.Sparql.Pattern : Object {
 						all_vars += v;
 						all_var_set.insert (v, VariableState.BOUND);
 						context.var_set.insert (v, VariableState.BOUND);
+						// extra columns are not projected
+						v.collation_key = false;
+						v.trigram_table = null;
 					}
 				}
 			}
@@ -1243,6 +1596,25 @@ class Tracker.Sparql.Pattern : Object {
 					binding.variable.get_extra_sql_expression ("localTime"));
 			}
 
+			if (binding.collation_key && (binding.variable.binding == null || binding.variable.collation_key)) {
+				sql.append_printf ("%s AS %s, ",
+					binding.get_extra_sql_expression ("collationKey"),
+					binding.variable.get_extra_sql_expression ("collationKey"));
+				binding.variable.collation_key = true;
+			} else {
+				binding.variable.collation_key = false;
+			}
+
+			// the row IDs are only usable if all of them refer to the same table
+			if (binding.trigram_table != null && (binding.variable.binding == null || binding.variable.trigram_table == binding.trigram_table)) {
+				sql.append_printf ("\"%s\".ID AS %s, ",
+					binding.table.sql_query_tablename,
+					binding.variable.get_extra_sql_expression ("trigramId"));
+				binding.variable.trigram_table = binding.trigram_table;
+			} else {
+				binding.variable.trigram_table = null;
+			}
+
 			context.var_set.insert (binding.variable, variable_state);
 		}
 		binding_list.list.append (binding);
@@ -1267,6 +1639,7 @@ class Tracker.Sparql.Pattern : Object {
 		Property prop = null;
 
 		Class subject_type = null;
+		Class table_class = null;
 
 		if (!current_predicate_is_var) {
 			prop = Ontologies.get_property_by_uri (current_predicate);
@@ -1282,6 +1655,7 @@ class Tracker.Sparql.Pattern : Object {
 				}
 				db_table = cl.name;
 				subject_type = cl;
+				table_class = cl;
 			} else if (prop == null) {
 				if (current_predicate == "http://www.tracker-project.org/ontologies/fts#match") {
 					// fts:match
@@ -1319,6 +1693,7 @@ class Tracker.Sparql.Pattern : Object {
 							foreach (VariableBinding b in list.list) {
 								if (b.type == cl) {
 									db_table = cl.name;
+									table_class = cl;
 									stop = true;
 									break;
 								}
@@ -1330,8 +1705,10 @@ class Tracker.Sparql.Pattern : Object {
 					}
 				}
 
-				if (db_table == null)
+				if (db_table == null) {
 					db_table = prop.table_name;
+					table_class = prop.domain;
+				}
 
 				if (prop.multiple_values) {
 					// we can never share the table with multiple triples
@@ -1371,6 +1748,9 @@ class Tracker.Sparql.Pattern : Object {
 				}
 			}
 			table = get_table (current_subject, db_table, share_table, out newtable);
+			if (newtable) {
+				table.estimated_rows = estimate_table_rows (table_class, rdftype ? null : prop);
+			}
 		} else {
 			// variable in predicate
 			newtable = true;
@@ -1394,6 +1774,16 @@ class Tracker.Sparql.Pattern : Object {
 			table.sql_query_tablename = current_predicate + (++counter).to_string ();
 			triple_context.tables.append (table);
 
+			if (!current_subject_is_var) {
+				table.estimated_rows = PROPERTIES_PER_RESOURCE;
+			} else {
+				var resource = Ontologies.get_class_by_uri ("http://www.w3.org/2000/01/rdf-schema#Resource");
+				table.estimated_rows = double.max (resource.count, 1) * PROPERTIES_PER_RESOURCE;
+				if (!object_is_var) {
+					table.estimated_rows *= UNINDEXED_SELECTIVITY;
+				}
+			}
+
 			// add to variable list
 			var binding = new VariableBinding ();
 			binding.data_type = PropertyType.RESOURCE;
@@ -1426,6 +1816,14 @@ class Tracker.Sparql.Pattern : Object {
 				binding.table = table;
 				binding.sql_db_column_name = "ID";
 				triple_context.bindings.append (binding);
+
+				if (table.predicate_variable != null) {
+					// already estimated for the single subject
+				} else if (prop != null && prop.multiple_values && !rdftype) {
+					restrict_rows (table, prop.values_per_resource);
+				} else {
+					restrict_rows (table, 1);
+				}
 			}
 		}
 
@@ -1446,6 +1844,11 @@ class Tracker.Sparql.Pattern : Object {
 						binding.maybe_null = true;
 						binding.in_simple_optional = in_simple_optional;
 					}
+					// domain index tables do not carry collation keys
+					binding.collation_key = prop.collation_key && db_table == prop.table_name;
+					if (prop.trigram_indexed && db_table == prop.table_name) {
+						binding.trigram_table = Trigram.get_table_name (prop.domain.name, prop.name);
+					}
 				} else {
 					// variable as predicate
 					binding.data_type = PropertyType.STRING;
@@ -1484,6 +1887,7 @@ class Tracker.Sparql.Pattern : Object {
 				if (prop != null) {
 					binding.data_type = prop.data_type;
 					binding.sql_db_column_name = prop.name;
+					restrict_rows (table, estimate_literal_rows (table, prop, object));
 				} else {
 					// variable as predicate
 					binding.sql_db_column_name = "object";
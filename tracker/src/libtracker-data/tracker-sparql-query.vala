@@ -29,6 +29,8 @@ namespace Tracker.Sparql {
 		public string sql_db_tablename; // as in db schema
 		public string sql_query_tablename; // temp. name, generated
 		public PredicateVariable predicate_variable;
+		// estimated number of rows matching the triple patterns, used to order joins
+		public double estimated_rows;
 	}
 
 	abstract class DataBinding : Object {
@@ -65,6 +67,10 @@ namespace Tracker.Sparql {
 		public bool maybe_null;
 		public bool in_simple_optional;
 		public Class? type;
+		// Specifies whether the table has a collation key column for the value
+		public bool collation_key;
+		// Trigram table of the value, keyed by the row ID
+		public string? trigram_table;
 	}
 
 	class VariableBindingList : Object {
@@ -76,6 +82,11 @@ namespace Tracker.Sparql {
 		public int index { get; private set; }
 		public string sql_expression { get; private set; }
 		public VariableBinding binding;
+		// Specifies whether a collation key column is selected for the variable
+		public bool collation_key;
+		// Trigram table of the value if the ID of the row holding the
+		// value is selected
+		public string? trigram_table;
 		string sql_identifier;
 
 		public Variable (string name, int index) {
@@ -89,6 +100,22 @@ namespace Tracker.Sparql {
 			return "\"%s:%s\"".printf (sql_identifier, suffix);
 		}
 
+		// Suffixes of the columns selected along with the variable
+		public string[] get_extra_suffixes () {
+			string[] suffixes = { };
+			if (binding.data_type == PropertyType.DATETIME) {
+				suffixes += "localDate";
+				suffixes += "localTime";
+			}
+			if (collation_key) {
+				suffixes += "collationKey";
+			}
+			if (trigram_table != null) {
+				suffixes += "trigramId";
+			}
+			return suffixes;
+		}
+
 		public static bool equal (Variable a, Variable b) {
 			return a.index == b.index;
 		}
@@ -230,6 +257,9 @@ public class Tracker.Sparql.Query : Object {
 
 	internal Context context;
 
+	// Join order chosen for every triples block, only collected by explain ()
+	internal StringBuilder? plan;
+
 	bool delete_statements;
 	bool update_statements;
 
@@ -243,6 +273,14 @@ public class Tracker.Sparql.Query : Object {
 
 	public bool no_cache { get; set; }
 
+	// Profile of the last execute_cursor () call. Parsing only covers the
+	// prologue as the rest of the query is parsed while translating it,
+	// times are in seconds
+	public double parse_time { get; private set; }
+	public double translate_time { get; private set; }
+	public double prepare_time { get; private set; }
+	public string? generated_sql { get; private set; }
+
 	public Query (string query) {
 		no_cache = false; /* Start with false, expression sets it */
 		tokens = new TokenInfo[BUFFER_SIZE];
@@ -414,9 +452,12 @@ public class Tracker.Sparql.Query : Object {
 
 
 	public DBCursor? execute_cursor (bool threadsafe) throws DBInterfaceError, Sparql.Error, DateError {
+		var timer = new Timer ();
 
 		prepare_execute ();
 
+		parse_time = timer.elapsed ();
+
 		switch (current ()) {
 		case SparqlTokenType.SELECT:
 			return execute_select_cursor (threadsafe);
@@ -498,6 +539,53 @@ public class Tracker.Sparql.Query : Object {
 		return result;
 	}
 
+	/*
+	 * Describes how a SELECT or ASK query would be executed without running
+	 * it: the join order and row estimates of every triples block, the
+	 * generated SQL and the SQLite query plan.
+	 */
+	public string explain () throws GLib.Error {
+		prepare_execute ();
+
+		if (current () != SparqlTokenType.SELECT && current () != SparqlTokenType.ASK) {
+			throw get_error ("expected SELECT or ASK");
+		}
+
+		plan = new StringBuilder ();
+
+		try {
+			string sql;
+			if (current () == SparqlTokenType.SELECT) {
+				SelectContext context;
+				sql = get_select_query (out context);
+			} else {
+				sql = get_ask_query ();
+			}
+
+			var result = new StringBuilder ();
+			result.append ("Join order:\n");
+			result.append (plan.str);
+			result.append_printf ("\nSQL:\n%s\n\nSQLite plan:\n", sql);
+
+			no_cache = true;
+			var cursor = prepare_for_exec ("EXPLAIN QUERY PLAN " + sql).start_cursor ();
+			while (cursor.next ()) {
+				for (int i = 0; i < cursor.n_columns; i++) {
+					if (i > 0) {
+						result.append ("|");
+					}
+					result.append (cursor.get_string (i) ?? "");
+				}
+				result.append ("\n");
+			}
+
+			return result.str;
+		} finally {
+			// stop collecting the plan, also if the query failed
+			plan = null;
+		}
+	}
+
 	DBStatement prepare_for_exec (string sql) throws DBInterfaceError, Sparql.Error, DateError {
 		var iface = DBManager.get_db_interface ();
 		var stmt = iface.create_statement (no_cache ? DBStatementCacheType.NONE : DBStatementCacheType.SELECT, "%s", sql);
@@ -518,7 +606,9 @@ public class Tracker.Sparql.Query : Object {
 			} else if (binding.data_type == PropertyType.DATETIME) {
 				stmt.bind_double (i, string_to_date (binding.literal, null));
 			} else if (binding.data_type == PropertyType.INTEGER) {
-				stmt.bind_int (i, int.parse (binding.literal));
+				stmt.bind_int (i, int64.parse (binding.literal));
+			} else if (binding.data_type == PropertyType.DOUBLE) {
+				stmt.bind_double (i, double.parse (binding.literal));
 			} else {
 				stmt.bind_text (i, binding.literal);
 			}
@@ -529,9 +619,16 @@ public class Tracker.Sparql.Query : Object {
 	}
 
 	DBCursor? exec_sql_cursor (string sql, PropertyType[]? types, string[]? variable_names, bool threadsafe) throws DBInterfaceError, Sparql.Error, DateError {
+		var timer = new Timer ();
+
+		generated_sql = sql;
+
 		var stmt = prepare_for_exec (sql);
+		var cursor = stmt.start_sparql_cursor (types, variable_names, threadsafe);
 
-		return stmt.start_sparql_cursor (types, variable_names, threadsafe);
+		prepare_time = timer.elapsed ();
+
+		return cursor;
 	}
 
 	string get_select_query (out SelectContext context) throws DBInterfaceError, Sparql.Error, DateError {
@@ -547,9 +644,13 @@ public class Tracker.Sparql.Query : Object {
 	}
 
 	DBCursor? execute_select_cursor (bool threadsafe) throws DBInterfaceError, Sparql.Error, DateError {
+		var timer = new Timer ();
+
 		SelectContext context;
 		string sql = get_select_query (out context);
 
+		translate_time = timer.elapsed ();
+
 		return exec_sql_cursor (sql, context.types, context.variable_names, true);
 	}
 
@@ -585,7 +686,13 @@ public class Tracker.Sparql.Query : Object {
 	}
 
 	DBCursor? execute_ask_cursor (bool threadsafe) throws DBInterfaceError, Sparql.Error, DateError {
-		return exec_sql_cursor (get_ask_query (), new PropertyType[] { PropertyType.BOOLEAN }, new string[] { "result" }, true);
+		var timer = new Timer ();
+
+		string sql = get_ask_query ();
+
+		translate_time = timer.elapsed ();
+
+		return exec_sql_cursor (sql, new PropertyType[] { PropertyType.BOOLEAN }, new string[] { "result" }, true);
 	}
 
 	private void parse_from_or_into_param () throws Sparql.Error {
@@ -0,0 +1,127 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include "tracker-trigram.h"
+
+/*
+ * Returns the distinct trigrams of str, as a NULL-terminated array.
+ *
+ * The string is case folded first. Case folding maps every character
+ * on its own, so the trigrams of a substring are always a subset of the
+ * trigrams of the whole string, also for case insensitive matches.
+ * Strings shorter than three characters have no trigrams.
+ */
+gchar **
+tracker_trigram_split (const gchar *str)
+{
+	GPtrArray *trigrams;
+	GHashTable *seen;
+	gchar *folded;
+	const gchar *p, *end;
+
+	trigrams = g_ptr_array_new ();
+
+	if (str == NULL || !g_utf8_validate (str, -1, NULL)) {
+		g_ptr_array_add (trigrams, NULL);
+		return (gchar **) g_ptr_array_free (trigrams, FALSE);
+	}
+
+	folded = g_utf8_casefold (str, -1);
+	seen = g_hash_table_new (g_str_hash, g_str_equal);
+
+	for (p = folded; *p; p = g_utf8_next_char (p)) {
+		gchar *trigram;
+
+		end = g_utf8_next_char (p);
+		if (*end == '\0') {
+			break;
+		}
+
+		end = g_utf8_next_char (end);
+		if (*end == '\0') {
+			break;
+		}
+
+		end = g_utf8_next_char (end);
+
+		trigram = g_strndup (p, end - p);
+
+		if (g_hash_table_lookup (seen, trigram)) {
+			g_free (trigram);
+			continue;
+		}
+
+		g_hash_table_insert (seen, trigram, trigram);
+		g_ptr_array_add (trigrams, trigram);
+	}
+
+	g_ptr_array_add (trigrams, NULL);
+
+	g_hash_table_destroy (seen);
+	g_free (folded);
+
+	return (gchar **) g_ptr_array_free (trigrams, FALSE);
+}
+
+/* The table lists the rows of the domain class containing each trigram */
+gchar *
+tracker_trigram_get_table_name (const gchar *class_name,
+                                const gchar *property_name)
+{
+	return g_strdup_printf ("%s_%s:trigram", class_name, property_name);
+}
+
+/* Old trigrams are removed by triggers on the class table */
+void
+tracker_trigram_insert (TrackerDBInterface  *iface,
+                        const gchar         *table_name,
+                        gint                 id,
+                        const gchar         *value,
+                        GError             **error)
+{
+	TrackerDBStatement *stmt;
+	GError *internal_error = NULL;
+	gchar **trigrams;
+	gint i;
+
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &internal_error,
+	                                              "INSERT OR IGNORE INTO \"%s\" (ID, Trigram) VALUES (?, ?)",
+	                                              table_name);
+
+	if (internal_error) {
+		g_propagate_error (error, internal_error);
+		return;
+	}
+
+	trigrams = tracker_trigram_split (value);
+
+	for (i = 0; trigrams[i] != NULL; i++) {
+		tracker_db_statement_bind_int (stmt, 0, id);
+		tracker_db_statement_bind_text (stmt, 1, trigrams[i]);
+		tracker_db_statement_execute (stmt, &internal_error);
+
+		if (internal_error) {
+			g_propagate_error (error, internal_error);
+			break;
+		}
+	}
+
+	g_strfreev (trigrams);
+	g_object_unref (stmt);
+}
@@ -0,0 +1,343 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * Imports a Turtle file in bounded transactions.
+ *
+ * The file is split at statement boundaries and the ranges are parsed
+ * by a pool of threads, while the caller inserts one batch of statements
+ * per import_batch () call in its own transaction. Statements are still
+ * inserted in file order. As splitting is done by looking at the raw
+ * text, every range is only used once the reader of the previous range
+ * confirmed it stopped exactly where the next one begins; otherwise the
+ * rest of the file is parsed again by a single reader.
+ *
+ * Batches are committed as they are imported, so an error halfway
+ * through the file leaves the statements of the batches before it in
+ * the store, the error is reported by the import_batch () call that
+ * reaches it.
+ */
+public class Tracker.TurtleImport : Object {
+	const int BATCH_SIZE = 10000;
+	const int MAX_THREADS = 4;
+	const int MAX_QUEUED_BATCHES = 4;
+	// ranges smaller than this are not worth a thread of their own
+	const size_t MIN_RANGE_SIZE = 4 * 1024 * 1024;
+
+	class Batch {
+		public string[] subjects;
+		public string[] predicates;
+		public string[] objects;
+		public bool[] object_is_uri;
+		public int length;
+		// offset in the file of the end of this batch
+		public size_t offset;
+		// the range has been parsed completely
+		public bool last;
+	}
+
+	class Range {
+		public int id;
+		public char* begin;
+		public char* limit;
+		public HashTable<string,string>? prefixes;
+		public AsyncQueue<Batch> queue = new AsyncQueue<Batch> ();
+		public int cancelled;
+
+		// batches pushed but not popped yet, the parser thread
+		// waits on cond while there are too many of them
+		public Mutex mutex = new Mutex ();
+		public Cond cond = new Cond ();
+		public int n_queued;
+
+		// only valid once the last batch has been popped
+		public TurtleReader reader;
+		public Error? error;
+	}
+
+	ThreadPool<Range> pool;
+
+	int batch_size;
+	size_t min_range_size;
+
+	MappedFile mapped_file;
+	char* contents;
+	size_t length;
+	uchar[] base_uuid;
+
+	// ranges not yet consumed, in file order
+	Queue<Range> ranges;
+	int n_ranges_started;
+
+	// fraction of the file that has been committed so far
+	public double progress { get; private set; }
+
+	// number of ranges parsed so far, including the one started after a fallback
+	public int n_ranges {
+		get { return n_ranges_started; }
+	}
+
+	public TurtleImport (string path) throws FileError, Sparql.Error {
+		this.with_limits (path, MIN_RANGE_SIZE, BATCH_SIZE);
+	}
+
+	// smaller limits make the splitting testable with small files
+	public TurtleImport.with_limits (string path, size_t min_range_size, int batch_size) throws FileError, Sparql.Error {
+		this.min_range_size = min_range_size;
+		this.batch_size = batch_size;
+
+		mapped_file = new MappedFile (path, false);
+		contents = mapped_file.get_contents ();
+		length = mapped_file.get_length ();
+
+		base_uuid = new uchar[16];
+		TurtleReader.uuid_generate (base_uuid);
+
+		ranges = new Queue<Range> ();
+
+		try {
+			pool = new ThreadPool<Range> (parse_range, MAX_THREADS, false);
+		} catch (ThreadError e) {
+			throw new Sparql.Error.INTERNAL (e.message);
+		}
+
+		// prefixes declared before the first statement apply to all ranges
+		var probe = new TurtleReader.for_range (mapped_file, contents, null, null, base_uuid, 0);
+		probe.next ();
+		char* first_statement = probe.get_position ();
+
+		int n_splits = (int) (length / min_range_size);
+		if (n_splits > MAX_THREADS) {
+			n_splits = MAX_THREADS;
+		}
+
+		char* begin = contents;
+		for (int i = 1; i < n_splits; i++) {
+			char* limit = find_statement_start (contents + i * (length / n_splits));
+
+			if (limit == null || (long) limit <= (long) first_statement || (long) limit <= (long) begin) {
+				continue;
+			}
+
+			start_range (begin, limit, probe.prefix_map);
+			begin = limit;
+		}
+
+		start_range (begin, null, probe.prefix_map);
+	}
+
+	~TurtleImport () {
+		cancel ();
+
+		// waits for the parser threads
+		pool = null;
+	}
+
+	// returns the beginning of the first line after p that looks like the start of a statement
+	char* find_statement_start (char* p) {
+		char* end = contents + length;
+
+		for (; (long) p < (long) end - 1; p++) {
+			if (p[0] != '\n') {
+				continue;
+			}
+
+			char c = p[1];
+			if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '#') {
+				continue;
+			}
+
+			// the previous line has to end a statement
+			char* q = p - 1;
+			while ((long) q > (long) contents && (q[0] == ' ' || q[0] == '\t' || q[0] == '\r')) {
+				q--;
+			}
+
+			if (q[0] == '.') {
+				return p + 1;
+			}
+		}
+
+		return null;
+	}
+
+	void start_range (char* begin, char* limit, HashTable<string,string>? prefixes) throws Sparql.Error {
+		var range = new Range ();
+		range.id = n_ranges_started++;
+		range.begin = begin;
+		range.limit = limit;
+		range.prefixes = prefixes;
+
+		ranges.push_tail (range);
+
+		try {
+			pool.push (range);
+		} catch (ThreadError e) {
+			throw new Sparql.Error.INTERNAL (e.message);
+		}
+	}
+
+	void cancel () {
+		Range range;
+
+		while ((range = ranges.pop_head ()) != null) {
+			range.mutex.lock ();
+			AtomicInt.set (ref range.cancelled, 1);
+			range.cond.broadcast ();
+			range.mutex.unlock ();
+		}
+	}
+
+	void push_batch (Range range, Batch batch) {
+		// do not parse ahead too far of the transactions
+		range.mutex.lock ();
+		while (range.n_queued >= MAX_QUEUED_BATCHES && AtomicInt.get (ref range.cancelled) == 0) {
+			range.cond.wait (range.mutex);
+		}
+		range.n_queued++;
+		range.mutex.unlock ();
+
+		range.queue.push (batch);
+	}
+
+	// run in parser threads
+	void parse_range (Range range) {
+		var reader = new TurtleReader.for_range (mapped_file, range.begin, range.limit, range.prefixes, base_uuid, range.id);
+		var batch = new Batch ();
+
+		try {
+			while (AtomicInt.get (ref range.cancelled) == 0 && reader.next ()) {
+				batch.subjects += reader.subject;
+				batch.predicates += reader.predicate;
+				batch.objects += reader.object;
+				batch.object_is_uri += reader.object_is_uri;
+				batch.length++;
+
+				// blank node statements must not be split over two transactions
+				if (batch.length >= batch_size && !reader.in_anonymous_node && !reader.subject.has_prefix (":")) {
+					batch.offset = (size_t) (reader.get_position () - contents);
+					push_batch (range, batch);
+					batch = new Batch ();
+				}
+			}
+		} catch (Sparql.Error e) {
+			range.error = e;
+		}
+
+		range.reader = reader;
+
+		batch.offset = (reader.stop_position != null) ? (size_t) (reader.stop_position - contents) : length;
+		batch.last = true;
+		range.queue.push (batch);
+	}
+
+	Batch? next_batch () throws Sparql.Error {
+		while (ranges.get_length () > 0) {
+			Range range = ranges.peek_head ();
+			var batch = range.queue.pop ();
+
+			if (!batch.last) {
+				range.mutex.lock ();
+				range.n_queued--;
+				range.cond.signal ();
+				range.mutex.unlock ();
+			} else {
+				ranges.pop_head ();
+
+				if (range.error != null) {
+					cancel ();
+					throw new Sparql.Error.PARSE (range.error.message);
+				}
+
+				unowned Range? next = ranges.peek_head ();
+				if (next != null) {
+					var reader = range.reader;
+
+					if (reader.stop_position == null) {
+						// the reader went on until the end of the file
+						cancel ();
+					} else if (reader.stop_position != next.begin || reader.prefixes_changed) {
+						// the split was not at a statement boundary or later ranges
+						// lack a prefix, parse the rest of the file sequentially
+						cancel ();
+						start_range (reader.stop_position, null, reader.prefix_map);
+					}
+				}
+
+				if (batch.length == 0) {
+					continue;
+				}
+			}
+
+			return batch;
+		}
+
+		return null;
+	}
+
+	/*
+	 * Inserts the next batch of statements in its own transaction.
+	 * Returns false once the whole file has been imported. On errors,
+	 * the batches imported by earlier calls stay committed.
+	 */
+	public bool import_batch () throws Sparql.Error, DateError, DBInterfaceError {
+		var batch = next_batch ();
+
+		if (batch == null) {
+			progress = 1;
+			return false;
+		}
+
+		try {
+			Data.begin_transaction ();
+		} catch (DBInterfaceError e) {
+			cancel ();
+			throw e;
+		}
+
+		try {
+			for (int i = 0; i < batch.length; i++) {
+				if (batch.object_is_uri[i]) {
+					Data.insert_statement_with_uri (null, batch.subjects[i], batch.predicates[i], batch.objects[i]);
+				} else {
+					Data.insert_statement_with_string (null, batch.subjects[i], batch.predicates[i], batch.objects[i]);
+				}
+				Data.update_buffer_might_flush ();
+			}
+
+			Data.commit_transaction ();
+		} catch (Sparql.Error e) {
+			Data.rollback_transaction ();
+			cancel ();
+			throw e;
+		} catch (DateError e) {
+			Data.rollback_transaction ();
+			cancel ();
+			throw e;
+		} catch (DBInterfaceError e) {
+			Data.rollback_transaction ();
+			cancel ();
+			throw e;
+		}
+
+		if (length > 0) {
+			progress = (double) batch.offset / length;
+		}
+
+		return true;
+	}
+}
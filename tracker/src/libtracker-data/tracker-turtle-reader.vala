@@ -53,7 +53,7 @@ public class Tracker.TurtleReader : Object {
 	public string object { get; private set; }
 	public bool object_is_uri { get; private set; }
 
-	HashTable<string,string> prefix_map;
+	internal HashTable<string,string> prefix_map;
 
 	string[] subject_stack;
 	string[] predicate_stack;
@@ -64,6 +64,17 @@ public class Tracker.TurtleReader : Object {
 
 	MappedFile? mapped_file;
 
+	// statements beginning at or after limit are left to the reader of the next range
+	char* limit;
+	// position of the first statement that was not parsed because of limit
+	internal char* stop_position;
+	// set when a prefix is (re)defined somewhere readers of later ranges did not see it
+	internal bool prefixes_changed;
+	bool mid_file;
+	bool seen_statement;
+	// keeps anonymous blank nodes of different ranges apart
+	string bnode_prefix = "";
+
 	public TurtleReader (string path) throws FileError {
 		mapped_file = new MappedFile (path, false);
 		scanner = new SparqlScanner (mapped_file.get_contents (), mapped_file.get_length ());
@@ -75,10 +86,41 @@ public class Tracker.TurtleReader : Object {
 		prefix_map = new HashTable<string,string>.full (str_hash, str_equal, g_free, g_free);
 	}
 
+	internal TurtleReader.for_range (MappedFile mapped_file, char* begin, char* limit, HashTable<string,string>? prefixes, uchar[] base_uuid, int range_id) {
+		this.mapped_file = mapped_file;
+
+		char* contents = mapped_file.get_contents ();
+		char* end = contents + mapped_file.get_length ();
+		scanner = new SparqlScanner (begin, (size_t) (end - begin));
+
+		this.limit = limit;
+		this.base_uuid = base_uuid;
+		mid_file = (begin != contents);
+		bnode_prefix = "%d-".printf (range_id);
+
+		tokens = new TokenInfo[BUFFER_SIZE];
+		prefix_map = new HashTable<string,string>.full (str_hash, str_equal, g_free, g_free);
+
+		if (prefixes != null) {
+			prefixes.foreach ((ns, uri) => {
+				prefix_map.insert (ns, uri);
+			});
+		}
+	}
+
+	// whether the last statement is part of a [ ... ] blank node
+	internal bool in_anonymous_node {
+		get { return subject_stack.length > 0; }
+	}
+
+	internal char* get_position () {
+		return tokens[index].begin.pos;
+	}
+
 	string generate_bnodeid (string? user_bnodeid) {
 		// user_bnodeid is NULL for anonymous nodes
 		if (user_bnodeid == null) {
-			return ":%d".printf (++bnodeid);
+			return ":%s%d".printf (bnode_prefix, ++bnodeid);
 		} else {
 			var checksum = new Checksum (ChecksumType.SHA1);
 			// base UUID, unique per file
@@ -154,6 +196,10 @@ public class Tracker.TurtleReader : Object {
 				continue;
 			case State.BOS:
 				// begin of statement
+				if (limit != null && (long) tokens[index].begin.pos >= (long) limit) {
+					stop_position = tokens[index].begin.pos;
+					return false;
+				}
 				if (accept (SparqlTokenType.ATPREFIX)) {
 					string ns = "";
 					if (accept (SparqlTokenType.PN_PREFIX)) {
@@ -162,6 +208,9 @@ public class Tracker.TurtleReader : Object {
 					expect (SparqlTokenType.COLON);
 					expect (SparqlTokenType.IRI_REF);
 					string uri = get_last_string (1);
+					if ((seen_statement || mid_file) && prefix_map.lookup (ns) != uri) {
+						prefixes_changed = true;
+					}
 					prefix_map.insert (ns, uri);
 					expect (SparqlTokenType.DOT);
 					continue;
@@ -172,6 +221,7 @@ public class Tracker.TurtleReader : Object {
 				} else if (current () == SparqlTokenType.EOF) {
 					return false;
 				}
+				seen_statement = true;
 				// parse subject
 				if (accept (SparqlTokenType.IRI_REF)) {
 					subject = get_last_string (1);
@@ -366,26 +416,9 @@ public class Tracker.TurtleReader : Object {
 	}
 
 	public static void load (string path) throws FileError, Sparql.Error, DateError, DBInterfaceError {
-		try {
-			Data.begin_transaction ();
-
-			var reader = new TurtleReader (path);
-			while (reader.next ()) {
-				if (reader.object_is_uri) {
-					Data.insert_statement_with_uri (reader.graph, reader.subject, reader.predicate, reader.object);
-				} else {
-					Data.insert_statement_with_string (reader.graph, reader.subject, reader.predicate, reader.object);
-				}
-				Data.update_buffer_might_flush ();
-			}
+		var import = new TurtleImport (path);
 
-			Data.commit_transaction ();
-		} catch (Sparql.Error e) {
-			Data.rollback_transaction ();
-			throw e;
-		} catch (DBInterfaceError e) {
-			Data.rollback_transaction ();
-			throw e;
+		while (import.import_batch ()) {
 		}
 	}
 
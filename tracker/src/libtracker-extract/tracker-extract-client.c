@@ -323,12 +323,16 @@ get_metadata_fast_cb (void     *buffer,
 		GDataInputStream *data_input_stream;
 		gchar *preupdate, *postupdate, *sparql, *where;
 		TrackerSparqlBuilder *builder;
+		GVariant *triples = NULL;
 		gssize remaining;
 
 		/* So the structure is like this:
 		 *
 		 *   [buffer,'\0'][buffer,'\0'][...]
 		 *
+		 * Optionally followed by the statements as a serialized
+		 * a(ssssb) GVariant, see tracker_sparql_builder_get_triples().
+		 *
 		 * We avoid strlen() using
 		 * g_data_input_stream_read_upto() and the
 		 * NUL-terminating byte given strlen() has a size_t
@@ -348,6 +352,17 @@ get_metadata_fast_cb (void     *buffer,
 		sparql     = get_metadata_fast_read (data_input_stream, &remaining, error);
 		where      = get_metadata_fast_read (data_input_stream, &remaining, error);
 
+		if (where && remaining > 0) {
+			/* Copy, so the serialized data is suitably aligned */
+			triples = g_variant_new_from_data (G_VARIANT_TYPE ("a(ssssb)"),
+			                                   g_memdup ((gchar *) buffer + buffer_size - remaining, remaining),
+			                                   remaining,
+			                                   FALSE,
+			                                   g_free,
+			                                   NULL);
+			g_variant_ref_sink (triples);
+		}
+
 		g_object_unref (data_input_stream);
 		g_object_unref (input_stream);
 
@@ -370,10 +385,20 @@ get_metadata_fast_cb (void     *buffer,
 
 		if (sparql) {
 			builder = tracker_extract_info_get_metadata_builder (data->info);
-			tracker_sparql_builder_prepend (builder, sparql);
+
+			if (*sparql) {
+				tracker_sparql_builder_prepend (builder, sparql);
+			}
+
 			g_free (sparql);
 		}
 
+		if (triples) {
+			builder = tracker_extract_info_get_metadata_builder (data->info);
+			tracker_sparql_builder_append_triples (builder, NULL, "", triples);
+			g_variant_unref (triples);
+		}
+
 		g_simple_async_result_set_op_res_gpointer (data->res,
 		                                           tracker_extract_info_ref (data->info),
 		                                           (GDestroyNotify) tracker_extract_info_unref);
@@ -19,6 +19,25 @@
  * Author: Carlos Garnacho <carlos@lanedo.com>
  */
 
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifndef G_OS_WIN32
+#include <sys/mman.h>
+#endif
+
+#ifdef __linux__
+#include <sys/vfs.h>
+#endif
+
+#include <libtracker-common/tracker-file-utils.h>
+
 #include "tracker-extract-info.h"
 
 /**
@@ -35,6 +54,14 @@
  **/
 
 
+/* A range of the file, mapped from the page it starts in or read */
+typedef struct {
+	guchar *data;
+	gsize padding;
+	gsize length;
+	gboolean mapped;
+} FileRange;
+
 struct _TrackerExtractInfo
 {
 	TrackerSparqlBuilder *preupdate;
@@ -46,12 +73,22 @@ struct _TrackerExtractInfo
 	gchar *mimetype;
 	gchar *graph;
 
+	/* File view, opened on first use */
+	gboolean view_opened;
+	gint fd;
+	goffset size;
+	gboolean use_map;
+	FileRange head;
+	FileRange tail;
+
 	gint ref_count;
 };
 
 G_DEFINE_BOXED_TYPE (TrackerExtractInfo, tracker_extract_info,
                      tracker_extract_info_ref, tracker_extract_info_unref)
 
+static void file_range_clear (FileRange *range);
+
 /**
  * tracker_extract_info_new:
  * @file: a #GFile
@@ -84,6 +121,8 @@ tracker_extract_info_new (GFile       *file,
 
         info->where_clause = NULL;
 
+	info->fd = -1;
+
 	info->ref_count = 1;
 
 	return info;
@@ -133,6 +172,16 @@ tracker_extract_info_unref (TrackerExtractInfo *info)
 		g_object_unref (info->metadata);
 		g_free (info->where_clause);
 
+		file_range_clear (&info->head);
+		file_range_clear (&info->tail);
+
+		if (info->fd != -1) {
+#ifdef HAVE_POSIX_FADVISE
+			posix_fadvise (info->fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif /* HAVE_POSIX_FADVISE */
+			close (info->fd);
+		}
+
 		g_slice_free (TrackerExtractInfo, info);
 	}
 }
@@ -294,3 +343,298 @@ tracker_extract_info_set_where_clause (TrackerExtractInfo *info,
 	g_free (info->where_clause);
 	info->where_clause = g_strdup (where);
 }
+
+#ifdef __linux__
+/* Not all of these have headers, see statfs(2) */
+#define NFS_SUPER_MAGIC   0x6969
+#define SMB_SUPER_MAGIC   0x517B
+#define CIFS_MAGIC_NUMBER 0xFF534D42
+#define CODA_SUPER_MAGIC  0x73757245
+#define FUSE_SUPER_MAGIC  0x65735546
+#endif
+
+/* Mapping files on network mounts may fault pages in over the network
+ * one at a time, reading the ranges we need is cheaper there */
+static gboolean
+file_view_is_remote (gint fd)
+{
+#ifdef __linux__
+	struct statfs st;
+
+	if (fstatfs (fd, &st) == -1) {
+		return FALSE;
+	}
+
+	switch ((guint32) st.f_type) {
+	case NFS_SUPER_MAGIC:
+	case SMB_SUPER_MAGIC:
+	case CIFS_MAGIC_NUMBER:
+	case CODA_SUPER_MAGIC:
+	case FUSE_SUPER_MAGIC:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+#else
+	return FALSE;
+#endif
+}
+
+static gboolean
+file_view_open (TrackerExtractInfo *info)
+{
+	struct stat st;
+	gchar *path;
+
+	if (info->view_opened) {
+		return info->fd != -1;
+	}
+
+	info->view_opened = TRUE;
+
+	path = g_file_get_path (info->file);
+
+	if (!path) {
+		return FALSE;
+	}
+
+	info->fd = tracker_file_open_fd (path);
+
+	if (info->fd == -1) {
+		g_debug ("Could not open '%s': %s", path, g_strerror (errno));
+		g_free (path);
+		return FALSE;
+	}
+
+	g_free (path);
+
+	if (fstat (info->fd, &st) == -1) {
+		close (info->fd);
+		info->fd = -1;
+		return FALSE;
+	}
+
+	info->size = st.st_size;
+
+#ifndef G_OS_WIN32
+	info->use_map = !file_view_is_remote (info->fd);
+#endif
+
+	return TRUE;
+}
+
+static guchar *
+file_view_read (TrackerExtractInfo *info,
+                goffset             offset,
+                gsize               length)
+{
+	guchar *buffer;
+	gsize bytes_read = 0;
+
+#ifdef HAVE_POSIX_FADVISE
+	posix_fadvise (info->fd, offset, length, POSIX_FADV_WILLNEED);
+#endif /* HAVE_POSIX_FADVISE */
+
+	buffer = g_malloc (length);
+
+	while (bytes_read < length) {
+		ssize_t rc;
+
+		rc = pread (info->fd, buffer + bytes_read, length - bytes_read, offset + bytes_read);
+
+		if (rc == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			g_free (buffer);
+			return NULL;
+		} else if (rc == 0) {
+			/* File was truncated */
+			g_free (buffer);
+			return NULL;
+		}
+
+		bytes_read += rc;
+	}
+
+	return buffer;
+}
+
+static void
+file_range_clear (FileRange *range)
+{
+#ifndef G_OS_WIN32
+	if (range->mapped) {
+		munmap (range->data, range->padding + range->length);
+	} else
+#endif
+	{
+		g_free (range->data);
+	}
+
+	memset (range, 0, sizeof (FileRange));
+}
+
+/* Only the requested range is mapped, extractors rarely look
+ * past the headers and trailing tags of large files.
+ */
+static gboolean
+file_view_load_range (TrackerExtractInfo *info,
+                      FileRange          *range,
+                      goffset             offset,
+                      gsize               length,
+                      gboolean            sequential)
+{
+	file_range_clear (range);
+
+#ifndef G_OS_WIN32
+	if (info->use_map) {
+		gpointer map;
+		gsize padding;
+
+		padding = offset % sysconf (_SC_PAGESIZE);
+		map = mmap (NULL, padding + length, PROT_READ, MAP_PRIVATE,
+		            info->fd, offset - padding);
+
+		/* Falls back to reading if there is no room for it */
+		if (map != MAP_FAILED) {
+			madvise (map, padding + length,
+			         sequential ? MADV_SEQUENTIAL : MADV_WILLNEED);
+
+			range->data = map;
+			range->padding = padding;
+			range->length = length;
+			range->mapped = TRUE;
+
+			return TRUE;
+		}
+	}
+#endif
+
+	range->data = file_view_read (info, offset, length);
+
+	if (!range->data) {
+		return FALSE;
+	}
+
+	range->length = length;
+
+	return TRUE;
+}
+
+/**
+ * tracker_extract_info_get_file_size:
+ * @info: a #TrackerExtractInfo
+ *
+ * Returns the size of the file being extracted, opening it
+ * if that was not done yet.
+ *
+ * Returns: the size in bytes, or -1 if the file could not be opened.
+ *
+ * Since: 0.14.5
+ **/
+goffset
+tracker_extract_info_get_file_size (TrackerExtractInfo *info)
+{
+	g_return_val_if_fail (info != NULL, -1);
+
+	if (!file_view_open (info)) {
+		return -1;
+	}
+
+	return info->size;
+}
+
+/**
+ * tracker_extract_info_get_file_head:
+ * @info: a #TrackerExtractInfo
+ * @max_length: maximum number of bytes needed
+ * @length: (out): return location for the number of bytes returned
+ *
+ * Returns the first bytes of the file being extracted, at most
+ * @max_length of them. Only that range of local files is mapped in
+ * memory, files on network mounts are read.
+ *
+ * The data is owned by @info and stays valid until @info is freed
+ * or this function is called again with a larger @max_length.
+ *
+ * Returns: (transfer none): the data, or %NULL if the file is
+ *          empty or could not be read.
+ *
+ * Since: 0.14.5
+ **/
+const guchar *
+tracker_extract_info_get_file_head (TrackerExtractInfo *info,
+                                    gsize               max_length,
+                                    gsize              *length)
+{
+	gsize len;
+
+	g_return_val_if_fail (info != NULL, NULL);
+	g_return_val_if_fail (length != NULL, NULL);
+
+	*length = 0;
+
+	if (!file_view_open (info) || info->size == 0) {
+		return NULL;
+	}
+
+	len = (gsize) MIN ((guint64) info->size, (guint64) max_length);
+
+	if (info->head.length < len) {
+		/* Headers are parsed from the start on */
+		if (!file_view_load_range (info, &info->head, 0, len, TRUE)) {
+			return NULL;
+		}
+	}
+
+	*length = len;
+
+	return info->head.data;
+}
+
+/**
+ * tracker_extract_info_get_file_tail:
+ * @info: a #TrackerExtractInfo
+ * @max_length: maximum number of bytes needed
+ * @length: (out): return location for the number of bytes returned
+ *
+ * Returns the last bytes of the file being extracted, at most
+ * @max_length of them, e.g. for trailing tags. See
+ * tracker_extract_info_get_file_head().
+ *
+ * Returns: (transfer none): the data, or %NULL if the file is
+ *          empty or could not be read.
+ *
+ * Since: 0.14.5
+ **/
+const guchar *
+tracker_extract_info_get_file_tail (TrackerExtractInfo *info,
+                                    gsize               max_length,
+                                    gsize              *length)
+{
+	gsize len;
+
+	g_return_val_if_fail (info != NULL, NULL);
+	g_return_val_if_fail (length != NULL, NULL);
+
+	*length = 0;
+
+	if (!file_view_open (info) || info->size == 0) {
+		return NULL;
+	}
+
+	len = (gsize) MIN ((guint64) info->size, (guint64) max_length);
+
+	if (info->tail.length < len) {
+		if (!file_view_load_range (info, &info->tail, info->size - len, len, FALSE)) {
+			return NULL;
+		}
+	}
+
+	*length = len;
+
+	/* A longer tail might have been loaded before */
+	return info->tail.data + info->tail.padding + info->tail.length - len;
+}
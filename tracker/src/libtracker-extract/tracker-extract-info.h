@@ -49,6 +49,13 @@ TrackerSparqlBuilder *tracker_extract_info_get_metadata_builder   (TrackerExtrac
 const gchar *         tracker_extract_info_get_where_clause       (TrackerExtractInfo *info);
 void                  tracker_extract_info_set_where_clause       (TrackerExtractInfo *info,
                                                                    const gchar        *where);
+goffset               tracker_extract_info_get_file_size          (TrackerExtractInfo *info);
+const guchar *        tracker_extract_info_get_file_head          (TrackerExtractInfo *info,
+                                                                   gsize               max_length,
+                                                                   gsize              *length);
+const guchar *        tracker_extract_info_get_file_tail          (TrackerExtractInfo *info,
+                                                                   gsize               max_length,
+                                                                   gsize              *length);
 
 G_END_DECLS
 
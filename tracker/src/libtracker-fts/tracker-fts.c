@@ -2371,6 +2371,13 @@ struct fulltext_vtab {
 #define kPendingThreshold (1*1024*1024)
   sqlite_int64 iPrevDocid;
   fts3Hash pendingTerms;
+
+  /* Terms of the document being updated through
+  ** tracker_fts_update_delta_column(), maps the term to a DeltaTerm.
+  ** deltaComputed is set once the affected terms are known.
+  */
+  GHashTable *pDeltaTerms;
+  int deltaComputed;
 };
 
 /*
@@ -2905,6 +2912,10 @@ static void fulltext_vtab_destroy(fulltext_vtab *v){
 
   clearPendingTerms(v);
 
+  if( v->pDeltaTerms!=NULL ){
+    g_hash_table_unref(v->pDeltaTerms);
+  }
+
   sqlite3_free(v);
 }
 
@@ -7963,12 +7974,246 @@ int tracker_fts_update_text(TrackerFts *fts, int id, int column_id,
   return buildTerms(fts, id, text, column_id, limit_word_length);
 }
 
+/* Position of a term in a column, as given by the parser */
+typedef struct TermPosition {
+  int iColumn;
+  int iPosition;
+  int iStartOffset;
+  int iEndOffset;
+} TermPosition;
+
+/* Positions of a term in the document being updated */
+typedef struct DeltaTerm {
+  GArray *aOld;      /* in the old text of changed columns */
+  GArray *aNew;      /* in the new text of changed columns */
+  GArray *aOther;    /* in unchanged columns, only for affected terms */
+  int isAffected;    /* positions differ between aOld and aNew */
+} DeltaTerm;
+
+#define DELTA_OLD   0
+#define DELTA_NEW   1
+#define DELTA_OTHER 2
+
+static void deltaTermFree(DeltaTerm *p){
+  g_array_free(p->aOld, TRUE);
+  g_array_free(p->aNew, TRUE);
+  g_array_free(p->aOther, TRUE);
+  g_slice_free(DeltaTerm, p);
+}
+
+static void clearDeltaTerms(fulltext_vtab *v){
+  if( v->pDeltaTerms ){
+    g_hash_table_unref(v->pDeltaTerms);
+    v->pDeltaTerms = NULL;
+  }
+  v->deltaComputed = 0;
+}
+
+/* A term is affected when its positions in the changed columns differ,
+** only those need their doclist entry rewritten.
+*/
+static void computeDeltaTerms(fulltext_vtab *v){
+  GHashTableIter iter;
+  DeltaTerm *p;
+
+  if( v->deltaComputed ) return;
+
+  g_hash_table_iter_init(&iter, v->pDeltaTerms);
+  while( g_hash_table_iter_next(&iter, NULL, (gpointer *) &p) ){
+    p->isAffected = p->aOld->len!=p->aNew->len || (p->aOld->len>0 &&
+      memcmp(p->aOld->data, p->aNew->data, p->aOld->len*sizeof(TermPosition))!=0);
+  }
+
+  v->deltaComputed = 1;
+}
+
+/* Collect the positions of the terms in [zText] into pDeltaTerms, using
+** the same limits as buildTerms(). With DELTA_OTHER, only positions of
+** affected terms are collected.
+*/
+static void collectDeltaTerms(fulltext_vtab *v, const char *zText,
+                              int iColumn, gboolean limit_word_length,
+                              int iWhich){
+  const char *pToken;
+  int nTokenBytes;
+  int iStartOffset, iEndOffset, iPosition, stop_word;
+  gint nText;
+  gint nWords;
+
+  if (!zText) return;
+
+  nText = strlen (zText);
+
+  if (!nText) return;
+
+  tracker_parser_reset (v->parser,
+                        zText,
+                        nText,
+                        v->max_word_length,
+                        v->enable_stemmer,
+                        v->enable_unaccent,
+                        v->ignore_stop_words,
+                        TRUE,
+                        v->ignore_numbers);
+  nWords = 0;
+  while(nWords < v->max_words){
+    TermPosition pos;
+    DeltaTerm *p;
+
+    pToken = tracker_parser_next (v->parser, &iPosition,
+                                  &iStartOffset,
+                                  &iEndOffset,
+                                  &stop_word,
+                                  &nTokenBytes);
+    if (!pToken) {
+      break;
+    }
+
+    if (limit_word_length && nTokenBytes < v->min_word_length) {
+      continue;
+    }
+
+    nWords++;
+
+    if (v->ignore_stop_words && stop_word) {
+      continue;
+    }
+
+    if( iPosition<0 || nTokenBytes == 0 ){
+      break;
+    }
+
+    p = g_hash_table_lookup(v->pDeltaTerms, pToken);
+
+    if( iWhich==DELTA_OTHER ){
+      if( !p || !p->isAffected ) continue;
+    }else if( !p ){
+      p = g_slice_new0(DeltaTerm);
+      p->aOld = g_array_new(FALSE, FALSE, sizeof(TermPosition));
+      p->aNew = g_array_new(FALSE, FALSE, sizeof(TermPosition));
+      p->aOther = g_array_new(FALSE, FALSE, sizeof(TermPosition));
+      g_hash_table_insert(v->pDeltaTerms, g_strndup(pToken, nTokenBytes), p);
+    }
+
+    pos.iColumn = iColumn;
+    pos.iPosition = iPosition;
+    pos.iStartOffset = iStartOffset;
+    pos.iEndOffset = iEndOffset;
+
+    g_array_append_val(iWhich==DELTA_OLD ? p->aOld :
+                       iWhich==DELTA_NEW ? p->aNew : p->aOther, pos);
+  }
+}
+
+static void addDeltaPositions(DLCollector *p, GArray *aPositions){
+  guint i;
+
+  for( i=0; i<aPositions->len; i++ ){
+    TermPosition *pos = &g_array_index(aPositions, TermPosition, i);
+    dlcAddPos(p, pos->iColumn, pos->iPosition, pos->iStartOffset, pos->iEndOffset);
+  }
+}
+
+/* Incremental update of a document: instead of deleting all its terms
+** and adding them again, only the terms whose positions changed in the
+** changed columns get a new doclist entry. As an entry replaces the
+** older ones for the document, it also needs the positions of the term
+** in the unchanged columns, see tracker_fts_update_delta_text().
+**
+** tracker_fts_update_init() is called first, then
+** tracker_fts_update_delta_column() for each changed column, then
+** tracker_fts_update_delta_text() for each unchanged column if
+** tracker_fts_update_delta_needs_text() says so, and finally
+** tracker_fts_update_delta_finish().
+*/
+int tracker_fts_update_delta_column(TrackerFts *fts, int column_id,
+                                    const char *old_text, const char *new_text,
+                                    gboolean limit_word_length){
+  if( !fts->pDeltaTerms ){
+    fts->pDeltaTerms = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                             (GDestroyNotify) deltaTermFree);
+  }
+
+  fts->deltaComputed = 0;
+  collectDeltaTerms(fts, old_text, column_id, limit_word_length, DELTA_OLD);
+  collectDeltaTerms(fts, new_text, column_id, limit_word_length, DELTA_NEW);
+
+  return SQLITE_OK;
+}
+
+gboolean tracker_fts_update_delta_needs_text(TrackerFts *fts){
+  GHashTableIter iter;
+  DeltaTerm *p;
+
+  if( !fts->pDeltaTerms ) return FALSE;
+
+  computeDeltaTerms(fts);
+
+  g_hash_table_iter_init(&iter, fts->pDeltaTerms);
+  while( g_hash_table_iter_next(&iter, NULL, (gpointer *) &p) ){
+    if( p->isAffected ) return TRUE;
+  }
+
+  return FALSE;
+}
+
+int tracker_fts_update_delta_text(TrackerFts *fts, int column_id,
+                                  const char *text, gboolean limit_word_length){
+  if( !fts->pDeltaTerms ) return SQLITE_OK;
+
+  computeDeltaTerms(fts);
+  collectDeltaTerms(fts, text, column_id, limit_word_length, DELTA_OTHER);
+
+  return SQLITE_OK;
+}
+
+int tracker_fts_update_delta_finish(TrackerFts *fts, int id){
+  GHashTableIter iter;
+  const char *pToken;
+  DeltaTerm *p;
+
+  if( !fts->pDeltaTerms ) return SQLITE_OK;
+
+  computeDeltaTerms(fts);
+
+  g_hash_table_iter_init(&iter, fts->pDeltaTerms);
+  while( g_hash_table_iter_next(&iter, (gpointer *) &pToken, (gpointer *) &p) ){
+    DLCollector *pCollector;
+    int nTokenBytes, nData;
+
+    if( !p->isAffected ) continue;
+
+    nTokenBytes = strlen(pToken);
+    pCollector = fts3HashFind(&fts->pendingTerms, pToken, nTokenBytes);
+    if( pCollector==NULL ){
+      nData = 0;
+      pCollector = dlcNew(id, DL_DEFAULT);
+      fts3HashInsert(&fts->pendingTerms, pToken, nTokenBytes, pCollector);
+      fts->nPendingData += sizeof(struct fts3HashElem)+sizeof(*pCollector)+nTokenBytes;
+    }else{
+      nData = pCollector->b.nData;
+      if( pCollector->dlw.iPrevDocid!=id ) dlcNext(pCollector, id);
+    }
+
+    /* No positions left means the term is deleted from the document */
+    addDeltaPositions(pCollector, p->aOther);
+    addDeltaPositions(pCollector, p->aNew);
+
+    fts->nPendingData += pCollector->b.nData-nData;
+  }
+
+  clearDeltaTerms(fts);
+
+  return SQLITE_OK;
+}
+
 void tracker_fts_update_commit(TrackerFts *fts){
   flushPendingTerms(fts);
   clearPendingTerms(fts);
 }
 
 void tracker_fts_update_rollback(TrackerFts *fts){
+  clearDeltaTerms(fts);
   clearPendingTerms(fts);
 }
 
@@ -37,6 +37,18 @@ int         tracker_fts_update_text      (TrackerFts        *fts,
                                           int                column_id,
                                           const char        *text,
                                           gboolean           limit_word_length);
+int         tracker_fts_update_delta_column     (TrackerFts        *fts,
+                                                 int                column_id,
+                                                 const char        *old_text,
+                                                 const char        *new_text,
+                                                 gboolean           limit_word_length);
+gboolean    tracker_fts_update_delta_needs_text (TrackerFts        *fts);
+int         tracker_fts_update_delta_text       (TrackerFts        *fts,
+                                                 int                column_id,
+                                                 const char        *text,
+                                                 gboolean           limit_word_length);
+int         tracker_fts_update_delta_finish     (TrackerFts        *fts,
+                                                 int                id);
 void        tracker_fts_update_commit    (TrackerFts        *fts);
 void        tracker_fts_update_rollback  (TrackerFts        *fts);
 
@@ -20,6 +20,7 @@
 #include "config.h"
 
 #include "tracker-crawler.h"
+#include "tracker-directory-snapshot.h"
 #include "tracker-marshal.h"
 #include "tracker-utils.h"
 
@@ -37,6 +38,12 @@
  */
 #define FILES_GROUP_SIZE             100
 
+/* Directories modified this recently are not added to the snapshot,
+ * mtimes have a granularity of seconds, so further changes within
+ * the same second wouldn't be noticed.
+ */
+#define SNAPSHOT_MTIME_MARGIN        2
+
 typedef struct DirectoryChildData DirectoryChildData;
 typedef struct DirectoryProcessingData DirectoryProcessingData;
 typedef struct DirectoryRootInfo DirectoryRootInfo;
@@ -49,8 +56,16 @@ struct DirectoryChildData {
 struct DirectoryProcessingData {
 	GNode *node;
 	GSList *children;
+
+	/* Indexed children, for the snapshot */
+	GPtrArray *subdirectories;
+	guint n_children;
+	guint32 names_hash;
+
 	guint was_inspected : 1;
+	guint was_enumerated : 1;
 	guint ignored_by_content : 1;
+	guint from_snapshot : 1;
 };
 
 struct DirectoryRootInfo {
@@ -82,6 +97,10 @@ struct TrackerCrawlerPrivate {
 
 	gboolean        recurse;
 
+	/* Directories known from previous crawls */
+	TrackerDirectorySnapshot *snapshot;
+	gboolean        use_snapshot;
+
 	/* Statistics */
 	GTimer         *timer;
 
@@ -126,6 +145,7 @@ static void     directory_root_info_free (DirectoryRootInfo *info);
 
 static guint signals[LAST_SIGNAL] = { 0, };
 static GQuark file_info_quark = 0;
+static GQuark snapshot_quark = 0;
 
 G_DEFINE_TYPE (TrackerCrawler, tracker_crawler, G_TYPE_OBJECT)
 
@@ -201,6 +221,7 @@ tracker_crawler_class_init (TrackerCrawlerClass *klass)
 	g_type_class_add_private (object_class, sizeof (TrackerCrawlerPrivate));
 
 	file_info_quark = g_quark_from_static_string ("tracker-crawler-file-info");
+	snapshot_quark = g_quark_from_static_string ("tracker-crawler-snapshot");
 }
 
 static void
@@ -213,6 +234,7 @@ tracker_crawler_init (TrackerCrawler *object)
 	priv = object->priv;
 
 	priv->directories = g_queue_new ();
+	priv->use_snapshot = TRUE;
 }
 
 static void
@@ -237,6 +259,10 @@ crawler_finalize (GObject *object)
 
 	g_free (priv->file_attributes);
 
+	if (priv->snapshot) {
+		tracker_directory_snapshot_free (priv->snapshot);
+	}
+
 	G_OBJECT_CLASS (tracker_crawler_parent_class)->finalize (object);
 }
 
@@ -356,6 +382,10 @@ directory_processing_data_free (DirectoryProcessingData *data)
 	g_slist_foreach (data->children, (GFunc) directory_child_data_free, NULL);
 	g_slist_free (data->children);
 
+	if (data->subdirectories) {
+		g_ptr_array_free (data->subdirectories, TRUE);
+	}
+
 	g_slice_free (DirectoryProcessingData, data);
 }
 
@@ -370,6 +400,28 @@ directory_processing_data_add_child (DirectoryProcessingData *data,
 	data->children = g_slist_prepend (data->children, child_data);
 }
 
+static void
+directory_processing_data_add_indexed_child (DirectoryProcessingData *data,
+                                             DirectoryChildData      *child_data)
+{
+	gchar *name;
+
+	name = g_file_get_basename (child_data->child);
+
+	data->n_children++;
+	data->names_hash += tracker_directory_snapshot_hash_name (name);
+
+	if (child_data->is_dir) {
+		if (!data->subdirectories) {
+			data->subdirectories = g_ptr_array_new_with_free_func (g_free);
+		}
+
+		g_ptr_array_add (data->subdirectories, name);
+	} else {
+		g_free (name);
+	}
+}
+
 static DirectoryRootInfo *
 directory_root_info_new (GFile    *file,
                          gboolean  recurse,
@@ -386,6 +438,9 @@ directory_root_info_new (GFile    *file,
 
 	info->tree = g_node_new (g_object_ref (file));
 
+	/* The root file may have been crawled before */
+	g_object_set_qdata (G_OBJECT (file), snapshot_quark, NULL);
+
 	if (file_attributes) {
 		GFileInfo *file_info;
 
@@ -436,6 +491,189 @@ directory_root_info_free (DirectoryRootInfo *info)
 	g_slice_free (DirectoryRootInfo, info);
 }
 
+static gchar *
+crawler_get_attributes (TrackerCrawler *crawler)
+{
+	if (crawler->priv->file_attributes) {
+		return g_strconcat (FILE_ATTRIBUTES ",",
+		                    crawler->priv->file_attributes,
+		                    NULL);
+	} else {
+		return g_strdup (FILE_ATTRIBUTES);
+	}
+}
+
+static gboolean
+check_directory_contents (TrackerCrawler          *crawler,
+                          DirectoryProcessingData *dir_data)
+{
+	GList *children = NULL;
+	GSList *l;
+	gboolean use = FALSE;
+
+	for (l = dir_data->children; l; l = l->next) {
+		DirectoryChildData *child_data;
+
+		child_data = l->data;
+		children = g_list_prepend (children, child_data->child);
+	}
+
+	g_signal_emit (crawler, signals[CHECK_DIRECTORY_CONTENTS], 0, dir_data->node->data, children, &use);
+	g_list_free (children);
+
+	if (!use) {
+		dir_data->ignored_by_content = TRUE;
+		/* FIXME: Update stats */
+	}
+
+	return use;
+}
+
+/* Uses the file info gathered before the directory was enumerated,
+ * so changes happening while it's being crawled aren't overlooked.
+ */
+static gboolean
+directory_get_mtime (GFile   *directory,
+                     guint64 *mtime)
+{
+	GFileInfo *file_info;
+
+	file_info = g_object_get_qdata (G_OBJECT (directory), file_info_quark);
+
+	if (!file_info ||
+	    !g_file_info_has_attribute (file_info, G_FILE_ATTRIBUTE_TIME_MODIFIED)) {
+		return FALSE;
+	}
+
+	*mtime = g_file_info_get_attribute_uint64 (file_info,
+	                                           G_FILE_ATTRIBUTE_TIME_MODIFIED);
+	return TRUE;
+}
+
+/* If the directory is unchanged since it was added to the snapshot,
+ * fill in its subdirectories from there instead of enumerating it.
+ */
+static gboolean
+directory_children_from_snapshot (TrackerCrawler          *crawler,
+                                  DirectoryProcessingData *dir_data)
+{
+	TrackerCrawlerPrivate *priv;
+	const gchar * const *subdirectories;
+	guint64 mtime, snapshot_mtime;
+	GFile *directory;
+	gchar *attrs;
+	guint i;
+
+	priv = crawler->priv;
+	directory = dir_data->node->data;
+
+	if (!priv->snapshot ||
+	    !priv->use_snapshot ||
+	    !tracker_directory_snapshot_lookup (priv->snapshot, directory,
+	                                        &snapshot_mtime, NULL, NULL,
+	                                        &subdirectories) ||
+	    !directory_get_mtime (directory, &mtime) ||
+	    mtime != snapshot_mtime) {
+		return FALSE;
+	}
+
+	attrs = crawler_get_attributes (crawler);
+
+	for (i = 0; subdirectories[i]; i++) {
+		GFileInfo *file_info;
+		GFile *child;
+
+		child = g_file_get_child (directory, subdirectories[i]);
+		file_info = g_file_query_info (child,
+		                               attrs,
+		                               G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+		                               NULL,
+		                               NULL);
+
+		if (!file_info ||
+		    g_file_info_get_file_type (file_info) != G_FILE_TYPE_DIRECTORY) {
+			/* Can't happen unless the directory was modified
+			 * without changing its mtime, don't trust the
+			 * snapshot then.
+			 */
+			if (file_info) {
+				g_object_unref (file_info);
+			}
+
+			g_object_unref (child);
+			g_free (attrs);
+
+			g_slist_foreach (dir_data->children, (GFunc) directory_child_data_free, NULL);
+			g_slist_free (dir_data->children);
+			dir_data->children = NULL;
+
+			tracker_directory_snapshot_remove (priv->snapshot, directory, FALSE);
+
+			return FALSE;
+		}
+
+		if (priv->file_attributes) {
+			g_object_set_qdata_full (G_OBJECT (child),
+			                         file_info_quark,
+			                         file_info,
+			                         (GDestroyNotify) g_object_unref);
+		} else {
+			g_object_unref (file_info);
+		}
+
+		directory_processing_data_add_child (dir_data, child, TRUE);
+		g_object_unref (child);
+	}
+
+	g_free (attrs);
+
+	dir_data->from_snapshot = TRUE;
+	g_object_set_qdata (G_OBJECT (directory), snapshot_quark, GUINT_TO_POINTER (TRUE));
+
+	return TRUE;
+}
+
+static void
+directory_snapshot_update (TrackerCrawler          *crawler,
+                           DirectoryProcessingData *dir_data)
+{
+	TrackerCrawlerPrivate *priv;
+	GFile *directory;
+	guint64 mtime;
+	gint64 now;
+
+	priv = crawler->priv;
+	directory = dir_data->node->data;
+
+	if (!priv->snapshot ||
+	    (dir_data->from_snapshot && !dir_data->ignored_by_content)) {
+		return;
+	}
+
+	now = g_get_real_time () / G_USEC_PER_SEC;
+
+	if (!dir_data->was_enumerated ||
+	    dir_data->ignored_by_content ||
+	    !directory_get_mtime (directory, &mtime) ||
+	    (gint64) mtime + SNAPSHOT_MTIME_MARGIN >= now) {
+		tracker_directory_snapshot_remove (priv->snapshot, directory, FALSE);
+		return;
+	}
+
+	if (dir_data->subdirectories) {
+		g_ptr_array_add (dir_data->subdirectories, NULL);
+	}
+
+	tracker_directory_snapshot_set (priv->snapshot,
+	                                directory,
+	                                mtime,
+	                                dir_data->n_children,
+	                                dir_data->names_hash,
+	                                dir_data->subdirectories ?
+	                                (const gchar * const *) dir_data->subdirectories->pdata :
+	                                NULL);
+}
+
 static gboolean
 process_func (gpointer data)
 {
@@ -481,11 +719,18 @@ process_func (gpointer data)
 			 *  check_directory return value, and thus we should check if it's
 			 *  running before going on with the iteration */
 			if (priv->is_running && iterate) {
-				/* Directory contents haven't been inspected yet,
-				 * stop this idle function while it's being iterated
-				 */
-				file_enumerate_children (crawler, info, dir_data);
-				stop_idle = TRUE;
+				if (directory_children_from_snapshot (crawler, dir_data)) {
+					/* Directory is unchanged, only its
+					 * subdirectories need to be crawled.
+					 */
+					check_directory_contents (crawler, dir_data);
+				} else {
+					/* Directory contents haven't been inspected yet,
+					 * stop this idle function while it's being iterated
+					 */
+					file_enumerate_children (crawler, info, dir_data);
+					stop_idle = TRUE;
+				}
 			}
 		} else if (dir_data->was_inspected &&
 			   !dir_data->ignored_by_content &&
@@ -510,6 +755,10 @@ process_func (gpointer data)
 			    priv->is_running) {
 				child_node = g_node_prepend_data (dir_data->node,
 								  g_object_ref (child_data->child));
+
+				if (priv->snapshot) {
+					directory_processing_data_add_indexed_child (dir_data, child_data);
+				}
 			}
 
 			if (info->recurse && priv->is_running &&
@@ -524,6 +773,7 @@ process_func (gpointer data)
 		} else {
 			/* No (more) children, or directory ignored. stop processing. */
 			g_queue_pop_head (info->directory_processing_queue);
+			directory_snapshot_update (crawler, dir_data);
 			directory_processing_data_free (dir_data);
 		}
 	} else if (!dir_data && info) {
@@ -609,28 +859,7 @@ enumerator_data_new (TrackerCrawler          *crawler,
 static void
 enumerator_data_process (EnumeratorData *ed)
 {
-	TrackerCrawler *crawler;
-	GSList *l;
-	GList *children = NULL;
-	gboolean use;
-
-	crawler = ed->crawler;
-
-	for (l = ed->dir_info->children; l; l = l->next) {
-		DirectoryChildData *child_data;
-
-		child_data = l->data;
-		children = g_list_prepend (children, child_data->child);
-	}
-
-	g_signal_emit (crawler, signals[CHECK_DIRECTORY_CONTENTS], 0, ed->dir_info->node->data, children, &use);
-	g_list_free (children);
-
-	if (!use) {
-		ed->dir_info->ignored_by_content = TRUE;
-		/* FIXME: Update stats */
-		return;
-	}
+	check_directory_contents (ed->crawler, ed->dir_info);
 }
 
 static void
@@ -696,6 +925,11 @@ file_enumerate_next_cb (GObject      *object,
 	                                             &error);
 
 	if (error || !files || !crawler->priv->is_running) {
+		if (!error && !files && !cancelled) {
+			/* All children were found */
+			ed->dir_info->was_enumerated = TRUE;
+		}
+
 		if (error && !cancelled) {
 			g_critical ("Could not crawl through directory: %s", error->message);
 			g_error_free (error);
@@ -817,14 +1051,7 @@ file_enumerate_children (TrackerCrawler          *crawler,
 	gchar *attrs;
 
 	ed = enumerator_data_new (crawler, info, dir_data);
-
-	if (crawler->priv->file_attributes) {
-		attrs = g_strconcat (FILE_ATTRIBUTES ",",
-		                     crawler->priv->file_attributes,
-		                     NULL);
-	} else {
-		attrs = g_strdup (FILE_ATTRIBUTES);
-	}
+	attrs = crawler_get_attributes (crawler);
 
 	g_file_enumerate_children_async (ed->dir_file,
 	                                 attrs,
@@ -1035,3 +1262,177 @@ tracker_crawler_get_file_info (TrackerCrawler *crawler,
 	info = g_object_get_qdata (G_OBJECT (file), file_info_quark);
 	return info;
 }
+
+/**
+ * tracker_crawler_load_snapshot:
+ * @crawler: a #TrackerCrawler
+ * @file: file the snapshot was saved to
+ * @error: return location for a #GError
+ *
+ * Loads a directory snapshot saved with tracker_crawler_save_snapshot().
+ * Directories whose mtime is the one recorded in the snapshot won't
+ * be enumerated again, only their subdirectories will be crawled.
+ * This requires %G_FILE_ATTRIBUTE_TIME_MODIFIED to be requested
+ * through tracker_crawler_set_file_attributes().
+ *
+ * Even if loading fails, @crawler will start recording the
+ * directories it crawls, so the snapshot can be saved later.
+ *
+ * Returns: %TRUE if the snapshot was loaded
+ **/
+gboolean
+tracker_crawler_load_snapshot (TrackerCrawler  *crawler,
+                               GFile           *file,
+                               GError         **error)
+{
+	TrackerCrawlerPrivate *priv;
+
+	g_return_val_if_fail (TRACKER_IS_CRAWLER (crawler), FALSE);
+	g_return_val_if_fail (G_IS_FILE (file), FALSE);
+
+	priv = crawler->priv;
+
+	if (!priv->snapshot) {
+		priv->snapshot = tracker_directory_snapshot_new ();
+	}
+
+	return tracker_directory_snapshot_load (priv->snapshot, file, error);
+}
+
+/**
+ * tracker_crawler_save_snapshot:
+ * @crawler: a #TrackerCrawler
+ * @file: file to save the snapshot to
+ * @error: return location for a #GError
+ *
+ * Saves the directories crawled so far, the snapshot is only saved
+ * if it changed since it was loaded or last saved.
+ *
+ * Returns: %TRUE on success
+ **/
+gboolean
+tracker_crawler_save_snapshot (TrackerCrawler  *crawler,
+                               GFile           *file,
+                               GError         **error)
+{
+	TrackerCrawlerPrivate *priv;
+
+	g_return_val_if_fail (TRACKER_IS_CRAWLER (crawler), FALSE);
+	g_return_val_if_fail (G_IS_FILE (file), FALSE);
+
+	priv = crawler->priv;
+
+	if (!priv->snapshot ||
+	    !tracker_directory_snapshot_is_dirty (priv->snapshot)) {
+		return TRUE;
+	}
+
+	return tracker_directory_snapshot_save (priv->snapshot, file, error);
+}
+
+/**
+ * tracker_crawler_forget_snapshot:
+ * @crawler: a #TrackerCrawler
+ * @directory: a #GFile
+ *
+ * Removes @directory and everything below it from the snapshot, so
+ * the next crawl enumerates it completely.
+ **/
+void
+tracker_crawler_forget_snapshot (TrackerCrawler *crawler,
+                                 GFile          *directory)
+{
+	g_return_if_fail (TRACKER_IS_CRAWLER (crawler));
+	g_return_if_fail (G_IS_FILE (directory));
+
+	if (crawler->priv->snapshot) {
+		tracker_directory_snapshot_remove (crawler->priv->snapshot,
+		                                   directory, TRUE);
+	}
+}
+
+/**
+ * tracker_crawler_set_use_snapshot:
+ * @crawler: a #TrackerCrawler
+ * @use_snapshot: whether to take unchanged directories from the snapshot
+ *
+ * Sets whether unchanged directories are taken from the snapshot on
+ * the next crawls, or enumerated as usual. The snapshot keeps being
+ * updated with the crawled directories in either case. This is
+ * %TRUE by default.
+ **/
+void
+tracker_crawler_set_use_snapshot (TrackerCrawler *crawler,
+                                  gboolean        use_snapshot)
+{
+	g_return_if_fail (TRACKER_IS_CRAWLER (crawler));
+
+	crawler->priv->use_snapshot = (use_snapshot == TRUE);
+}
+
+/**
+ * tracker_crawler_set_snapshot_config_hash:
+ * @crawler: a #TrackerCrawler
+ * @config_hash: hash of the configuration used for crawling
+ *
+ * Sets the hash of the configuration (e.g. filters) the crawled
+ * directories were checked against. If it differs from the one the
+ * snapshot was recorded with, the snapshot is discarded, as the
+ * children it remembers may not match the current configuration.
+ **/
+void
+tracker_crawler_set_snapshot_config_hash (TrackerCrawler *crawler,
+                                          guint32         config_hash)
+{
+	TrackerCrawlerPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_CRAWLER (crawler));
+
+	priv = crawler->priv;
+
+	if (!priv->snapshot) {
+		priv->snapshot = tracker_directory_snapshot_new ();
+	}
+
+	tracker_directory_snapshot_set_config_hash (priv->snapshot, config_hash);
+}
+
+/**
+ * tracker_crawler_get_snapshot_info:
+ * @crawler: a #TrackerCrawler
+ * @directory: a #GFile returned by @crawler
+ * @n_children: (out) (allow-none): return location for the number
+ *              of children
+ * @names_hash: (out) (allow-none): return location for the hash of
+ *              the children names
+ *
+ * Checks whether the contents of @directory were taken from the
+ * snapshot instead of being enumerated, in which case only its
+ * subdirectories were reported. @n_children and @names_hash are the
+ * number of children that passed the checks when it was last
+ * enumerated, and a hash of their names.
+ *
+ * Returns: %TRUE if @directory was not enumerated
+ **/
+gboolean
+tracker_crawler_get_snapshot_info (TrackerCrawler *crawler,
+                                   GFile          *directory,
+                                   guint          *n_children,
+                                   guint32        *names_hash)
+{
+	TrackerCrawlerPrivate *priv;
+
+	g_return_val_if_fail (TRACKER_IS_CRAWLER (crawler), FALSE);
+	g_return_val_if_fail (G_IS_FILE (directory), FALSE);
+
+	priv = crawler->priv;
+
+	if (!priv->snapshot ||
+	    !g_object_get_qdata (G_OBJECT (directory), snapshot_quark)) {
+		return FALSE;
+	}
+
+	return tracker_directory_snapshot_lookup (priv->snapshot, directory,
+	                                          NULL, n_children, names_hash,
+	                                          NULL);
+}
@@ -87,6 +87,23 @@ const gchar *   tracker_crawler_get_file_attributes (TrackerCrawler *crawler);
 GFileInfo *     tracker_crawler_get_file_info       (TrackerCrawler *crawler,
 						     GFile          *file);
 
+gboolean        tracker_crawler_load_snapshot       (TrackerCrawler  *crawler,
+                                                     GFile           *file,
+                                                     GError         **error);
+gboolean        tracker_crawler_save_snapshot       (TrackerCrawler  *crawler,
+                                                     GFile           *file,
+                                                     GError         **error);
+void            tracker_crawler_forget_snapshot     (TrackerCrawler  *crawler,
+                                                     GFile           *directory);
+void            tracker_crawler_set_use_snapshot    (TrackerCrawler  *crawler,
+                                                     gboolean         use_snapshot);
+void            tracker_crawler_set_snapshot_config_hash (TrackerCrawler *crawler,
+                                                          guint32         config_hash);
+gboolean        tracker_crawler_get_snapshot_info   (TrackerCrawler  *crawler,
+                                                     GFile           *directory,
+                                                     guint           *n_children,
+                                                     guint32         *names_hash);
+
 G_END_DECLS
 
 #endif /* __LIBTRACKER_MINER_CRAWLER_H__ */
@@ -0,0 +1,367 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include "tracker-directory-snapshot.h"
+
+/* The snapshot keeps, for every crawled directory, the mtime it had
+ * when it was last enumerated, the number and a hash of the names of
+ * the children that were indexed, and the names of its indexed
+ * subdirectories. Along with those, a hash of the configuration that
+ * decided which children were indexed. It is stored as a GVariant of
+ * type SNAPSHOT_VARIANT_TYPE, bump SNAPSHOT_VERSION on format changes.
+ */
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_VARIANT_TYPE "(uua{s(tuuas)})"
+
+typedef struct _SnapshotEntry SnapshotEntry;
+
+struct _SnapshotEntry {
+	guint64 mtime;
+	guint n_children;
+	guint32 names_hash;
+	gchar **subdirectories;
+};
+
+struct _TrackerDirectorySnapshot {
+	/* URI -> SnapshotEntry */
+	GHashTable *entries;
+	guint32 config_hash;
+	guint dirty : 1;
+};
+
+static SnapshotEntry *
+snapshot_entry_new (guint64  mtime,
+                    guint    n_children,
+                    guint32  names_hash,
+                    gchar  **subdirectories)
+{
+	SnapshotEntry *entry;
+
+	entry = g_slice_new (SnapshotEntry);
+	entry->mtime = mtime;
+	entry->n_children = n_children;
+	entry->names_hash = names_hash;
+	entry->subdirectories = subdirectories;
+
+	return entry;
+}
+
+static void
+snapshot_entry_free (SnapshotEntry *entry)
+{
+	g_strfreev (entry->subdirectories);
+	g_slice_free (SnapshotEntry, entry);
+}
+
+TrackerDirectorySnapshot *
+tracker_directory_snapshot_new (void)
+{
+	TrackerDirectorySnapshot *snapshot;
+
+	snapshot = g_slice_new0 (TrackerDirectorySnapshot);
+	snapshot->entries = g_hash_table_new_full (g_str_hash,
+	                                           g_str_equal,
+	                                           (GDestroyNotify) g_free,
+	                                           (GDestroyNotify) snapshot_entry_free);
+
+	return snapshot;
+}
+
+void
+tracker_directory_snapshot_free (TrackerDirectorySnapshot *snapshot)
+{
+	g_return_if_fail (snapshot != NULL);
+
+	g_hash_table_unref (snapshot->entries);
+	g_slice_free (TrackerDirectorySnapshot, snapshot);
+}
+
+gboolean
+tracker_directory_snapshot_load (TrackerDirectorySnapshot  *snapshot,
+                                 GFile                     *file,
+                                 GError                   **error)
+{
+	GVariant *variant, *entries;
+	GVariantIter iter;
+	gchar *contents, *uri, **subdirectories;
+	guint64 mtime;
+	guint32 version, config_hash, n_children, names_hash;
+	gsize len;
+
+	g_return_val_if_fail (snapshot != NULL, FALSE);
+	g_return_val_if_fail (G_IS_FILE (file), FALSE);
+
+	g_hash_table_remove_all (snapshot->entries);
+	snapshot->dirty = FALSE;
+
+	if (!g_file_load_contents (file, NULL, &contents, &len, NULL, error)) {
+		return FALSE;
+	}
+
+	/* Malformed data is handled by GVariant itself, it will just
+	 * give back default values, those are caught by the version check.
+	 */
+	variant = g_variant_new_from_data (G_VARIANT_TYPE (SNAPSHOT_VARIANT_TYPE),
+	                                   contents, len, FALSE,
+	                                   (GDestroyNotify) g_free, contents);
+	g_variant_ref_sink (variant);
+
+	g_variant_get (variant, "(uu@a{s(tuuas)})", &version, &config_hash, &entries);
+
+	if (version != SNAPSHOT_VERSION) {
+		g_set_error (error,
+		             G_IO_ERROR,
+		             G_IO_ERROR_INVALID_DATA,
+		             "Unsupported directory snapshot version %u (expected %u)",
+		             version, SNAPSHOT_VERSION);
+		g_variant_unref (entries);
+		g_variant_unref (variant);
+		return FALSE;
+	}
+
+	snapshot->config_hash = config_hash;
+	g_variant_iter_init (&iter, entries);
+
+	while (g_variant_iter_next (&iter, "{s(tuu^as)}",
+	                            &uri, &mtime, &n_children,
+	                            &names_hash, &subdirectories)) {
+		g_hash_table_insert (snapshot->entries, uri,
+		                     snapshot_entry_new (mtime, n_children,
+		                                         names_hash, subdirectories));
+	}
+
+	g_variant_unref (entries);
+	g_variant_unref (variant);
+
+	return TRUE;
+}
+
+gboolean
+tracker_directory_snapshot_save (TrackerDirectorySnapshot  *snapshot,
+                                 GFile                     *file,
+                                 GError                   **error)
+{
+	GVariantBuilder builder;
+	GHashTableIter iter;
+	GVariant *variant;
+	GFile *parent;
+	gpointer key, value;
+	gboolean retval;
+
+	g_return_val_if_fail (snapshot != NULL, FALSE);
+	g_return_val_if_fail (G_IS_FILE (file), FALSE);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{s(tuuas)}"));
+	g_hash_table_iter_init (&iter, snapshot->entries);
+
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		SnapshotEntry *entry = value;
+
+		g_variant_builder_add (&builder, "{s(tuu^as)}",
+		                       key,
+		                       entry->mtime,
+		                       entry->n_children,
+		                       entry->names_hash,
+		                       entry->subdirectories);
+	}
+
+	variant = g_variant_new ("(uu@a{s(tuuas)})",
+	                         SNAPSHOT_VERSION,
+	                         snapshot->config_hash,
+	                         g_variant_builder_end (&builder));
+	g_variant_ref_sink (variant);
+
+	parent = g_file_get_parent (file);
+
+	if (parent) {
+		/* Just ensure it exists, it usually does already */
+		g_file_make_directory_with_parents (parent, NULL, NULL);
+		g_object_unref (parent);
+	}
+
+	retval = g_file_replace_contents (file,
+	                                  g_variant_get_data (variant),
+	                                  g_variant_get_size (variant),
+	                                  NULL, FALSE,
+	                                  G_FILE_CREATE_PRIVATE,
+	                                  NULL, NULL, error);
+	g_variant_unref (variant);
+
+	if (retval) {
+		snapshot->dirty = FALSE;
+	}
+
+	return retval;
+}
+
+gboolean
+tracker_directory_snapshot_is_dirty (TrackerDirectorySnapshot *snapshot)
+{
+	g_return_val_if_fail (snapshot != NULL, FALSE);
+
+	return snapshot->dirty;
+}
+
+guint32
+tracker_directory_snapshot_get_config_hash (TrackerDirectorySnapshot *snapshot)
+{
+	g_return_val_if_fail (snapshot != NULL, 0);
+
+	return snapshot->config_hash;
+}
+
+/* Entries recorded with a different configuration can't be
+ * trusted, children may be filtered differently now.
+ */
+void
+tracker_directory_snapshot_set_config_hash (TrackerDirectorySnapshot *snapshot,
+                                            guint32                   config_hash)
+{
+	g_return_if_fail (snapshot != NULL);
+
+	if (snapshot->config_hash == config_hash) {
+		return;
+	}
+
+	g_hash_table_remove_all (snapshot->entries);
+	snapshot->config_hash = config_hash;
+	snapshot->dirty = TRUE;
+}
+
+void
+tracker_directory_snapshot_set (TrackerDirectorySnapshot *snapshot,
+                                GFile                    *directory,
+                                guint64                   mtime,
+                                guint                     n_children,
+                                guint32                   names_hash,
+                                const gchar * const      *subdirectories)
+{
+	SnapshotEntry *entry;
+	gchar **copy;
+
+	g_return_if_fail (snapshot != NULL);
+	g_return_if_fail (G_IS_FILE (directory));
+
+	if (subdirectories) {
+		copy = g_strdupv ((gchar **) subdirectories);
+	} else {
+		copy = g_new0 (gchar *, 1);
+	}
+
+	entry = snapshot_entry_new (mtime, n_children, names_hash, copy);
+	g_hash_table_replace (snapshot->entries,
+	                      g_file_get_uri (directory),
+	                      entry);
+	snapshot->dirty = TRUE;
+}
+
+gboolean
+tracker_directory_snapshot_lookup (TrackerDirectorySnapshot  *snapshot,
+                                   GFile                     *directory,
+                                   guint64                   *mtime,
+                                   guint                     *n_children,
+                                   guint32                   *names_hash,
+                                   const gchar * const      **subdirectories)
+{
+	SnapshotEntry *entry;
+	gchar *uri;
+
+	g_return_val_if_fail (snapshot != NULL, FALSE);
+	g_return_val_if_fail (G_IS_FILE (directory), FALSE);
+
+	uri = g_file_get_uri (directory);
+	entry = g_hash_table_lookup (snapshot->entries, uri);
+	g_free (uri);
+
+	if (!entry) {
+		return FALSE;
+	}
+
+	if (mtime) {
+		*mtime = entry->mtime;
+	}
+
+	if (n_children) {
+		*n_children = entry->n_children;
+	}
+
+	if (names_hash) {
+		*names_hash = entry->names_hash;
+	}
+
+	if (subdirectories) {
+		*subdirectories = (const gchar * const *) entry->subdirectories;
+	}
+
+	return TRUE;
+}
+
+void
+tracker_directory_snapshot_remove (TrackerDirectorySnapshot *snapshot,
+                                   GFile                    *directory,
+                                   gboolean                  recursive)
+{
+	gchar *uri;
+
+	g_return_if_fail (snapshot != NULL);
+	g_return_if_fail (G_IS_FILE (directory));
+
+	uri = g_file_get_uri (directory);
+
+	if (g_hash_table_remove (snapshot->entries, uri)) {
+		snapshot->dirty = TRUE;
+	}
+
+	if (recursive) {
+		GHashTableIter iter;
+		gpointer key;
+		gchar *prefix;
+
+		if (g_str_has_suffix (uri, "/")) {
+			prefix = g_strdup (uri);
+		} else {
+			prefix = g_strconcat (uri, "/", NULL);
+		}
+
+		g_hash_table_iter_init (&iter, snapshot->entries);
+
+		while (g_hash_table_iter_next (&iter, &key, NULL)) {
+			if (g_str_has_prefix (key, prefix)) {
+				g_hash_table_iter_remove (&iter);
+				snapshot->dirty = TRUE;
+			}
+		}
+
+		g_free (prefix);
+	}
+
+	g_free (uri);
+}
+
+/* Hash for a single child name, the names hash of a directory is the
+ * sum of these for all its children, so it doesn't depend on the order
+ * the children were found in.
+ */
+guint32
+tracker_directory_snapshot_hash_name (const gchar *name)
+{
+	g_return_val_if_fail (name != NULL, 0);
+
+	return (guint32) g_str_hash (name);
+}
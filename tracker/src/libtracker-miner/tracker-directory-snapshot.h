@@ -0,0 +1,62 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __LIBTRACKER_MINER_DIRECTORY_SNAPSHOT_H__
+#define __LIBTRACKER_MINER_DIRECTORY_SNAPSHOT_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _TrackerDirectorySnapshot TrackerDirectorySnapshot;
+
+TrackerDirectorySnapshot *tracker_directory_snapshot_new  (void);
+void      tracker_directory_snapshot_free     (TrackerDirectorySnapshot  *snapshot);
+
+gboolean  tracker_directory_snapshot_load     (TrackerDirectorySnapshot  *snapshot,
+                                               GFile                     *file,
+                                               GError                   **error);
+gboolean  tracker_directory_snapshot_save     (TrackerDirectorySnapshot  *snapshot,
+                                               GFile                     *file,
+                                               GError                   **error);
+gboolean  tracker_directory_snapshot_is_dirty (TrackerDirectorySnapshot  *snapshot);
+
+guint32   tracker_directory_snapshot_get_config_hash (TrackerDirectorySnapshot *snapshot);
+void      tracker_directory_snapshot_set_config_hash (TrackerDirectorySnapshot *snapshot,
+                                                      guint32                   config_hash);
+
+void      tracker_directory_snapshot_set      (TrackerDirectorySnapshot  *snapshot,
+                                               GFile                     *directory,
+                                               guint64                    mtime,
+                                               guint                      n_children,
+                                               guint32                    names_hash,
+                                               const gchar * const       *subdirectories);
+gboolean  tracker_directory_snapshot_lookup   (TrackerDirectorySnapshot  *snapshot,
+                                               GFile                     *directory,
+                                               guint64                   *mtime,
+                                               guint                     *n_children,
+                                               guint32                   *names_hash,
+                                               const gchar * const      **subdirectories);
+void      tracker_directory_snapshot_remove   (TrackerDirectorySnapshot  *snapshot,
+                                               GFile                     *directory,
+                                               gboolean                   recursive);
+
+guint32   tracker_directory_snapshot_hash_name (const gchar              *name);
+
+G_END_DECLS
+
+#endif /* __LIBTRACKER_MINER_DIRECTORY_SNAPSHOT_H__ */
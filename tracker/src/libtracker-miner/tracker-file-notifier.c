@@ -27,6 +27,7 @@
 #include "tracker-file-notifier.h"
 #include "tracker-file-system.h"
 #include "tracker-crawler.h"
+#include "tracker-directory-snapshot.h"
 #include "tracker-monitor.h"
 #include "tracker-marshal.h"
 
@@ -35,6 +36,7 @@ static GQuark quark_property_queried = 0;
 static GQuark quark_property_iri = 0;
 static GQuark quark_property_store_mtime = 0;
 static GQuark quark_property_filesystem_mtime = 0;
+static GQuark quark_property_snapshot = 0;
 
 enum {
 	PROP_0,
@@ -71,9 +73,25 @@ typedef struct {
 	 */
 	GList *pending_index_roots;
 
+	/* Directories in the current root that
+	 * were not enumerated by the crawler
+	 */
+	GList *snapshot_directories;
+	GFile *snapshot_file;
+
 	guint stopped : 1;
 } TrackerFileNotifierPrivate;
 
+typedef struct {
+	/* As recorded by the crawler */
+	guint n_children;
+	guint32 names_hash;
+
+	/* As found in the store */
+	guint store_n_children;
+	guint32 store_names_hash;
+} SnapshotCheck;
+
 typedef struct {
 	TrackerFileNotifier *notifier;
 	GNode *cur_parent_node;
@@ -225,6 +243,19 @@ file_notifier_traverse_tree_foreach (GFile    *file,
 	                                               quark_property_filesystem_mtime);
 
 	if (store_mtime && !disk_mtime) {
+		GFile *parent;
+
+		parent = tracker_file_system_peek_parent (priv->file_system, file);
+
+		if (parent &&
+		    tracker_file_system_get_property (priv->file_system, parent,
+		                                      quark_property_snapshot)) {
+			/* Parent directory is unchanged, so its
+			 * contents were not crawled.
+			 */
+			return TRUE;
+		}
+
 		/* In store but not in disk, delete */
 		g_signal_emit (notifier, signals[FILE_DELETED], 0, file);
 
@@ -255,6 +286,122 @@ file_notifier_traverse_tree_foreach (GFile    *file,
 	return FALSE;
 }
 
+static gboolean
+file_notifier_snapshot_check_foreach (GFile    *file,
+                                      gpointer  user_data)
+{
+	TrackerFileNotifier *notifier;
+	TrackerFileNotifierPrivate *priv;
+	SnapshotCheck *check;
+	GFile *parent;
+	gchar *name;
+
+	notifier = user_data;
+	priv = notifier->priv;
+
+	if (!tracker_file_system_get_property (priv->file_system, file,
+	                                       quark_property_store_mtime)) {
+		return FALSE;
+	}
+
+	parent = tracker_file_system_peek_parent (priv->file_system, file);
+
+	if (!parent) {
+		return FALSE;
+	}
+
+	check = tracker_file_system_get_property (priv->file_system, parent,
+	                                          quark_property_snapshot);
+
+	/* Other configured roots aren't crawled as part of this one */
+	if (!check ||
+	    tracker_indexing_tree_file_is_root (priv->indexing_tree, file)) {
+		return FALSE;
+	}
+
+	name = g_file_get_basename (file);
+	check->store_n_children++;
+	check->store_names_hash += tracker_directory_snapshot_hash_name (name);
+	g_free (name);
+
+	return FALSE;
+}
+
+/* Checks that the directories the crawler took from the snapshot
+ * have in the store the same children they had on disk when the
+ * snapshot was made, this catches the store and the snapshot
+ * getting out of sync.
+ */
+static gboolean
+file_notifier_check_snapshot (TrackerFileNotifier *notifier,
+                              GFile               *root)
+{
+	TrackerFileNotifierPrivate *priv;
+	GList *l;
+
+	priv = notifier->priv;
+
+	if (!priv->snapshot_directories) {
+		return TRUE;
+	}
+
+	tracker_file_system_traverse (priv->file_system,
+	                              root,
+	                              G_PRE_ORDER,
+	                              file_notifier_snapshot_check_foreach,
+	                              notifier);
+
+	for (l = priv->snapshot_directories; l; l = l->next) {
+		SnapshotCheck *check;
+
+		if (!tracker_file_system_peek_file (priv->file_system, l->data)) {
+			/* Deleted meanwhile */
+			continue;
+		}
+
+		check = tracker_file_system_get_property (priv->file_system,
+		                                          l->data,
+		                                          quark_property_snapshot);
+
+		if (check->n_children != check->store_n_children ||
+		    check->names_hash != check->store_names_hash) {
+			gchar *uri;
+
+			uri = g_file_get_uri (l->data);
+			g_debug ("Directory '%s' has %d children in the snapshot, "
+			         "%d in the store",
+			         uri, check->n_children, check->store_n_children);
+			g_free (uri);
+
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static void
+file_notifier_clear_snapshot_directories (TrackerFileNotifier *notifier)
+{
+	TrackerFileNotifierPrivate *priv;
+	GList *l;
+
+	priv = notifier->priv;
+
+	for (l = priv->snapshot_directories; l; l = l->next) {
+		if (tracker_file_system_peek_file (priv->file_system, l->data)) {
+			tracker_file_system_unset_property (priv->file_system,
+			                                    l->data,
+			                                    quark_property_snapshot);
+		}
+
+		g_object_unref (l->data);
+	}
+
+	g_list_free (priv->snapshot_directories);
+	priv->snapshot_directories = NULL;
+}
+
 static void
 file_notifier_traverse_tree (TrackerFileNotifier *notifier)
 {
@@ -272,6 +419,26 @@ file_notifier_traverse_tree (TrackerFileNotifier *notifier)
 	 */
 	if (config_root != current_root ||
 	    flags & TRACKER_DIRECTORY_FLAG_CHECK_MTIME) {
+		if (!file_notifier_check_snapshot (notifier, current_root)) {
+			gchar *uri;
+
+			uri = g_file_get_uri (current_root);
+			tracker_info ("  Directory snapshot out of date, crawling '%s' again",
+			              uri);
+			g_free (uri);
+
+			/* Crawl and query the root again, with
+			 * every directory being enumerated.
+			 */
+			tracker_crawler_forget_snapshot (priv->crawler, current_root);
+			file_notifier_clear_snapshot_directories (notifier);
+			tracker_file_system_forget_files (priv->file_system,
+			                                  current_root,
+			                                  G_FILE_TYPE_REGULAR);
+			crawl_directories_start (notifier);
+			return;
+		}
+
 		tracker_file_system_traverse (priv->file_system,
 		                              current_root,
 		                              G_LEVEL_ORDER,
@@ -279,6 +446,8 @@ file_notifier_traverse_tree (TrackerFileNotifier *notifier)
 		                              notifier);
 	}
 
+	file_notifier_clear_snapshot_directories (notifier);
+
 	/* We dispose regular files here, only directories are cached once crawling
 	 * has completed.
 	 */
@@ -345,6 +514,27 @@ file_notifier_add_node_foreach (GNode    *node,
 		tracker_file_system_set_property (priv->file_system, canonical,
 		                                  quark_property_filesystem_mtime,
 		                                  time_ptr);
+
+		if (file_type == G_FILE_TYPE_DIRECTORY) {
+			SnapshotCheck *check;
+			guint n_children;
+			guint32 names_hash;
+
+			if (tracker_crawler_get_snapshot_info (priv->crawler, file,
+			                                       &n_children,
+			                                       &names_hash)) {
+				check = g_new0 (SnapshotCheck, 1);
+				check->n_children = n_children;
+				check->names_hash = names_hash;
+
+				tracker_file_system_set_property (priv->file_system, canonical,
+				                                  quark_property_snapshot,
+				                                  check);
+				priv->snapshot_directories =
+					g_list_prepend (priv->snapshot_directories,
+					                g_object_ref (canonical));
+			}
+		}
 	}
 
 	return FALSE;
@@ -582,6 +772,20 @@ crawl_directories_start (TrackerFileNotifier *notifier)
 		tracker_file_system_unset_property (priv->file_system,
 						    directory,
 						    quark_property_queried);
+		file_notifier_clear_snapshot_directories (notifier);
+
+		/* A snapshot made with other filters may miss directories
+		 * that are now indexed, and it must not stand in for the
+		 * full store/disk comparison when mtime checks are requested.
+		 */
+		if (priv->snapshot_file) {
+			tracker_crawler_set_snapshot_config_hash (priv->crawler,
+			                                          tracker_indexing_tree_get_config_hash (priv->indexing_tree));
+		}
+
+		tracker_crawler_set_use_snapshot (priv->crawler,
+		                                  priv->snapshot_file != NULL &&
+		                                  (flags & TRACKER_DIRECTORY_FLAG_CHECK_MTIME) == 0);
 
 		g_cancellable_reset (priv->cancellable);
 
@@ -982,6 +1186,44 @@ monitor_item_moved_cb (TrackerMonitor *monitor,
 	}
 }
 
+static void
+monitor_directory_overflowed_cb (TrackerMonitor *monitor,
+                                 GFile          *directory,
+                                 gpointer        user_data)
+{
+	TrackerFileNotifier *notifier = user_data;
+	TrackerFileNotifierPrivate *priv = notifier->priv;
+	gboolean start_crawler = FALSE;
+	GFile *canonical;
+
+	if (!tracker_indexing_tree_file_is_indexable (priv->indexing_tree,
+	                                              directory,
+	                                              G_FILE_TYPE_DIRECTORY)) {
+		return;
+	}
+
+	/* Events were lost for this directory, crawl it
+	 * again to find out about the changes within.
+	 */
+	canonical = tracker_file_system_get_file (priv->file_system,
+	                                          directory,
+	                                          G_FILE_TYPE_DIRECTORY,
+	                                          NULL);
+
+	if (!priv->stopped &&
+	    !priv->pending_index_roots) {
+		start_crawler = TRUE;
+	}
+
+	if (!g_list_find (priv->pending_index_roots, canonical)) {
+		priv->pending_index_roots = g_list_append (priv->pending_index_roots,
+		                                           canonical);
+		if (start_crawler) {
+			crawl_directories_start (notifier);
+		}
+	}
+}
+
 /* Indexing tree signal handlers */
 static void
 indexing_tree_directory_added (TrackerIndexingTree *indexing_tree,
@@ -1109,8 +1351,14 @@ tracker_file_notifier_finalize (GObject *object)
 	g_object_unref (priv->cancellable);
 
 	g_list_free (priv->pending_index_roots);
+	g_list_foreach (priv->snapshot_directories, (GFunc) g_object_unref, NULL);
+	g_list_free (priv->snapshot_directories);
 	g_timer_destroy (priv->timer);
 
+	if (priv->snapshot_file) {
+		g_object_unref (priv->snapshot_file);
+	}
+
 	G_OBJECT_CLASS (tracker_file_notifier_parent_class)->finalize (object);
 }
 
@@ -1239,6 +1487,10 @@ tracker_file_notifier_class_init (TrackerFileNotifierClass *klass)
 	quark_property_filesystem_mtime = g_quark_from_static_string ("tracker-property-filesystem-mtime");
 	tracker_file_system_register_property (quark_property_filesystem_mtime,
 	                                       g_free);
+
+	quark_property_snapshot = g_quark_from_static_string ("tracker-property-snapshot");
+	tracker_file_system_register_property (quark_property_snapshot,
+	                                       g_free);
 }
 
 static void
@@ -1309,6 +1561,9 @@ tracker_file_notifier_init (TrackerFileNotifier *notifier)
 	g_signal_connect (priv->monitor, "item-moved",
 	                  G_CALLBACK (monitor_item_moved_cb),
 	                  notifier);
+	g_signal_connect (priv->monitor, "directory-overflowed",
+	                  G_CALLBACK (monitor_directory_overflowed_cb),
+	                  notifier);
 }
 
 TrackerFileNotifier *
@@ -1405,3 +1660,64 @@ tracker_file_notifier_get_file_iri (TrackerFileNotifier *notifier,
 
 	return iri;
 }
+
+/* Directories found unchanged against the snapshot in @file
+ * won't be enumerated again, see tracker_crawler_load_snapshot().
+ * A %NULL @file disables the snapshot.
+ */
+void
+tracker_file_notifier_set_snapshot_file (TrackerFileNotifier *notifier,
+                                         GFile               *file)
+{
+	TrackerFileNotifierPrivate *priv;
+	GError *error = NULL;
+
+	g_return_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier));
+	g_return_if_fail (!file || G_IS_FILE (file));
+
+	priv = notifier->priv;
+
+	if (priv->snapshot_file) {
+		g_object_unref (priv->snapshot_file);
+		priv->snapshot_file = NULL;
+	}
+
+	if (!file) {
+		return;
+	}
+
+	priv->snapshot_file = g_object_ref (file);
+
+	if (!tracker_crawler_load_snapshot (priv->crawler, file, &error)) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND)) {
+			g_message ("Could not load directory snapshot, "
+			           "crawling all directories: %s",
+			           error->message);
+		}
+
+		g_error_free (error);
+	}
+}
+
+void
+tracker_file_notifier_save_snapshot (TrackerFileNotifier *notifier)
+{
+	TrackerFileNotifierPrivate *priv;
+	GError *error = NULL;
+
+	g_return_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier));
+
+	priv = notifier->priv;
+
+	if (!priv->snapshot_file) {
+		return;
+	}
+
+	if (!tracker_crawler_save_snapshot (priv->crawler,
+	                                    priv->snapshot_file,
+	                                    &error)) {
+		g_warning ("Could not save directory snapshot: %s",
+		           error->message);
+		g_error_free (error);
+	}
+}
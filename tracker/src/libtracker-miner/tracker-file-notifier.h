@@ -84,6 +84,10 @@ gboolean      tracker_file_notifier_is_active (TrackerFileNotifier *notifier);
 const gchar * tracker_file_notifier_get_file_iri (TrackerFileNotifier *notifier,
                                                   GFile               *file);
 
+void          tracker_file_notifier_set_snapshot_file (TrackerFileNotifier *notifier,
+                                                       GFile               *file);
+void          tracker_file_notifier_save_snapshot     (TrackerFileNotifier *notifier);
+
 G_END_DECLS
 
 #endif /* __TRACKER_FILE_SYSTEM_H__ */
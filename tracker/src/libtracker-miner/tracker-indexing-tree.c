@@ -47,6 +47,7 @@ struct _NodeData
 struct _PatternData
 {
 	GPatternSpec *pattern;
+	gchar *glob_string;
 	TrackerFilterType type;
 	GFile *file; /* Only filled in in absolute paths */
 };
@@ -118,6 +119,7 @@ pattern_data_new (const gchar *glob_string,
 
 	data = g_slice_new0 (PatternData);
 	data->pattern = g_pattern_spec_new (glob_string);
+	data->glob_string = g_strdup (glob_string);
 	data->type = type;
 
 	if (g_path_is_absolute (glob_string)) {
@@ -135,6 +137,7 @@ pattern_data_free (PatternData *data)
 	}
 
 	g_pattern_spec_free (data->pattern);
+	g_free (data->glob_string);
 	g_slice_free (PatternData, data);
 }
 
@@ -896,3 +899,70 @@ tracker_indexing_tree_list_roots (TrackerIndexingTree *tree)
 	                 &nodes);
 	return nodes;
 }
+
+static gboolean
+hash_config_root (GNode    *node,
+                  gpointer  user_data)
+{
+	guint32 *hash = user_data;
+	NodeData *data = node->data;
+	gchar *uri;
+
+	if (data->shallow) {
+		return FALSE;
+	}
+
+	uri = g_file_get_uri (data->file);
+	*hash += g_str_hash (uri) * 31 + data->flags;
+	g_free (uri);
+
+	return FALSE;
+}
+
+/**
+ * tracker_indexing_tree_get_config_hash:
+ * @tree: a #TrackerIndexingTree
+ *
+ * Returns a hash of the configuration of @tree: its roots and their
+ * flags, the filters, default policies and whether hidden files are
+ * filtered. The hash changes whenever any of these does, so it can
+ * be stored along with results that depend on this configuration.
+ *
+ * Returns: the configuration hash
+ **/
+guint32
+tracker_indexing_tree_get_config_hash (TrackerIndexingTree *tree)
+{
+	TrackerIndexingTreePrivate *priv;
+	guint32 hash = 0, filters_hash = 0;
+	GList *l;
+	gint i;
+
+	g_return_val_if_fail (TRACKER_IS_INDEXING_TREE (tree), 0);
+
+	priv = tree->priv;
+
+	/* Roots and filters are combined with a sum, so the
+	 * order they were added in doesn't matter.
+	 */
+	g_node_traverse (priv->config_tree,
+	                 G_PRE_ORDER,
+	                 G_TRAVERSE_ALL,
+	                 -1,
+	                 hash_config_root,
+	                 &hash);
+
+	for (l = priv->filter_patterns; l; l = l->next) {
+		PatternData *data = l->data;
+
+		filters_hash += g_str_hash (data->glob_string) * 31 + data->type;
+	}
+
+	hash = hash * 31 + filters_hash;
+
+	for (i = TRACKER_FILTER_FILE; i <= TRACKER_FILTER_PARENT_DIRECTORY; i++) {
+		hash = hash * 31 + priv->policies[i];
+	}
+
+	return hash * 31 + priv->filter_hidden;
+}
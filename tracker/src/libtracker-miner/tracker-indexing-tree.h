@@ -116,6 +116,8 @@ gboolean  tracker_indexing_tree_file_is_root         (TrackerIndexingTree   *tre
 
 GList *   tracker_indexing_tree_list_roots           (TrackerIndexingTree   *tree);
 
+guint32   tracker_indexing_tree_get_config_hash      (TrackerIndexingTree   *tree);
+
 
 G_END_DECLS
 
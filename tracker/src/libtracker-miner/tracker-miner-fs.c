@@ -104,6 +104,25 @@ static gboolean miner_fs_queues_status_trace_timeout_cb (gpointer data);
  */
 #define TRACKER_TASK_PRIORITY G_PRIORITY_DEFAULT_IDLE + 10
 
+/* Latency histograms have one bucket for under 1ms, then one per
+ * power of two in milliseconds, the last bucket holds everything
+ * from ~16s on.
+ */
+#define LATENCY_N_BUCKETS 16
+
+/* Seconds over which the processing rate is averaged */
+#define RATE_WINDOW_SECS 5
+
+/* Introspection data for the metrics interface */
+static const gchar introspection_xml[] =
+  "<node>"
+  "  <interface name='org.freedesktop.Tracker1.Miner.FS'>"
+  "    <method name='GetMetrics'>"
+  "      <arg type='a{sv}' name='metrics' direction='out' />"
+  "    </method>"
+  "  </interface>"
+  "</node>";
+
 /**
  * SECTION:tracker-miner-fs
  * @short_description: Abstract base class for filesystem miners
@@ -147,6 +166,12 @@ typedef struct {
 	const gchar *uri;
 } RecursiveMoveData;
 
+typedef struct {
+	guint  buckets[LATENCY_N_BUCKETS];
+	guint  count;
+	gint64 total;
+} LatencyHistogram;
+
 struct _TrackerMinerFSPrivate {
 	/* File queues for indexer */
 	TrackerPriorityQueue *items_created;
@@ -197,6 +222,8 @@ struct _TrackerMinerFSPrivate {
 	                                       * during initial crawling. */
 	guint           initial_crawling : 1; /* TRUE if initial crawling should be
 	                                       * done */
+	guint           directory_snapshot : 1; /* TRUE if unchanged directories
+	                                         * are taken from a snapshot */
 	guint           timer_stopped : 1;    /* TRUE if main timer is stopped */
 	guint           extraction_timer_stopped : 1; /* TRUE if the extraction
 						       * timer is stopped */
@@ -215,6 +242,20 @@ struct _TrackerMinerFSPrivate {
 	guint           total_files_processed;
 	guint           total_files_notified;
 	guint           total_files_notified_error;
+
+	/* Metrics, exported over D-Bus */
+	GDBusNodeInfo  *introspection_data;
+	guint           registration_id;
+
+	LatencyHistogram extraction_latency;
+	LatencyHistogram sparql_latency;
+
+	guint           items_completed;
+	guint           rate_window_items;
+	gint64          rate_window_start;
+	gdouble         items_per_second;
+
+	guint64         throttled_time;       /* msecs spent in throttle timeouts */
 };
 
 typedef enum {
@@ -243,7 +284,8 @@ enum {
 	PROP_WAIT_POOL_LIMIT,
 	PROP_READY_POOL_LIMIT,
 	PROP_MTIME_CHECKING,
-	PROP_INITIAL_CRAWLING
+	PROP_INITIAL_CRAWLING,
+	PROP_DIRECTORY_SNAPSHOT
 };
 
 static void           miner_fs_initable_iface_init        (GInitableIface       *iface);
@@ -310,6 +352,15 @@ static void           task_pool_limit_reached_notify_cb       (GObject        *o
                                                                GParamSpec     *pspec,
                                                                gpointer        user_data);
 
+static void           handle_method_call                      (GDBusConnection       *connection,
+                                                               const gchar           *sender,
+                                                               const gchar           *object_path,
+                                                               const gchar           *interface_name,
+                                                               const gchar           *method_name,
+                                                               GVariant              *parameters,
+                                                               GDBusMethodInvocation *invocation,
+                                                               gpointer               user_data);
+
 static GInitableIface* miner_fs_initable_parent_iface;
 static guint signals[LAST_SIGNAL] = { 0, };
 
@@ -370,6 +421,13 @@ tracker_miner_fs_class_init (TrackerMinerFSClass *klass)
 	                                                       "Whether to perform initial crawling or not",
 	                                                       TRUE,
 	                                                       G_PARAM_READWRITE));
+	g_object_class_install_property (object_class,
+	                                 PROP_DIRECTORY_SNAPSHOT,
+	                                 g_param_spec_boolean ("directory-snapshot",
+	                                                       "Directory snapshot",
+	                                                       "Whether to skip enumerating directories unchanged since the last crawl",
+	                                                       FALSE,
+	                                                       G_PARAM_READWRITE));
 
 	/**
 	 * TrackerMinerFS::process-file:
@@ -614,27 +672,95 @@ tracker_miner_fs_init (TrackerMinerFS *object)
 	priv->initial_crawling = TRUE;
 }
 
+/* Directories unchanged since the last time the miner was idle
+ * are not enumerated again when crawling.
+ */
+static void
+miner_fs_set_snapshot_file (TrackerMinerFS *fs)
+{
+	gchar *name, *basename, *path;
+	GFile *file;
+
+	if (!fs->priv->directory_snapshot) {
+		tracker_file_notifier_set_snapshot_file (fs->priv->file_notifier, NULL);
+		return;
+	}
+
+	g_object_get (fs, "name", &name, NULL);
+
+	basename = g_strdup_printf ("%s.snapshot", name);
+	path = g_build_filename (g_get_user_cache_dir (),
+	                         "tracker",
+	                         basename,
+	                         NULL);
+	file = g_file_new_for_path (path);
+
+	tracker_file_notifier_set_snapshot_file (fs->priv->file_notifier, file);
+
+	g_object_unref (file);
+	g_free (path);
+	g_free (basename);
+	g_free (name);
+}
+
 static gboolean
 miner_fs_initable_init (GInitable     *initable,
                         GCancellable  *cancellable,
                         GError       **error)
 {
 	TrackerMinerFSPrivate *priv;
+	TrackerMiner *miner;
+	GError *inner_error = NULL;
 	guint limit;
+	GDBusInterfaceVTable interface_vtable = {
+		handle_method_call,
+		NULL,
+		NULL
+	};
 
 	if (!miner_fs_initable_parent_iface->init (initable, cancellable, error)) {
 		return FALSE;
 	}
 
+	miner = TRACKER_MINER (initable);
 	priv = TRACKER_MINER_FS_GET_PRIVATE (initable);
 
 	g_object_get (initable, "processing-pool-ready-limit", &limit, NULL);
-	priv->sparql_buffer = tracker_sparql_buffer_new (tracker_miner_get_connection (TRACKER_MINER (initable)),
+	priv->sparql_buffer = tracker_sparql_buffer_new (tracker_miner_get_connection (miner),
 	                                                 limit);
 	g_signal_connect (priv->sparql_buffer, "notify::limit-reached",
 	                  G_CALLBACK (task_pool_limit_reached_notify_cb),
 	                  initable);
 
+	/* Setup metrics interface introspection data */
+	priv->introspection_data = g_dbus_node_info_new_for_xml (introspection_xml, &inner_error);
+	if (!priv->introspection_data) {
+		g_propagate_error (error, inner_error);
+		return FALSE;
+	}
+
+	g_message ("Registering FS interface in D-Bus object...");
+	g_message ("  Path:'%s'", tracker_miner_get_dbus_full_path (miner));
+	g_message ("  Object Type:'%s'", G_OBJECT_TYPE_NAME (initable));
+
+	priv->registration_id =
+		g_dbus_connection_register_object (tracker_miner_get_dbus_connection (miner),
+		                                   tracker_miner_get_dbus_full_path (miner),
+		                                   priv->introspection_data->interfaces[0],
+		                                   &interface_vtable,
+		                                   initable,
+		                                   NULL,
+		                                   &inner_error);
+	if (inner_error) {
+		g_propagate_error (error, inner_error);
+		g_prefix_error (error,
+		                "Could not register the D-Bus object %s. ",
+		                tracker_miner_get_dbus_full_path (miner));
+		return FALSE;
+	}
+
+	miner_fs_set_snapshot_file (TRACKER_MINER_FS (initable));
+
 	return TRUE;
 }
 
@@ -652,6 +778,15 @@ fs_finalize (GObject *object)
 
 	priv = TRACKER_MINER_FS_GET_PRIVATE (object);
 
+	if (priv->registration_id != 0) {
+		g_dbus_connection_unregister_object (tracker_miner_get_dbus_connection (TRACKER_MINER (object)),
+		                                     priv->registration_id);
+	}
+
+	if (priv->introspection_data) {
+		g_dbus_node_info_unref (priv->introspection_data);
+	}
+
 	g_timer_destroy (priv->timer);
 	g_timer_destroy (priv->extraction_timer);
 
@@ -747,6 +882,9 @@ fs_set_property (GObject      *object,
 	case PROP_INITIAL_CRAWLING:
 		fs->priv->initial_crawling = g_value_get_boolean (value);
 		break;
+	case PROP_DIRECTORY_SNAPSHOT:
+		tracker_miner_fs_set_directory_snapshot (fs, g_value_get_boolean (value));
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -780,6 +918,9 @@ fs_get_property (GObject    *object,
 	case PROP_INITIAL_CRAWLING:
 		g_value_set_boolean (value, fs->priv->initial_crawling);
 		break;
+	case PROP_DIRECTORY_SNAPSHOT:
+		g_value_set_boolean (value, fs->priv->directory_snapshot);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -931,6 +1072,9 @@ process_stop (TrackerMinerFS *fs)
 	              "remaining-time", 0,
 	              NULL);
 
+	/* Everything found so far is in the store */
+	tracker_file_notifier_save_snapshot (fs->priv->file_notifier);
+
 	g_signal_emit (fs, signals[FINISHED], 0,
 	               g_timer_elapsed (fs->priv->timer, NULL),
 	               fs->priv->total_directories_found,
@@ -1013,6 +1157,77 @@ item_queue_is_blocked_by_file (TrackerMinerFS *fs,
 	return FALSE;
 }
 
+static void
+latency_histogram_add (LatencyHistogram *histogram,
+                       gint64            usecs)
+{
+	gint64 msecs;
+	guint bucket = 0;
+
+	for (msecs = usecs / 1000; msecs > 0 && bucket < LATENCY_N_BUCKETS - 1; msecs >>= 1) {
+		bucket++;
+	}
+
+	histogram->buckets[bucket]++;
+	histogram->count++;
+	histogram->total += usecs;
+}
+
+static GVariant *
+latency_histogram_to_variant (LatencyHistogram *histogram)
+{
+	GVariantBuilder builder;
+	guint i;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&builder, "{sv}", "count",
+	                       g_variant_new_uint32 (histogram->count));
+	g_variant_builder_add (&builder, "{sv}", "total-usecs",
+	                       g_variant_new_int64 (histogram->total));
+
+	g_variant_builder_open (&builder, G_VARIANT_TYPE ("{sv}"));
+	g_variant_builder_add (&builder, "s", "buckets");
+	g_variant_builder_open (&builder, G_VARIANT_TYPE_VARIANT);
+	g_variant_builder_open (&builder, G_VARIANT_TYPE ("au"));
+
+	for (i = 0; i < LATENCY_N_BUCKETS; i++) {
+		g_variant_builder_add (&builder, "u", histogram->buckets[i]);
+	}
+
+	g_variant_builder_close (&builder);
+	g_variant_builder_close (&builder);
+	g_variant_builder_close (&builder);
+
+	return g_variant_builder_end (&builder);
+}
+
+static void
+metrics_item_completed (TrackerMinerFS *fs,
+                        TrackerTask    *task)
+{
+	TrackerMinerFSPrivate *priv = fs->priv;
+	gint64 now;
+
+	now = g_get_monotonic_time ();
+	latency_histogram_add (&priv->sparql_latency,
+	                       now - tracker_task_get_creation_time (task));
+
+	priv->items_completed++;
+
+	if (priv->rate_window_start == 0) {
+		priv->rate_window_start = now;
+	}
+
+	priv->rate_window_items++;
+
+	if (now - priv->rate_window_start >= RATE_WINDOW_SECS * G_USEC_PER_SEC) {
+		priv->items_per_second = (gdouble) priv->rate_window_items * G_USEC_PER_SEC /
+			(now - priv->rate_window_start);
+		priv->rate_window_start = now;
+		priv->rate_window_items = 0;
+	}
+}
+
 static void
 sparql_buffer_task_finished_cb (GObject      *object,
                                 GAsyncResult *result,
@@ -1037,6 +1252,8 @@ sparql_buffer_task_finished_cb (GObject      *object,
 	task = g_simple_async_result_get_op_res_gpointer (G_SIMPLE_ASYNC_RESULT (result));
 	task_file = tracker_task_get_file (task);
 
+	metrics_item_completed (fs, task);
+
 	if (item_queue_is_blocked_by_file (fs, task_file)) {
 		g_object_unref (priv->item_queue_blocker);
 		priv->item_queue_blocker = NULL;
@@ -1171,6 +1388,9 @@ item_add_or_update_cb (TrackerMinerFS *fs,
 
 	tracker_task_pool_remove (fs->priv->task_pool, extraction_task);
 
+	latency_histogram_add (&fs->priv->extraction_latency,
+	                       g_get_monotonic_time () - tracker_task_get_creation_time (extraction_task));
+
 	if (error) {
 		g_message ("Could not process '%s': %s", uri, error->message);
 
@@ -2128,6 +2348,9 @@ item_queue_handlers_cb (gpointer user_data)
 	gboolean keep_processing = TRUE;
 	gint priority = 0;
 
+	/* With throttling, each run comes after a timeout of this length */
+	fs->priv->throttled_time += (guint64) (TRACKER_MAX_TIMEOUT_INTERVAL * fs->priv->throttle);
+
 	if (fs->priv->timer_stopped) {
 		g_timer_start (fs->priv->timer);
 		fs->priv->timer_stopped = FALSE;
@@ -2859,6 +3082,140 @@ file_equal_or_descendant (GFile *file,
 	return FALSE;
 }
 
+static void
+metrics_add_pool (GVariantBuilder *builder,
+                  const gchar     *prefix,
+                  TrackerTaskPool *pool)
+{
+	gchar *key;
+
+	key = g_strconcat (prefix, "-tasks", NULL);
+	g_variant_builder_add (builder, "{sv}", key,
+	                       g_variant_new_uint32 (tracker_task_pool_get_size (pool)));
+	g_free (key);
+
+	key = g_strconcat (prefix, "-limit", NULL);
+	g_variant_builder_add (builder, "{sv}", key,
+	                       g_variant_new_uint32 (tracker_task_pool_get_limit (pool)));
+	g_free (key);
+}
+
+static GVariant *
+miner_fs_get_metrics (TrackerMinerFS *fs)
+{
+	TrackerMinerFSPrivate *priv = fs->priv;
+	GVariantBuilder builder;
+	guint n_flushes, n_flushed_tasks, max_flush_size;
+	gint64 flush_time, max_flush_time, now;
+	gdouble items_per_second;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+
+	/* Queue depths */
+	g_variant_builder_add (&builder, "{sv}", "queue-created",
+	                       g_variant_new_uint32 (tracker_priority_queue_get_length (priv->items_created)));
+	g_variant_builder_add (&builder, "{sv}", "queue-updated",
+	                       g_variant_new_uint32 (tracker_priority_queue_get_length (priv->items_updated)));
+	g_variant_builder_add (&builder, "{sv}", "queue-deleted",
+	                       g_variant_new_uint32 (tracker_priority_queue_get_length (priv->items_deleted)));
+	g_variant_builder_add (&builder, "{sv}", "queue-moved",
+	                       g_variant_new_uint32 (tracker_priority_queue_get_length (priv->items_moved)));
+	g_variant_builder_add (&builder, "{sv}", "queue-writeback",
+	                       g_variant_new_uint32 (tracker_priority_queue_get_length (priv->items_writeback)));
+
+	/* Pool occupancy */
+	metrics_add_pool (&builder, "extraction", priv->task_pool);
+	metrics_add_pool (&builder, "writeback", priv->writeback_pool);
+	metrics_add_pool (&builder, "sparql", TRACKER_TASK_POOL (priv->sparql_buffer));
+
+	/* Throughput, a window that is running late means processing
+	 * slowed down or stopped, so average over it instead.
+	 */
+	now = g_get_monotonic_time ();
+	items_per_second = priv->items_per_second;
+
+	if (priv->rate_window_start != 0 &&
+	    now - priv->rate_window_start >= RATE_WINDOW_SECS * G_USEC_PER_SEC) {
+		items_per_second = (gdouble) priv->rate_window_items * G_USEC_PER_SEC /
+			(now - priv->rate_window_start);
+	}
+
+	g_variant_builder_add (&builder, "{sv}", "items-processed",
+	                       g_variant_new_uint32 (priv->items_completed));
+	g_variant_builder_add (&builder, "{sv}", "items-per-second",
+	                       g_variant_new_double (items_per_second));
+
+	/* Per stage latencies */
+	g_variant_builder_add (&builder, "{sv}", "extraction-latency",
+	                       latency_histogram_to_variant (&priv->extraction_latency));
+	g_variant_builder_add (&builder, "{sv}", "sparql-latency",
+	                       latency_histogram_to_variant (&priv->sparql_latency));
+
+	/* SPARQL buffer flushes */
+	tracker_sparql_buffer_get_flush_stats (priv->sparql_buffer,
+	                                       &n_flushes,
+	                                       &n_flushed_tasks,
+	                                       &max_flush_size,
+	                                       &flush_time,
+	                                       &max_flush_time);
+
+	g_variant_builder_add (&builder, "{sv}", "flushes",
+	                       g_variant_new_uint32 (n_flushes));
+	g_variant_builder_add (&builder, "{sv}", "flushed-tasks",
+	                       g_variant_new_uint32 (n_flushed_tasks));
+	g_variant_builder_add (&builder, "{sv}", "max-flush-size",
+	                       g_variant_new_uint32 (max_flush_size));
+	g_variant_builder_add (&builder, "{sv}", "flush-usecs",
+	                       g_variant_new_int64 (flush_time));
+	g_variant_builder_add (&builder, "{sv}", "max-flush-usecs",
+	                       g_variant_new_int64 (max_flush_time));
+
+	/* Throttling */
+	g_variant_builder_add (&builder, "{sv}", "throttle",
+	                       g_variant_new_double (priv->throttle));
+	g_variant_builder_add (&builder, "{sv}", "throttled-msecs",
+	                       g_variant_new_uint64 (priv->throttled_time));
+
+	return g_variant_builder_end (&builder);
+}
+
+static void
+handle_method_call_get_metrics (TrackerMinerFS        *fs,
+                                GDBusMethodInvocation *invocation,
+                                GVariant              *parameters)
+{
+	TrackerDBusRequest *request;
+
+	request = tracker_g_dbus_request_begin (invocation, "%s()", __PRETTY_FUNCTION__);
+
+	tracker_dbus_request_end (request, NULL);
+	g_dbus_method_invocation_return_value (invocation,
+	                                       g_variant_new ("(@a{sv})",
+	                                                      miner_fs_get_metrics (fs)));
+}
+
+static void
+handle_method_call (GDBusConnection       *connection,
+                    const gchar           *sender,
+                    const gchar           *object_path,
+                    const gchar           *interface_name,
+                    const gchar           *method_name,
+                    GVariant              *parameters,
+                    GDBusMethodInvocation *invocation,
+                    gpointer               user_data)
+{
+	TrackerMinerFS *fs = user_data;
+
+	tracker_gdbus_async_return_if_fail (fs != NULL, invocation);
+	tracker_gdbus_async_return_if_fail (TRACKER_IS_MINER_FS (fs), invocation);
+
+	if (g_strcmp0 (method_name, "GetMetrics") == 0) {
+		handle_method_call_get_metrics (fs, invocation, parameters);
+	} else {
+		g_assert_not_reached ();
+	}
+}
+
 /**
  * tracker_miner_fs_directory_add:
  * @fs: a #TrackerMinerFS
@@ -2945,15 +3302,17 @@ indexing_tree_directory_removed (TrackerIndexingTree *indexing_tree,
 	GTimer *timer = g_timer_new ();
 
 	/* Cancel all pending tasks on files inside the path given by file */
-	tracker_task_pool_foreach (priv->task_pool,
-	                           task_pool_cancel_foreach,
-	                           directory);
+	tracker_task_pool_foreach_under (priv->task_pool,
+	                                 directory,
+	                                 task_pool_cancel_foreach,
+	                                 directory);
 
 	g_debug ("  Cancelled processing pool tasks at %f\n", g_timer_elapsed (timer, NULL));
 
-	tracker_task_pool_foreach (priv->writeback_pool,
-	                           writeback_pool_cancel_foreach,
-	                           directory);
+	tracker_task_pool_foreach_under (priv->writeback_pool,
+	                                 directory,
+	                                 writeback_pool_cancel_foreach,
+	                                 directory);
 
 	g_debug ("  Cancelled writeback pool tasks at %f\n",
 	         g_timer_elapsed (timer, NULL));
@@ -3717,6 +4076,56 @@ tracker_miner_fs_get_initial_crawling (TrackerMinerFS *fs)
 	return fs->priv->initial_crawling;
 }
 
+/**
+ * tracker_miner_fs_set_directory_snapshot:
+ * @fs: a #TrackerMinerFS
+ * @directory_snapshot: a #gboolean
+ *
+ * Tells @fs whether to keep a snapshot of the crawled directories
+ * when it becomes idle, so directories whose mtime didn't change
+ * since are not enumerated again on the next crawls. Changes in the
+ * indexing tree configuration discard the snapshot, and it is not
+ * used for directories that require mtime checks.
+ *
+ * The default if not set directly is that @directory_snapshot is #FALSE.
+ **/
+void
+tracker_miner_fs_set_directory_snapshot (TrackerMinerFS *fs,
+                                         gboolean        directory_snapshot)
+{
+	g_return_if_fail (TRACKER_IS_MINER_FS (fs));
+
+	directory_snapshot = (directory_snapshot == TRUE);
+
+	if (fs->priv->directory_snapshot == directory_snapshot) {
+		return;
+	}
+
+	fs->priv->directory_snapshot = directory_snapshot;
+
+	/* Before initable_init(), the snapshot file is set there */
+	if (fs->priv->file_notifier && fs->priv->sparql_buffer) {
+		miner_fs_set_snapshot_file (fs);
+	}
+
+	g_object_notify (G_OBJECT (fs), "directory-snapshot");
+}
+
+/**
+ * tracker_miner_fs_get_directory_snapshot:
+ * @fs: a #TrackerMinerFS
+ *
+ * Returns: #TRUE if @fs skips enumerating directories unchanged
+ * since the last crawl, otherwise #FALSE.
+ **/
+gboolean
+tracker_miner_fs_get_directory_snapshot (TrackerMinerFS *fs)
+{
+	g_return_val_if_fail (TRACKER_IS_MINER_FS (fs), FALSE);
+
+	return fs->priv->directory_snapshot;
+}
+
 /**
  * tracker_miner_fs_has_items_to_process:
  * @fs: a #TrackerMinerFS
@@ -142,6 +142,9 @@ void                  tracker_miner_fs_set_initial_crawling (TrackerMinerFS *fs,
                                                              gboolean        do_initial_crawling);
 gboolean              tracker_miner_fs_get_mtime_checking   (TrackerMinerFS *fs);
 gboolean              tracker_miner_fs_get_initial_crawling (TrackerMinerFS *fs);
+void                  tracker_miner_fs_set_directory_snapshot (TrackerMinerFS *fs,
+                                                               gboolean        directory_snapshot);
+gboolean              tracker_miner_fs_get_directory_snapshot (TrackerMinerFS *fs);
 
 gboolean              tracker_miner_fs_has_items_to_process (TrackerMinerFS *fs);
 
@@ -23,6 +23,12 @@
 #include <string.h>
 #include <gio/gio.h>
 
+#ifdef HAVE_SYS_INOTIFY_H
+#include <errno.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif /* HAVE_SYS_INOTIFY_H */
+
 #include "tracker-monitor.h"
 #include "tracker-marshal.h"
 
@@ -57,6 +63,59 @@
  */
 #undef  PAUSE_ON_IO
 
+#ifdef HAVE_SYS_INOTIFY_H
+
+/* When GIO uses inotify, we talk to inotify directly instead. Events
+ * are read in batches and coalesced per path in a bounded ring before
+ * being handed to the event cache below, so a checkout or a rebuild
+ * results in at most one event per file. If the ring (or the kernel
+ * queue) overflows, the affected directories are crawled again instead.
+ */
+#define INOTIFY_RING_SIZE          4096
+
+/* Time events are kept in the ring so they can be coalesced */
+#define INOTIFY_COALESCE_MSECONDS  100
+
+/* Time a MOVED_FROM waits for its MOVED_TO before it becomes a DELETED */
+#define INOTIFY_MOVE_PAIR_MSECONDS 500
+
+/* Size of a read from the inotify descriptor, and reads done
+ * per main loop iteration.
+ */
+#define INOTIFY_READ_SIZE          (64 * 1024)
+#define INOTIFY_MAX_READS          4
+
+#ifdef IN_EXCL_UNLINK
+#define INOTIFY_MASK_EXCL_UNLINK   IN_EXCL_UNLINK
+#else
+#define INOTIFY_MASK_EXCL_UNLINK   0
+#endif
+
+#define INOTIFY_MASK (IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | \
+                      IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | \
+                      INOTIFY_MASK_EXCL_UNLINK)
+
+typedef struct {
+	gchar             *path;
+	/* Destination of a MOVED event, NULL until the MOVED_TO arrives */
+	gchar             *other_path;
+	GFileMonitorEvent  event_type;
+	guint32            cookie;
+	gint64             time;
+	guint              is_directory : 1;
+	guint              cancelled : 1;
+	/* The moved file was created within the same batch */
+	guint              created : 1;
+} InotifyEvent;
+
+typedef struct {
+	TrackerMonitor *monitor;
+	gchar          *path;
+	gint            wd;
+} InotifyWatch;
+
+#endif /* HAVE_SYS_INOTIFY_H */
+
 struct TrackerMonitorPrivate {
 	GHashTable    *monitors;
 
@@ -83,6 +142,25 @@ struct TrackerMonitorPrivate {
 	guint          event_pairs_timeout_id;
 
 	TrackerIndexingTree *tree;
+
+#ifdef HAVE_SYS_INOTIFY_H
+	/* Direct inotify backend, -1 if GIO monitors are used */
+	gint           inotify_fd;
+	guint          inotify_source_id;
+	gchar         *inotify_buffer;
+	GHashTable    *inotify_watches;
+
+	/* Pending coalesced events, in arrival order */
+	InotifyEvent  *ring;
+	guint          ring_head;
+	guint          ring_length;
+	GHashTable    *ring_by_path;
+	GHashTable    *ring_moves;
+	guint          ring_flush_id;
+
+	/* Directories which lost events and must be crawled again */
+	GHashTable    *recrawl;
+#endif /* HAVE_SYS_INOTIFY_H */
 };
 
 typedef struct {
@@ -102,6 +180,7 @@ enum {
 	ITEM_ATTRIBUTE_UPDATED,
 	ITEM_DELETED,
 	ITEM_MOVED,
+	DIRECTORY_OVERFLOWED,
 	LAST_SIGNAL
 };
 
@@ -120,9 +199,22 @@ static void           tracker_monitor_get_property (GObject        *object,
                                                     GValue         *value,
                                                     GParamSpec     *pspec);
 static guint          get_inotify_limit            (void);
-static GFileMonitor * directory_monitor_new        (TrackerMonitor *monitor,
+static gpointer       directory_monitor_new        (TrackerMonitor *monitor,
                                                     GFile          *file);
 static void           directory_monitor_cancel     (GFileMonitor     *dir_monitor);
+static void           monitor_event_process        (TrackerMonitor    *monitor,
+                                                    GFile             *file,
+                                                    GFile             *other_file,
+                                                    gboolean           is_directory,
+                                                    GFileMonitorEvent  event_type);
+#ifdef HAVE_SYS_INOTIFY_H
+static gboolean       inotify_backend_init         (TrackerMonitor *monitor);
+static void           inotify_backend_shutdown     (TrackerMonitor *monitor);
+static void           inotify_watch_free           (gpointer        data);
+static void           inotify_watch_stop           (InotifyWatch   *watch);
+static gint           inotify_watch_start          (InotifyWatch   *watch);
+static void           inotify_ring_clear           (TrackerMonitorPrivate *priv);
+#endif /* HAVE_SYS_INOTIFY_H */
 
 
 static void           event_data_free              (gpointer        data);
@@ -204,6 +296,20 @@ tracker_monitor_class_init (TrackerMonitorClass *klass)
 		              G_TYPE_BOOLEAN,
 		              G_TYPE_BOOLEAN);
 
+	/* Emitted when events for items in the directory were lost,
+	 * its contents have to be inspected again.
+	 */
+	signals[DIRECTORY_OVERFLOWED] =
+		g_signal_new ("directory-overflowed",
+		              G_TYPE_FROM_CLASS (klass),
+		              G_SIGNAL_RUN_LAST,
+		              0,
+		              NULL, NULL,
+		              g_cclosure_marshal_VOID__OBJECT,
+		              G_TYPE_NONE,
+		              1,
+		              G_TYPE_OBJECT);
+
 	g_object_class_install_property (object_class,
 	                                 PROP_ENABLED,
 	                                 g_param_spec_boolean ("enabled",
@@ -231,12 +337,9 @@ tracker_monitor_init (TrackerMonitor *object)
 	/* By default we enable monitoring */
 	priv->enabled = TRUE;
 
-	/* Create monitors table for this module */
-	priv->monitors =
-		g_hash_table_new_full (g_file_hash,
-		                       (GEqualFunc) g_file_equal,
-		                       (GDestroyNotify) g_object_unref,
-		                       (GDestroyNotify) directory_monitor_cancel);
+#ifdef HAVE_SYS_INOTIFY_H
+	priv->inotify_fd = -1;
+#endif /* HAVE_SYS_INOTIFY_H */
 
 	priv->pre_update =
 		g_hash_table_new_full (g_file_hash,
@@ -295,6 +398,12 @@ tracker_monitor_init (TrackerMonitor *object)
 			 * negative maximum.
 			 */
 			priv->monitor_limit = MAX (priv->monitor_limit, 0);
+
+#ifdef HAVE_SYS_INOTIFY_H
+			if (inotify_backend_init (object)) {
+				g_message ("Reading inotify events directly");
+			}
+#endif /* HAVE_SYS_INOTIFY_H */
 		}
 		else if (strcmp (name, "GFamDirectoryMonitor") == 0) {
 			/* Using Fam */
@@ -336,6 +445,24 @@ tracker_monitor_init (TrackerMonitor *object)
 
 	g_object_unref (file);
 	g_message ("Monitor limit is %d", priv->monitor_limit);
+
+	/* Create monitors table for this module */
+#ifdef HAVE_SYS_INOTIFY_H
+	if (priv->inotify_fd >= 0) {
+		priv->monitors =
+			g_hash_table_new_full (g_file_hash,
+			                       (GEqualFunc) g_file_equal,
+			                       (GDestroyNotify) g_object_unref,
+			                       inotify_watch_free);
+	} else
+#endif /* HAVE_SYS_INOTIFY_H */
+	{
+		priv->monitors =
+			g_hash_table_new_full (g_file_hash,
+			                       (GEqualFunc) g_file_equal,
+			                       (GDestroyNotify) g_object_unref,
+			                       (GDestroyNotify) directory_monitor_cancel);
+	}
 }
 
 static void
@@ -359,6 +486,12 @@ tracker_monitor_finalize (GObject *object)
 	g_hash_table_unref (priv->pre_delete);
 	g_hash_table_unref (priv->monitors);
 
+#ifdef HAVE_SYS_INOTIFY_H
+	if (priv->inotify_fd >= 0) {
+		inotify_backend_shutdown (TRACKER_MONITOR (object));
+	}
+#endif /* HAVE_SYS_INOTIFY_H */
+
 	G_OBJECT_CLASS (tracker_monitor_parent_class)->finalize (object);
 }
 
@@ -1198,8 +1331,6 @@ monitor_event_cb (GFileMonitor      *file_monitor,
                   gpointer           user_data)
 {
 	TrackerMonitor *monitor;
-	gchar *file_uri;
-	gchar *other_file_uri;
 	gboolean is_directory;
 
 	monitor = user_data;
@@ -1209,12 +1340,37 @@ monitor_event_cb (GFileMonitor      *file_monitor,
 		return;
 	}
 
+	if (!other_file) {
+		is_directory = check_is_directory (monitor, file);
+	} else {
+		/* If we have other_file, it means an item was moved from file to other_file;
+		 * so, it makes sense to check if the other_file is directory instead of
+		 * the origin file, as this one will not exist any more */
+		is_directory = check_is_directory (monitor, other_file);
+	}
+
+	monitor_event_process (monitor, file, other_file, is_directory, event_type);
+}
+
+static void
+monitor_event_process (TrackerMonitor    *monitor,
+                       GFile             *file,
+                       GFile             *other_file,
+                       gboolean           is_directory,
+                       GFileMonitorEvent  event_type)
+{
+	gchar *file_uri;
+	gchar *other_file_uri;
+
+	if (G_UNLIKELY (!monitor->priv->enabled)) {
+		g_debug ("Silently dropping monitor event, monitor disabled for now");
+		return;
+	}
+
 	/* Get URIs as paths may not be in UTF-8 */
 	file_uri = g_file_get_uri (file);
 
 	if (!other_file) {
-		is_directory = check_is_directory (monitor, file);
-
 		/* Avoid non-indexable-files */
 		if (monitor->priv->tree &&
 		    !tracker_indexing_tree_file_is_indexable (monitor->priv->tree,
@@ -1233,11 +1389,6 @@ monitor_event_cb (GFileMonitor      *file_monitor,
 		         is_directory ? "directory" : "file",
 		         file_uri);
 	} else {
-		/* If we have other_file, it means an item was moved from file to other_file;
-		 * so, it makes sense to check if the other_file is directory instead of
-		 * the origin file, as this one will not exist any more */
-		is_directory = check_is_directory (monitor, other_file);
-
 		/* Avoid doing anything of both
 		 * file/other_file are non-indexable
 		 */
@@ -1350,13 +1501,743 @@ monitor_event_cb (GFileMonitor      *file_monitor,
 	g_free (other_file_uri);
 }
 
-static GFileMonitor *
+#ifdef HAVE_SYS_INOTIFY_H
+
+static gint
+inotify_watch_start (InotifyWatch *watch)
+{
+	TrackerMonitorPrivate *priv;
+	gint wd;
+
+	priv = watch->monitor->priv;
+	wd = inotify_add_watch (priv->inotify_fd, watch->path, INOTIFY_MASK);
+
+	if (wd < 0) {
+		return errno;
+	}
+
+	watch->wd = wd;
+
+	/* inotify returns the same watch descriptor for a
+	 * directory reachable through several paths (e.g. the
+	 * destination of a directory move, before the old
+	 * location is removed), events are reported for the
+	 * latest path.
+	 */
+	g_hash_table_insert (priv->inotify_watches,
+	                     GINT_TO_POINTER (wd),
+	                     watch);
+
+	return 0;
+}
+
+static void
+inotify_watch_stop (InotifyWatch *watch)
+{
+	TrackerMonitorPrivate *priv;
+
+	if (watch->wd < 0) {
+		return;
+	}
+
+	priv = watch->monitor->priv;
+
+	if (g_hash_table_lookup (priv->inotify_watches,
+	                         GINT_TO_POINTER (watch->wd)) == watch) {
+		g_hash_table_remove (priv->inotify_watches,
+		                     GINT_TO_POINTER (watch->wd));
+		inotify_rm_watch (priv->inotify_fd, watch->wd);
+	}
+
+	watch->wd = -1;
+}
+
+static InotifyWatch *
+inotify_watch_new (TrackerMonitor *monitor,
+                   GFile          *file)
+{
+	InotifyWatch *watch;
+	gint error_code;
+	gchar *path;
+
+	path = g_file_get_path (file);
+
+	if (!path) {
+		gchar *uri;
+
+		uri = g_file_get_uri (file);
+		g_warning ("Could not add monitor for path:'%s', not a local file",
+		           uri);
+		g_free (uri);
+
+		return NULL;
+	}
+
+	watch = g_slice_new0 (InotifyWatch);
+	watch->monitor = monitor;
+	watch->path = path;
+	watch->wd = -1;
+
+	error_code = inotify_watch_start (watch);
+
+	/* Directories which don't exist yet are watched once
+	 * they are added again after being created.
+	 */
+	if (error_code != 0 && error_code != ENOENT) {
+		g_warning ("Could not add monitor for path:'%s', %s",
+		           path, g_strerror (error_code));
+		inotify_watch_free (watch);
+
+		return NULL;
+	}
+
+	return watch;
+}
+
+static void
+inotify_watch_free (gpointer data)
+{
+	InotifyWatch *watch;
+
+	watch = data;
+
+	if (!watch) {
+		return;
+	}
+
+	inotify_watch_stop (watch);
+	g_free (watch->path);
+	g_slice_free (InotifyWatch, watch);
+}
+
+static void
+inotify_event_clear (InotifyEvent *event)
+{
+	g_free (event->path);
+	g_free (event->other_path);
+	memset (event, 0, sizeof (InotifyEvent));
+}
+
+static void
+inotify_ring_unlink (TrackerMonitorPrivate *priv,
+                     InotifyEvent          *event)
+{
+	if (event->path &&
+	    g_hash_table_lookup (priv->ring_by_path, event->path) == event) {
+		g_hash_table_remove (priv->ring_by_path, event->path);
+	}
+
+	if (event->other_path &&
+	    g_hash_table_lookup (priv->ring_by_path, event->other_path) == event) {
+		g_hash_table_remove (priv->ring_by_path, event->other_path);
+	}
+
+	if (event->cookie != 0 &&
+	    g_hash_table_lookup (priv->ring_moves, GUINT_TO_POINTER (event->cookie)) == event) {
+		g_hash_table_remove (priv->ring_moves, GUINT_TO_POINTER (event->cookie));
+	}
+}
+
+static void
+inotify_event_cancel (TrackerMonitorPrivate *priv,
+                      InotifyEvent          *event)
+{
+	/* The slot is reclaimed when it reaches the head of the ring */
+	inotify_ring_unlink (priv, event);
+	inotify_event_clear (event);
+	event->cancelled = TRUE;
+}
+
+static void
+inotify_ring_clear (TrackerMonitorPrivate *priv)
+{
+	guint i;
+
+	g_hash_table_remove_all (priv->ring_by_path);
+	g_hash_table_remove_all (priv->ring_moves);
+
+	for (i = 0; i < priv->ring_length; i++) {
+		inotify_event_clear (&priv->ring[(priv->ring_head + i) % INOTIFY_RING_SIZE]);
+	}
+
+	priv->ring_head = 0;
+	priv->ring_length = 0;
+}
+
+static void
+inotify_ring_overflow (TrackerMonitorPrivate *priv)
+{
+	guint i;
+
+	/* Drop all pending events, and crawl again the
+	 * directories they happened in.
+	 */
+	for (i = 0; i < priv->ring_length; i++) {
+		InotifyEvent *event;
+
+		event = &priv->ring[(priv->ring_head + i) % INOTIFY_RING_SIZE];
+
+		if (event->cancelled) {
+			continue;
+		}
+
+		g_hash_table_replace (priv->recrawl,
+		                      g_path_get_dirname (event->path),
+		                      NULL);
+
+		if (event->other_path) {
+			g_hash_table_replace (priv->recrawl,
+			                      g_path_get_dirname (event->other_path),
+			                      NULL);
+		}
+	}
+
+	inotify_ring_clear (priv);
+}
+
+static InotifyEvent *
+inotify_ring_append (TrackerMonitorPrivate *priv,
+                     const gchar           *path,
+                     gboolean               is_directory,
+                     GFileMonitorEvent      event_type)
+{
+	InotifyEvent *event;
+
+	if (priv->ring_length == INOTIFY_RING_SIZE) {
+		g_message ("Too many pending monitor events, "
+		           "crawling again the directories involved");
+
+		inotify_ring_overflow (priv);
+		g_hash_table_replace (priv->recrawl,
+		                      g_path_get_dirname (path),
+		                      NULL);
+		return NULL;
+	}
+
+	event = &priv->ring[(priv->ring_head + priv->ring_length) % INOTIFY_RING_SIZE];
+	priv->ring_length++;
+
+	event->path = g_strdup (path);
+	event->event_type = event_type;
+	event->is_directory = is_directory;
+	event->time = g_get_monotonic_time ();
+
+	g_hash_table_replace (priv->ring_by_path, event->path, event);
+
+	return event;
+}
+
+static gint
+inotify_event_rank (GFileMonitorEvent event_type)
+{
+	switch (event_type) {
+	case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
+		return 0;
+	case G_FILE_MONITOR_EVENT_CHANGED:
+		return 1;
+	case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+		return 2;
+	default:
+		return -1;
+	}
+}
+
+static void
+inotify_event_queue (TrackerMonitorPrivate *priv,
+                     const gchar           *path,
+                     gboolean               is_directory,
+                     GFileMonitorEvent      event_type)
+{
+	InotifyEvent *previous;
+
+	previous = g_hash_table_lookup (priv->ring_by_path, path);
+
+	/* Events are merged with the last pending one for the
+	 * same path, moves are never merged with later events.
+	 */
+	if (previous &&
+	    previous->event_type != G_FILE_MONITOR_EVENT_MOVED) {
+		switch (event_type) {
+		case G_FILE_MONITOR_EVENT_CREATED:
+			/* DELETED + CREATED = UPDATED, the file was replaced */
+			if (previous->event_type == G_FILE_MONITOR_EVENT_DELETED &&
+			    !previous->is_directory && !is_directory) {
+				previous->event_type = G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT;
+				return;
+			}
+			break;
+
+		case G_FILE_MONITOR_EVENT_CHANGED:
+		case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+		case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
+			/* CREATED + UPDATED = CREATED */
+			if (previous->event_type == G_FILE_MONITOR_EVENT_CREATED) {
+				return;
+			}
+
+			/* UPDATED + UPDATED = UPDATED, keeping the strongest */
+			if (previous->event_type != G_FILE_MONITOR_EVENT_DELETED) {
+				if (inotify_event_rank (event_type) > inotify_event_rank (previous->event_type)) {
+					previous->event_type = event_type;
+				}
+				return;
+			}
+			break;
+
+		case G_FILE_MONITOR_EVENT_DELETED:
+			/* CREATED + DELETED = nothing */
+			if (previous->event_type == G_FILE_MONITOR_EVENT_CREATED) {
+				inotify_event_cancel (priv, previous);
+				return;
+			}
+
+			/* UPDATED + DELETED = DELETED */
+			previous->event_type = G_FILE_MONITOR_EVENT_DELETED;
+			return;
+
+		default:
+			break;
+		}
+	}
+
+	inotify_ring_append (priv, path, is_directory, event_type);
+}
+
+static void
+inotify_event_queue_move_from (TrackerMonitorPrivate *priv,
+                               const gchar           *path,
+                               gboolean               is_directory,
+                               guint32                cookie)
+{
+	InotifyEvent *previous, *event;
+	gboolean created = FALSE;
+
+	previous = g_hash_table_lookup (priv->ring_by_path, path);
+
+	if (previous &&
+	    previous->event_type == G_FILE_MONITOR_EVENT_CREATED) {
+		/* The CREATED is reported at the destination */
+		inotify_event_cancel (priv, previous);
+		created = TRUE;
+	}
+
+	event = inotify_ring_append (priv, path, is_directory,
+	                             G_FILE_MONITOR_EVENT_MOVED);
+
+	if (!event) {
+		return;
+	}
+
+	event->cookie = cookie;
+	event->created = created;
+
+	g_hash_table_replace (priv->ring_moves,
+	                      GUINT_TO_POINTER (cookie),
+	                      event);
+}
+
+static void
+inotify_event_queue_move_to (TrackerMonitorPrivate *priv,
+                             const gchar           *path,
+                             gboolean               is_directory,
+                             guint32                cookie)
+{
+	InotifyEvent *event;
+
+	event = g_hash_table_lookup (priv->ring_moves, GUINT_TO_POINTER (cookie));
+
+	if (!event) {
+		/* Moved from a place we don't monitor */
+		inotify_event_queue (priv, path, is_directory,
+		                     G_FILE_MONITOR_EVENT_CREATED);
+		return;
+	}
+
+	g_hash_table_remove (priv->ring_moves, GUINT_TO_POINTER (cookie));
+	event->cookie = 0;
+
+	if (event->created) {
+		/* CREATED(A) + MOVED(A->B) = UPDATED(B), as B may have
+		 * existed before. Directories still need to be crawled.
+		 */
+		inotify_event_cancel (priv, event);
+		inotify_event_queue (priv, path, is_directory,
+		                     (is_directory ?
+		                      G_FILE_MONITOR_EVENT_CREATED :
+		                      G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT));
+		return;
+	}
+
+	event->other_path = g_strdup (path);
+	g_hash_table_replace (priv->ring_by_path, event->other_path, event);
+}
+
+static void
+inotify_queue_overflow (TrackerMonitor *monitor)
+{
+	TrackerMonitorPrivate *priv;
+
+	priv = monitor->priv;
+
+	if (priv->ring_length == 0 &&
+	    g_hash_table_size (priv->recrawl) == 0) {
+		GHashTableIter iter;
+		gpointer key, value;
+
+		/* We have no clue about where events were
+		 * lost, so check all top level directories.
+		 */
+		g_message ("Inotify queue overflowed, crawling again all monitored directories");
+
+		g_hash_table_iter_init (&iter, priv->monitors);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			InotifyWatch *watch = value;
+			GFile *parent;
+
+			if (!watch) {
+				continue;
+			}
+
+			parent = g_file_get_parent (key);
+
+			if (!parent ||
+			    !g_hash_table_lookup (priv->monitors, parent)) {
+				g_hash_table_replace (priv->recrawl,
+				                      g_strdup (watch->path),
+				                      NULL);
+			}
+
+			if (parent) {
+				g_object_unref (parent);
+			}
+		}
+	} else {
+		g_message ("Inotify queue overflowed, crawling again "
+		           "the directories with pending events");
+	}
+
+	inotify_ring_overflow (priv);
+}
+
+static void
+inotify_event_handle (TrackerMonitor       *monitor,
+                      struct inotify_event *ievent)
+{
+	TrackerMonitorPrivate *priv;
+	InotifyWatch *watch;
+	gboolean is_directory;
+	gchar *path;
+
+	priv = monitor->priv;
+
+	if (ievent->mask & IN_Q_OVERFLOW) {
+		inotify_queue_overflow (monitor);
+		return;
+	}
+
+	watch = g_hash_table_lookup (priv->inotify_watches,
+	                             GINT_TO_POINTER (ievent->wd));
+
+	if (!watch) {
+		return;
+	}
+
+	if (ievent->mask & IN_IGNORED) {
+		/* The directory is gone, the watch can
+		 * be set up again if it's created back.
+		 */
+		g_hash_table_remove (priv->inotify_watches,
+		                     GINT_TO_POINTER (ievent->wd));
+		watch->wd = -1;
+		return;
+	}
+
+	/* Events on the directory itself are
+	 * reported through its parent.
+	 */
+	if (ievent->len == 0 || !priv->enabled) {
+		return;
+	}
+
+	/* No need to track items in directories
+	 * which are going to be crawled anyway.
+	 */
+	if (g_hash_table_lookup_extended (priv->recrawl, watch->path, NULL, NULL)) {
+		return;
+	}
+
+	is_directory = (ievent->mask & IN_ISDIR) != 0;
+	path = g_build_filename (watch->path, ievent->name, NULL);
+
+	if (ievent->mask & IN_MOVED_FROM) {
+		inotify_event_queue_move_from (priv, path, is_directory, ievent->cookie);
+	} else if (ievent->mask & IN_MOVED_TO) {
+		inotify_event_queue_move_to (priv, path, is_directory, ievent->cookie);
+	} else if (ievent->mask & IN_CREATE) {
+		inotify_event_queue (priv, path, is_directory,
+		                     G_FILE_MONITOR_EVENT_CREATED);
+	} else if (ievent->mask & IN_DELETE) {
+		inotify_event_queue (priv, path, is_directory,
+		                     G_FILE_MONITOR_EVENT_DELETED);
+	} else if (ievent->mask & IN_CLOSE_WRITE) {
+		inotify_event_queue (priv, path, is_directory,
+		                     G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT);
+	} else if (ievent->mask & IN_MODIFY) {
+		inotify_event_queue (priv, path, is_directory,
+		                     G_FILE_MONITOR_EVENT_CHANGED);
+	} else if (ievent->mask & IN_ATTRIB) {
+		inotify_event_queue (priv, path, is_directory,
+		                     G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED);
+	}
+
+	g_free (path);
+}
+
+static void
+inotify_event_emit (TrackerMonitor *monitor,
+                    InotifyEvent   *event)
+{
+	GFile *file, *other_file = NULL;
+
+	file = g_file_new_for_path (event->path);
+
+	if (event->other_path) {
+		other_file = g_file_new_for_path (event->other_path);
+	}
+
+	monitor_event_process (monitor, file, other_file,
+	                       event->is_directory,
+	                       event->event_type);
+
+	g_object_unref (file);
+
+	if (other_file) {
+		g_object_unref (other_file);
+	}
+}
+
+static gboolean
+inotify_ring_flush_cb (gpointer user_data)
+{
+	TrackerMonitor *monitor;
+	TrackerMonitorPrivate *priv;
+	GHashTableIter iter;
+	GHashTable *recrawl;
+	gpointer key;
+	gint64 now;
+
+	monitor = user_data;
+	priv = monitor->priv;
+	now = g_get_monotonic_time ();
+
+	/* Steal the set, as handlers may modify the monitor */
+	recrawl = priv->recrawl;
+	priv->recrawl = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	g_hash_table_iter_init (&iter, recrawl);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		GFile *directory;
+
+		g_debug ("Emitting DIRECTORY_OVERFLOWED for '%s'", (gchar *) key);
+
+		directory = g_file_new_for_path (key);
+		g_signal_emit (monitor, signals[DIRECTORY_OVERFLOWED], 0, directory);
+		g_object_unref (directory);
+	}
+
+	g_hash_table_unref (recrawl);
+
+	while (priv->ring_length > 0) {
+		InotifyEvent *head;
+		InotifyEvent event;
+
+		head = &priv->ring[priv->ring_head];
+
+		/* Events are emitted in order, so stop at a move
+		 * still waiting for its destination.
+		 */
+		if (!head->cancelled &&
+		    head->event_type == G_FILE_MONITOR_EVENT_MOVED &&
+		    !head->other_path &&
+		    now - head->time < INOTIFY_MOVE_PAIR_MSECONDS * 1000) {
+			break;
+		}
+
+		inotify_ring_unlink (priv, head);
+		event = *head;
+		memset (head, 0, sizeof (InotifyEvent));
+
+		priv->ring_head = (priv->ring_head + 1) % INOTIFY_RING_SIZE;
+		priv->ring_length--;
+
+		if (!event.cancelled) {
+			if (event.event_type == G_FILE_MONITOR_EVENT_MOVED &&
+			    !event.other_path) {
+				/* Moved to a place we don't monitor */
+				event.event_type = G_FILE_MONITOR_EVENT_DELETED;
+			}
+
+			if (!event.created) {
+				inotify_event_emit (monitor, &event);
+			}
+		}
+
+		g_free (event.path);
+		g_free (event.other_path);
+	}
+
+	if (priv->ring_length > 0) {
+		return TRUE;
+	}
+
+	priv->ring_flush_id = 0;
+
+	return FALSE;
+}
+
+static void
+inotify_ring_schedule_flush (TrackerMonitor *monitor)
+{
+	TrackerMonitorPrivate *priv;
+
+	priv = monitor->priv;
+
+	if ((priv->ring_length > 0 || g_hash_table_size (priv->recrawl) > 0) &&
+	    priv->ring_flush_id == 0) {
+		priv->ring_flush_id =
+			g_timeout_add (INOTIFY_COALESCE_MSECONDS,
+			               inotify_ring_flush_cb,
+			               monitor);
+	}
+}
+
+static gboolean
+inotify_read_cb (GIOChannel   *channel,
+                 GIOCondition  condition,
+                 gpointer      user_data)
+{
+	TrackerMonitor *monitor;
+	TrackerMonitorPrivate *priv;
+	gint reads;
+
+	monitor = user_data;
+	priv = monitor->priv;
+
+	/* Read a bounded amount of events per main loop
+	 * iteration, the rest is read in the next ones.
+	 */
+	for (reads = 0; reads < INOTIFY_MAX_READS; reads++) {
+		gssize length;
+		gchar *p;
+
+		length = read (priv->inotify_fd, priv->inotify_buffer, INOTIFY_READ_SIZE);
+
+		if (length < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			if (errno != EAGAIN) {
+				g_warning ("Could not read inotify events: %s",
+				           g_strerror (errno));
+			}
+
+			break;
+		}
+
+		if (length == 0) {
+			break;
+		}
+
+		p = priv->inotify_buffer;
+
+		while (p < priv->inotify_buffer + length) {
+			struct inotify_event *ievent;
+
+			ievent = (struct inotify_event *) p;
+			inotify_event_handle (monitor, ievent);
+
+			p += sizeof (struct inotify_event) + ievent->len;
+		}
+	}
+
+	inotify_ring_schedule_flush (monitor);
+
+	return TRUE;
+}
+
+static gboolean
+inotify_backend_init (TrackerMonitor *monitor)
+{
+	TrackerMonitorPrivate *priv;
+	GIOChannel *channel;
+
+	priv = monitor->priv;
+	priv->inotify_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+
+	if (priv->inotify_fd < 0) {
+		g_warning ("Could not initialize inotify, %s",
+		           g_strerror (errno));
+		return FALSE;
+	}
+
+	priv->inotify_buffer = g_malloc (INOTIFY_READ_SIZE);
+	priv->inotify_watches = g_hash_table_new (NULL, NULL);
+
+	priv->ring = g_new0 (InotifyEvent, INOTIFY_RING_SIZE);
+	priv->ring_by_path = g_hash_table_new (g_str_hash, g_str_equal);
+	priv->ring_moves = g_hash_table_new (NULL, NULL);
+	priv->recrawl = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	channel = g_io_channel_unix_new (priv->inotify_fd);
+	priv->inotify_source_id = g_io_add_watch (channel, G_IO_IN,
+	                                          inotify_read_cb,
+	                                          monitor);
+	g_io_channel_unref (channel);
+
+	return TRUE;
+}
+
+static void
+inotify_backend_shutdown (TrackerMonitor *monitor)
+{
+	TrackerMonitorPrivate *priv;
+
+	priv = monitor->priv;
+
+	g_source_remove (priv->inotify_source_id);
+
+	if (priv->ring_flush_id) {
+		g_source_remove (priv->ring_flush_id);
+	}
+
+	inotify_ring_clear (priv);
+	g_free (priv->ring);
+	g_hash_table_unref (priv->ring_by_path);
+	g_hash_table_unref (priv->ring_moves);
+	g_hash_table_unref (priv->recrawl);
+	g_hash_table_unref (priv->inotify_watches);
+	g_free (priv->inotify_buffer);
+
+	close (priv->inotify_fd);
+	priv->inotify_fd = -1;
+}
+
+#endif /* HAVE_SYS_INOTIFY_H */
+
+static gpointer
 directory_monitor_new (TrackerMonitor *monitor,
                        GFile          *file)
 {
 	GFileMonitor *file_monitor;
 	GError *error = NULL;
 
+#ifdef HAVE_SYS_INOTIFY_H
+	if (monitor->priv->inotify_fd >= 0) {
+		return inotify_watch_new (monitor, file);
+	}
+#endif /* HAVE_SYS_INOTIFY_H */
+
 	file_monitor = g_file_monitor_directory (file,
 	                                         G_FILE_MONITOR_SEND_MOVED | G_FILE_MONITOR_WATCH_MOUNTS,
 	                                         NULL,
@@ -1448,6 +2329,14 @@ tracker_monitor_set_enabled (TrackerMonitor *monitor,
 	monitor->priv->enabled = enabled;
 	g_object_notify (G_OBJECT (monitor), "enabled");
 
+#ifdef HAVE_SYS_INOTIFY_H
+	if (!enabled && monitor->priv->inotify_fd >= 0) {
+		/* Drop pending events, as GIO monitors would do */
+		inotify_ring_clear (monitor->priv);
+		g_hash_table_remove_all (monitor->priv->recrawl);
+	}
+#endif /* HAVE_SYS_INOTIFY_H */
+
 	keys = g_hash_table_get_keys (monitor->priv->monitors);
 
 	/* Update state on all monitored dirs */
@@ -1457,7 +2346,7 @@ tracker_monitor_set_enabled (TrackerMonitor *monitor,
 		file = k->data;
 
 		if (enabled) {
-			GFileMonitor *dir_monitor;
+			gpointer dir_monitor;
 
 			dir_monitor = directory_monitor_new (monitor, file);
 			g_hash_table_replace (monitor->priv->monitors,
@@ -1476,13 +2365,25 @@ gboolean
 tracker_monitor_add (TrackerMonitor *monitor,
                      GFile          *file)
 {
-	GFileMonitor *dir_monitor = NULL;
+	gpointer dir_monitor = NULL;
 	gchar *uri;
 
 	g_return_val_if_fail (TRACKER_IS_MONITOR (monitor), FALSE);
 	g_return_val_if_fail (G_IS_FILE (file), FALSE);
 
-	if (g_hash_table_lookup (monitor->priv->monitors, file)) {
+	dir_monitor = g_hash_table_lookup (monitor->priv->monitors, file);
+
+	if (dir_monitor) {
+#ifdef HAVE_SYS_INOTIFY_H
+		/* The directory might not have existed
+		 * when the watch was first added.
+		 */
+		if (monitor->priv->inotify_fd >= 0 &&
+		    ((InotifyWatch *) dir_monitor)->wd < 0) {
+			inotify_watch_start (dir_monitor);
+		}
+#endif /* HAVE_SYS_INOTIFY_H */
+
 		return TRUE;
 	}
 
@@ -1615,7 +2516,18 @@ monitor_cancel_recursively (TrackerMonitor *monitor,
 		}
 
 		uri = g_file_get_uri (iter_file);
-		g_file_monitor_cancel (G_FILE_MONITOR (iter_file_monitor));
+
+#ifdef HAVE_SYS_INOTIFY_H
+		if (monitor->priv->inotify_fd >= 0) {
+			if (iter_file_monitor) {
+				inotify_watch_stop (iter_file_monitor);
+			}
+		} else
+#endif /* HAVE_SYS_INOTIFY_H */
+		{
+			g_file_monitor_cancel (G_FILE_MONITOR (iter_file_monitor));
+		}
+
 		g_debug ("Cancelled monitor for path:'%s'", uri);
 		g_free (uri);
 
@@ -1667,3 +2579,34 @@ tracker_monitor_get_ignored (TrackerMonitor *monitor)
 
 	return monitor->priv->monitors_ignored;
 }
+
+/* Handles an IN_Q_OVERFLOW event as if the kernel had sent it, so
+ * tests don't depend on the inotify queue size. Returns FALSE if
+ * inotify isn't used directly.
+ */
+gboolean
+tracker_monitor_inject_queue_overflow (TrackerMonitor *monitor)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+	struct inotify_event ievent;
+
+	g_return_val_if_fail (TRACKER_IS_MONITOR (monitor), FALSE);
+
+	if (monitor->priv->inotify_fd < 0) {
+		return FALSE;
+	}
+
+	memset (&ievent, 0, sizeof (ievent));
+	ievent.wd = -1;
+	ievent.mask = IN_Q_OVERFLOW;
+
+	inotify_event_handle (monitor, &ievent);
+	inotify_ring_schedule_flush (monitor);
+
+	return TRUE;
+#else  /* HAVE_SYS_INOTIFY_H */
+	g_return_val_if_fail (TRACKER_IS_MONITOR (monitor), FALSE);
+
+	return FALSE;
+#endif /* HAVE_SYS_INOTIFY_H */
+}
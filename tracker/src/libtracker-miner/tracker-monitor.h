@@ -76,6 +76,9 @@ gboolean        tracker_monitor_is_watched_by_string (TrackerMonitor *monitor,
 guint           tracker_monitor_get_count            (TrackerMonitor *monitor);
 guint           tracker_monitor_get_ignored          (TrackerMonitor *monitor);
 
+/* Testing */
+gboolean        tracker_monitor_inject_queue_overflow (TrackerMonitor *monitor);
+
 G_END_DECLS
 
 #endif /* __LIBTRACKER_MINER_MONITOR_H__ */
@@ -51,6 +51,13 @@ struct _TrackerSparqlBufferPrivate
 	guint flush_timeout_id;
 	GPtrArray *tasks;
 	gint n_updates;
+
+	/* Flush statistics, times in microseconds */
+	guint n_flushes;
+	guint n_flushed_tasks;
+	guint max_flush_size;
+	gint64 flush_time;
+	gint64 max_flush_time;
 };
 
 struct _SparqlTaskData
@@ -82,6 +89,8 @@ struct _UpdateArrayData {
 	GArray *error_map;
 	GPtrArray *bulk_ops;
 	gint n_bulk_operations;
+	gboolean with_triples;
+	gint64 start_time;
 };
 
 struct _BulkOperationMerge {
@@ -260,6 +269,7 @@ tracker_sparql_buffer_update_array_cb (GObject      *object,
 	GError *global_error = NULL;
 	GPtrArray *sparql_array_errors;
 	UpdateArrayData *update_data;
+	gint64 elapsed;
 	gint i;
 
 	/* Get arrays of errors and queries */
@@ -267,12 +277,22 @@ tracker_sparql_buffer_update_array_cb (GObject      *object,
 	priv = TRACKER_SPARQL_BUFFER (update_data->buffer)->priv;
 	priv->n_updates--;
 
+	elapsed = g_get_monotonic_time () - update_data->start_time;
+	priv->flush_time += elapsed;
+	priv->max_flush_time = MAX (priv->max_flush_time, elapsed);
+
 	g_debug ("(Sparql buffer) Finished array-update with %u tasks",
 	         update_data->tasks->len);
 
-	sparql_array_errors = tracker_sparql_connection_update_array_finish (priv->connection,
-	                                                                     result,
-	                                                                     &global_error);
+	if (update_data->with_triples) {
+		sparql_array_errors = tracker_sparql_connection_update_array_with_triples_finish (priv->connection,
+		                                                                                  result,
+		                                                                                  &global_error);
+	} else {
+		sparql_array_errors = tracker_sparql_connection_update_array_finish (priv->connection,
+		                                                                     result,
+		                                                                     &global_error);
+	}
 	if (global_error) {
 		g_critical ("  (Sparql buffer) Error in array-update: %s",
 		            global_error->message);
@@ -500,10 +520,11 @@ tracker_sparql_buffer_flush (TrackerSparqlBuffer *buffer,
                              const gchar         *reason)
 {
 	TrackerSparqlBufferPrivate *priv;
-	GPtrArray *bulk_ops = NULL;
+	GPtrArray *bulk_ops = NULL, *triples_array = NULL;
 	GArray *sparql_array, *error_map;
 	UpdateArrayData *update_data;
-	gint i, j;
+	GVariant *triples = NULL;
+	gint i, j, n_prepended = 0;
 
 	priv = buffer->priv;
 
@@ -540,10 +561,28 @@ tracker_sparql_buffer_flush (TrackerSparqlBuffer *buffer,
 			pos = sparql_array->len - 1;
 		} else if (task_data->type == TASK_TYPE_SPARQL) {
 			const gchar *str;
+			GVariant *task_triples;
 
 			str = tracker_sparql_builder_get_result (task_data->data.builder);
 			g_array_append_val (sparql_array, str);
 			pos = sparql_array->len - 1;
+
+			/* Triples attached to the update, see sparql_builder_finish()
+			 * in tracker-miner-files.c, keep these aligned with sparql_array.
+			 */
+			task_triples = tracker_sparql_builder_get_triples (task_data->data.builder);
+
+			if (task_triples) {
+				if (!triples_array) {
+					triples_array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_variant_unref);
+				}
+
+				while (triples_array->len < (guint) pos) {
+					g_ptr_array_add (triples_array, NULL);
+				}
+
+				g_ptr_array_add (triples_array, task_triples);
+			}
 		} else if (task_data->type == TASK_TYPE_BULK) {
 			BulkOperationMerge *bulk = NULL;
 			gint j;
@@ -588,8 +627,36 @@ tracker_sparql_buffer_flush (TrackerSparqlBuffer *buffer,
 			if (bulk->sparql) {
 				g_array_prepend_val (sparql_array,
 				                     bulk->sparql);
+				n_prepended++;
+			}
+		}
+	}
+
+	if (triples_array) {
+		GVariantBuilder builder;
+
+		/* One a(ssssb) array per update, empty for bulk operations
+		 * and updates without triples.
+		 */
+		g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa(ssssb)"));
+
+		for (i = 0; i < sparql_array->len; i++) {
+			GVariant *task_triples = NULL;
+
+			if (i >= n_prepended && i - n_prepended < triples_array->len) {
+				task_triples = g_ptr_array_index (triples_array, i - n_prepended);
+			}
+
+			if (task_triples) {
+				g_variant_builder_add_value (&builder, task_triples);
+			} else {
+				g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(ssssb)"));
+				g_variant_builder_close (&builder);
 			}
 		}
+
+		triples = g_variant_ref_sink (g_variant_builder_end (&builder));
+		g_ptr_array_free (triples_array, TRUE);
 	}
 
 	update_data = g_slice_new0 (UpdateArrayData);
@@ -599,6 +666,12 @@ tracker_sparql_buffer_flush (TrackerSparqlBuffer *buffer,
 	update_data->n_bulk_operations = bulk_ops ? bulk_ops->len : 0;
 	update_data->error_map = error_map;
 	update_data->sparql_array = sparql_array;
+	update_data->with_triples = (triples != NULL);
+	update_data->start_time = g_get_monotonic_time ();
+
+	priv->n_flushes++;
+	priv->n_flushed_tasks += priv->tasks->len;
+	priv->max_flush_size = MAX (priv->max_flush_size, priv->tasks->len);
 
 	/* Empty pool, update_data will keep
 	 * references to the tasks to keep
@@ -609,13 +682,25 @@ tracker_sparql_buffer_flush (TrackerSparqlBuffer *buffer,
 	priv->n_updates++;
 
 	/* Start the update */
-	tracker_sparql_connection_update_array_async (priv->connection,
-	                                              (gchar **) update_data->sparql_array->data,
-	                                              update_data->sparql_array->len,
-	                                              G_PRIORITY_DEFAULT,
-	                                              NULL,
-	                                              tracker_sparql_buffer_update_array_cb,
-	                                              update_data);
+	if (triples) {
+		tracker_sparql_connection_update_array_with_triples_async (priv->connection,
+		                                                           (gchar **) update_data->sparql_array->data,
+		                                                           update_data->sparql_array->len,
+		                                                           triples,
+		                                                           G_PRIORITY_DEFAULT,
+		                                                           NULL,
+		                                                           tracker_sparql_buffer_update_array_cb,
+		                                                           update_data);
+		g_variant_unref (triples);
+	} else {
+		tracker_sparql_connection_update_array_async (priv->connection,
+		                                              (gchar **) update_data->sparql_array->data,
+		                                              update_data->sparql_array->len,
+		                                              G_PRIORITY_DEFAULT,
+		                                              NULL,
+		                                              tracker_sparql_buffer_update_array_cb,
+		                                              update_data);
+	}
 
 	return TRUE;
 }
@@ -659,6 +744,7 @@ tracker_sparql_buffer_push (TrackerSparqlBuffer *buffer,
 {
 	TrackerSparqlBufferPrivate *priv;
 	SparqlTaskData *data;
+	gboolean has_triples = FALSE;
 
 	g_return_if_fail (TRACKER_IS_SPARQL_BUFFER (buffer));
 	g_return_if_fail (task != NULL);
@@ -669,8 +755,20 @@ tracker_sparql_buffer_push (TrackerSparqlBuffer *buffer,
 	data->result = g_simple_async_result_new (G_OBJECT (buffer),
 	                                          cb, user_data, NULL);
 
+	if (data->type == TASK_TYPE_SPARQL) {
+		GVariant *triples;
+
+		triples = tracker_sparql_builder_get_triples (data->data.builder);
+
+		if (triples) {
+			has_triples = TRUE;
+			g_variant_unref (triples);
+		}
+	}
+
 	if (priority <= G_PRIORITY_HIGH &&
-	    data->type != TASK_TYPE_BULK) {
+	    data->type != TASK_TYPE_BULK &&
+	    !has_triples) {
 		UpdateData *update_data;
 		const gchar *sparql = NULL;
 
@@ -707,6 +805,9 @@ tracker_sparql_buffer_push (TrackerSparqlBuffer *buffer,
 
 		if (tracker_task_pool_limit_reached (TRACKER_TASK_POOL (buffer))) {
 			tracker_sparql_buffer_flush (buffer, "SPARQL buffer limit reached");
+		} else if (priority <= G_PRIORITY_HIGH && has_triples) {
+			/* Triples only go through array updates */
+			tracker_sparql_buffer_flush (buffer, "High priority task with triples");
 		} else if (priv->tasks->len > tracker_task_pool_get_limit (TRACKER_TASK_POOL (buffer)) / 2) {
 			/* We've filled half of the buffer, flush it as we receive more tasks */
 			tracker_sparql_buffer_flush (buffer, "SPARQL buffer half-full");
@@ -809,3 +910,49 @@ tracker_sparql_task_new_bulk (GFile                *file,
 	return tracker_task_new (file, data,
 	                         (GDestroyNotify) sparql_task_data_free);
 }
+
+/**
+ * tracker_sparql_buffer_get_flush_stats:
+ * @buffer: a #TrackerSparqlBuffer
+ * @n_flushes: (out) (allow-none): number of array updates sent
+ * @n_tasks: (out) (allow-none): number of tasks in all of them
+ * @max_size: (out) (allow-none): largest number of tasks in one update
+ * @total_time: (out) (allow-none): time spent by finished updates
+ * @max_time: (out) (allow-none): longest time spent by one update
+ *
+ * Gets statistics on the flushes done so far, times are in microseconds.
+ **/
+void
+tracker_sparql_buffer_get_flush_stats (TrackerSparqlBuffer *buffer,
+                                       guint               *n_flushes,
+                                       guint               *n_tasks,
+                                       guint               *max_size,
+                                       gint64              *total_time,
+                                       gint64              *max_time)
+{
+	TrackerSparqlBufferPrivate *priv;
+
+	g_return_if_fail (TRACKER_IS_SPARQL_BUFFER (buffer));
+
+	priv = buffer->priv;
+
+	if (n_flushes) {
+		*n_flushes = priv->n_flushes;
+	}
+
+	if (n_tasks) {
+		*n_tasks = priv->n_flushed_tasks;
+	}
+
+	if (max_size) {
+		*max_size = priv->max_flush_size;
+	}
+
+	if (total_time) {
+		*total_time = priv->flush_time;
+	}
+
+	if (max_time) {
+		*max_time = priv->max_flush_time;
+	}
+}
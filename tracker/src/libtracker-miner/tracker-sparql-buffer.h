@@ -73,6 +73,13 @@ void                 tracker_sparql_buffer_push  (TrackerSparqlBuffer *buffer,
                                                   GAsyncReadyCallback  cb,
                                                   gpointer             user_data);
 
+void                 tracker_sparql_buffer_get_flush_stats (TrackerSparqlBuffer *buffer,
+                                                            guint               *n_flushes,
+                                                            guint               *n_tasks,
+                                                            guint               *max_size,
+                                                            gint64              *total_time,
+                                                            gint64              *max_time);
+
 TrackerTask *        tracker_sparql_task_new_take_sparql_str (GFile                *file,
                                                               gchar                *sparql_str);
 TrackerTask *        tracker_sparql_task_new_with_sparql_str (GFile                *file,
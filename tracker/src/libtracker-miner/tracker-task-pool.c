@@ -21,6 +21,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include "tracker-task-pool.h"
 
 enum {
@@ -35,15 +37,26 @@ typedef struct _TrackerTaskPoolPrivate TrackerTaskPoolPrivate;
 
 struct _TrackerTaskPoolPrivate
 {
+	/* GFile -> TaskEntry */
 	GHashTable *tasks;
+	/* TaskEntry sorted by URI, so tasks below a
+	 * directory can be found without a full scan */
+	GSequence *tasks_by_uri;
 	guint limit;
 };
 
+typedef struct {
+	TrackerTask *task;
+	gchar *uri;
+	GSequenceIter *iter;
+} TaskEntry;
+
 struct _TrackerTask
 {
 	GFile *file;
 	gpointer data;
 	GDestroyNotify destroy_notify;
+	gint64 creation_time;
 	gint ref_count;
 };
 
@@ -54,6 +67,7 @@ tracker_task_pool_finalize (GObject *object)
 
 	priv = TRACKER_TASK_POOL (object)->priv;
 	g_hash_table_destroy (priv->tasks);
+	g_sequence_free (priv->tasks_by_uri);
 
 	G_OBJECT_CLASS (tracker_task_pool_parent_class)->finalize (object);
 }
@@ -137,6 +151,26 @@ file_equal (GFile *file1,
 	}
 }
 
+static gint
+task_entry_compare (gconstpointer a,
+                    gconstpointer b,
+                    gpointer      user_data)
+{
+	const TaskEntry *entry_a = a;
+	const TaskEntry *entry_b = b;
+
+	return strcmp (entry_a->uri, entry_b->uri);
+}
+
+static void
+task_entry_free (TaskEntry *entry)
+{
+	g_sequence_remove (entry->iter);
+	tracker_task_unref (entry->task);
+	g_free (entry->uri);
+	g_slice_free (TaskEntry, entry);
+}
+
 static void
 tracker_task_pool_init (TrackerTaskPool *pool)
 {
@@ -147,7 +181,8 @@ tracker_task_pool_init (TrackerTaskPool *pool)
 	                                                 TrackerTaskPoolPrivate);
 	priv->tasks = g_hash_table_new_full (g_file_hash,
 	                                     (GEqualFunc) file_equal, NULL,
-	                                     (GDestroyNotify) tracker_task_unref);
+	                                     (GDestroyNotify) task_entry_free);
+	priv->tasks_by_uri = g_sequence_new (NULL);
 	priv->limit = 0;
 }
 
@@ -217,14 +252,22 @@ tracker_task_pool_add (TrackerTaskPool *pool,
                        TrackerTask     *task)
 {
 	TrackerTaskPoolPrivate *priv;
+	TaskEntry *entry;
+	GFile *file;
 
 	g_return_if_fail (TRACKER_IS_TASK_POOL (pool));
 
 	priv = pool->priv;
+	file = tracker_task_get_file (task);
 
-	g_hash_table_insert (priv->tasks,
-	                     tracker_task_get_file (task),
-	                     tracker_task_ref (task));
+	entry = g_slice_new (TaskEntry);
+	entry->task = tracker_task_ref (task);
+	entry->uri = g_file_get_uri (file);
+	entry->iter = g_sequence_insert_sorted (priv->tasks_by_uri, entry,
+	                                        task_entry_compare, NULL);
+
+	/* Replace the key too, it belongs to the task being replaced */
+	g_hash_table_replace (priv->tasks, file, entry);
 
 	if (g_hash_table_size (priv->tasks) == priv->limit) {
 		g_object_notify (G_OBJECT (pool), "limit-reached");
@@ -261,7 +304,7 @@ tracker_task_pool_foreach (TrackerTaskPool *pool,
 {
 	TrackerTaskPoolPrivate *priv;
 	GHashTableIter iter;
-	TrackerTask *task;
+	TaskEntry *entry;
 
 	g_return_if_fail (TRACKER_IS_TASK_POOL (pool));
 	g_return_if_fail (func != NULL);
@@ -269,22 +312,98 @@ tracker_task_pool_foreach (TrackerTaskPool *pool,
 	priv = pool->priv;
 	g_hash_table_iter_init (&iter, priv->tasks);
 
-	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &task)) {
-		(func) (task, user_data);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry)) {
+		(func) (entry->task, user_data);
 	}
 }
 
+/**
+ * tracker_task_pool_foreach_under:
+ * @pool: a #TrackerTaskPool
+ * @directory: directory to look tasks up in
+ * @func: function to call on every task found
+ * @user_data: user data to pass to @func
+ *
+ * Calls @func on every task for @directory itself or any file
+ * below it. Only the matching tasks are visited, so this is cheap
+ * even on pools with large limits. @func may remove tasks from @pool.
+ **/
+void
+tracker_task_pool_foreach_under (TrackerTaskPool *pool,
+                                 GFile           *directory,
+                                 GFunc            func,
+                                 gpointer         user_data)
+{
+	TrackerTaskPoolPrivate *priv;
+	GSequenceIter *iter;
+	TaskEntry *entry, key;
+	GList *tasks = NULL, *l;
+	gchar *uri;
+
+	g_return_if_fail (TRACKER_IS_TASK_POOL (pool));
+	g_return_if_fail (G_IS_FILE (directory));
+	g_return_if_fail (func != NULL);
+
+	priv = pool->priv;
+
+	entry = g_hash_table_lookup (priv->tasks, directory);
+
+	if (entry) {
+		tasks = g_list_prepend (tasks, tracker_task_ref (entry->task));
+	}
+
+	/* Children URIs all start with the directory URI and a slash,
+	 * and sort right after it */
+	uri = g_file_get_uri (directory);
+
+	if (g_str_has_suffix (uri, "/")) {
+		key.uri = uri;
+	} else {
+		key.uri = g_strconcat (uri, "/", NULL);
+		g_free (uri);
+	}
+
+	iter = g_sequence_search (priv->tasks_by_uri, &key,
+	                          task_entry_compare, NULL);
+
+	/* g_sequence_search() lands after any equal item, those are
+	 * only the root directory itself, already handled above */
+	while (!g_sequence_iter_is_end (iter)) {
+		entry = g_sequence_get (iter);
+
+		if (!g_str_has_prefix (entry->uri, key.uri)) {
+			break;
+		}
+
+		tasks = g_list_prepend (tasks, tracker_task_ref (entry->task));
+		iter = g_sequence_iter_next (iter);
+	}
+
+	g_free (key.uri);
+
+	/* Collected first, so func can modify the pool */
+	for (l = tasks; l; l = l->next) {
+		(func) (l->data, user_data);
+		tracker_task_unref (l->data);
+	}
+
+	g_list_free (tasks);
+}
+
 TrackerTask *
 tracker_task_pool_find (TrackerTaskPool *pool,
                         GFile           *file)
 {
 	TrackerTaskPoolPrivate *priv;
+	TaskEntry *entry;
 
 	g_return_val_if_fail (TRACKER_IS_TASK_POOL (pool), NULL);
 	g_return_val_if_fail (G_IS_FILE (file), NULL);
 
 	priv = pool->priv;
-	return g_hash_table_lookup (priv->tasks, file);
+	entry = g_hash_table_lookup (priv->tasks, file);
+
+	return (entry) ? entry->task : NULL;
 }
 
 /* Task */
@@ -299,6 +418,7 @@ tracker_task_new (GFile          *file,
 	task->file = g_object_ref (file);
 	task->destroy_notify = destroy_notify;
 	task->data = data;
+	task->creation_time = g_get_monotonic_time ();
 	task->ref_count = 1;
 
 	return task;
@@ -345,3 +465,12 @@ tracker_task_get_data (TrackerTask *task)
 
 	return task->data;
 }
+
+/* Monotonic time in microseconds at which the task was created */
+gint64
+tracker_task_get_creation_time (TrackerTask *task)
+{
+	g_return_val_if_fail (task != NULL, 0);
+
+	return task->creation_time;
+}
@@ -70,6 +70,10 @@ gboolean tracker_task_pool_remove        (TrackerTaskPool *pool,
 void     tracker_task_pool_foreach       (TrackerTaskPool *pool,
                                           GFunc            func,
                                           gpointer         user_data);
+void     tracker_task_pool_foreach_under (TrackerTaskPool *pool,
+                                          GFile           *directory,
+                                          GFunc            func,
+                                          gpointer         user_data);
 
 TrackerTask * tracker_task_pool_find     (TrackerTaskPool *pool,
                                           GFile           *file);
@@ -86,6 +90,8 @@ void          tracker_task_unref       (TrackerTask    *task);
 
 gpointer      tracker_task_get_data    (TrackerTask    *task);
 
+gint64        tracker_task_get_creation_time (TrackerTask *task);
+
 
 G_END_DECLS
 
@@ -120,6 +120,13 @@ class Tracker.Sparql.Backend : Connection {
 		return yield bus.update_array_async (sparql, priority, cancellable);
 	}
 
+	public async override GenericArray<Error?>? update_array_with_triples_async (string[] sparql, Variant triples, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		if (bus == null) {
+			throw new Sparql.Error.UNSUPPORTED ("Update support not available for direct-only connection");
+		}
+		return yield bus.update_array_with_triples_async (sparql, triples, priority, cancellable);
+	}
+
 	public async override GLib.Variant? update_blank_async (string sparql, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
 		debug ("%s(priority:%d): '%s'", Log.METHOD, priority, sparql);
 		if (bus == null) {
@@ -162,6 +169,22 @@ class Tracker.Sparql.Backend : Connection {
 		return yield bus.statistics_async (cancellable);
 	}
 
+	public override Cursor? explain (string sparql, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		debug ("%s(): '%s'", Log.METHOD, sparql);
+		if (bus == null) {
+			throw new Sparql.Error.UNSUPPORTED ("Explain support not available for direct-only connection");
+		}
+		return bus.explain (sparql, cancellable);
+	}
+
+	public async override Cursor? explain_async (string sparql, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		debug ("%s(): '%s'", Log.METHOD, sparql);
+		if (bus == null) {
+			throw new Sparql.Error.UNSUPPORTED ("Explain support not available for direct-only connection");
+		}
+		return yield bus.explain_async (sparql, cancellable);
+	}
+
 	// Plugin loading functions
 	private void load_plugins () throws GLib.Error {
 		string env_backend = Environment.get_variable ("TRACKER_SPARQL_BACKEND");
@@ -160,6 +160,17 @@ public class Tracker.Sparql.Builder : Object {
 	State[] states;
 	StringBuilder str = new StringBuilder ();
 
+	// Statements of embedded inserts are also kept as (graph, subject,
+	// predicate, object, object is IRI) tuples, so they can be handed to
+	// tracker-store without going through SPARQL text. The embedded
+	// subject is "", anonymous blank nodes are ":1", ":2"...
+	bool embedded;
+	bool triples_valid = true;
+	Variant[] triples;
+	string[] triple_subjects;
+	string[] triple_predicates;
+	int n_blank_nodes;
+
 	/**
 	 * tracker_sparql_builder_new_update:
 	 *
@@ -188,6 +199,10 @@ public class Tracker.Sparql.Builder : Object {
 		states += State.EMBEDDED_INSERT;
 		states += State.INSERT;
 		states += State.SUBJECT;
+
+		embedded = true;
+		triple_subjects += "";
+		triple_predicates += "";
 	}
 
 	/**
@@ -304,6 +319,10 @@ public class Tracker.Sparql.Builder : Object {
 	{
 		states += State.GRAPH;
 		str.append_printf ("GRAPH <%s> {\n", graph);
+
+		if (embedded) {
+			invalidate_triples ();
+		}
 	}
 
 	/**
@@ -419,6 +438,14 @@ public class Tracker.Sparql.Builder : Object {
 		}
 		str.append (s);
 		states += State.SUBJECT;
+
+		if (embedded) {
+			if (s.has_prefix ("<") && triple_subjects.length == 1) {
+				triple_subjects[0] = s;
+			} else {
+				invalidate_triples ();
+			}
+		}
 	}
 
 	/**
@@ -453,6 +480,14 @@ public class Tracker.Sparql.Builder : Object {
 		str.append (" ");
 		str.append (s);
 		states += State.PREDICATE;
+
+		if (embedded) {
+			if (s.has_prefix ("?")) {
+				invalidate_triples ();
+			} else {
+				triple_predicates[triple_predicates.length - 1] = s;
+			}
+		}
 	}
 
 	/**
@@ -489,6 +524,19 @@ public class Tracker.Sparql.Builder : Object {
 		states += State.OBJECT;
 
 		length++;
+
+		if (embedded) {
+			char c = s[0];
+
+			if (c == '<' || (c.isalpha () && s.index_of_char (':') > 0 && s != "true" && s != "false")) {
+				add_triple (s, true);
+			} else if (c.isdigit () || c == '-' || c == '+' || c == '.' || s == "true" || s == "false") {
+				add_triple (s, false);
+			} else {
+				// Variables, quoted or typed literals, labeled blank nodes
+				invalidate_triples ();
+			}
+		}
 	}
 
 	/**
@@ -543,6 +591,10 @@ public class Tracker.Sparql.Builder : Object {
 		states += State.OBJECT;
 
 		length++;
+
+		if (embedded) {
+			add_triple (literal, false);
+		}
 	}
 
 	/**
@@ -644,6 +696,11 @@ public class Tracker.Sparql.Builder : Object {
 		}
 		str.append (" [");
 		states += State.BLANK;
+
+		if (embedded) {
+			triple_subjects += ":%d".printf (++n_blank_nodes);
+			triple_predicates += "";
+		}
 	}
 
 	/**
@@ -662,6 +719,15 @@ public class Tracker.Sparql.Builder : Object {
 		states += State.OBJECT;
 
 		length++;
+
+		if (embedded) {
+			// Statements of the blank node come first, as in tracker-store
+			string blank_node = triple_subjects[triple_subjects.length - 1];
+
+			triple_subjects.length--;
+			triple_predicates.length--;
+			add_triple (blank_node, true);
+		}
 	}
 
 	/**
@@ -678,6 +744,10 @@ public class Tracker.Sparql.Builder : Object {
 		str.prepend ("%s\n".printf (raw));
 
 		length++;
+
+		if (embedded) {
+			invalidate_triples ();
+		}
 	}
 
 	/**
@@ -699,6 +769,98 @@ public class Tracker.Sparql.Builder : Object {
 		str.append (raw);
 
 		length++;
+
+		if (embedded) {
+			invalidate_triples ();
+		}
+	}
+
+	/**
+	 * tracker_sparql_builder_get_triples:
+	 * @self: a #TrackerSparqlBuilder
+	 *
+	 * Retrieves the statements of @self as a #GVariant of type
+	 * <literal>a(ssssb)</literal>, each element holding the graph, subject,
+	 * predicate and object of a statement, and whether the object is an
+	 * IRI. An empty graph means no graph, literal objects are not escaped.
+	 *
+	 * For embedded inserts, the triples are the same statements the SPARQL
+	 * text holds, the embedded subject is an empty string and anonymous
+	 * blank nodes are named ":1", ":2"... Raw content, variables or typed
+	 * literals can't be represented this way, %NULL is returned then.
+	 * For other builders, these are the triples added through
+	 * tracker_sparql_builder_append_triples(), to be inserted after the
+	 * SPARQL text.
+	 *
+	 * Returns: a #GVariant, or %NULL if there are no triples. Free with
+	 * g_variant_unref() when done.
+	 *
+	 * Since: 0.14.5
+	 */
+	public Variant? get_triples () {
+		if (!triples_valid || triples.length == 0) {
+			return null;
+		}
+
+		return new Variant.array (new VariantType ("(ssssb)"), triples);
+	}
+
+	/**
+	 * tracker_sparql_builder_append_triples:
+	 * @self: a #TrackerSparqlBuilder
+	 * @graph: graph name, or %NULL.
+	 * @subject: subject to use for statements of the embedded subject
+	 * @triples: a #GVariant of type <literal>a(ssssb)</literal>, as
+	 * returned by tracker_sparql_builder_get_triples().
+	 *
+	 * Adds @triples to @self, without changing its SPARQL text. Statements
+	 * about the embedded subject get @subject instead, and statements
+	 * without a graph get @graph. This allows inserting the result of an
+	 * embedded insert without serializing it to SPARQL.
+	 *
+	 * Since: 0.14.5
+	 */
+	public void append_triples (string? graph, string subject, Variant triples) {
+		var iter = triples.iterator ();
+		Variant? triple;
+
+		while ((triple = iter.next_value ()) != null) {
+			string triple_graph = triple.get_child_value (0).get_string ();
+			string triple_subject = triple.get_child_value (1).get_string ();
+
+			if (triple_graph == "" && graph != null) {
+				triple_graph = graph;
+			}
+
+			if (triple_subject == "") {
+				triple_subject = subject;
+			}
+
+			this.triples += new Variant ("(ssssb)",
+			                             triple_graph,
+			                             triple_subject,
+			                             triple.get_child_value (2).get_string (),
+			                             triple.get_child_value (3).get_string (),
+			                             triple.get_child_value (4).get_boolean ());
+		}
+	}
+
+	void add_triple (string value, bool value_is_iri) {
+		if (!triples_valid) {
+			return;
+		}
+
+		triples += new Variant ("(ssssb)",
+		                        "",
+		                        triple_subjects[triple_subjects.length - 1],
+		                        triple_predicates[triple_predicates.length - 1],
+		                        value,
+		                        value_is_iri);
+	}
+
+	void invalidate_triples () {
+		triples_valid = false;
+		triples = null;
 	}
 }
 
@@ -518,4 +518,120 @@ public abstract class Tracker.Sparql.Connection : Object {
 		warning ("Interface 'statistics_async' not implemented");
 		return null;
 	}
+
+	/**
+	 * tracker_sparql_connection_explain:
+	 * @self: a #TrackerSparqlConnection
+	 * @sparql: string containing the SPARQL query
+	 * @cancellable: a #GCancellable used to cancel the operation
+	 * @error: #GError for error reporting.
+	 *
+	 * Runs a SPARQL query in the Store without returning its results and
+	 * reports how it was executed. The cursor has two columns, the name
+	 * and the value of every item of the report:
+	 *
+	 * <itemizedlist>
+	 *   <listitem><para>sql: the SQL the query was translated to</para></listitem>
+	 *   <listitem><para>plan: the join order and the SQLite query plan</para></listitem>
+	 *   <listitem><para>parse-time, translate-time, prepare-time: time in seconds
+	 *   spent parsing the query, translating it to SQL and preparing the SQL
+	 *   statement</para></listitem>
+	 *   <listitem><para>first-row-time: time in seconds to retrieve the first
+	 *   row</para></listitem>
+	 *   <listitem><para>total-time: time in seconds to run the whole query</para></listitem>
+	 *   <listitem><para>rows: number of rows of the result</para></listitem>
+	 *   <listitem><para>steroids-bytes: size in bytes of the result when sent
+	 *   over the file descriptor used for queries</para></listitem>
+	 * </itemizedlist>
+	 *
+	 * The API call is completely synchronous, so it may block.
+	 *
+	 * Returns: a #TrackerSparqlCursor to iterate the reply if successful, #NULL
+	 * on error. Call g_object_unref() on the returned cursor when no longer
+	 * needed.
+	 *
+	 * Since: 0.14.5
+	 */
+	public virtual Cursor? explain (string sparql, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		warning ("Interface 'explain' not implemented");
+		return null;
+	}
+
+	/**
+	 * tracker_sparql_connection_explain_async:
+	 * @self: a #TrackerSparqlConnection
+	 * @sparql: string containing the SPARQL query
+	 * @cancellable: a #GCancellable used to cancel the operation
+	 * @_callback_: user-defined #GAsyncReadyCallback to be called when
+	 *              asynchronous operation is finished.
+	 * @_user_data_: user-defined data to be passed to @_callback_
+	 *
+	 * Runs asynchronously a SPARQL query in the Store and reports how it
+	 * was executed, see tracker_sparql_connection_explain().
+	 *
+	 * Since: 0.14.5
+	 */
+
+	/**
+	 * tracker_sparql_connection_explain_finish:
+	 * @self: a #TrackerSparqlConnection
+	 * @_res_: a #GAsyncResult with the result of the operation
+	 * @error: #GError for error reporting.
+	 *
+	 * Finishes the asynchronous query report.
+	 *
+	 * Returns: a #TrackerSparqlCursor to iterate the reply if successful, #NULL
+	 * on error. Call g_object_unref() on the returned cursor when no longer
+	 * needed.
+	 *
+	 * Since: 0.14.5
+	 */
+	public async virtual Cursor? explain_async (string sparql, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		warning ("Interface 'explain_async' not implemented");
+		return null;
+	}
+
+	/**
+	 * tracker_sparql_connection_update_array_with_triples_async:
+	 * @self: a #TrackerSparqlConnection
+	 * @sparql: an array of strings containing the SPARQL update queries
+	 * @sparql_length1: the amount of strings you pass as @sparql
+	 * @triples: a #GVariant of type <literal>aa(ssssb)</literal>, holding
+	 *           one array of triples for each update in @sparql
+	 * @priority: the priority for the asynchronous operation
+	 * @cancellable: a #GCancellable used to cancel the operation
+	 * @_callback_: user-defined #GAsyncReadyCallback to be called when
+	 *              asynchronous operation is finished.
+	 * @_user_data_: user-defined data to be passed to @_callback_
+	 *
+	 * Executes asynchronously an array of SPARQL updates, like
+	 * tracker_sparql_connection_update_array_async(). After each update,
+	 * its triples, as returned by tracker_sparql_builder_get_triples(), are
+	 * inserted as part of the same transaction, without being serialized
+	 * to SPARQL and parsed again. Triples are inserted silently, those the
+	 * ontology doesn't allow are skipped. A blank node subject such as
+	 * "_:file" refers to the blank node of that name in the update, each
+	 * anonymous blank node (":1", ":2"...) becomes a new resource.
+	 *
+	 * Since: 0.14.5
+	 */
+
+	/**
+	 * tracker_sparql_connection_update_array_with_triples_finish:
+	 * @self: a #TrackerSparqlConnection
+	 * @_res_: a #GAsyncResult with the result of the operation
+	 * @error: #GError for error reporting.
+	 *
+	 * Finishes the asynchronous operation started with
+	 * tracker_sparql_connection_update_array_with_triples_async().
+	 *
+	 * Returns: a #GPtrArray of errors, see
+	 * tracker_sparql_connection_update_array_finish().
+	 *
+	 * Since: 0.14.5
+	 */
+	public async virtual GenericArray<Error?>? update_array_with_triples_async (string[] sparql, Variant triples, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		warning ("Interface 'update_array_with_triples_async' not implemented");
+		return null;
+	}
 }
@@ -286,4 +286,51 @@ public abstract class Tracker.Sparql.Cursor : Object {
 		}
 		return false;
 	}
+
+	/**
+	 * tracker_sparql_cursor_next_n:
+	 * @self: a #TrackerSparqlCursor
+	 * @values: (array length=values_length1): buffer for the strings
+	 * @values_length1: length of @values
+	 * @types: (array length=types_length1): buffer for the value types
+	 * @types_length1: length of @types
+	 * @n_rows: maximum number of rows to fetch
+	 * @cancellable: a #GCancellable used to cancel the operation
+	 * @error: #GError for error reporting.
+	 *
+	 * Iterates over up to @n_rows results at once, storing the string
+	 * representation and the value type of every cell. Both buffers are
+	 * laid out by column, the cell for @row and @column is at index
+	 * @column * @n_rows + @row, so they need to hold at least @n_rows
+	 * times #n_columns elements. Strings previously held in @values are
+	 * freed, unbound cells are set to %NULL. This is completely
+	 * synchronous and it may block.
+	 *
+	 * This is equivalent to calling tracker_sparql_cursor_next() and
+	 * retrieving every column for each row, but cursors may implement
+	 * it in a cheaper way. After this call, the cursor is positioned
+	 * on the last row fetched.
+	 *
+	 * Returns: the number of rows fetched, 0 if no more results found.
+	 *
+	 * Since: 0.14.5
+	 */
+	public virtual int next_n (string?[] values, ValueType[] types, int n_rows, Cancellable? cancellable = null) throws GLib.Error
+	requires (n_rows >= 0 && values.length >= n_rows * n_columns && types.length >= n_rows * n_columns) {
+		int n_cols = n_columns;
+		int row;
+
+		for (row = 0; row < n_rows; row++) {
+			if (!next (cancellable)) {
+				break;
+			}
+
+			for (int column = 0; column < n_cols; column++) {
+				types[column * n_rows + row] = get_value_type (column);
+				values[column * n_rows + row] = get_string (column);
+			}
+		}
+
+		return row;
+	}
 }
@@ -960,6 +960,14 @@ main (gint argc, gchar *argv[])
 	/* Configure files miner */
 	tracker_miner_fs_set_initial_crawling (TRACKER_MINER_FS (miner_files), do_crawling);
 	tracker_miner_fs_set_mtime_checking (TRACKER_MINER_FS (miner_files), do_mtime_checking);
+
+	/* The directory snapshot is left disabled. The configured roots
+	 * are added when the miner is created, before the decision above,
+	 * so they always have TRACKER_DIRECTORY_FLAG_CHECK_MTIME set and
+	 * are crawled in full regardless. Besides, with the snapshot a
+	 * file modified in place while the miner isn't running is missed
+	 * if the mtime of its directory didn't change.
+	 */
 	g_signal_connect (miner_files, "finished",
 			  G_CALLBACK (miner_finished_cb),
 			  NULL);
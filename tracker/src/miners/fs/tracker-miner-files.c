@@ -65,6 +65,10 @@ struct ProcessFileData {
 	GCancellable *cancellable;
 	GFile *file;
 	gchar *mime_type;
+
+	/* link in either the extraction or the failed extraction queue,
+	 * embedded so that removal is O(1) */
+	GList link;
 };
 
 struct TrackerMinerFilesPrivate {
@@ -101,8 +105,8 @@ struct TrackerMinerFilesPrivate {
 	guint stale_volumes_check_id;
 
 	guint failed_extraction_pause_cookie;
-	GList *extraction_queue;
-	GList *failed_extraction_queue;
+	GQueue extraction_queue;
+	GQueue failed_extraction_queue;
 
 	gboolean failsafe_extraction;
 };
@@ -650,8 +654,8 @@ miner_files_finalize (GObject *object)
 		priv->stale_volumes_check_id = 0;
 	}
 
-	g_list_free (priv->extraction_queue);
-	g_list_free (priv->failed_extraction_queue);
+	/* Nothing to free in the extraction queues, every pending
+	 * ProcessFileData holds a reference on the miner */
 
 	G_OBJECT_CLASS (tracker_miner_files_parent_class)->finalize (object);
 }
@@ -1991,11 +1995,27 @@ sparql_builder_finish (ProcessFileData *data,
                        const gchar     *preupdate,
                        const gchar     *postupdate,
                        const gchar     *sparql,
+                       GVariant        *triples,
                        const gchar     *where)
 {
 	const gchar *uuid;
 
-	if (sparql && *sparql) {
+	if ((!sparql || !*sparql) && triples) {
+		gboolean is_iri;
+		const gchar *urn;
+		gchar *str;
+
+		/* The extractor sent the statements as triples, these
+		 * are inserted by the store after the SPARQL update.
+		 */
+		urn = miner_files_get_file_urn (data->miner, data->file, &is_iri);
+		str = is_iri ? g_strdup_printf ("<%s>", urn) : g_strdup (urn);
+		tracker_sparql_builder_append_triples (data->sparql,
+		                                       TRACKER_MINER_FS_GRAPH_URN,
+		                                       str,
+		                                       triples);
+		g_free (str);
+	} else if (sparql && *sparql) {
 		gboolean is_iri;
 		const gchar *urn;
 
@@ -2081,6 +2101,7 @@ extractor_get_failsafe_metadata_cb (GObject      *object,
 	TrackerMinerFilesPrivate *priv = miner->private;
 	const gchar *preupdate, *postupdate, *sparql, *where;
 	TrackerExtractInfo *info;
+	GVariant *triples = NULL;
 	GError *error = NULL;
 	gchar *uri;
 
@@ -2128,18 +2149,23 @@ extractor_get_failsafe_metadata_cb (GObject      *object,
 
 		builder = tracker_extract_info_get_metadata_builder (info);
 		sparql = tracker_sparql_builder_get_result (builder);
+		triples = tracker_sparql_builder_get_triples (builder);
 
 		where = tracker_extract_info_get_where_clause (info);
 	}
 
-	sparql_builder_finish (data, preupdate, postupdate, sparql, where);
+	sparql_builder_finish (data, preupdate, postupdate, sparql, triples, where);
+
+	if (triples) {
+		g_variant_unref (triples);
+	}
 
 	/* Notify success even if the extraction failed
 	 * again, so we get the essential data in the store.
 	 */
 	tracker_miner_fs_file_notify (TRACKER_MINER_FS (miner), data->file, NULL);
 
-	priv->failed_extraction_queue = g_list_remove (priv->failed_extraction_queue, data);
+	g_queue_unlink (&priv->failed_extraction_queue, &data->link);
 	process_file_data_free (data);
 
 	/* Get on to the next failed extraction, or resume miner */
@@ -2158,10 +2184,10 @@ extractor_process_failsafe (TrackerMinerFiles *miner)
 
 	priv = miner->private;
 
-	if (priv->failed_extraction_queue) {
+	if (!g_queue_is_empty (&priv->failed_extraction_queue)) {
 		gchar *uri;
 
-		data = priv->failed_extraction_queue->data;
+		data = g_queue_peek_head (&priv->failed_extraction_queue);
 
 		uri = g_file_get_uri (data->file);
 		g_message ("Performing failsafe extraction on '%s'", uri);
@@ -2200,8 +2226,8 @@ extractor_check_process_failsafe (TrackerMinerFiles *miner)
 		return;
 	}
 
-	if (priv->extraction_queue ||
-	    !priv->failed_extraction_queue) {
+	if (!g_queue_is_empty (&priv->extraction_queue) ||
+	    g_queue_is_empty (&priv->failed_extraction_queue)) {
 		/* No reasons (yet) to start failsafe extraction */
 		return;
 	}
@@ -2221,11 +2247,12 @@ extractor_get_embedded_metadata_cb (GObject      *object,
 	TrackerSparqlBuilder *preupdate, *postupdate, *sparql;
 	const gchar *where;
 	TrackerExtractInfo *info;
+	GVariant *triples;
 	GError *error = NULL;
 
 	miner = data->miner;
 	priv = miner->private;
-	priv->extraction_queue = g_list_remove (priv->extraction_queue, data);
+	g_queue_unlink (&priv->extraction_queue, &data->link);
 	info = tracker_extract_client_get_metadata_finish (G_FILE (object), res, &error);
 
 	if (error) {
@@ -2245,10 +2272,10 @@ extractor_get_embedded_metadata_cb (GObject      *object,
 					                     NULL);
 			}
 
-			priv->failed_extraction_queue = g_list_prepend (priv->failed_extraction_queue, data);
+			g_queue_push_head_link (&priv->failed_extraction_queue, &data->link);
 			g_free (uri);
 		} else {
-			sparql_builder_finish (data, NULL, NULL, NULL, NULL);
+			sparql_builder_finish (data, NULL, NULL, NULL, NULL, NULL);
 
 			/* Something bad happened, notify about the error */
 			tracker_miner_fs_file_notify (TRACKER_MINER_FS (data->miner), data->file, error);
@@ -2261,13 +2288,19 @@ extractor_get_embedded_metadata_cb (GObject      *object,
 		postupdate = tracker_extract_info_get_postupdate_builder (info);
 		sparql = tracker_extract_info_get_metadata_builder (info);
 		where = tracker_extract_info_get_where_clause (info);
+		triples = tracker_sparql_builder_get_triples (sparql);
 
 		sparql_builder_finish (data,
 		                       tracker_sparql_builder_get_result (preupdate),
 		                       tracker_sparql_builder_get_result (postupdate),
 		                       tracker_sparql_builder_get_result (sparql),
+		                       triples,
 		                       where);
 
+		if (triples) {
+			g_variant_unref (triples);
+		}
+
 		/* Notify about the success */
 		tracker_miner_fs_file_notify (TRACKER_MINER_FS (data->miner), data->file, NULL);
 
@@ -2306,7 +2339,7 @@ process_file_cb (GObject      *object,
 	if (error) {
 		/* Something bad happened, notify about the error */
 		tracker_miner_fs_file_notify (TRACKER_MINER_FS (data->miner), file, error);
-		priv->extraction_queue = g_list_remove (priv->extraction_queue, data);
+		g_queue_unlink (&priv->extraction_queue, &data->link);
 		process_file_data_free (data);
 		g_error_free (error);
 
@@ -2387,10 +2420,10 @@ process_file_cb (GObject      *object,
 	} else {
 		/* Otherwise, don't request embedded metadata extraction. */
 		g_debug ("Avoiding embedded metadata request for uri '%s'", uri);
-		sparql_builder_finish (data, NULL, NULL, NULL, NULL);
+		sparql_builder_finish (data, NULL, NULL, NULL, NULL, NULL);
 		tracker_miner_fs_file_notify (TRACKER_MINER_FS (data->miner), data->file, NULL);
 
-		priv->extraction_queue = g_list_remove (priv->extraction_queue, data);
+		g_queue_unlink (&priv->extraction_queue, &data->link);
 		extractor_check_process_failsafe (data->miner);
 		process_file_data_free (data);
 	}
@@ -2416,7 +2449,8 @@ miner_files_process_file (TrackerMinerFS       *fs,
 	data->file = g_object_ref (file);
 
 	priv = TRACKER_MINER_FILES (fs)->private;
-	priv->extraction_queue = g_list_prepend (priv->extraction_queue, data);
+	data->link.data = data;
+	g_queue_push_head_link (&priv->extraction_queue, &data->link);
 
 	attrs = G_FILE_ATTRIBUTE_STANDARD_TYPE ","
 		G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE ","
@@ -605,6 +605,7 @@ get_metadata_fast_cb (GObject      *object,
 		GDataOutputStream *data_output_stream;
 		const gchar *preupdate, *postupdate, *statements, *where;
 		TrackerSparqlBuilder *builder;
+		GVariant *triples = NULL;
 		GError *error = NULL;
 
 #ifdef THREAD_ENABLE_TRACE
@@ -630,6 +631,15 @@ get_metadata_fast_cb (GObject      *object,
 
 		where = tracker_extract_info_get_where_clause (info);
 
+		/* Statements that can be inserted as triples are sent
+		 * serialized after the strings instead, so the store
+		 * doesn't need to parse them. Post-updates and WHERE
+		 * clauses need the statements to be part of the query.
+		 */
+		if ((!postupdate || !*postupdate) && (!where || !*where)) {
+			triples = tracker_sparql_builder_get_triples (builder);
+		}
+
 		/* So the structure is like this:
 		 *
 		 *   [buffer,'\0'][buffer,'\0'][...]
@@ -639,8 +649,24 @@ get_metadata_fast_cb (GObject      *object,
 		 * NUL-terminating byte given strlen() has a size_t
 		 * limitation and costs us time evaluating string
 		 * lengths.
+		 *
+		 * When there are triples, the statements are empty and
+		 * the serialized a(ssssb) GVariant follows:
+		 *
+		 *   [...][buffer,'\0'][variant data]
 		 */
-		if (statements && *statements) {
+		if (triples) {
+			get_metadata_fast_write (data_output_stream, preupdate, error);
+			get_metadata_fast_write (data_output_stream, postupdate, error);
+			get_metadata_fast_write (data_output_stream, "", error);
+			get_metadata_fast_write (data_output_stream, where, error);
+
+			g_output_stream_write_all (G_OUTPUT_STREAM (data_output_stream),
+			                           g_variant_get_data (triples),
+			                           g_variant_get_size (triples),
+			                           NULL, NULL, &error);
+			g_variant_unref (triples);
+		} else if (statements && *statements) {
 			get_metadata_fast_write (data_output_stream, preupdate, error);
 			get_metadata_fast_write (data_output_stream, postupdate, error);
 			get_metadata_fast_write (data_output_stream, statements, error);
@@ -28,8 +28,6 @@
 #include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <sys/select.h>
-#include <sys/wait.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <string.h>
@@ -41,9 +39,6 @@
 #include <glib/gstdio.h>
 #include <glib/poppler.h>
 
-#include <gio/gunixoutputstream.h>
-#include <gio/gunixinputstream.h>
-
 #include <libtracker-common/tracker-date-time.h>
 #include <libtracker-common/tracker-utils.h>
 #include <libtracker-common/tracker-file-utils.h>
@@ -51,13 +46,14 @@
 #include <libtracker-extract/tracker-extract.h>
 
 #include "tracker-main.h"
+#include "tracker-worker-pool.h"
 
-/* Time in seconds before we kill the forked child process used for
+/* Time in seconds before we kill the helper process used for
  * content extraction */
 #define EXTRACTION_PROCESS_TIMEOUT 10
 
-/* Size of the buffer to use when reading, in bytes */
-#define BUFFER_SIZE 65535
+/* Number of documents after which the helper process is replaced */
+#define EXTRACTION_PROCESS_MAX_DOCUMENTS 100
 
 typedef struct {
 	gchar *title;
@@ -68,6 +64,8 @@ typedef struct {
 	gchar *keywords;
 } PDFData;
 
+static TrackerWorkerPool *content_pool;
+
 static void
 read_toc (PopplerIndexIter  *index,
           GString          **toc)
@@ -258,261 +256,58 @@ extract_content_text (PopplerDocument *document,
 	return string;
 }
 
-static void
-extract_content_child_process (PopplerDocument *document,
-                               gsize            n_bytes,
-                               int              fd[2])
+/* Runs in a helper process of the pool */
+static gchar *
+extract_content_worker (const gchar *uri,
+                        gsize        n_bytes)
 {
+	PopplerDocument *document;
 	GString *str;
-	gint64 size;
-	GOutputStream *output_stream;
-	GDataOutputStream *dataout_stream;
+	gchar *filename;
+	gchar *contents = NULL;
+	struct stat st;
+	int fd;
 
-	/* This is the child extracting the content, hopefully in time */
+	filename = g_filename_from_uri (uri, NULL, NULL);
 
-	output_stream = g_unix_output_stream_new (fd[1], FALSE);
-	dataout_stream = g_data_output_stream_new (output_stream);
-	str = extract_content_text (document, n_bytes);
-	size = (gint64) str->len;
-
-	/* Write the results to the pipe */
-	if (g_data_output_stream_put_int64 (dataout_stream, size, NULL, NULL)) {
-		g_output_stream_write_all (output_stream,
-		                           str->str,
-		                           str->len,
-		                           NULL,
-		                           NULL,
-		                           NULL);
+	if (!filename) {
+		return NULL;
 	}
 
-	g_debug ("Child: Content extraction now finished in child process, "
-	         "written %" G_GSIZE_FORMAT " bytes to parent process",
-	         size);
-
-	g_string_free (str, TRUE);
-	g_object_unref (dataout_stream);
-	g_object_unref (output_stream);
-
-	close (fd[1]);
-
-	exit (0);
-}
-
-static gchar *
-extract_content_parent_process (PopplerDocument *document,
-                                int              fd[2],
-                                pid_t            child_pid)
-{
-	GInputStream *input_stream;
-	GDataInputStream *datain_stream;
-	GString *content = NULL;
-	GError *error = NULL;
-	GTimer *timer = NULL;
-	gsize bytes_expected = -1;
-	gboolean timed_out = FALSE;
-	gboolean finished = FALSE;
-	struct timeval timeout;
-	fd_set rfds;
-
-	/* This is the parent process waiting for the content extractor to
-	 * finish in time. */
-
-	g_debug ("Parent: Content extraction now starting in child process (pid = %d)", child_pid);
-
-	/* Set up gio streams */
-	input_stream = g_unix_input_stream_new (fd[0], FALSE);
-	datain_stream = g_data_input_stream_new (input_stream);
-
-	/* Watch FD to see when it has input. */
-	FD_ZERO(&rfds);
-	FD_SET(fd[0], &rfds);
-
-	/* We give the content extractor 10 seconds to do its job */
-	timeout.tv_sec = EXTRACTION_PROCESS_TIMEOUT;
-	timeout.tv_usec = 0;
-
-	/* We also use our own timer because timeouts in select()
-	 * can be inconsistent across UNIX platforms. Some update the
-	 * timeout and some don't.
-	 */
-	timer = g_timer_new ();
-
-	/* So, this is fairly simple, what we're doing here is using
-	 * select() to know when the child process has written some or
-	 * all the data and we then avoid the child blocking by
-	 * reading from that stream. We couple with this with a
-	 * timeout of 10 seconds so if we receive nothing then we know
-	 * we can kill the process because it is taking too long.
-	 *
-	 * We use waitpid() to know if the process quit because it has
-	 * finished or if it is still processing data and needs to be
-	 * killed.
-	 */
-	while (!finished) {
-		int retval;
-
-		/* 1a. Wait for data on the FD and limit by timeout */
-		retval = select (fd[0] + 1,  &rfds, NULL, NULL, &timeout);
-
-		/* 2. Did we error? Have data? or just timeout? */
-		if (retval == -1) {
-			perror ("select()");
-			finished = TRUE;
-		} else if (retval == 1) {
-			gsize bytes_remaining;
-			gboolean read_finished = FALSE;
-
-			if (g_timer_elapsed (timer, NULL) >= EXTRACTION_PROCESS_TIMEOUT) {
-				finished = TRUE;
-				timed_out = TRUE;
-				continue;
-			}
-
-			/* 3. Start reading data */
-			if (bytes_expected == -1) {
-				/* We only need to read the size once before the data! */
-				bytes_expected = (gsize) g_data_input_stream_read_int64 (datain_stream,
-				                                                         NULL,
-				                                                         &error);
-				if (error) {
-					g_warning ("Call to g_data_input_stream_read_int64() failed, %s",
-					           error->message);
-					g_error_free (error);
-					finished = TRUE;
-					continue;
-				}
-
-				g_debug ("Parent: Expected bytes to read is %" G_GSSIZE_FORMAT "", bytes_expected);
-				bytes_remaining = bytes_expected;
-				content = g_string_new ("");
-			}
+	fd = tracker_file_open_fd (filename);
+	g_free (filename);
 
-			/* 4. Read until done from stream and concatenate data */
-			while (!read_finished) {
-				gchar buf[BUFFER_SIZE];
-				gsize bytes_read;
-
-				memset (buf, 0, BUFFER_SIZE);
-				bytes_read = g_input_stream_read (G_INPUT_STREAM (datain_stream),
-				                                  buf,
-				                                  MIN (BUFFER_SIZE, bytes_remaining),
-				                                  NULL,
-				                                  &error);
-
-				g_debug ("Parent:   Bytes read is %" G_GSSIZE_FORMAT ","
-				         "bytes remaining is %" G_GSSIZE_FORMAT "",
-				         bytes_read,
-				         MAX (bytes_remaining - bytes_read, 0));
-
-				if (bytes_read == -1 || error) {
-					g_warning ("Call to g_input_stream_read() failed, %s",
-					           error ? error->message : "no error given");
-					g_clear_error (&error);
-					read_finished = TRUE;
-					finished = TRUE;
-				} else {
-					content = g_string_append (content, buf);
-
-					bytes_remaining -= bytes_read;
-					bytes_remaining  = MAX (bytes_remaining, 0);
-
-					if (bytes_read == 0) {
-						/* We finished reading */
-						g_debug ("Parent:   Finished reading all bytes");
-						read_finished = TRUE;
-					}
-
-					/* Are we finished reading everything */
-					if (bytes_remaining < 1) {
-						finished = TRUE;
-					}
-				}
-			}
-		} else {
-			/* 3. We must have timed out with no data in select() */
-			finished = TRUE;
-			timed_out = TRUE;
-			g_debug ("Parent: Must have timed out with no data in select()");
-		}
+	if (fd == -1) {
+		return NULL;
 	}
 
-	if (timed_out) {
-		g_debug ("Parent: Child process took too long. We waited %d seconds, so we're going to kill it!",
-		         EXTRACTION_PROCESS_TIMEOUT);
-		kill (child_pid, SIGKILL);
-	} else {
-		g_debug ("Parent: Data received in %2.2f seconds (timeout is %d seconds)",
-		         g_timer_elapsed (timer, NULL),
-		         EXTRACTION_PROCESS_TIMEOUT);
+	if (fstat (fd, &st) == -1 || st.st_size == 0) {
+		close (fd);
+		return NULL;
 	}
 
-	g_timer_destroy (timer);
-
-	g_object_unref (datain_stream);
-	g_object_unref (input_stream);
-
-	close (fd[0]);
-
-	return content ? g_string_free (content, FALSE) : NULL;
-}
-
-static void
-extract_content_child_cleanup (int action)
-{
-	pid_t child_pid;
-	int status;
-
-	g_debug ("Parent: Zombies, say hello to my little friend!");
-	while ((child_pid = waitpid (-1, &status, WNOHANG)) > 0) {
-		g_debug ("Parent:   Zombie %d reaped", child_pid);
-	}
-}
+	contents = (gchar *) mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
 
-static gchar *
-extract_content (PopplerDocument *document,
-                 gsize            n_bytes)
-{
-	pid_t child_pid;
-	int fd[2];
-	sigset_t mask;
-	sigset_t orig_mask;
-	struct sigaction sa;
-
-	if (pipe (fd) == -1) {
-		g_warning ("Content extraction failed, call to pipe() failed");
+	if (contents == NULL || contents == MAP_FAILED) {
+		close (fd);
 		return NULL;
 	}
 
-	/* Set sig mask before fork() to avoid race conditions */
-	sigemptyset (&mask);
-	sigaddset (&mask, SIGCHLD);
+	document = poppler_document_new_from_data (contents, st.st_size, NULL, NULL);
 
-	/* Add zombie handler */
-	sigfillset (&sa.sa_mask);
-	sa.sa_handler = extract_content_child_cleanup;
-	sa.sa_flags = 0;
-	sigaction (SIGCHLD, &sa, NULL);
-
-	if (sigprocmask (SIG_SETMASK, &mask, &orig_mask) == -1) {
-		g_warning ("Content extraction failed, call to sigprocmask() failed");
+	if (!document) {
+		munmap (contents, st.st_size);
+		close (fd);
 		return NULL;
 	}
 
-	child_pid = fork ();
-
-	if (child_pid == -1) {
-		g_warning ("Content extraction failed, call to fork() failed");
-
-		close (fd[0]);
-		close (fd[1]);
-	}
+	str = extract_content_text (document, n_bytes);
 
-	if (child_pid == 0) {
-		extract_content_child_process (document, n_bytes, fd);
-		return NULL;
-	}
+	g_object_unref (document);
+	munmap (contents, st.st_size);
+	close (fd);
 
-	return extract_content_parent_process (document, fd, child_pid);
+	return g_string_free (str, FALSE);
 }
 
 static void
@@ -550,6 +345,28 @@ write_pdf_data (PDFData               data,
 	}
 }
 
+G_MODULE_EXPORT gboolean
+tracker_extract_module_init (TrackerModuleThreadAwareness  *thread_awareness_ret,
+                             GError                       **error)
+{
+	/* Poppler is not thread safe, the text is extracted in a
+	 * long-lived helper process instead of forking per document */
+	content_pool = tracker_worker_pool_new (extract_content_worker,
+	                                        1,
+	                                        EXTRACTION_PROCESS_MAX_DOCUMENTS,
+	                                        EXTRACTION_PROCESS_TIMEOUT);
+
+	*thread_awareness_ret = TRACKER_MODULE_MAIN_THREAD;
+	return TRUE;
+}
+
+G_MODULE_EXPORT void
+tracker_extract_module_shutdown (void)
+{
+	tracker_worker_pool_free (content_pool);
+	content_pool = NULL;
+}
+
 G_MODULE_EXPORT gboolean
 tracker_extract_get_metadata (TrackerExtractInfo *info)
 {
@@ -997,7 +814,7 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 
 	config = tracker_main_get_config ();
 	n_bytes = tracker_config_get_max_bytes (config);
-	content = extract_content (document, n_bytes);
+	content = tracker_worker_pool_run (content_pool, uri, n_bytes);
 
 	if (content) {
 		tracker_sparql_builder_predicate (metadata, "nie:plainTextContent");
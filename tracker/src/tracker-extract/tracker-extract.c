@@ -56,7 +56,8 @@ typedef struct {
 
 typedef struct {
 	GHashTable *statistics_data;
-	GList *running_tasks;
+	/* Set of TrackerExtractTask */
+	GHashTable *running_tasks;
 
 	/* used to maintain the running tasks
 	 * and stats from different threads
@@ -141,6 +142,7 @@ tracker_extract_init (TrackerExtract *object)
 	priv->statistics_data = g_hash_table_new_full (NULL, NULL, NULL,
 	                                               (GDestroyNotify) statistics_data_free);
 	priv->single_thread_extractors = g_hash_table_new (NULL, NULL);
+	priv->running_tasks = g_hash_table_new (NULL, NULL);
 	priv->thread_pool = g_thread_pool_new ((GFunc) get_metadata,
 	                                       NULL, 10, TRUE, NULL);
 
@@ -172,6 +174,7 @@ tracker_extract_finalize (GObject *object)
 #endif /* HAVE_STREAMANALYZER */
 
 	g_hash_table_destroy (priv->statistics_data);
+	g_hash_table_destroy (priv->running_tasks);
 
 #if GLIB_CHECK_VERSION (2,31,0)
 	g_mutex_clear (&priv->task_mutex);
@@ -295,7 +298,7 @@ notify_task_finish (TrackerExtractTask *task,
 		stats_data->failed_count++;
 	}
 
-	priv->running_tasks = g_list_remove (priv->running_tasks, task);
+	g_hash_table_remove (priv->running_tasks, task);
 
 #if GLIB_CHECK_VERSION (2,31,0)
 	g_mutex_unlock (&priv->task_mutex);
@@ -417,7 +420,7 @@ task_cancellable_cancelled_cb (GCancellable       *cancellable,
 	g_mutex_lock (priv->task_mutex);
 #endif
 
-	if (g_list_find (priv->running_tasks, task)) {
+	if (g_hash_table_lookup (priv->running_tasks, task)) {
 		g_message ("Cancelled task for '%s' was currently being "
 		           "processed, _exit()ing immediately",
 		           task->file);
@@ -697,11 +700,11 @@ dispatch_task_cb (TrackerExtractTask *task)
 
 #if GLIB_CHECK_VERSION (2,31,0)
 	g_mutex_lock (&priv->task_mutex);
-	priv->running_tasks = g_list_prepend (priv->running_tasks, task);
+	g_hash_table_insert (priv->running_tasks, task, task);
 	g_mutex_unlock (&priv->task_mutex);
 #else
 	g_mutex_lock (priv->task_mutex);
-	priv->running_tasks = g_list_prepend (priv->running_tasks, task);
+	g_hash_table_insert (priv->running_tasks, task, task);
 	g_mutex_unlock (priv->task_mutex);
 #endif
 
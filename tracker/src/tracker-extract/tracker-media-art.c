@@ -68,6 +68,38 @@ typedef struct {
 	gchar *title_strdown;
 } TrackerMediaArtSearch;
 
+/* Checksum of a file in the media art directory or of an external
+ * image, valid as long as the file is not replaced or modified */
+typedef struct {
+	guint64 inode;
+	goffset size;
+	time_t mtime;
+	gchar *md5;
+	gboolean is_jpeg;
+} ArtChecksum;
+
+/* Images found in a directory next to media files */
+typedef struct {
+	/* 0 if the directory changed while it was read */
+	time_t mtime;
+	/* lower case UTF-8 names, in directory order */
+	GList *images;
+} ArtDirectory;
+
+/* String keyed table that drops its least recently used entries
+ * once it holds TRACKER_MEDIA_ART_MAX_CACHED of them */
+typedef struct {
+	GHashTable *table;
+	/* ArtCacheEntry, most recently used first */
+	GQueue order;
+	GDestroyNotify value_free;
+} ArtCache;
+
+typedef struct {
+	gchar *key;
+	gpointer value;
+} ArtCacheEntry;
+
 typedef enum {
 	IMAGE_MATCH_EXACT = 0,
 	IMAGE_MATCH_EXACT_SMALL = 1,
@@ -81,46 +113,44 @@ static TrackerStorage *media_art_storage;
 static GHashTable *media_art_cache;
 static GDBusConnection *connection;
 
+/* In-memory index of the media art, so processing every track of
+ * an album does not read and convert the same images again:
+ *   path -> ArtChecksum
+ *   MD5 of an embedded image -> MD5 of the image converted to JPEG
+ *   media art path -> MD5 of the embedded image it was made from
+ *   directory -> ArtDirectory
+ */
+static ArtCache *media_art_checksums;
+static ArtCache *media_art_converted;
+static ArtCache *media_art_embedded;
+static GHashTable *media_art_directories;
+
+/* Directories with external images to remember at most */
+#define MAX_CACHED_DIRECTORIES 64
+
 static void
 albumart_queue_cb (GObject      *source_object,
                    GAsyncResult *res,
                    gpointer      user_data);
 
 
-static GDir *
-get_parent_g_dir (const gchar  *uri,
-                  gchar       **dirname,
-                  GError      **error)
+static gchar *
+get_parent_dirname (const gchar *uri)
 {
 	GFile *file, *dirf;
-	GDir *dir;
-
-	g_return_val_if_fail (dirname != NULL, NULL);
-
-	*dirname = NULL;
+	gchar *dirname = NULL;
 
 	file = g_file_new_for_uri (uri);
 	dirf = g_file_get_parent (file);
 	if (dirf) {
-		*dirname = g_file_get_path (dirf);
+		dirname = g_file_get_path (dirf);
 		g_object_unref (dirf);
 	}
 	g_object_unref (file);
 
-	if (*dirname == NULL) {
-		*error = g_error_new (G_FILE_ERROR,
-		                      G_FILE_ERROR_EXIST,
-		                      "No parent directory found for '%s'",
-		                      uri);
-		return NULL;
-	}
-
-	dir = g_dir_open (*dirname, 0, error);
-
-	return dir;
+	return dirname;
 }
 
-
 static gchar *
 checksum_for_data (GChecksumType  checksum_type,
                    const guchar  *data,
@@ -219,6 +249,164 @@ end:
 	return retval;
 }
 
+static ArtCache *
+art_cache_new (GDestroyNotify value_free)
+{
+	ArtCache *cache;
+
+	cache = g_slice_new0 (ArtCache);
+	cache->table = g_hash_table_new (g_str_hash, g_str_equal);
+	cache->value_free = value_free;
+
+	return cache;
+}
+
+static void
+art_cache_entry_free (ArtCache      *cache,
+                      ArtCacheEntry *entry)
+{
+	g_free (entry->key);
+	cache->value_free (entry->value);
+	g_slice_free (ArtCacheEntry, entry);
+}
+
+static void
+art_cache_free (ArtCache *cache)
+{
+	ArtCacheEntry *entry;
+
+	while ((entry = g_queue_pop_head (&cache->order)) != NULL) {
+		art_cache_entry_free (cache, entry);
+	}
+
+	g_hash_table_unref (cache->table);
+	g_slice_free (ArtCache, cache);
+}
+
+static gpointer
+art_cache_lookup (ArtCache    *cache,
+                  const gchar *key)
+{
+	GList *link;
+
+	link = g_hash_table_lookup (cache->table, key);
+
+	if (!link) {
+		return NULL;
+	}
+
+	if (link != cache->order.head) {
+		g_queue_unlink (&cache->order, link);
+		g_queue_push_head_link (&cache->order, link);
+	}
+
+	return ((ArtCacheEntry *) link->data)->value;
+}
+
+static void
+art_cache_remove (ArtCache    *cache,
+                  const gchar *key)
+{
+	GList *link;
+
+	link = g_hash_table_lookup (cache->table, key);
+
+	if (!link) {
+		return;
+	}
+
+	g_hash_table_remove (cache->table, key);
+	g_queue_unlink (&cache->order, link);
+	art_cache_entry_free (cache, link->data);
+	g_list_free_1 (link);
+}
+
+/* Takes ownership of @value */
+static void
+art_cache_insert (ArtCache    *cache,
+                  const gchar *key,
+                  gpointer     value)
+{
+	ArtCacheEntry *entry;
+
+	art_cache_remove (cache, key);
+
+	if (cache->order.length >= TRACKER_MEDIA_ART_MAX_CACHED) {
+		entry = cache->order.tail->data;
+		art_cache_remove (cache, entry->key);
+	}
+
+	entry = g_slice_new (ArtCacheEntry);
+	entry->key = g_strdup (key);
+	entry->value = value;
+
+	g_queue_push_head (&cache->order, entry);
+	g_hash_table_insert (cache->table, entry->key, cache->order.head);
+}
+
+static void
+art_checksum_free (ArtChecksum *checksum)
+{
+	g_free (checksum->md5);
+	g_slice_free (ArtChecksum, checksum);
+}
+
+/* Returns the MD5 checksum of @path and whether it is a JPEG file,
+ * reading the file only if it changed since the last call */
+static gboolean
+file_get_md5_cached (const gchar  *path,
+                     gchar       **md5,
+                     gboolean     *is_jpeg)
+{
+	ArtChecksum *checksum;
+	struct stat st;
+
+	if (g_stat (path, &st) == -1) {
+		art_cache_remove (media_art_checksums, path);
+		return FALSE;
+	}
+
+	checksum = art_cache_lookup (media_art_checksums, path);
+
+	if (!checksum ||
+	    checksum->inode != (guint64) st.st_ino ||
+	    checksum->size != (goffset) st.st_size ||
+	    checksum->mtime != st.st_mtime) {
+		gchar *contents;
+		gsize length;
+
+		if (!g_file_get_contents (path, &contents, &length, NULL)) {
+			g_debug ("%s isn't readable while calculating MD5 checksum", path);
+			art_cache_remove (media_art_checksums, path);
+			return FALSE;
+		}
+
+		checksum = g_slice_new0 (ArtChecksum);
+		checksum->inode = (guint64) st.st_ino;
+		checksum->size = (goffset) st.st_size;
+		checksum->mtime = st.st_mtime;
+		checksum->md5 = checksum_for_data (G_CHECKSUM_MD5, (const guchar *) contents, length);
+		checksum->is_jpeg = (length >= 3 &&
+		                     (guchar) contents[0] == 0xff &&
+		                     (guchar) contents[1] == 0xd8 &&
+		                     (guchar) contents[2] == 0xff);
+
+		g_free (contents);
+
+		art_cache_insert (media_art_checksums, path, checksum);
+	}
+
+	if (md5) {
+		*md5 = g_strdup (checksum->md5);
+	}
+
+	if (is_jpeg) {
+		*is_jpeg = checksum->is_jpeg;
+	}
+
+	return TRUE;
+}
+
 static gboolean
 convert_from_other_format (const gchar *found,
                            const gchar *target,
@@ -239,7 +427,7 @@ convert_from_other_format (const gchar *found,
 		}
 	} else if (retval && file_get_checksum_if_exists (G_CHECKSUM_MD5, target_temp, &sum1, FALSE, NULL)) {
 		gchar *sum2 = NULL;
-		if (file_get_checksum_if_exists (G_CHECKSUM_MD5, album_path, &sum2, FALSE, NULL)) {
+		if (file_get_md5_cached (album_path, &sum2, NULL)) {
 			if (g_strcmp0 (sum1, sum2) == 0) {
 
 				/* If album-space-md5.jpg is the same as found,
@@ -370,50 +558,62 @@ classify_image_file (TrackerMediaArtSearch *search,
 	return IMAGE_MATCH_SAME_DIRECTORY;
 }
 
-static gchar *
-tracker_media_art_process_external_images (const gchar         *uri,
-                                           TrackerMediaArtType  type,
-                                           const gchar         *artist,
-                                           const gchar         *title)
+static void
+art_directory_free (ArtDirectory *directory)
 {
-	TrackerMediaArtSearch *search;
-	GDir *dir;
+	g_list_foreach (directory->images, (GFunc) g_free, NULL);
+	g_list_free (directory->images);
+	g_slice_free (ArtDirectory, directory);
+}
+
+/* Returns the lower case names of the images in @dirname, only
+ * reading the directory again if it changed. The list is owned by
+ * the cache. */
+static GList *
+media_art_directory_get_images (const gchar *dirname)
+{
+	ArtDirectory *directory;
 	GError *error = NULL;
-	gchar *dirname = NULL;
 	const gchar *name;
-	gchar *name_utf8, *name_strdown;
-	guint i;
-	gchar *art_file_name;
-	gchar *art_file_path;
-	gint priority;
+	struct stat st;
+	GDir *dir;
 
-	GList *image_list[IMAGE_MATCH_TYPE_COUNT] = { NULL, };
+	if (g_stat (dirname, &st) == -1) {
+		g_hash_table_remove (media_art_directories, dirname);
+		return NULL;
+	}
 
-	g_return_val_if_fail (type > TRACKER_MEDIA_ART_NONE && type < TRACKER_MEDIA_ART_TYPE_COUNT, FALSE);
-	g_return_val_if_fail (title != NULL, FALSE);
+	directory = g_hash_table_lookup (media_art_directories, dirname);
+
+	if (directory && directory->mtime != 0 && directory->mtime == st.st_mtime) {
+		return directory->images;
+	}
 
-	dir = get_parent_g_dir (uri, &dirname, &error);
+	dir = g_dir_open (dirname, 0, &error);
 
 	if (!dir) {
 		g_debug ("Media art directory could not be opened: %s",
 		         error ? error->message : "no error given");
 
 		g_clear_error (&error);
-		g_free (dirname);
+		g_hash_table_remove (media_art_directories, dirname);
 
 		return NULL;
 	}
 
-	/* First, classify each file in the directory as either an image, relevant
-	 * to the media object in question, or irrelevant. We use this information
-	 * to decide if the image is a cover or if the file is in a random directory.
-	 */
+	if (g_hash_table_size (media_art_directories) >= MAX_CACHED_DIRECTORIES) {
+		g_hash_table_remove_all (media_art_directories);
+	}
 
-	search = tracker_media_art_search_new (uri, type, artist, title);
+	directory = g_slice_new0 (ArtDirectory);
+
+	/* Changes within the same second would go unnoticed */
+	directory->mtime = (st.st_mtime < time (NULL)) ? st.st_mtime : 0;
 
 	for (name = g_dir_read_name (dir);
 	     name != NULL;
 	     name = g_dir_read_name (dir)) {
+		gchar *name_utf8, *name_strdown;
 
 		name_utf8 = g_filename_to_utf8 (name, -1, NULL, NULL, NULL);
 
@@ -425,11 +625,9 @@ tracker_media_art_process_external_images (const gchar         *uri,
 		name_strdown = g_utf8_strdown (name_utf8, -1);
 
 		if (g_str_has_suffix (name_strdown, "jpeg") ||
-			g_str_has_suffix (name_strdown, "jpg") ||
-			g_str_has_suffix (name_strdown, "png")) {
-
-			priority = classify_image_file (search, name_strdown);
-			image_list[priority] = g_list_prepend (image_list[priority], name_strdown);
+		    g_str_has_suffix (name_strdown, "jpg") ||
+		    g_str_has_suffix (name_strdown, "png")) {
+			directory->images = g_list_prepend (directory->images, name_strdown);
 		} else {
 			g_free (name_strdown);
 		}
@@ -437,6 +635,55 @@ tracker_media_art_process_external_images (const gchar         *uri,
 		g_free (name_utf8);
 	}
 
+	directory->images = g_list_reverse (directory->images);
+
+	g_dir_close (dir);
+
+	g_hash_table_replace (media_art_directories, g_strdup (dirname), directory);
+
+	return directory->images;
+}
+
+static gchar *
+tracker_media_art_process_external_images (const gchar         *uri,
+                                           TrackerMediaArtType  type,
+                                           const gchar         *artist,
+                                           const gchar         *title)
+{
+	TrackerMediaArtSearch *search;
+	gchar *dirname;
+	GList *images, *l;
+	guint i;
+	gchar *art_file_name;
+	gchar *art_file_path;
+	gint priority;
+
+	GList *image_list[IMAGE_MATCH_TYPE_COUNT] = { NULL, };
+
+	g_return_val_if_fail (type > TRACKER_MEDIA_ART_NONE && type < TRACKER_MEDIA_ART_TYPE_COUNT, FALSE);
+	g_return_val_if_fail (title != NULL, FALSE);
+
+	dirname = get_parent_dirname (uri);
+
+	if (!dirname) {
+		g_debug ("No parent directory found for '%s'", uri);
+		return NULL;
+	}
+
+	images = media_art_directory_get_images (dirname);
+
+	/* First, classify each file in the directory as either an image, relevant
+	 * to the media object in question, or irrelevant. We use this information
+	 * to decide if the image is a cover or if the file is in a random directory.
+	 */
+
+	search = tracker_media_art_search_new (uri, type, artist, title);
+
+	for (l = images; l; l = l->next) {
+		priority = classify_image_file (search, l->data);
+		image_list[priority] = g_list_prepend (image_list[priority], l->data);
+	}
+
 	/* Use the results to pick a media art image */
 
 	art_file_name = NULL;
@@ -453,7 +700,6 @@ tracker_media_art_process_external_images (const gchar         *uri,
 	}
 
 	for (i = 0; i < IMAGE_MATCH_TYPE_COUNT; i ++) {
-		g_list_foreach (image_list[i], (GFunc)g_free, NULL);
 		g_list_free (image_list[i]);
 	}
 
@@ -466,7 +712,6 @@ tracker_media_art_process_external_images (const gchar         *uri,
 	}
 
 	tracker_media_art_search_free (search);
-	g_dir_close (dir);
 	g_free (dirname);
 
 	return art_file_path;
@@ -557,7 +802,7 @@ media_art_heuristic (const gchar         *artist,
 				}
 				g_object_unref (art_file);
 				g_object_unref (target_file);
-			} else if (file_get_checksum_if_exists (G_CHECKSUM_MD5, art_file_path, &sum1, TRUE, &is_jpeg)) {
+			} else if (file_get_md5_cached (art_file_path, &sum1, &is_jpeg)) {
 				/* Avoid duplicate artwork for each track in an album */
 				tracker_media_art_get_path (NULL,
 				                            title_stripped,
@@ -571,7 +816,7 @@ media_art_heuristic (const gchar         *artist,
 
 					g_debug ("Album art (JPEG) found in same directory being used:'%s'", art_file_path);
 
-					if (file_get_checksum_if_exists (G_CHECKSUM_MD5, album_art_file_path, &sum2, FALSE, NULL)) {
+					if (file_get_md5_cached (album_art_file_path, &sum2, NULL)) {
 						if (g_strcmp0 (sum1, sum2) == 0) {
 							/* If album-space-md5.jpg is the same as found,
 							 * make a symlink */
@@ -674,6 +919,7 @@ media_art_set (const unsigned char *buffer,
                const gchar         *uri)
 {
 	gchar *local_path;
+	gchar *buffer_sum;
 	gboolean retval = FALSE;
 
 	g_return_val_if_fail (type > TRACKER_MEDIA_ART_NONE && type < TRACKER_MEDIA_ART_TYPE_COUNT, FALSE);
@@ -685,6 +931,17 @@ media_art_set (const unsigned char *buffer,
 
 	tracker_media_art_get_path (artist, title, media_art_type_name[type], NULL, &local_path, NULL);
 
+	buffer_sum = checksum_for_data (G_CHECKSUM_MD5, buffer, len);
+
+	/* Other tracks of the same album usually embed the same image */
+	if (g_strcmp0 (art_cache_lookup (media_art_embedded, local_path), buffer_sum) == 0 &&
+	    g_file_test (local_path, G_FILE_TEST_EXISTS)) {
+		g_debug ("Album art '%s' was already made from this embedded image", local_path);
+		g_free (buffer_sum);
+		g_free (local_path);
+		return TRUE;
+	}
+
 	if (type != TRACKER_MEDIA_ART_ALBUM || (artist == NULL || g_strcmp0 (artist, " ") == 0)) {
 		retval = tracker_media_art_buffer_to_jpeg (buffer, len, mime, local_path);
 	} else {
@@ -707,51 +964,72 @@ media_art_set (const unsigned char *buffer,
 		} else {
 			gchar *sum2 = NULL;
 
-			if (file_get_checksum_if_exists (G_CHECKSUM_MD5, album_path, &sum2, FALSE, NULL)) {
+			if (file_get_md5_cached (album_path, &sum2, NULL)) {
 				if ( !(g_strcmp0 (mime, "image/jpeg") == 0 || g_strcmp0 (mime, "JPG") == 0) ||
 			       ( !(len > 2 && buffer[0] == 0xff && buffer[1] == 0xd8 && buffer[2] == 0xff) )) {
-					gchar *sum1 = NULL;
-					gchar *temp = g_strdup_printf ("%s-tmp", album_path);
+					gchar *sum1;
 
-					/* If buffer isn't a JPEG */
+					/* If buffer isn't a JPEG, it only has to be converted
+					 * if we don't know what it converts to yet */
 
-					retval = tracker_media_art_buffer_to_jpeg (buffer, len, mime, temp);
+					sum1 = g_strdup (art_cache_lookup (media_art_converted, buffer_sum));
 
-					if (retval && file_get_checksum_if_exists (G_CHECKSUM_MD5, temp, &sum1, FALSE, NULL)) {
-						if (g_strcmp0 (sum1, sum2) == 0) {
+					if (g_strcmp0 (sum1, sum2) == 0) {
+						/* If album-space-md5.jpg is the same as buffer, make a symlink
+						 * to album-md5-md5.jpg */
 
-							/* If album-space-md5.jpg is the same as buffer, make a symlink
-							 * to album-md5-md5.jpg */
+						if (symlink (album_path, local_path) != 0) {
+							g_debug ("symlink(%s, %s) error: %s", album_path, local_path, g_strerror (errno));
+							retval = FALSE;
+						} else {
+							retval = TRUE;
+						}
+					} else {
+						gchar *temp = g_strdup_printf ("%s-tmp", album_path);
 
-							g_unlink (temp);
-							if (symlink (album_path, local_path) != 0) {
-								g_debug ("symlink(%s, %s) error: %s", album_path, local_path, g_strerror (errno));
-								retval = FALSE;
+						g_free (sum1);
+						sum1 = NULL;
+
+						retval = tracker_media_art_buffer_to_jpeg (buffer, len, mime, temp);
+
+						if (retval && file_get_checksum_if_exists (G_CHECKSUM_MD5, temp, &sum1, FALSE, NULL)) {
+							art_cache_insert (media_art_converted,
+							                  buffer_sum,
+							                  g_strdup (sum1));
+
+							if (g_strcmp0 (sum1, sum2) == 0) {
+
+								/* If album-space-md5.jpg is the same as buffer, make a symlink
+								 * to album-md5-md5.jpg */
+
+								g_unlink (temp);
+								if (symlink (album_path, local_path) != 0) {
+									g_debug ("symlink(%s, %s) error: %s", album_path, local_path, g_strerror (errno));
+									retval = FALSE;
+								} else {
+									retval = TRUE;
+								}
 							} else {
-								retval = TRUE;
+								/* If album-space-md5.jpg isn't the same as buffer, make a
+								 * new album-md5-md5.jpg */
+								if (g_rename (temp, local_path) == -1) {
+									g_debug ("rename(%s, %s) error: %s", temp, local_path, g_strerror (errno));
+								}
 							}
 						} else {
-							/* If album-space-md5.jpg isn't the same as buffer, make a
-							 * new album-md5-md5.jpg */
-							if (g_rename (temp, local_path) == -1) {
-								g_debug ("rename(%s, %s) error: %s", temp, local_path, g_strerror (errno));
-							}
+							/* Can't read temp file ... */
+							g_unlink (temp);
 						}
-						g_free (sum1);
-					} else {
-						/* Can't read temp file ... */
-						g_unlink (temp);
+
+						g_free (temp);
 					}
 
-					g_free (temp);
+					g_free (sum1);
 				} else {
-					gchar *sum1 = NULL;
-
-					sum1 = checksum_for_data (G_CHECKSUM_MD5, buffer, len);
 					/* If album-space-md5.jpg is the same as buffer, make a symlink
 					 * to album-md5-md5.jpg */
 
-					if (g_strcmp0 (sum1, sum2) == 0) {
+					if (g_strcmp0 (buffer_sum, sum2) == 0) {
 						if (symlink (album_path, local_path) != 0) {
 							g_debug ("symlink(%s, %s) error: %s", album_path, local_path, g_strerror (errno));
 							retval = FALSE;
@@ -763,7 +1041,6 @@ media_art_set (const unsigned char *buffer,
 						 * new album-md5-md5.jpg */
 						retval = tracker_media_art_buffer_to_jpeg (buffer, len, mime, local_path);
 					}
-					g_free (sum1);
 				}
 				g_free (sum2);
 			}
@@ -771,6 +1048,12 @@ media_art_set (const unsigned char *buffer,
 		}
 	}
 
+	if (retval) {
+		art_cache_insert (media_art_embedded, local_path, buffer_sum);
+	} else {
+		g_free (buffer_sum);
+	}
+
 	g_free (local_path);
 
 	return retval;
@@ -952,6 +1235,14 @@ tracker_media_art_init (void)
 	                                         (GDestroyNotify) g_free,
 	                                         NULL);
 
+	media_art_checksums = art_cache_new ((GDestroyNotify) art_checksum_free);
+	media_art_converted = art_cache_new (g_free);
+	media_art_embedded = art_cache_new (g_free);
+	media_art_directories = g_hash_table_new_full (g_str_hash,
+	                                               g_str_equal,
+	                                               (GDestroyNotify) g_free,
+	                                               (GDestroyNotify) art_directory_free);
+
 	/* Signal handler for new album art from the extractor */
 	connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
 
@@ -980,6 +1271,11 @@ tracker_media_art_shutdown (void)
 		g_hash_table_unref (media_art_cache);
 	}
 
+	art_cache_free (media_art_checksums);
+	art_cache_free (media_art_converted);
+	art_cache_free (media_art_embedded);
+	g_hash_table_unref (media_art_directories);
+
 	if (media_art_storage) {
 		g_object_unref (media_art_storage);
 	}
@@ -1057,16 +1353,9 @@ tracker_media_art_process (const unsigned char *buffer,
 	if ((!created) && ((!a_exists) || (a_exists && mtime > a_mtime))) {
 		/* If not, we perform a heuristic on the dir */
 		gchar *key;
-		gchar *dirname = NULL;
-		GFile *file, *dirf;
-
-		file = g_file_new_for_uri (uri);
-		dirf = g_file_get_parent (file);
-		if (dirf) {
-			dirname = g_file_get_path (dirf);
-			g_object_unref (dirf);
-		}
-		g_object_unref (file);
+		gchar *dirname;
+
+		dirname = get_parent_dirname (uri);
 
 		key = g_strdup_printf ("%i-%s-%s-%s",
 		                       type,
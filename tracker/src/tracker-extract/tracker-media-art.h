@@ -31,6 +31,9 @@ typedef enum {
 	TRACKER_MEDIA_ART_TYPE_COUNT
 } TrackerMediaArtType;
 
+/* Entries kept at most in each in-memory index of the media art */
+#define TRACKER_MEDIA_ART_MAX_CACHED 256
+
 gboolean tracker_media_art_init     (void);
 void     tracker_media_art_shutdown (void);
 
@@ -0,0 +1,502 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include <libtracker-common/tracker-os-dependant.h>
+
+#include "tracker-worker-pool.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+typedef struct {
+	pid_t pid;
+	/* our end of the socket pair */
+	int fd;
+	guint n_documents;
+} Worker;
+
+struct _TrackerWorkerPool {
+	TrackerWorkerFunc func;
+	guint max_workers;
+	guint max_documents;
+	guint timeout;
+
+#if GLIB_CHECK_VERSION (2,31,0)
+	GMutex mutex;
+	GCond cond;
+#else
+	GMutex *mutex;
+	GCond *cond;
+#endif
+
+	/* all helper processes and those waiting for a document */
+	GList *workers;
+	GQueue *idle_workers;
+	guint n_workers;
+};
+
+static void
+pool_lock (TrackerWorkerPool *pool)
+{
+#if GLIB_CHECK_VERSION (2,31,0)
+	g_mutex_lock (&pool->mutex);
+#else
+	g_mutex_lock (pool->mutex);
+#endif
+}
+
+static void
+pool_unlock (TrackerWorkerPool *pool)
+{
+#if GLIB_CHECK_VERSION (2,31,0)
+	g_mutex_unlock (&pool->mutex);
+#else
+	g_mutex_unlock (pool->mutex);
+#endif
+}
+
+static void
+pool_wait (TrackerWorkerPool *pool)
+{
+#if GLIB_CHECK_VERSION (2,31,0)
+	g_cond_wait (&pool->cond, &pool->mutex);
+#else
+	g_cond_wait (pool->cond, pool->mutex);
+#endif
+}
+
+static void
+pool_signal (TrackerWorkerPool *pool)
+{
+#if GLIB_CHECK_VERSION (2,31,0)
+	g_cond_signal (&pool->cond);
+#else
+	g_cond_signal (pool->cond);
+#endif
+}
+
+static gboolean
+write_all (int          fd,
+           gconstpointer buf,
+           gsize        len)
+{
+	const gchar *p = buf;
+
+	while (len > 0) {
+		ssize_t written;
+
+		written = send (fd, p, len, MSG_NOSIGNAL);
+
+		if (written == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			return FALSE;
+		}
+
+		p += written;
+		len -= written;
+	}
+
+	return TRUE;
+}
+
+/* Waits at most until @deadline (monotonic time) unless it is 0 */
+static gboolean
+read_all (int      fd,
+          gpointer buf,
+          gsize    len,
+          gint64   deadline)
+{
+	gchar *p = buf;
+
+	while (len > 0) {
+		ssize_t n_read;
+
+		if (deadline != 0) {
+			struct pollfd pfd;
+			gint64 remaining;
+			int retval;
+
+			remaining = deadline - g_get_monotonic_time ();
+			if (remaining <= 0) {
+				return FALSE;
+			}
+
+			pfd.fd = fd;
+			pfd.events = POLLIN;
+			pfd.revents = 0;
+
+			retval = poll (&pfd, 1, (int) (remaining / 1000) + 1);
+
+			if (retval == -1 && errno == EINTR) {
+				continue;
+			} else if (retval <= 0) {
+				return FALSE;
+			}
+		}
+
+		n_read = read (fd, p, len);
+
+		if (n_read == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			return FALSE;
+		} else if (n_read == 0) {
+			/* the other end went away */
+			return FALSE;
+		}
+
+		p += n_read;
+		len -= n_read;
+	}
+
+	return TRUE;
+}
+
+/* Main loop of the helper process, handles one document at a time
+ * until the pool closes the socket or max_documents is reached */
+static void
+worker_main (TrackerWorkerPool *pool,
+             int                fd)
+{
+	guint n_documents;
+
+	tracker_memory_setrlimits ();
+
+	for (n_documents = 0; n_documents < pool->max_documents; n_documents++) {
+		guint32 uri_len;
+		guint64 max_bytes;
+		gint64 len;
+		gchar *uri, *text;
+
+		if (!read_all (fd, &uri_len, sizeof (uri_len), 0)) {
+			break;
+		}
+
+		uri = g_malloc (uri_len + 1);
+
+		if (!read_all (fd, uri, uri_len, 0) ||
+		    !read_all (fd, &max_bytes, sizeof (max_bytes), 0)) {
+			g_free (uri);
+			break;
+		}
+
+		uri[uri_len] = '\0';
+
+		text = (pool->func) (uri, (gsize) max_bytes);
+		len = text ? (gint64) strlen (text) : -1;
+
+		if (!write_all (fd, &len, sizeof (len)) ||
+		    (text && !write_all (fd, text, len))) {
+			g_free (text);
+			g_free (uri);
+			break;
+		}
+
+		g_free (text);
+		g_free (uri);
+	}
+
+	close (fd);
+
+	/* do not run any exit handlers of the extractor */
+	_exit (0);
+}
+
+/* Called with the pool locked */
+static Worker *
+worker_new (TrackerWorkerPool *pool)
+{
+	Worker *worker;
+	GList *l;
+	int fd[2];
+	pid_t pid;
+
+	if (socketpair (AF_UNIX, SOCK_STREAM, 0, fd) == -1) {
+		g_warning ("Could not create socket pair for helper process, %s",
+		           g_strerror (errno));
+		return NULL;
+	}
+
+	pid = fork ();
+
+	if (pid == -1) {
+		g_warning ("Could not fork helper process, %s",
+		           g_strerror (errno));
+		close (fd[0]);
+		close (fd[1]);
+		return NULL;
+	}
+
+	if (pid == 0) {
+		/* other helpers have to see the end of their socket when the
+		 * pool closes it */
+		for (l = pool->workers; l; l = l->next) {
+			close (((Worker *) l->data)->fd);
+		}
+
+		close (fd[0]);
+		worker_main (pool, fd[1]);
+	}
+
+	close (fd[1]);
+	fcntl (fd[0], F_SETFD, FD_CLOEXEC);
+
+	g_debug ("Started helper process %d", pid);
+
+	worker = g_slice_new0 (Worker);
+	worker->pid = pid;
+	worker->fd = fd[0];
+
+	pool->workers = g_list_prepend (pool->workers, worker);
+	pool->n_workers++;
+
+	return worker;
+}
+
+static void
+worker_free (Worker   *worker,
+             gboolean  terminate)
+{
+	close (worker->fd);
+
+	if (terminate) {
+		kill (worker->pid, SIGKILL);
+	}
+
+	/* the helper exits as soon as it sees the socket closed */
+	waitpid (worker->pid, NULL, 0);
+
+	g_slice_free (Worker, worker);
+}
+
+static Worker *
+pool_get_worker (TrackerWorkerPool *pool)
+{
+	Worker *worker;
+
+	pool_lock (pool);
+
+	while (TRUE) {
+		worker = g_queue_pop_head (pool->idle_workers);
+
+		if (worker) {
+			break;
+		}
+
+		if (pool->n_workers < pool->max_workers) {
+			worker = worker_new (pool);
+			break;
+		}
+
+		pool_wait (pool);
+	}
+
+	pool_unlock (pool);
+
+	return worker;
+}
+
+static void
+pool_release_worker (TrackerWorkerPool *pool,
+                     Worker            *worker,
+                     gboolean           reuse)
+{
+	pool_lock (pool);
+
+	if (reuse) {
+		g_queue_push_tail (pool->idle_workers, worker);
+	} else {
+		pool->workers = g_list_remove (pool->workers, worker);
+		pool->n_workers--;
+	}
+
+	pool_signal (pool);
+	pool_unlock (pool);
+}
+
+/**
+ * tracker_worker_pool_new:
+ * @func: function run in the helper processes for every document
+ * @max_workers: maximum number of helper processes
+ * @max_documents: number of documents after which a helper is replaced
+ * @timeout: time in seconds a helper has for a document before it is killed
+ *
+ * Creates a pool of helper processes, these are forked on demand.
+ *
+ * Returns: a new #TrackerWorkerPool
+ **/
+TrackerWorkerPool *
+tracker_worker_pool_new (TrackerWorkerFunc func,
+                         guint             max_workers,
+                         guint             max_documents,
+                         guint             timeout)
+{
+	TrackerWorkerPool *pool;
+
+	g_return_val_if_fail (func != NULL, NULL);
+	g_return_val_if_fail (max_workers > 0, NULL);
+	g_return_val_if_fail (max_documents > 0, NULL);
+
+	pool = g_slice_new0 (TrackerWorkerPool);
+	pool->func = func;
+	pool->max_workers = max_workers;
+	pool->max_documents = max_documents;
+	pool->timeout = timeout;
+	pool->idle_workers = g_queue_new ();
+
+#if GLIB_CHECK_VERSION (2,31,0)
+	g_mutex_init (&pool->mutex);
+	g_cond_init (&pool->cond);
+#else
+	pool->mutex = g_mutex_new ();
+	pool->cond = g_cond_new ();
+#endif
+
+	return pool;
+}
+
+/**
+ * tracker_worker_pool_free:
+ * @pool: a #TrackerWorkerPool
+ *
+ * Stops all helper processes, no document may be in progress.
+ **/
+void
+tracker_worker_pool_free (TrackerWorkerPool *pool)
+{
+	GList *l;
+
+	g_return_if_fail (pool != NULL);
+	g_return_if_fail (g_queue_get_length (pool->idle_workers) == pool->n_workers);
+
+	for (l = pool->workers; l; l = l->next) {
+		worker_free (l->data, FALSE);
+	}
+
+	g_list_free (pool->workers);
+	g_queue_free (pool->idle_workers);
+
+#if GLIB_CHECK_VERSION (2,31,0)
+	g_mutex_clear (&pool->mutex);
+	g_cond_clear (&pool->cond);
+#else
+	g_mutex_free (pool->mutex);
+	g_cond_free (pool->cond);
+#endif
+
+	g_slice_free (TrackerWorkerPool, pool);
+}
+
+/**
+ * tracker_worker_pool_run:
+ * @pool: a #TrackerWorkerPool
+ * @uri: URI of the document
+ * @max_bytes: maximum size of the returned text
+ *
+ * Runs the function of @pool for @uri in one of the helper processes,
+ * waiting for a helper to become available if all are busy.
+ *
+ * Returns: the text returned by the helper, %NULL if there is none or
+ * if the helper crashed or did not finish in time. Use g_free() when
+ * no longer needed.
+ **/
+gchar *
+tracker_worker_pool_run (TrackerWorkerPool *pool,
+                         const gchar       *uri,
+                         gsize              max_bytes)
+{
+	Worker *worker;
+	guint32 uri_len;
+	guint64 max_bytes64;
+	gint64 len = -1;
+	gint64 deadline;
+	gchar *text = NULL;
+	gboolean success;
+
+	g_return_val_if_fail (pool != NULL, NULL);
+	g_return_val_if_fail (uri != NULL, NULL);
+
+	worker = pool_get_worker (pool);
+
+	if (!worker) {
+		return NULL;
+	}
+
+	uri_len = strlen (uri);
+	max_bytes64 = max_bytes;
+	deadline = g_get_monotonic_time () + (gint64) pool->timeout * G_USEC_PER_SEC;
+
+	success = write_all (worker->fd, &uri_len, sizeof (uri_len)) &&
+	          write_all (worker->fd, uri, uri_len) &&
+	          write_all (worker->fd, &max_bytes64, sizeof (max_bytes64)) &&
+	          read_all (worker->fd, &len, sizeof (len), deadline);
+
+	/* text may exceed max_bytes by separators, not by more than that */
+	if (success && len > (gint64) max_bytes64 * 2 + 4096) {
+		g_warning ("Helper process %d returned %" G_GINT64_FORMAT " bytes for '%s', expected at most %" G_GSIZE_FORMAT,
+		           worker->pid, len, uri, max_bytes);
+		success = FALSE;
+	}
+
+	if (success && len >= 0) {
+		text = g_malloc (len + 1);
+		success = read_all (worker->fd, text, len, deadline);
+
+		if (success) {
+			text[len] = '\0';
+		} else {
+			g_free (text);
+			text = NULL;
+		}
+	}
+
+	if (!success) {
+		g_debug ("Helper process %d crashed or took longer than %d seconds for '%s', killing it",
+		         worker->pid, pool->timeout, uri);
+
+		pool_release_worker (pool, worker, FALSE);
+		worker_free (worker, TRUE);
+	} else if (++worker->n_documents >= pool->max_documents) {
+		/* the helper exits by itself after the last document */
+		pool_release_worker (pool, worker, FALSE);
+		worker_free (worker, FALSE);
+	} else {
+		pool_release_worker (pool, worker, TRUE);
+	}
+
+	return text;
+}
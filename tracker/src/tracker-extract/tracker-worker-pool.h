@@ -0,0 +1,50 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __TRACKER_WORKER_POOL_H__
+#define __TRACKER_WORKER_POOL_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Runs risky parts of extractors, e.g. getting the text of a document,
+ * in long-lived helper processes. A helper that crashes, hangs for
+ * longer than the timeout or exceeds its resource limits only loses
+ * the document it was working on, helpers are replaced after a number
+ * of documents to bound leaks.
+ */
+typedef struct _TrackerWorkerPool TrackerWorkerPool;
+
+/* Called in the helper process, returns newly allocated text of at
+ * most @max_bytes bytes, or %NULL */
+typedef gchar * (* TrackerWorkerFunc) (const gchar *uri,
+                                       gsize        max_bytes);
+
+TrackerWorkerPool *tracker_worker_pool_new  (TrackerWorkerFunc  func,
+                                             guint              max_workers,
+                                             guint              max_documents,
+                                             guint              timeout);
+void               tracker_worker_pool_free (TrackerWorkerPool *pool);
+gchar *            tracker_worker_pool_run  (TrackerWorkerPool *pool,
+                                             const gchar       *uri,
+                                             gsize              max_bytes);
+
+G_END_DECLS
+
+#endif /* __TRACKER_WORKER_POOL_H__ */
@@ -22,6 +22,10 @@
 public class Tracker.Backup : Object {
 	public const string PATH = "/org/freedesktop/Tracker1/Backup";
 
+	/* Emitted while a backup started with save () is being written,
+	 * @progress goes from 0 to 1. */
+	public signal void progress (string destination_uri, double progress);
+
 	public async void save (BusName sender, string destination_uri) throws Error {
 		var resources = (Resources) Tracker.DBus.get_object (typeof (Resources));
 		if (resources != null) {
@@ -37,13 +41,29 @@ public class Tracker.Backup : Object {
 				throw new DataBackupError.INVALID_URI ("'" + destination_uri + "' is not a valid uri");
 			}
 
+			Error backup_error = null;
+
+			/* The store only needs to be paused while the backup takes its
+			 * snapshot, copying happens in a thread while the store keeps
+			 * processing queries and updates. */
 			yield Tracker.Store.pause ();
+			try {
+				Data.backup_save (destination, p => {
+					progress (destination_uri, p);
+				}, error => {
+					backup_error = error;
+					save.callback ();
+				});
+			} finally {
+				if (resources != null) {
+					Tracker.Events.init ();
+					resources.enable_signals ();
+					resources = null;
+				}
+
+				Tracker.Store.resume ();
+			}
 
-			Error backup_error = null;
-			Data.backup_save (destination, error => {
-				backup_error = error;
-				save.callback ();
-			});
 			yield;
 
 			if (backup_error != null) {
@@ -59,8 +79,6 @@ public class Tracker.Backup : Object {
 				Tracker.Events.init ();
 				resources.enable_signals ();
 			}
-
-			Tracker.Store.resume ();
 		}
 	}
 
@@ -248,6 +248,8 @@ License which can be viewed at:
 
 		Tracker.DBJournal.set_rotating (do_rotating, chunk_size, rotate_to);
 
+		Tracker.Data.backup_set_pacing (db_config.backup_pages_per_step, db_config.backup_io_budget);
+
 		int select_cache_size, update_cache_size;
 		string cache_size_s;
 
@@ -18,6 +18,99 @@
  * Boston, MA  02110-1301, USA.
  */
 
+/* A client registered for the changes of one class, matching changes are
+ * written to its file descriptor as they are emitted, see
+ * Resources.subscribe () */
+class Tracker.Subscription {
+	public uint id;
+	public string owner;
+	public unowned Class cl;
+	/* predicate URIs, null for all predicates */
+	public HashTable<string,bool>? predicates;
+	public string? graph;
+	public bool resolve_uris;
+	public UnixOutputStream output_stream;
+
+	/* changes of the current transaction */
+	public ByteArray pending = new ByteArray ();
+	public int n_pending;
+
+	/* changes of committed transactions, not yet emitted */
+	public ByteArray ready = new ByteArray ();
+	public int n_ready;
+
+	/* emitted changes not yet written to the client */
+	public ByteArray output = new ByteArray ();
+	public bool writing;
+
+	public static void put_int32 (ByteArray buffer, int32 value) {
+		/* host byte order, as the steroids streams */
+		uint8[] data = new uint8[sizeof (int32)];
+		Memory.copy (data, &value, sizeof (int32));
+		buffer.append (data);
+	}
+
+	public void reset_pending () {
+		pending.set_size (0);
+		n_pending = 0;
+	}
+
+	public bool matches (string? graph, int pred_id, PtrArray rdf_types) {
+		if (this.graph != null && this.graph != graph) {
+			return false;
+		}
+
+		if (predicates != null) {
+			unowned string? pred = Ontologies.get_uri_by_id (pred_id);
+			if (pred == null || !predicates.contains (pred)) {
+				return false;
+			}
+		}
+
+		for (uint i = 0; i < rdf_types.len; i++) {
+			if (rdf_types.index (i) == (void*) cl) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void put_string (string? str) {
+		if (str == null) {
+			str = "";
+		}
+
+		put_int32 (pending, str.length);
+		pending.append (str.data);
+	}
+
+	public void add (bool insert, int graph_id, string? graph, int subject_id, string subject, int pred_id, int object_id, string? object) {
+		put_int32 (pending, insert ? 1 : 0);
+		put_int32 (pending, graph_id);
+		put_int32 (pending, subject_id);
+		put_int32 (pending, pred_id);
+		put_int32 (pending, object_id);
+
+		if (resolve_uris) {
+			put_string (graph);
+			put_string (subject);
+			put_string (Ontologies.get_uri_by_id (pred_id));
+			put_string (object);
+		}
+
+		n_pending++;
+	}
+
+	public void transact () {
+		if (n_pending > 0) {
+			ready.append (pending.data);
+			n_ready += n_pending;
+			reset_pending ();
+		}
+	}
+}
+
 [DBus (name = "org.freedesktop.Tracker1.Resources")]
 public class Tracker.Resources : Object {
 	public const string PATH = "/org/freedesktop/Tracker1/Resources";
@@ -50,15 +143,31 @@ public class Tracker.Resources : Object {
 
 	const int DBUS_ARBITRARY_MAX_MSG_SIZE = 10000000;
 
+	/* Subscriptions whose client doesn't read its changes are dropped
+	 * once that much data is waiting to be written */
+	const int SUBSCRIPTION_MAX_OUTPUT_SIZE = 16 * 1024 * 1024;
+
 	DBusConnection connection;
 	uint signal_timeout;
 	bool regular_commit_pending;
 
+	/* subscriptions are filled in the update thread and written to
+	 * clients from the main loop, the mutex protects the table and
+	 * the buffers of each subscription, streams are only used from
+	 * the main loop */
+	static StaticMutex subscriptions_mutex;
+	HashTable<uint,Subscription> subscriptions;
+	uint last_subscription_id;
+	/* changes added to subscriptions since the last emission, they
+	 * count towards GRAPH_UPDATED_IMMEDIATE_EMIT_AT as events do */
+	uint subscription_total;
+
 	public signal void writeback ([DBus (signature = "a{iai}")] Variant subjects);
 	public signal void graph_updated (string classname, [DBus (signature = "a(iiii)")] Variant deletes, [DBus (signature = "a(iiii)")] Variant inserts);
 
 	public Resources (DBusConnection connection) {
 		this.connection = connection;
+		this.subscriptions = new HashTable<uint,Subscription> (direct_hash, direct_equal);
 	}
 
 	public async void load (BusName sender, string uri) throws Error {
@@ -88,8 +197,10 @@ public class Tracker.Resources : Object {
 		try {
 			var builder = new VariantBuilder ((VariantType) "aas");
 
-			yield Tracker.Store.sparql_query (query, Tracker.Store.Priority.HIGH, cursor => {
+			yield Tracker.Store.sparql_query (query, Tracker.Store.Priority.HIGH, (cursor, profile) => {
 				while (cursor.next ()) {
+					profile.add_row (0);
+
 					builder.open ((VariantType) "as");
 
 					for (int i = 0; i < cursor.n_columns; i++) {
@@ -124,6 +235,42 @@ public class Tracker.Resources : Object {
 		}
 	}
 
+	/* Runs the query without returning its results, the reply lists the
+	 * generated SQL, the query plan and where the time was spent */
+	[DBus (signature = "aas")]
+	public async Variant sparql_explain (BusName sender, string query) throws Error {
+		var request = DBusRequest.begin (sender, "Resources.SparqlExplain");
+		request.debug ("query: %s", query);
+		try {
+			Tracker.Store.QueryProfile result = null;
+
+			yield Tracker.Store.sparql_query (query, Tracker.Store.Priority.HIGH, (cursor, profile) => {
+				while (cursor.next ()) {
+					profile.add_row (Steroids.get_row_size (cursor));
+				}
+
+				try {
+					profile.plan = new Sparql.Query (query).explain ();
+				} catch (Error e) {
+					// the query ran fine, reply without a plan
+					debug ("Could not explain query: %s", e.message);
+				}
+				result = profile;
+			}, sender);
+
+			request.end ();
+
+			return result.to_variant ();
+		} catch (Error e) {
+			request.end (e);
+			if (e is Sparql.Error) {
+				throw e;
+			} else {
+				throw new Sparql.Error.INTERNAL (e.message);
+			}
+		}
+	}
+
 	public async void sparql_update (BusName sender, string update) throws Error {
 		var request = DBusRequest.begin (sender, "Resources.SparqlUpdate");
 		request.debug ("query: %s", update);
@@ -199,6 +346,156 @@ public class Tracker.Resources : Object {
 		/* no longer needed, just return */
 	}
 
+	/* Changes to resources of the class are written to the file
+	 * descriptor as they would be emitted with GraphUpdated, predicates
+	 * and graph restrict them further when not empty. */
+	public uint subscribe (BusName sender, string class_uri, string[] predicates, string graph, bool resolve_uris, UnixOutputStream output_stream) throws Error {
+		var request = DBusRequest.begin (sender, "Resources.Subscribe (class: '%s')", class_uri);
+
+		unowned Class cl = Ontologies.get_class_by_uri (class_uri);
+		if (cl == null) {
+			var e = new Sparql.Error.UNKNOWN_CLASS ("Unknown class '%s'", class_uri);
+			request.end (e);
+			throw e;
+		}
+
+		var sub = new Subscription ();
+		sub.id = ++last_subscription_id;
+		sub.owner = sender;
+		sub.cl = cl;
+		sub.graph = (graph != "") ? graph : null;
+		sub.resolve_uris = resolve_uris;
+		sub.output_stream = output_stream;
+
+		if (predicates.length > 0) {
+			sub.predicates = new HashTable<string,bool> (str_hash, str_equal);
+			foreach (string predicate in predicates) {
+				if (Ontologies.get_property_by_uri (predicate) == null) {
+					var e = new Sparql.Error.UNKNOWN_PROPERTY ("Unknown property '%s'", predicate);
+					request.end (e);
+					throw e;
+				}
+				sub.predicates.insert (predicate, true);
+			}
+		}
+
+		subscriptions_mutex.lock ();
+		subscriptions.insert (sub.id, sub);
+		subscriptions_mutex.unlock ();
+
+		request.end ();
+
+		return sub.id;
+	}
+
+	public void unsubscribe (BusName sender, uint id) {
+		var request = DBusRequest.begin (sender, "Resources.Unsubscribe (id: %u)", id);
+
+		subscriptions_mutex.lock ();
+		Subscription? sub = subscriptions.lookup (id);
+		subscriptions_mutex.unlock ();
+
+		if (sub != null && sub.owner == sender) {
+			remove_subscription (sub);
+		}
+
+		request.end ();
+	}
+
+	void remove_subscription (Subscription sub) {
+		try {
+			sub.output_stream.close ();
+		} catch (Error e) {
+		}
+
+		subscriptions_mutex.lock ();
+		subscriptions.remove (sub.id);
+		subscriptions_mutex.unlock ();
+	}
+
+	async void write_subscription (Subscription sub) {
+		while (true) {
+			subscriptions_mutex.lock ();
+
+			if (sub.output.len == 0) {
+				sub.writing = false;
+				subscriptions_mutex.unlock ();
+				break;
+			}
+
+			/* keep the chunk alive while it's being written */
+			uint8[] chunk = sub.output.data;
+			sub.output.set_size (0);
+
+			subscriptions_mutex.unlock ();
+
+			try {
+				size_t offset = 0;
+				while (offset < chunk.length) {
+					offset += yield sub.output_stream.write_async (chunk[offset:chunk.length]);
+				}
+			} catch (Error e) {
+				/* client went away */
+				remove_subscription (sub);
+				return;
+			}
+		}
+	}
+
+	/* may run in the update thread, writing and dropping subscriptions
+	 * is left to the main loop */
+	void emit_subscriptions () {
+		var to_write = new GenericArray<Subscription> ();
+		var to_drop = new GenericArray<Subscription> ();
+
+		subscriptions_mutex.lock ();
+
+		subscription_total = 0;
+
+		foreach (unowned Subscription sub in subscriptions.get_values ()) {
+			if (sub.n_ready == 0) {
+				continue;
+			}
+
+			/* a large transaction is fine, the client not
+			 * reading what was emitted before is not */
+			if (sub.output.len > SUBSCRIPTION_MAX_OUTPUT_SIZE) {
+				warning ("Dropping subscription %u of %s, changes are not being read", sub.id, sub.owner);
+				to_drop.add (sub);
+				continue;
+			}
+
+			Subscription.put_int32 (sub.output, sub.n_ready);
+			sub.output.append (sub.ready.data);
+
+			sub.ready.set_size (0);
+			sub.n_ready = 0;
+
+			if (!sub.writing) {
+				sub.writing = true;
+				to_write.add (sub);
+			}
+		}
+
+		subscriptions_mutex.unlock ();
+
+		if (to_write.length == 0 && to_drop.length == 0) {
+			return;
+		}
+
+		Idle.add (() => {
+			for (int i = 0; i < to_drop.length; i++) {
+				remove_subscription (to_drop[i]);
+			}
+
+			for (int i = 0; i < to_write.length; i++) {
+				write_subscription.begin (to_write[i]);
+			}
+
+			return false;
+		});
+	}
+
 	bool emit_graph_updated (Class cl) {
 		if (cl.has_insert_events () || cl.has_delete_events ()) {
 			var builder = new VariantBuilder ((VariantType) "a(iiii)");
@@ -230,6 +527,8 @@ public class Tracker.Resources : Object {
 		/* Reset counter */
 		Tracker.Events.get_total (true);
 
+		emit_subscriptions ();
+
 		/* Writeback feature */
 		var writebacks = Tracker.Writeback.get_ready ();
 
@@ -271,6 +570,12 @@ public class Tracker.Resources : Object {
 			cl.transact_events ();
 		}
 
+		subscriptions_mutex.lock ();
+		foreach (unowned Subscription sub in subscriptions.get_values ()) {
+			sub.transact ();
+		}
+		subscriptions_mutex.unlock ();
+
 		if (!regular_commit_pending) {
 			// never cancel timeout for non-batch commits as we want
 			// to ensure that the signal corresponding to a certain
@@ -304,11 +609,21 @@ public class Tracker.Resources : Object {
 	void on_statements_rolled_back (Tracker.Data.CommitType commit_type) {
 		Tracker.Events.reset_pending ();
 		Tracker.Writeback.reset_pending ();
+
+		subscriptions_mutex.lock ();
+		foreach (unowned Subscription sub in subscriptions.get_values ()) {
+			sub.reset_pending ();
+		}
+		subscriptions_mutex.unlock ();
 	}
 
 	void check_graph_updated_signal () {
+		subscriptions_mutex.lock ();
+		uint total = Tracker.Events.get_total (false) + subscription_total;
+		subscriptions_mutex.unlock ();
+
 		/* Check for whether we need an immediate emit */
-		if (Tracker.Events.get_total (false) > GRAPH_UPDATED_IMMEDIATE_EMIT_AT) {
+		if (total > GRAPH_UPDATED_IMMEDIATE_EMIT_AT) {
 			// possibly active timeout no longer necessary as signals
 			// for committed transactions will be emitted by the following on_emit_signals call
 			// do this before actually calling on_emit_signals as on_emit_signals sets signal_timeout to 0
@@ -325,12 +640,32 @@ public class Tracker.Resources : Object {
 	void on_statement_inserted (int graph_id, string? graph, int subject_id, string subject, int pred_id, int object_id, string? object, PtrArray rdf_types) {
 		Tracker.Events.add_insert (graph_id, subject_id, subject, pred_id, object_id, object, rdf_types);
 		Tracker.Writeback.check (graph_id, graph, subject_id, subject, pred_id, object_id, object, rdf_types);
+
+		subscriptions_mutex.lock ();
+		foreach (unowned Subscription sub in subscriptions.get_values ()) {
+			if (sub.matches (graph, pred_id, rdf_types)) {
+				sub.add (true, graph_id, graph, subject_id, subject, pred_id, object_id, object);
+				subscription_total++;
+			}
+		}
+		subscriptions_mutex.unlock ();
+
 		check_graph_updated_signal ();
 	}
 
 	void on_statement_deleted (int graph_id, string? graph, int subject_id, string subject, int pred_id, int object_id, string? object, PtrArray rdf_types) {
 		Tracker.Events.add_delete (graph_id, subject_id, subject, pred_id, object_id, object, rdf_types);
 		Tracker.Writeback.check (graph_id, graph, subject_id, subject, pred_id, object_id, object, rdf_types);
+
+		subscriptions_mutex.lock ();
+		foreach (unowned Subscription sub in subscriptions.get_values ()) {
+			if (sub.matches (graph, pred_id, rdf_types)) {
+				sub.add (false, graph_id, graph, subject_id, subject, pred_id, object_id, object);
+				subscription_total++;
+			}
+		}
+		subscriptions_mutex.unlock ();
+
 		check_graph_updated_signal ();
 	}
 
@@ -361,5 +696,19 @@ public class Tracker.Resources : Object {
 	[DBus (visible = false)]
 	public void unreg_batches (string old_owner) {
 		Tracker.Store.unreg_batches (old_owner);
+
+		var owned_subscriptions = new GenericArray<Subscription> ();
+
+		subscriptions_mutex.lock ();
+		foreach (unowned Subscription sub in subscriptions.get_values ()) {
+			if (sub.owner == old_owner) {
+				owned_subscriptions.add (sub);
+			}
+		}
+		subscriptions_mutex.unlock ();
+
+		for (int i = 0; i < owned_subscriptions.length; i++) {
+			remove_subscription (owned_subscriptions[i]);
+		}
 	}
 }
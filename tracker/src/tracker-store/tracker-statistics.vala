@@ -21,35 +21,12 @@
 public class Tracker.Statistics : Object {
 	public const string PATH = "/org/freedesktop/Tracker1/Statistics";
 
-	static bool initialized;
-
 	[DBus (signature = "aas")]
 	public new Variant get (BusName sender) throws GLib.Error {
 		var request = DBusRequest.begin (sender, "Statistics.Get");
 
-		if (!initialized) {
-			var iface = DBManager.get_db_interface ();
-
-			foreach (var cl in Ontologies.get_classes ()) {
-				/* xsd classes do not derive from rdfs:Resource and do not use separate tables */
-				if (!cl.name.has_prefix ("xsd:")) {
-					/* update statistics */
-					var stmt = iface.create_statement (DBStatementCacheType.NONE,
-						                           "SELECT COUNT(1) FROM \"%s\"",
-						                            cl.name);
-
-					var stat_cursor = stmt.start_cursor ();
-					if (stat_cursor.next ()) {
-						cl.count = (int) stat_cursor.get_integer (0);
-					} else {
-						warning ("Unable to query instance count for class %s", cl.name);
-					}
-				}
-			}
-
-			initialized = true;
-		}
-
+		/* class counts are persisted and kept up to date on every commit,
+		 * no need to scan the class tables here */
 		var builder = new VariantBuilder ((VariantType) "aas");
 
 		foreach (var cl in Ontologies.get_classes ()) {
@@ -24,13 +24,28 @@ public class Tracker.Steroids : Object {
 
 	public const int BUFFER_SIZE = 65536;
 
+	// Size of a row as query () writes it to the pipe
+	[DBus (visible = false)]
+	public static size_t get_row_size (Sparql.Cursor cursor) {
+		int n_columns = cursor.n_columns;
+		size_t size = sizeof (int32) * (1 + 2 * n_columns);
+
+		for (int i = 0; i < n_columns; i++) {
+			unowned string str = cursor.get_string (i);
+
+			size += (str != null ? str.length : 0) + 1;
+		}
+
+		return size;
+	}
+
 	public async string[] query (BusName sender, string query, UnixOutputStream output_stream) throws Error {
 		var request = DBusRequest.begin (sender, "Steroids.Query");
 		request.debug ("query: %s", query);
 		try {
 			string[] variable_names = null;
 
-			yield Tracker.Store.sparql_query (query, Tracker.Store.Priority.HIGH, cursor => {
+			yield Tracker.Store.sparql_query (query, Tracker.Store.Priority.HIGH, (cursor, profile) => {
 				var data_output_stream = new DataOutputStream (new BufferedOutputStream.sized (output_stream, BUFFER_SIZE));
 				data_output_stream.set_byte_order (DataStreamByteOrder.HOST_ENDIAN);
 
@@ -73,6 +88,8 @@ public class Tracker.Steroids : Object {
 						data_output_stream.put_string (column_data[i] != null ? column_data[i] : "");
 						data_output_stream.put_byte (0);
 					}
+
+					profile.add_row (sizeof (int32) * (1 + 2 * n_columns) + last_offset + 1);
 				}
 			}, sender);
 
@@ -232,4 +249,100 @@ public class Tracker.Steroids : Object {
 			}
 		}
 	}
+
+	public async Variant update_array_with_triples (BusName sender, UnixInputStream input_stream) throws Error {
+		var request = DBusRequest.begin (sender, "Steroids.UpdateArrayWithTriples");
+		try {
+			var data_input_stream = new DataInputStream (input_stream);
+			data_input_stream.set_buffer_size (BUFFER_SIZE);
+			data_input_stream.set_byte_order (DataStreamByteOrder.HOST_ENDIAN);
+
+			int query_count = data_input_stream.read_int32 ();
+
+			string[] query_array = new string[query_count];
+			Variant[] triples_array = new Variant[query_count];
+
+			int i;
+			for (i = 0; i < query_count; i++) {
+				query_array[i] = read_string (data_input_stream);
+
+				request.debug ("query: %s", query_array[i]);
+
+				// triples inserted after the update, see
+				// tracker_sparql_builder_get_triples()
+				int triple_count = data_input_stream.read_int32 ();
+				var triples = new VariantBuilder ((VariantType) "a(ssssb)");
+
+				for (int j = 0; j < triple_count; j++) {
+					string graph = read_string (data_input_stream);
+					string subject = read_string (data_input_stream);
+					string predicate = read_string (data_input_stream);
+					string object = read_string (data_input_stream);
+					bool object_is_iri = (data_input_stream.read_byte () != 0);
+
+					triples.add ("(ssssb)", graph, subject, predicate, object, object_is_iri);
+				}
+
+				triples_array[i] = triples.end ();
+			}
+
+			data_input_stream = null;
+
+			var builder = new VariantBuilder ((VariantType) "as");
+
+			// first try all updates in one transaction for best possible performance
+			try {
+				yield Tracker.Store.sparql_update_with_triples (query_array, new Variant.array ((VariantType) "a(ssssb)", triples_array), Tracker.Store.Priority.LOW, sender);
+
+				for (i = 0; i < query_count; i++) {
+					builder.add ("s", "");
+					builder.add ("s", "");
+				}
+
+				request.end ();
+
+				return builder.end ();
+			} catch {
+				// combined update was not successful
+			}
+
+			// try updates one by one
+			for (i = 0; i < query_count; i++) {
+				request.debug ("query: %s", query_array[i]);
+
+				try {
+					yield Tracker.Store.sparql_update_with_triples ({ query_array[i] }, new Variant.array ((VariantType) "a(ssssb)", { triples_array[i] }), Tracker.Store.Priority.LOW, sender);
+					builder.add ("s", "");
+					builder.add ("s", "");
+				} catch (Error e1) {
+					builder.add ("s", "org.freedesktop.Tracker1.SparqlError.Internal");
+					builder.add ("s", e1.message);
+				}
+			}
+
+			request.end ();
+
+			return builder.end ();
+		} catch (Error e) {
+			request.end (e);
+			if (e is Sparql.Error) {
+				throw e;
+			} else {
+				throw new Sparql.Error.INTERNAL (e.message);
+			}
+		}
+	}
+
+	string read_string (DataInputStream data_input_stream) throws Error {
+		size_t bytes_read;
+
+		int size = data_input_stream.read_int32 ();
+
+		/* We malloc one more char to ensure string is 0 terminated */
+		var str = (string) new uint8[size + 1];
+
+		data_input_stream.read_all (((uint8[]) str)[0:size], out bytes_read);
+
+		return str;
+	}
 }
@@ -24,6 +24,17 @@ public class Tracker.Store {
 
 	const int MAX_TASK_TIME = 30;
 
+	// WAL size at which updates are blocked until a checkpoint completes,
+	// unless TRACKER_STORE_MAX_WAL_SIZE gives it in megabytes
+	const int DEFAULT_MAX_WAL_PAGES = 10000;
+	// smallest WAL worth a passive checkpoint while no query is running
+	const int IDLE_CHECKPOINT_PAGES = 100;
+	// passive checkpoints start early enough for the WAL to stay below
+	// its maximum size for that many seconds at the current write rate
+	const double CHECKPOINT_LOOKAHEAD = 5.0;
+	// seconds without updates after which the WAL is checkpointed
+	const int IDLE_CHECKPOINT_DELAY = 2;
+
 	static Queue<Task> query_queues[3 /* TRACKER_STORE_N_PRIORITIES */];
 	static Queue<Task> update_queues[3 /* TRACKER_STORE_N_PRIORITIES */];
 	static int n_queries_running;
@@ -33,8 +44,11 @@ public class Tracker.Store {
 	static ThreadPool<bool> checkpoint_pool;
 	static GenericArray<Task> running_tasks;
 	static int max_task_time;
+	static double slow_query_time;
 	static bool active;
 	static SourceFunc active_callback;
+	static int max_wal_pages;
+	static uint idle_checkpoint_id;
 
 	public enum Priority {
 		HIGH,
@@ -47,10 +61,78 @@ public class Tracker.Store {
 		QUERY,
 		UPDATE,
 		UPDATE_BLANK,
+		UPDATE_TRIPLES,
 		TURTLE,
 	}
 
-	public delegate void SparqlQueryInThread (DBCursor cursor) throws Error;
+	public delegate void SparqlQueryInThread (DBCursor cursor, QueryProfile profile) throws Error;
+
+	// Where the time of a query is spent, as returned by SparqlExplain and
+	// written to the slow query log, times are in seconds
+	public class QueryProfile {
+		public string query;
+		public string? sql;
+		public string? plan;
+		public double parse_time;
+		public double translate_time;
+		public double prepare_time;
+		// time to step to the first row
+		public double first_row_time;
+		public double total_time;
+		public int64 n_rows;
+		// size of the results on the Steroids pipe
+		public int64 n_bytes;
+
+		Timer timer = new Timer ();
+
+		public void start_rows () {
+			timer.start ();
+		}
+
+		// called by the query callback for every row it reads
+		public void add_row (size_t row_size) {
+			if (n_rows == 0) {
+				first_row_time = timer.elapsed ();
+			}
+			n_rows++;
+			n_bytes += row_size;
+		}
+
+		public void end_rows () {
+			if (n_rows == 0) {
+				first_row_time = timer.elapsed ();
+			}
+		}
+
+		public Variant to_variant () {
+			var builder = new VariantBuilder ((VariantType) "aas");
+
+			add_value (builder, "sql", sql ?? "");
+			add_value (builder, "plan", plan ?? "");
+			add_value (builder, "parse-time", parse_time.to_string ());
+			add_value (builder, "translate-time", translate_time.to_string ());
+			add_value (builder, "prepare-time", prepare_time.to_string ());
+			add_value (builder, "first-row-time", first_row_time.to_string ());
+			add_value (builder, "total-time", total_time.to_string ());
+			add_value (builder, "rows", n_rows.to_string ());
+			add_value (builder, "steroids-bytes", n_bytes.to_string ());
+
+			return builder.end ();
+		}
+
+		static void add_value (VariantBuilder builder, string name, string value) {
+			builder.open ((VariantType) "as");
+			builder.add ("s", name);
+			builder.add ("s", value);
+			builder.close ();
+		}
+
+		public string to_string () {
+			return "%s\n  parse: %f s, translate: %f s, prepare: %f s, first row: %f s, total: %f s, %s rows, %s bytes\n%s".printf (
+				query, parse_time, translate_time, prepare_time, first_row_time, total_time,
+				n_rows.to_string (), n_bytes.to_string (), plan ?? "");
+		}
+	}
 
 	abstract class Task {
 		public TaskType type;
@@ -76,10 +158,15 @@ public class Tracker.Store {
 		public string query;
 		public Variant blank_nodes;
 		public Priority priority;
+		// only for UPDATE_TRIPLES
+		public string[] queries;
+		public Variant triples;
 	}
 
 	class TurtleTask : Task {
 		public string path;
+		public TurtleImport importer;
+		public bool finished;
 	}
 
 	static void sched () {
@@ -110,7 +197,7 @@ public class Tracker.Store {
 				});
 			}
 
-			n_queries_running++;
+			AtomicInt.inc (ref n_queries_running);
 			try {
 				query_pool.push (task);
 			} catch (Error e) {
@@ -140,6 +227,7 @@ public class Tracker.Store {
 		switch (task.type) {
 			case TaskType.UPDATE:
 			case TaskType.UPDATE_BLANK:
+			case TaskType.UPDATE_TRIPLES:
 				if (((UpdateTask) task).priority == Priority.HIGH) {
 					return Tracker.Data.CommitType.REGULAR;
 				} else if (update_queues[Priority.LOW].get_length () > 0) {
@@ -148,7 +236,7 @@ public class Tracker.Store {
 					return Tracker.Data.CommitType.BATCH_LAST;
 				}
 			case TaskType.TURTLE:
-				if (update_queues[Priority.TURTLE].get_length () > 0) {
+				if (!((TurtleTask) task).finished || update_queues[Priority.TURTLE].get_length () > 0) {
 					return Tracker.Data.CommitType.BATCH;
 				} else {
 					return Tracker.Data.CommitType.BATCH_LAST;
@@ -175,8 +263,13 @@ public class Tracker.Store {
 			task.error = null;
 
 			running_tasks.remove (task);
-			n_queries_running--;
-		} else if (task.type == TaskType.UPDATE || task.type == TaskType.UPDATE_BLANK) {
+			if (AtomicInt.dec_and_test (ref n_queries_running)) {
+				// checkpoint while no query competes for the disk
+				if (AtomicInt.get (ref wal_pages) >= IDLE_CHECKPOINT_PAGES) {
+					start_checkpoint ();
+				}
+			}
+		} else if (task.type == TaskType.UPDATE || task.type == TaskType.UPDATE_BLANK || task.type == TaskType.UPDATE_TRIPLES) {
 			if (task.error == null) {
 				Tracker.Data.notify_transaction (commit_type (task));
 			}
@@ -185,15 +278,30 @@ public class Tracker.Store {
 			task.error = null;
 
 			update_running = false;
+			schedule_idle_checkpoint ();
 		} else if (task.type == TaskType.TURTLE) {
+			var turtle_task = (TurtleTask) task;
+
 			if (task.error == null) {
 				Tracker.Data.notify_transaction (commit_type (task));
 			}
 
-			task.callback ();
-			task.error = null;
+			if (task.error == null && !turtle_task.finished) {
+				/* only one batch is imported at a time so that other
+				   updates can run in between, continue with this file
+				   before any other queued import */
+				update_queues[Priority.TURTLE].push_head (task);
+				report_import_progress (turtle_task.importer.progress);
+			} else {
+				turtle_task.importer = null;
+				report_import_progress (1);
+
+				task.callback ();
+				task.error = null;
+			}
 
 			update_running = false;
+			schedule_idle_checkpoint ();
 		}
 
 		if (n_queries_running == 0 && !update_running && active_callback != null) {
@@ -205,14 +313,48 @@ public class Tracker.Store {
 		return false;
 	}
 
+	static void report_import_progress (double progress) {
+		var notifier = (Status) Tracker.DBus.get_object (typeof (Status));
+
+		if (notifier != null) {
+			var busy_callback = notifier.get_callback ();
+			busy_callback (progress < 1 ? "Importing data" : "Idle", progress);
+		}
+	}
+
 	static void pool_dispatch_cb (Task task) {
 		try {
 			if (task.type == TaskType.QUERY) {
 				var query_task = (QueryTask) task;
-
-				var cursor = Tracker.Data.query_sparql_cursor (query_task.query);
-
-				query_task.in_thread (cursor);
+				var timer = new Timer ();
+
+				var query = new Sparql.Query (query_task.query);
+				var cursor = query.execute_cursor (false);
+
+				var profile = new QueryProfile ();
+				profile.query = query_task.query;
+				profile.sql = query.generated_sql;
+				profile.parse_time = query.parse_time;
+				profile.translate_time = query.translate_time;
+				profile.prepare_time = query.prepare_time;
+
+				profile.start_rows ();
+				query_task.in_thread (cursor, profile);
+				profile.end_rows ();
+
+				profile.total_time = timer.elapsed ();
+
+				if (slow_query_time > 0 && profile.total_time >= slow_query_time) {
+					if (profile.plan == null) {
+						// the query succeeded, don't fail it for the log
+						try {
+							profile.plan = new Sparql.Query (query_task.query).explain ();
+						} catch (Error e) {
+							debug ("Could not explain slow query: %s", e.message);
+						}
+					}
+					message ("Slow query: %s", profile.to_string ());
+				}
 			} else {
 				var iface = DBManager.get_db_interface ();
 				iface.sqlite_wal_hook (wal_hook);
@@ -225,14 +367,20 @@ public class Tracker.Store {
 					var update_task = (UpdateTask) task;
 
 					update_task.blank_nodes = Tracker.Data.update_sparql_blank (update_task.query);
+				} else if (task.type == TaskType.UPDATE_TRIPLES) {
+					var update_task = (UpdateTask) task;
+
+					Tracker.Data.update_array_with_triples (update_task.queries, update_task.triples);
 				} else if (task.type == TaskType.TURTLE) {
 					var turtle_task = (TurtleTask) task;
 
-					var file = File.new_for_path (turtle_task.path);
+					if (turtle_task.importer == null) {
+						turtle_task.importer = new TurtleImport (turtle_task.path);
+					}
 
 					Tracker.Events.freeze ();
 					try {
-						Tracker.Data.load_turtle_file (file);
+						turtle_task.finished = !turtle_task.importer.import_batch ();
 					} finally {
 						Tracker.Events.reset_pending ();
 					}
@@ -248,41 +396,144 @@ public class Tracker.Store {
 		});
 	}
 
+	static int checkpointing;
+	// pages in the WAL as of the last commit
+	static int wal_pages;
+	// time spent checkpointing in milliseconds, and number of checkpoints
+	static int checkpoint_time;
+	static int n_checkpoints;
+	static int n_blocking_checkpoints;
+
+	// only used in the update thread
+	static Timer write_timer;
+	static int last_wal_pages;
+	static double write_rate;
+
 	public static void wal_checkpoint () {
 		try {
 			debug ("Checkpointing database...");
+			var timer = new Timer ();
 			var iface = DBManager.get_db_interface ();
 			iface.execute_query ("PRAGMA wal_checkpoint");
-			debug ("Checkpointing complete...");
+
+			int elapsed = (int) (timer.elapsed () * 1000);
+			AtomicInt.add (ref checkpoint_time, elapsed);
+			AtomicInt.inc (ref n_checkpoints);
+			AtomicInt.set (ref wal_pages, 0);
+			debug ("Checkpointing complete in %d ms", elapsed);
 		} catch (Error e) {
 			warning (e.message);
 		}
 	}
 
-	static int checkpointing;
+	static void start_checkpoint () {
+		if (AtomicInt.compare_and_exchange (ref checkpointing, 0, 1)) {
+			// initiate asynchronous checkpointing (not blocking updates)
+			try {
+				checkpoint_pool.push (true);
+			} catch (Error e) {
+				warning (e.message);
+				AtomicInt.set (ref checkpointing, 0);
+			}
+		}
+	}
+
+	static int get_max_wal_pages () {
+		// run in update thread
+
+		if (max_wal_pages == 0) {
+			string max_wal_size_env = Environment.get_variable ("TRACKER_STORE_MAX_WAL_SIZE");
+			int64 max_wal_size = 0;
+			int page_size = 0;
+
+			max_wal_pages = DEFAULT_MAX_WAL_PAGES;
+
+			if (max_wal_size_env != null) {
+				unowned string end;
+				max_wal_size = max_wal_size_env.to_int64 (out end, 10);
+
+				if (max_wal_size_env == "" || end != "" || max_wal_size <= 0) {
+					warning ("Ignoring TRACKER_STORE_MAX_WAL_SIZE '%s', expected a size in megabytes", max_wal_size_env);
+					max_wal_size = 0;
+				}
+			}
+
+			if (max_wal_size > 0) {
+				try {
+					var iface = DBManager.get_db_interface ();
+					var cursor = iface.create_statement (DBStatementCacheType.NONE, "PRAGMA page_size").start_cursor ();
+					if (cursor.next ()) {
+						page_size = (int) cursor.get_integer (0);
+					}
+				} catch (Error e) {
+					warning (e.message);
+				}
+			}
+
+			if (page_size > 0) {
+				int64 pages = int64.min (max_wal_size, int.MAX) * 1024 * 1024 / page_size;
+				max_wal_pages = (int) int64.max (int64.min (pages, int.MAX), IDLE_CHECKPOINT_PAGES);
+			}
+		}
+
+		return max_wal_pages;
+	}
 
 	static void wal_hook (int n_pages) {
 		// run in update thread
 
 		debug ("WAL: %d pages", n_pages);
 
-		if (n_pages >= 10000) {
+		AtomicInt.set (ref wal_pages, n_pages);
+
+		// pages written per second, averaged over the last commits
+		if (write_timer == null) {
+			write_timer = new Timer ();
+		} else {
+			int written = (n_pages >= last_wal_pages) ? n_pages - last_wal_pages : n_pages;
+			double elapsed = double.max (write_timer.elapsed (), 0.001);
+			write_rate = 0.7 * write_rate + 0.3 * (written / elapsed);
+			write_timer.start ();
+		}
+		last_wal_pages = n_pages;
+
+		int max_pages = get_max_wal_pages ();
+
+		if (n_pages >= max_pages) {
 			// do immediate checkpointing (blocking updates)
 			// to prevent excessive wal file growth
+			var timer = new Timer ();
 			wal_checkpoint ();
-		} else if (n_pages >= 1000) {
-			if (AtomicInt.compare_and_exchange (ref checkpointing, 0, 1)) {
-				// initiate asynchronous checkpointing (not blocking updates)
-				try {
-					checkpoint_pool.push (true);
-				} catch (Error e) {
-					warning (e.message);
-					AtomicInt.set (ref checkpointing, 0);
-				}
+			AtomicInt.inc (ref n_blocking_checkpoints);
+			debug ("WAL reached %d pages, updates were blocked for %f s while checkpointing", n_pages, timer.elapsed ());
+		} else if (n_pages >= IDLE_CHECKPOINT_PAGES) {
+			if (AtomicInt.get (ref n_queries_running) == 0 ||
+			    n_pages + write_rate * CHECKPOINT_LOOKAHEAD >= max_pages) {
+				// nobody is waiting for queries, or the WAL
+				// would soon grow to its maximum size
+				start_checkpoint ();
 			}
 		}
 	}
 
+	static void schedule_idle_checkpoint () {
+		// checkpoint the rest of the WAL once updates stop
+
+		if (idle_checkpoint_id != 0) {
+			Source.remove (idle_checkpoint_id);
+		}
+
+		idle_checkpoint_id = Timeout.add_seconds (IDLE_CHECKPOINT_DELAY, () => {
+			idle_checkpoint_id = 0;
+
+			if (!update_running && AtomicInt.get (ref wal_pages) > 0) {
+				start_checkpoint ();
+			}
+
+			return false;
+		});
+	}
+
 	static void checkpoint_dispatch_cb (bool task) {
 		// run in checkpoint thread
 
@@ -298,6 +549,12 @@ public class Tracker.Store {
 			max_task_time = MAX_TASK_TIME;
 		}
 
+		// queries taking longer than this many milliseconds are logged
+		string slow_query_time_env = Environment.get_variable ("TRACKER_STORE_SLOW_QUERY_TIME");
+		if (slow_query_time_env != null) {
+			slow_query_time = int.parse (slow_query_time_env) / 1000.0;
+		}
+
 		running_tasks = new GenericArray<Task> ();
 
 		for (int i = 0; i < Priority.N_PRIORITIES; i++) {
@@ -325,6 +582,16 @@ public class Tracker.Store {
 		update_pool = null;
 		checkpoint_pool = null;
 
+		if (idle_checkpoint_id != 0) {
+			Source.remove (idle_checkpoint_id);
+			idle_checkpoint_id = 0;
+		}
+
+		message ("Spent %f s in %d WAL checkpoints, %d of them blocking updates",
+		         AtomicInt.get (ref checkpoint_time) / 1000.0,
+		         AtomicInt.get (ref n_checkpoints),
+		         AtomicInt.get (ref n_blocking_checkpoints));
+
 		for (int i = 0; i < Priority.N_PRIORITIES; i++) {
 			query_queues[i] = null;
 			update_queues[i] = null;
@@ -391,6 +658,26 @@ public class Tracker.Store {
 		return task.blank_nodes;
 	}
 
+	public static async void sparql_update_with_triples (string[] sparql, Variant triples, Priority priority, string client_id) throws Error {
+		var task = new UpdateTask ();
+		task.type = TaskType.UPDATE_TRIPLES;
+		task.queries = sparql;
+		task.triples = triples;
+		task.priority = priority;
+		task.callback = sparql_update_with_triples.callback;
+		task.client_id = client_id;
+
+		update_queues[priority].push_tail (task);
+
+		sched ();
+
+		yield;
+
+		if (task.error != null) {
+			throw task.error;
+		}
+	}
+
 	public static async void queue_turtle_import (File file, string client_id) throws Error {
 		var task = new TurtleTask ();
 		task.type = TaskType.TURTLE;
@@ -28,6 +28,7 @@
 #include <glib/gi18n.h>
 
 #include <libtracker-sparql/tracker-sparql.h>
+#include <libtracker-data/tracker-data.h>
 
 #define ABOUT \
 	"Tracker " PACKAGE_VERSION "\n"
@@ -51,6 +52,7 @@ static gboolean parse_list_indexes  (const gchar  *option_name,
 static gchar *file;
 static gchar *query;
 static gboolean update;
+static gboolean explain;
 static gboolean list_classes;
 static gboolean list_class_prefixes;
 static gchar *list_properties;
@@ -72,6 +74,10 @@ static GOptionEntry   entries[] = {
 	  N_("This is used with --query and for database updates only."),
 	  NULL,
 	},
+	{ "explain", 'e', 0, G_OPTION_ARG_NONE, &explain,
+	  N_("Show how the query would be executed instead of running it. This is used with --query or --file."),
+	  NULL,
+	},
 	{ "list-classes", 'c', 0, G_OPTION_ARG_NONE, &list_classes,
 	  N_("Retrieve classes"),
 	  NULL,
@@ -103,6 +109,36 @@ static GOptionEntry   entries[] = {
 	{ NULL }
 };
 
+static gboolean
+explain_query (const gchar  *query,
+               GError      **error)
+{
+	gchar *plan;
+
+	/* Plans are made by the query translator, which runs in
+	 * this process as with direct access */
+	if (!tracker_data_manager_init (TRACKER_DB_MANAGER_READONLY,
+	                                NULL, NULL, FALSE, FALSE,
+	                                100, 0,
+	                                NULL, NULL, NULL,
+	                                error)) {
+		return FALSE;
+	}
+
+	plan = tracker_data_query_explain (query, error);
+
+	tracker_data_manager_shutdown ();
+
+	if (!plan) {
+		return FALSE;
+	}
+
+	g_print ("%s", plan);
+	g_free (plan);
+
+	return TRUE;
+}
+
 static gchar *
 get_class_from_prefix (TrackerSparqlConnection *connection,
                        const gchar             *prefix)
@@ -259,6 +295,8 @@ main (int argc, char **argv)
 		error_message = _("An argument must be supplied");
 	} else if (file && query) {
 		error_message = _("File and query can not be used together");
+	} else if (explain && (update || (!file && !query))) {
+		error_message = _("Explain can only be used with a query");
 	} else {
 		error_message = NULL;
 	}
@@ -552,7 +590,17 @@ main (int argc, char **argv)
 	}
 
 	if (query) {
-		if (G_UNLIKELY (update)) {
+		if (G_UNLIKELY (explain)) {
+			if (!explain_query (query, &error)) {
+				g_printerr ("%s, %s\n",
+				            _("Could not explain query"),
+				            error ? error->message : _("No error given"));
+				g_clear_error (&error);
+				g_object_unref (connection);
+
+				return EXIT_FAILURE;
+			}
+		} else if (G_UNLIKELY (update)) {
 			tracker_sparql_connection_update (connection, query, 0, NULL, &error);
 
 			if (error) {
@@ -27,6 +27,7 @@
 #include <libtracker-common/tracker-log.h>
 
 #include "tracker-writeback.h"
+#include "tracker-writeback-journal.h"
 #include "tracker-config.h"
 
 #define ABOUT	  \
@@ -82,8 +83,8 @@ main (int   argc,
 	GOptionContext *context;
 	GMainLoop *loop;
 	GError *error = NULL;
-	gchar *log_filename;
-	guint shutdown_timeout;
+	gchar *log_filename, *journal_dir;
+	guint shutdown_timeout, n_journals;
 
 	g_type_init ();
 
@@ -122,6 +123,17 @@ main (int   argc,
 
 	sanity_check_option_values (config);
 
+	/* Roll back in place updates interrupted by a crash before
+	 * any new one is started.
+	 */
+	journal_dir = tracker_writeback_journal_get_default_dir ();
+	n_journals = tracker_writeback_journal_rollback (journal_dir);
+	g_free (journal_dir);
+
+	if (n_journals > 0) {
+		g_message ("Rolled back %u interrupted metadata updates", n_journals);
+	}
+
 	if (disable_shutdown) {
 		shutdown_timeout = 0;
 	} else {
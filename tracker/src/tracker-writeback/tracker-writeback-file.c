@@ -20,14 +20,19 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
 #include <fcntl.h> /* O_WRONLY */
+#include <sys/stat.h>
 
+#include <glib/gstdio.h>
 #include <gio/gunixoutputstream.h>
 
 #include <libtracker-common/tracker-file-utils.h>
 #include <libtracker-common/tracker-common.h>
 
 #include "tracker-writeback-file.h"
+#include "tracker-writeback-journal.h"
 
 static gboolean tracker_writeback_file_update_metadata (TrackerWriteback         *writeback,
                                                         GPtrArray                *values,
@@ -50,6 +55,28 @@ tracker_writeback_file_init (TrackerWritebackFile *writeback_file)
 {
 }
 
+static gchar *
+create_temporary_path (GFile *file)
+{
+	GFile *parent;
+	gchar *dir, *name, *tmp_path;
+
+	/* Keep the original name as suffix, libraries guess the
+	 * file format from the extension.
+	 */
+	parent = g_file_get_parent (file);
+	dir = g_file_get_path (parent);
+	g_object_unref (parent);
+
+	name = g_file_get_basename (file);
+	tmp_path = g_strdup_printf ("%s" G_DIR_SEPARATOR_S ".tracker-XXXXXX.%s",
+	                            dir, name);
+	g_free (dir);
+	g_free (name);
+
+	return tmp_path;
+}
+
 static GFile *
 create_temporary_file (GFile      *file,
                        GFileInfo  *file_info,
@@ -57,8 +84,8 @@ create_temporary_file (GFile      *file,
 {
 	GInputStream *input_stream;
 	GOutputStream *output_stream;
-	GFile *tmp_file, *parent;
-	gchar *dir, *name, *tmp_path;
+	GFile *tmp_file;
+	gchar *tmp_path;
 	guint32 mode;
 	gint fd;
 	GError *error = NULL;
@@ -89,15 +116,7 @@ create_temporary_file (GFile      *file,
 	}
 
 	/* Create output stream in a tmp file */
-	parent = g_file_get_parent (file);
-	dir = g_file_get_path (parent);
-	g_object_unref (parent);
-
-	name = g_file_get_basename (file);
-	tmp_path = g_strdup_printf ("%s" G_DIR_SEPARATOR_S ".tracker-XXXXXX.%s",
-	                            dir, name);
-	g_free (dir);
-	g_free (name);
+	tmp_path = create_temporary_path (file);
 
 	mode = g_file_info_get_attribute_uint32 (file_info,
 	                                         G_FILE_ATTRIBUTE_UNIX_MODE);
@@ -130,6 +149,223 @@ create_temporary_file (GFile      *file,
 	return tmp_file;
 }
 
+static gboolean
+read_region (GInputStream  *stream,
+             goffset        offset,
+             guchar        *buffer,
+             gsize          size,
+             GError       **error)
+{
+	gsize bytes_read;
+
+	if (!g_seekable_seek (G_SEEKABLE (stream), offset, G_SEEK_SET, NULL, error) ||
+	    !g_input_stream_read_all (stream, buffer, size, &bytes_read, NULL, error)) {
+		return FALSE;
+	}
+
+	if (bytes_read != size) {
+		g_set_error (error,
+		             G_IO_ERROR,
+		             G_IO_ERROR_FAILED,
+		             "Short read, expected %" G_GSIZE_FORMAT " bytes, got %" G_GSIZE_FORMAT,
+		             size, bytes_read);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Updates the metadata without rewriting the whole file: the
+ * regions declared by the module are copied into a small shadow
+ * file, the module updates that one, and if its size didn't change
+ * (i.e. the new metadata fit in the existing padding) the modified
+ * bytes are written back into the original file and synced. The
+ * old regions are journaled first, so a crash in between is rolled
+ * back on the next start.
+ *
+ * Returns FALSE without setting @error if the file has to go
+ * through the regular copy path instead. @error is only set if
+ * the original file could be left modified.
+ */
+static gboolean
+update_file_in_place (TrackerWritebackFile     *writeback_file,
+                      GFile                    *file,
+                      goffset                   file_size,
+                      goffset                   head_size,
+                      goffset                   tail_size,
+                      GPtrArray                *values,
+                      TrackerSparqlConnection  *connection,
+                      GCancellable             *cancellable,
+                      GError                  **error)
+{
+	TrackerWritebackFileClass *writeback_file_class;
+	GInputStream *input_stream;
+	GOutputStream *output_stream;
+	GFile *shadow_file = NULL;
+	gchar *path = NULL, *shadow_path = NULL;
+	gchar *journal_dir = NULL, *journal_path = NULL;
+	gchar *new_data = NULL;
+	guchar *old_data;
+	gsize region_size, new_size;
+	struct stat st;
+	gboolean retval = FALSE;
+	GError *inner_error = NULL;
+	gint fd;
+
+	if (!g_file_is_native (file)) {
+		return FALSE;
+	}
+
+	writeback_file_class = TRACKER_WRITEBACK_FILE_GET_CLASS (writeback_file);
+	region_size = head_size + tail_size;
+	old_data = g_malloc (region_size);
+
+	input_stream = G_INPUT_STREAM (g_file_read (file, NULL, &inner_error));
+
+	if (!input_stream ||
+	    !read_region (input_stream, 0, old_data, head_size, &inner_error) ||
+	    !read_region (input_stream, file_size - tail_size,
+	                  old_data + head_size, tail_size, &inner_error)) {
+		goto out;
+	}
+
+	shadow_path = create_temporary_path (file);
+	fd = g_mkstemp_full (shadow_path, O_WRONLY, 0600);
+
+	if (fd == -1) {
+		g_set_error (&inner_error,
+		             G_IO_ERROR,
+		             g_io_error_from_errno (errno),
+		             "Could not create shadow file: %s",
+		             g_strerror (errno));
+		goto out;
+	}
+
+	shadow_file = g_file_new_for_path (shadow_path);
+	output_stream = g_unix_output_stream_new (fd, TRUE);
+
+	if (!g_output_stream_write_all (output_stream, old_data, region_size,
+	                                NULL, NULL, &inner_error) ||
+	    !g_output_stream_close (output_stream, NULL, &inner_error)) {
+		g_object_unref (output_stream);
+		goto out;
+	}
+
+	g_object_unref (output_stream);
+
+	if (!(writeback_file_class->update_file_metadata) (writeback_file,
+	                                                   shadow_file,
+	                                                   values,
+	                                                   connection,
+	                                                   cancellable,
+	                                                   &inner_error) ||
+	    !g_file_load_contents (shadow_file, NULL, &new_data, &new_size,
+	                           NULL, &inner_error)) {
+		goto out;
+	}
+
+	if (new_size != region_size) {
+		g_debug ("Metadata doesn't fit in the space available, "
+		         "rewriting the whole file");
+		goto out;
+	}
+
+	path = g_file_get_path (file);
+	fd = g_open (path, O_WRONLY, 0);
+
+	if (fd == -1) {
+		goto out;
+	}
+
+	if (fstat (fd, &st) != 0 || st.st_size != file_size) {
+		/* Changed under our feet, let the copy path deal with it */
+		close (fd);
+		goto out;
+	}
+
+	/* Nothing is written into the original file until the old
+	 * contents are safe, the copy path is used otherwise.
+	 */
+	journal_dir = tracker_writeback_journal_get_default_dir ();
+	journal_path = tracker_writeback_journal_create (journal_dir, path, file_size,
+	                                                 old_data, (guchar *) new_data,
+	                                                 head_size, tail_size,
+	                                                 &inner_error);
+
+	if (!journal_path) {
+		close (fd);
+		goto out;
+	}
+
+	if (!tracker_writeback_write_changed_region (fd, 0,
+	                                             old_data, (guchar *) new_data,
+	                                             head_size, &inner_error) ||
+	    !tracker_writeback_write_changed_region (fd, file_size - tail_size,
+	                                             old_data + head_size, (guchar *) new_data + head_size,
+	                                             tail_size, &inner_error) ||
+	    fsync (fd) != 0) {
+		GError *replay_error = NULL;
+
+		if (!inner_error) {
+			g_set_error (&inner_error,
+			             G_IO_ERROR,
+			             g_io_error_from_errno (errno),
+			             "Could not sync metadata to disk: %s",
+			             g_strerror (errno));
+		}
+
+		close (fd);
+
+		/* Restore the old contents and let the copy path retry,
+		 * if that fails too the journal is left for the next start.
+		 */
+		if (!tracker_writeback_journal_replay (journal_path, &replay_error)) {
+			g_warning ("Could not roll back metadata of '%s', %s",
+			           path, replay_error->message);
+			g_error_free (replay_error);
+			g_propagate_error (error, inner_error);
+			inner_error = NULL;
+		}
+
+		goto out;
+	}
+
+	close (fd);
+	retval = TRUE;
+
+	if (!tracker_writeback_journal_remove (journal_path, &inner_error)) {
+		/* The update is on disk, at worst it's rolled back on the next start */
+		g_warning ("Could not remove writeback journal '%s', %s",
+		           journal_path, inner_error->message);
+		g_clear_error (&inner_error);
+	}
+
+out:
+	if (inner_error) {
+		g_debug ("Could not update metadata in place, %s",
+		         inner_error->message);
+		g_error_free (inner_error);
+	}
+
+	if (shadow_file) {
+		g_file_delete (shadow_file, NULL, NULL);
+		g_object_unref (shadow_file);
+	}
+
+	if (input_stream) {
+		g_object_unref (input_stream);
+	}
+
+	g_free (journal_path);
+	g_free (journal_dir);
+	g_free (shadow_path);
+	g_free (path);
+	g_free (new_data);
+	g_free (old_data);
+
+	return retval;
+}
+
 static gboolean
 tracker_writeback_file_update_metadata (TrackerWriteback         *writeback,
                                         GPtrArray                *values,
@@ -181,6 +417,7 @@ tracker_writeback_file_update_metadata (TrackerWriteback         *writeback,
 
 	file_info = g_file_query_info (file,
 	                               G_FILE_ATTRIBUTE_UNIX_MODE ","
+	                               G_FILE_ATTRIBUTE_STANDARD_SIZE ","
 	                               G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE ","
 	                               G_FILE_ATTRIBUTE_ACCESS_CAN_WRITE,
 	                               G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
@@ -236,6 +473,39 @@ tracker_writeback_file_update_metadata (TrackerWriteback         *writeback,
 		return FALSE;
 	}
 
+	if (writeback_file_class->get_metadata_regions) {
+		goffset head_size = 0, tail_size = 0;
+
+		if ((writeback_file_class->get_metadata_regions) (TRACKER_WRITEBACK_FILE (writeback),
+		                                                  file,
+		                                                  mime_type,
+		                                                  &head_size,
+		                                                  &tail_size) &&
+		    head_size >= 0 && tail_size >= 0 &&
+		    head_size + tail_size < g_file_info_get_size (file_info)) {
+			retval = update_file_in_place (TRACKER_WRITEBACK_FILE (writeback),
+			                               file,
+			                               g_file_info_get_size (file_info),
+			                               head_size,
+			                               tail_size,
+			                               values,
+			                               connection,
+			                               cancellable,
+			                               &n_error);
+
+			if (retval || n_error) {
+				g_object_unref (file_info);
+				g_object_unref (file);
+
+				if (n_error) {
+					g_propagate_error (error, n_error);
+				}
+
+				return retval;
+			}
+		}
+	}
+
 	/* Copy to a temporary file so we can perform an atomic write on move */
 	tmp_file = create_temporary_file (file, file_info, &n_error);
 
@@ -51,6 +51,17 @@ struct TrackerWritebackFileClass {
 	                                                GError                  **error);
 	const gchar * const * (* content_types)        (TrackerWritebackFile     *writeback_file);
 
+	/* Optional. Returns TRUE if all metadata in @file, of type
+	 * @mime_type, lives in its first @head_size and last @tail_size
+	 * bytes, and update_file_metadata() keeps the file size unchanged
+	 * whenever the new metadata fits in the space (padding) already
+	 * reserved there. The file can then be updated in place.
+	 */
+	gboolean              (* get_metadata_regions) (TrackerWritebackFile     *writeback_file,
+	                                                GFile                    *file,
+	                                                const gchar              *mime_type,
+	                                                goffset                  *head_size,
+	                                                goffset                  *tail_size);
 };
 
 GType tracker_writeback_file_get_type (void) G_GNUC_CONST;
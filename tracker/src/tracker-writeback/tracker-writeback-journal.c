@@ -0,0 +1,524 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "tracker-writeback-journal.h"
+
+/* A journal is the magic, the size and path of the file, the head and
+ * tail regions as size + old contents + new contents, and the trailer.
+ * It is only complete, and the file only modified, once the trailer is
+ * on disk.
+ */
+#define JOURNAL_MAGIC   "TRKWBJ02"
+#define JOURNAL_TRAILER "TRKWBEND"
+#define JOURNAL_MARK_SIZE 8
+#define JOURNAL_SUFFIX  ".journal"
+
+static gboolean
+write_at (gint           fd,
+          const guchar  *data,
+          gsize          size,
+          goffset        offset,
+          GError       **error)
+{
+	while (size > 0) {
+		gssize written;
+
+		written = pwrite (fd, data, size, offset);
+
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			g_set_error (error,
+			             G_IO_ERROR,
+			             g_io_error_from_errno (errno),
+			             "Could not write metadata: %s",
+			             g_strerror (errno));
+			return FALSE;
+		}
+
+		data += written;
+		size -= written;
+		offset += written;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+sync_fd (gint     fd,
+         GError **error)
+{
+	if (fsync (fd) != 0) {
+		g_set_error (error,
+		             G_IO_ERROR,
+		             g_io_error_from_errno (errno),
+		             "Could not sync to disk: %s",
+		             g_strerror (errno));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Makes creating or removing a journal durable */
+static gboolean
+sync_dir (const gchar  *dir,
+          GError      **error)
+{
+	gboolean retval;
+	gint fd;
+
+	fd = g_open (dir, O_RDONLY, 0);
+
+	if (fd == -1) {
+		g_set_error (error,
+		             G_IO_ERROR,
+		             g_io_error_from_errno (errno),
+		             "Could not open '%s': %s",
+		             dir, g_strerror (errno));
+		return FALSE;
+	}
+
+	retval = sync_fd (fd, error);
+	close (fd);
+
+	return retval;
+}
+
+static void
+append_int64 (GByteArray *journal,
+              gint64      value)
+{
+	g_byte_array_append (journal, (const guint8 *) &value, sizeof (value));
+}
+
+static gboolean
+read_int64 (const gchar *contents,
+            gsize        length,
+            gsize       *pos,
+            gint64      *value)
+{
+	if (length - *pos < sizeof (gint64)) {
+		return FALSE;
+	}
+
+	memcpy (value, contents + *pos, sizeof (gint64));
+	*pos += sizeof (gint64);
+
+	return TRUE;
+}
+
+static gboolean
+read_data (const gchar   *contents,
+           gsize          length,
+           gsize         *pos,
+           gint64         size,
+           const guchar **data)
+{
+	if (size < 0 || length - *pos < (guint64) size) {
+		return FALSE;
+	}
+
+	*data = (const guchar *) contents + *pos;
+	*pos += size;
+
+	return TRUE;
+}
+
+static gboolean
+read_at (gint     fd,
+         guchar  *data,
+         gsize    size,
+         goffset  offset,
+         GError **error)
+{
+	while (size > 0) {
+		gssize n_read;
+
+		n_read = pread (fd, data, size, offset);
+
+		if (n_read < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			g_set_error (error,
+			             G_IO_ERROR,
+			             g_io_error_from_errno (errno),
+			             "Could not read metadata: %s",
+			             g_strerror (errno));
+			return FALSE;
+		} else if (n_read == 0) {
+			g_set_error (error,
+			             G_IO_ERROR,
+			             G_IO_ERROR_FAILED,
+			             "Could not read metadata: file was truncated");
+			return FALSE;
+		}
+
+		data += n_read;
+		size -= n_read;
+		offset += n_read;
+	}
+
+	return TRUE;
+}
+
+/* Whether every byte of the region at @offset still holds either its
+ * old or its new contents, which is all an interrupted update leaves.
+ */
+static gboolean
+region_matches (gint           fd,
+                goffset        offset,
+                const guchar  *old_data,
+                const guchar  *new_data,
+                gsize          size,
+                gboolean      *matches,
+                GError       **error)
+{
+	guchar *data;
+	gsize i;
+
+	data = g_malloc (size);
+
+	if (!read_at (fd, data, size, offset, error)) {
+		g_free (data);
+		return FALSE;
+	}
+
+	for (i = 0; i < size; i++) {
+		if (data[i] != old_data[i] && data[i] != new_data[i]) {
+			break;
+		}
+	}
+
+	*matches = (i == size);
+	g_free (data);
+
+	return TRUE;
+}
+
+static gboolean
+journal_parse (const gchar   *contents,
+               gsize          length,
+               gchar        **path,
+               gint64        *file_size,
+               const guchar **head,
+               const guchar **new_head,
+               gint64        *head_size,
+               const guchar **tail,
+               const guchar **new_tail,
+               gint64        *tail_size)
+{
+	const guchar *data;
+	gint64 path_len;
+	gsize pos;
+
+	if (length < 2 * JOURNAL_MARK_SIZE ||
+	    memcmp (contents, JOURNAL_MAGIC, JOURNAL_MARK_SIZE) != 0 ||
+	    memcmp (contents + length - JOURNAL_MARK_SIZE, JOURNAL_TRAILER, JOURNAL_MARK_SIZE) != 0) {
+		return FALSE;
+	}
+
+	pos = JOURNAL_MARK_SIZE;
+	length -= JOURNAL_MARK_SIZE;
+
+	if (!read_int64 (contents, length, &pos, file_size) ||
+	    !read_int64 (contents, length, &pos, &path_len) ||
+	    path_len <= 0 ||
+	    !read_data (contents, length, &pos, path_len, &data) ||
+	    !read_int64 (contents, length, &pos, head_size) ||
+	    !read_data (contents, length, &pos, *head_size, head) ||
+	    !read_data (contents, length, &pos, *head_size, new_head) ||
+	    !read_int64 (contents, length, &pos, tail_size) ||
+	    !read_data (contents, length, &pos, *tail_size, tail) ||
+	    !read_data (contents, length, &pos, *tail_size, new_tail) ||
+	    pos != length ||
+	    *head_size + *tail_size > *file_size) {
+		return FALSE;
+	}
+
+	*path = g_strndup ((const gchar *) data, path_len);
+
+	return TRUE;
+}
+
+gchar *
+tracker_writeback_journal_get_default_dir (void)
+{
+	return g_build_filename (g_get_user_data_dir (), "tracker", "writeback", NULL);
+}
+
+/* Writes and syncs a journal holding @old_data, the current contents
+ * of the first @head_size and last @tail_size bytes of @path, and
+ * @new_data, what they are about to be replaced with. Returns the path
+ * of the journal, which has to be removed once the new contents are
+ * synced.
+ */
+gchar *
+tracker_writeback_journal_create (const gchar   *journal_dir,
+                                  const gchar   *path,
+                                  goffset        file_size,
+                                  const guchar  *old_data,
+                                  const guchar  *new_data,
+                                  goffset        head_size,
+                                  goffset        tail_size,
+                                  GError       **error)
+{
+	GByteArray *journal;
+	gchar *checksum, *name, *journal_path;
+	gboolean success;
+	gint fd;
+
+	if (g_mkdir_with_parents (journal_dir, 0700) != 0) {
+		g_set_error (error,
+		             G_IO_ERROR,
+		             g_io_error_from_errno (errno),
+		             "Could not create journal directory '%s': %s",
+		             journal_dir, g_strerror (errno));
+		return NULL;
+	}
+
+	journal = g_byte_array_new ();
+	g_byte_array_append (journal, (const guint8 *) JOURNAL_MAGIC, JOURNAL_MARK_SIZE);
+	append_int64 (journal, file_size);
+	append_int64 (journal, strlen (path));
+	g_byte_array_append (journal, (const guint8 *) path, strlen (path));
+	append_int64 (journal, head_size);
+	g_byte_array_append (journal, old_data, head_size);
+	g_byte_array_append (journal, new_data, head_size);
+	append_int64 (journal, tail_size);
+	g_byte_array_append (journal, old_data + head_size, tail_size);
+	g_byte_array_append (journal, new_data + head_size, tail_size);
+	g_byte_array_append (journal, (const guint8 *) JOURNAL_TRAILER, JOURNAL_MARK_SIZE);
+
+	/* One journal per file, a leftover one is replaced */
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, path, -1);
+	name = g_strconcat (checksum, JOURNAL_SUFFIX, NULL);
+	journal_path = g_build_filename (journal_dir, name, NULL);
+	g_free (checksum);
+	g_free (name);
+
+	fd = g_open (journal_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+	if (fd == -1) {
+		g_set_error (error,
+		             G_IO_ERROR,
+		             g_io_error_from_errno (errno),
+		             "Could not create journal '%s': %s",
+		             journal_path, g_strerror (errno));
+		g_byte_array_unref (journal);
+		g_free (journal_path);
+		return NULL;
+	}
+
+	success = (write_at (fd, journal->data, journal->len, 0, error) &&
+	           sync_fd (fd, error));
+	close (fd);
+	g_byte_array_unref (journal);
+
+	if (!success || !sync_dir (journal_dir, error)) {
+		g_unlink (journal_path);
+		g_free (journal_path);
+		return NULL;
+	}
+
+	return journal_path;
+}
+
+gboolean
+tracker_writeback_journal_remove (const gchar  *journal_path,
+                                  GError      **error)
+{
+	gchar *dir;
+	gboolean retval;
+
+	if (g_unlink (journal_path) != 0 && errno != ENOENT) {
+		g_set_error (error,
+		             G_IO_ERROR,
+		             g_io_error_from_errno (errno),
+		             "Could not remove journal '%s': %s",
+		             journal_path, g_strerror (errno));
+		return FALSE;
+	}
+
+	/* Otherwise a finished update could be rolled back after a crash */
+	dir = g_path_get_dirname (journal_path);
+	retval = sync_dir (dir, error);
+	g_free (dir);
+
+	return retval;
+}
+
+/* Writes the old contents in @journal_path back into its file, then
+ * removes the journal. Files modified by something else since are
+ * left alone.
+ */
+gboolean
+tracker_writeback_journal_replay (const gchar  *journal_path,
+                                  GError      **error)
+{
+	const guchar *head, *new_head, *tail, *new_tail;
+	gint64 file_size, head_size, tail_size;
+	gchar *contents, *path;
+	gsize length;
+	struct stat st;
+	gboolean success, head_matches, tail_matches;
+	gint fd;
+
+	if (!g_file_get_contents (journal_path, &contents, &length, error)) {
+		return FALSE;
+	}
+
+	if (!journal_parse (contents, length, &path, &file_size,
+	                    &head, &new_head, &head_size,
+	                    &tail, &new_tail, &tail_size)) {
+		/* Interrupted while writing the journal, the file
+		 * itself wasn't modified yet.
+		 */
+		g_free (contents);
+		return tracker_writeback_journal_remove (journal_path, error);
+	}
+
+	fd = g_open (path, O_RDWR, 0);
+
+	if (fd == -1) {
+		if (errno != ENOENT) {
+			g_set_error (error,
+			             G_IO_ERROR,
+			             g_io_error_from_errno (errno),
+			             "Could not open '%s': %s",
+			             path, g_strerror (errno));
+			g_free (contents);
+			g_free (path);
+			return FALSE;
+		}
+
+		g_free (contents);
+		g_free (path);
+
+		return tracker_writeback_journal_remove (journal_path, error);
+	}
+
+	if (fstat (fd, &st) != 0 || st.st_size != file_size) {
+		/* Replaced since, the journal doesn't apply anymore */
+		g_message ("Size of '%s' changed, dropping its writeback journal", path);
+		success = TRUE;
+	} else if (!region_matches (fd, 0, head, new_head, head_size,
+	                            &head_matches, error) ||
+	           !region_matches (fd, file_size - tail_size, tail, new_tail, tail_size,
+	                            &tail_matches, error)) {
+		success = FALSE;
+	} else if (!head_matches || !tail_matches) {
+		/* Written by something else since, rolling back would
+		 * mix its contents with ours.
+		 */
+		g_message ("Metadata of '%s' changed, dropping its writeback journal", path);
+		success = TRUE;
+	} else {
+		success = (write_at (fd, head, head_size, 0, error) &&
+		           write_at (fd, tail, tail_size, file_size - tail_size, error) &&
+		           sync_fd (fd, error));
+	}
+
+	close (fd);
+	g_free (contents);
+	g_free (path);
+
+	return success && tracker_writeback_journal_remove (journal_path, error);
+}
+
+/* Rolls back the updates left unfinished in @journal_dir, returns
+ * the number of journals handled.
+ */
+guint
+tracker_writeback_journal_rollback (const gchar *journal_dir)
+{
+	GDir *dir;
+	const gchar *name;
+	guint n_journals = 0;
+
+	dir = g_dir_open (journal_dir, 0, NULL);
+
+	if (!dir) {
+		return 0;
+	}
+
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		GError *error = NULL;
+		gchar *journal_path;
+
+		if (!g_str_has_suffix (name, JOURNAL_SUFFIX)) {
+			continue;
+		}
+
+		journal_path = g_build_filename (journal_dir, name, NULL);
+
+		if (tracker_writeback_journal_replay (journal_path, &error)) {
+			n_journals++;
+		} else {
+			g_warning ("Could not roll back writeback journal '%s', %s",
+			           journal_path, error->message);
+			g_error_free (error);
+		}
+
+		g_free (journal_path);
+	}
+
+	g_dir_close (dir);
+
+	return n_journals;
+}
+
+/* Writes the smallest span of @new_data that differs from
+ * @old_data, usually just the updated tag frames.
+ */
+gboolean
+tracker_writeback_write_changed_region (gint           fd,
+                                        goffset        offset,
+                                        const guchar  *old_data,
+                                        const guchar  *new_data,
+                                        gsize          size,
+                                        GError       **error)
+{
+	gsize start, end;
+
+	for (start = 0; start < size && old_data[start] == new_data[start]; start++)
+		;
+
+	if (start == size) {
+		return TRUE;
+	}
+
+	for (end = size; end > start && old_data[end - 1] == new_data[end - 1]; end--)
+		;
+
+	return write_at (fd, new_data + start, end - start, offset + start, error);
+}
@@ -0,0 +1,53 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __TRACKER_WRITEBACK_JOURNAL_H__
+#define __TRACKER_WRITEBACK_JOURNAL_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Files updated in place keep the old and new contents of the regions
+ * being written in a journal until the new contents are synced to disk,
+ * so an interrupted update can be rolled back.
+ */
+gchar    *tracker_writeback_journal_get_default_dir (void);
+gchar    *tracker_writeback_journal_create          (const gchar   *journal_dir,
+                                                     const gchar   *path,
+                                                     goffset        file_size,
+                                                     const guchar  *old_data,
+                                                     const guchar  *new_data,
+                                                     goffset        head_size,
+                                                     goffset        tail_size,
+                                                     GError       **error);
+gboolean  tracker_writeback_journal_remove          (const gchar   *journal_path,
+                                                     GError       **error);
+gboolean  tracker_writeback_journal_replay          (const gchar   *journal_path,
+                                                     GError       **error);
+guint     tracker_writeback_journal_rollback        (const gchar   *journal_dir);
+
+gboolean  tracker_writeback_write_changed_region    (gint           fd,
+                                                     goffset        offset,
+                                                     const guchar  *old_data,
+                                                     const guchar  *new_data,
+                                                     gsize          size,
+                                                     GError       **error);
+
+G_END_DECLS
+
+#endif /* __TRACKER_WRITEBACK_JOURNAL_H__ */
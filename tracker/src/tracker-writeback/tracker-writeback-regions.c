@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2009, Nokia <ivan.frade@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "tracker-writeback-regions.h"
+
+#define JPEG_XMP_NAMESPACE "http://ns.adobe.com/xap/1.0/"
+
+static gboolean
+read_block (GInputStream *stream,
+            goffset       offset,
+            GSeekType     type,
+            guchar       *buffer,
+            gsize         size)
+{
+	gsize bytes_read;
+
+	return (g_seekable_seek (G_SEEKABLE (stream), offset, type, NULL, NULL) &&
+	        g_input_stream_read_all (stream, buffer, size, &bytes_read, NULL, NULL) &&
+	        bytes_read == size);
+}
+
+static gboolean
+has_id3v1_tag (GInputStream *stream,
+               goffset       file_size)
+{
+	guchar data[3];
+
+	return (file_size >= 128 &&
+	        read_block (stream, -128, G_SEEK_END, data, sizeof (data)) &&
+	        memcmp (data, "TAG", 3) == 0);
+}
+
+gboolean
+tracker_writeback_mpeg_get_metadata_regions (GInputStream *stream,
+                                             goffset       file_size,
+                                             goffset      *head_size,
+                                             goffset      *tail_size)
+{
+	guchar header[10], data[8];
+	goffset tag_size;
+
+	/* TagLib renders the ID3v2 tag into its original size as long
+	 * as it fits in the padding, new tags are inserted though.
+	 */
+	if (!read_block (stream, 0, G_SEEK_SET, header, sizeof (header)) ||
+	    memcmp (header, "ID3", 3) != 0) {
+		return FALSE;
+	}
+
+	tag_size = (((header[6] & 0x7f) << 21) |
+	            ((header[7] & 0x7f) << 14) |
+	            ((header[8] & 0x7f) << 7) |
+	            (header[9] & 0x7f)) + 10;
+
+	if (header[5] & 0x10) {
+		/* Footer present */
+		tag_size += 10;
+	}
+
+	/* An ID3v1 tag is always written, it has a fixed size though.
+	 * APE tags are rewritten as well and may grow.
+	 */
+	if (!has_id3v1_tag (stream, file_size) ||
+	    tag_size + 128 > file_size ||
+	    (file_size >= 128 + 32 &&
+	     read_block (stream, -128 - 32, G_SEEK_END, data, sizeof (data)) &&
+	     memcmp (data, "APETAGEX", 8) == 0)) {
+		return FALSE;
+	}
+
+	*tail_size = 128;
+	*head_size = MIN (tag_size + TRACKER_WRITEBACK_AUDIO_SAMPLE_SIZE,
+	                  file_size - *tail_size);
+
+	return TRUE;
+}
+
+gboolean
+tracker_writeback_flac_get_metadata_regions (GInputStream *stream,
+                                             goffset       file_size,
+                                             goffset      *head_size,
+                                             goffset      *tail_size)
+{
+	guchar header[4];
+	goffset offset;
+	gboolean last;
+
+	/* Files with a leading ID3v2 tag are left to the copy path */
+	if (!read_block (stream, 0, G_SEEK_SET, header, sizeof (header)) ||
+	    memcmp (header, "fLaC", 4) != 0) {
+		return FALSE;
+	}
+
+	/* All metadata blocks come before the audio frames, TagLib
+	 * takes the space for a grown Vorbis comment from the padding
+	 * block.
+	 */
+	offset = 4;
+
+	do {
+		if (!read_block (stream, offset, G_SEEK_SET, header, sizeof (header))) {
+			return FALSE;
+		}
+
+		last = (header[0] & 0x80) != 0;
+		offset += 4 + ((header[1] << 16) | (header[2] << 8) | header[3]);
+
+		if (offset > file_size) {
+			return FALSE;
+		}
+	} while (!last);
+
+	/* An existing ID3v1 tag is updated too */
+	*tail_size = has_id3v1_tag (stream, file_size) ? 128 : 0;
+
+	if (offset + *tail_size > file_size) {
+		return FALSE;
+	}
+
+	*head_size = MIN (offset + TRACKER_WRITEBACK_AUDIO_SAMPLE_SIZE,
+	                  file_size - *tail_size);
+
+	return TRUE;
+}
+
+gboolean
+tracker_writeback_jpeg_get_metadata_regions (GInputStream *stream,
+                                             goffset       file_size,
+                                             goffset      *head_size,
+                                             goffset      *tail_size)
+{
+	guchar marker[4], name[sizeof (JPEG_XMP_NAMESPACE)];
+	goffset offset;
+	gboolean has_xmp = FALSE;
+
+	/* Exempi overwrites an existing XMP packet if the new one fits
+	 * in its padding, all segments before the scan data are then
+	 * left untouched.
+	 */
+	if (!read_block (stream, 0, G_SEEK_SET, marker, 2) ||
+	    marker[0] != 0xff || marker[1] != 0xd8) {
+		return FALSE;
+	}
+
+	offset = 2;
+
+	while (read_block (stream, offset, G_SEEK_SET, marker, sizeof (marker)) &&
+	       marker[0] == 0xff) {
+		goffset length;
+
+		length = (marker[2] << 8) | marker[3];
+
+		if (marker[1] == 0xe1 &&
+		    length >= (goffset) (2 + sizeof (name)) &&
+		    read_block (stream, offset + 4, G_SEEK_SET, name, sizeof (name)) &&
+		    memcmp (name, JPEG_XMP_NAMESPACE, sizeof (name)) == 0) {
+			has_xmp = TRUE;
+		}
+
+		offset += 2 + length;
+
+		if (offset > file_size) {
+			return FALSE;
+		}
+
+		if (marker[1] == 0xda) {
+			/* Start of scan, no more metadata after this. A
+			 * missing packet has to be inserted though.
+			 */
+			if (!has_xmp) {
+				return FALSE;
+			}
+
+			*tail_size = 0;
+			*head_size = MIN (offset + TRACKER_WRITEBACK_JPEG_SAMPLE_SIZE,
+			                  file_size);
+
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2009, Nokia <ivan.frade@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __TRACKER_WRITEBACK_REGIONS_H__
+#define __TRACKER_WRITEBACK_REGIONS_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* Audio data kept after the tags when updating in place, so TagLib
+ * can still read the stream properties.
+ */
+#define TRACKER_WRITEBACK_AUDIO_SAMPLE_SIZE 8192
+
+/* Scan data kept after the JPEG headers when updating in place */
+#define TRACKER_WRITEBACK_JPEG_SAMPLE_SIZE 4096
+
+/* Container parsers behind TrackerWritebackFile::get_metadata_regions(),
+ * @stream must be seekable and @file_size is the size of the file it
+ * reads from.
+ */
+gboolean tracker_writeback_mpeg_get_metadata_regions (GInputStream *stream,
+                                                      goffset       file_size,
+                                                      goffset      *head_size,
+                                                      goffset      *tail_size);
+gboolean tracker_writeback_flac_get_metadata_regions (GInputStream *stream,
+                                                      goffset       file_size,
+                                                      goffset      *head_size,
+                                                      goffset      *tail_size);
+gboolean tracker_writeback_jpeg_get_metadata_regions (GInputStream *stream,
+                                                      goffset       file_size,
+                                                      goffset      *head_size,
+                                                      goffset      *tail_size);
+
+G_END_DECLS
+
+#endif /* __TRACKER_WRITEBACK_REGIONS_H__ */
@@ -25,10 +25,12 @@
 #include <taglib/tag_c.h>
 
 #include <glib-object.h>
+#include <gio/gio.h>
 
 #include <libtracker-common/tracker-ontologies.h>
 
 #include "tracker-writeback-file.h"
+#include "tracker-writeback-regions.h"
 
 #define TRACKER_TYPE_WRITEBACK_TAGLIB (tracker_writeback_taglib_get_type ())
 
@@ -51,6 +53,11 @@ static gboolean             writeback_taglib_update_file_metadata     (TrackerWr
                                                                        GCancellable             *cancellable,
                                                                        GError                   **error);
 static const gchar * const *writeback_taglib_content_types            (TrackerWritebackFile     *wbf);
+static gboolean             writeback_taglib_get_metadata_regions     (TrackerWritebackFile     *wbf,
+                                                                       GFile                    *file,
+                                                                       const gchar              *mime_type,
+                                                                       goffset                  *head_size,
+                                                                       goffset                  *tail_size);
 static gchar*               writeback_taglib_get_artist_name          (TrackerSparqlConnection  *connection,
                                                                        const gchar              *urn);
 static gchar*               writeback_taglib_get_album_name           (TrackerSparqlConnection  *connection,
@@ -65,6 +72,7 @@ tracker_writeback_taglib_class_init (TrackerWritebackTaglibClass *klass)
 
 	writeback_file_class->update_file_metadata = writeback_taglib_update_file_metadata;
 	writeback_file_class->content_types = writeback_taglib_content_types;
+	writeback_file_class->get_metadata_regions = writeback_taglib_get_metadata_regions;
 }
 
 static void
@@ -132,6 +140,54 @@ writeback_taglib_content_types (TrackerWritebackFile *wbf)
 	return content_types;
 }
 
+static gboolean
+writeback_taglib_get_metadata_regions (TrackerWritebackFile *writeback_file,
+                                       GFile                *file,
+                                       const gchar          *mime_type,
+                                       goffset              *head_size,
+                                       goffset              *tail_size)
+{
+	GInputStream *stream;
+	goffset file_size;
+	gboolean retval = FALSE;
+
+	stream = G_INPUT_STREAM (g_file_read (file, NULL, NULL));
+
+	if (!stream) {
+		return FALSE;
+	}
+
+	if (!g_seekable_seek (G_SEEKABLE (stream), 0, G_SEEK_END, NULL, NULL)) {
+		g_object_unref (stream);
+		return FALSE;
+	}
+
+	file_size = g_seekable_tell (G_SEEKABLE (stream));
+
+	if (g_strcmp0 (mime_type, "audio/flac") == 0 ||
+	    g_strcmp0 (mime_type, "audio/x-flac") == 0) {
+		retval = tracker_writeback_flac_get_metadata_regions (stream, file_size, head_size, tail_size);
+	} else if (g_strcmp0 (mime_type, "audio/mpeg") == 0 ||
+	           g_strcmp0 (mime_type, "audio/x-mpeg") == 0 ||
+	           g_strcmp0 (mime_type, "audio/mp3") == 0 ||
+	           g_strcmp0 (mime_type, "audio/x-mp3") == 0 ||
+	           g_strcmp0 (mime_type, "audio/mpeg3") == 0 ||
+	           g_strcmp0 (mime_type, "audio/x-mpeg3") == 0 ||
+	           g_strcmp0 (mime_type, "audio/mpg") == 0 ||
+	           g_strcmp0 (mime_type, "audio/x-mpg") == 0 ||
+	           g_strcmp0 (mime_type, "audio/x-mpegaudio") == 0) {
+		retval = tracker_writeback_mpeg_get_metadata_regions (stream, file_size, head_size, tail_size);
+	}
+
+	/* Ogg streams are paged and checksummed, and MP4 atoms may
+	 * live anywhere in the file, those are always copied.
+	 */
+
+	g_object_unref (stream);
+
+	return retval;
+}
+
 static gboolean
 writeback_taglib_update_file_metadata (TrackerWritebackFile     *writeback_file,
                                        GFile                    *file,
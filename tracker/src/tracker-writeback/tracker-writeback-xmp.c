@@ -35,6 +35,7 @@
 #include <libtracker-common/tracker-utils.h>
 
 #include "tracker-writeback-file.h"
+#include "tracker-writeback-regions.h"
 
 #define TRACKER_TYPE_WRITEBACK_XMP (tracker_writeback_xmp_get_type ())
 
@@ -57,6 +58,11 @@ static gboolean             writeback_xmp_update_file_metadata (TrackerWriteback
                                                                 GCancellable             *cancellable,
                                                                 GError                  **error);
 static const gchar * const *writeback_xmp_content_types        (TrackerWritebackFile     *writeback_file);
+static gboolean             writeback_xmp_get_metadata_regions (TrackerWritebackFile     *writeback_file,
+                                                                GFile                    *file,
+                                                                const gchar              *mime_type,
+                                                                goffset                  *head_size,
+                                                                goffset                  *tail_size);
 
 G_DEFINE_DYNAMIC_TYPE (TrackerWritebackXMP, tracker_writeback_xmp, TRACKER_TYPE_WRITEBACK_FILE);
 
@@ -69,6 +75,7 @@ tracker_writeback_xmp_class_init (TrackerWritebackXMPClass *klass)
 
 	writeback_file_class->update_file_metadata = writeback_xmp_update_file_metadata;
 	writeback_file_class->content_types = writeback_xmp_content_types;
+	writeback_file_class->get_metadata_regions = writeback_xmp_get_metadata_regions;
 }
 
 static void
@@ -107,6 +114,38 @@ writeback_xmp_content_types (TrackerWritebackFile *wbf)
 	return content_types;
 }
 
+static gboolean
+writeback_xmp_get_metadata_regions (TrackerWritebackFile *writeback_file,
+                                    GFile                *file,
+                                    const gchar          *mime_type,
+                                    goffset              *head_size,
+                                    goffset              *tail_size)
+{
+	GInputStream *stream;
+	goffset file_size;
+	gboolean retval = FALSE;
+
+	/* Only JPEG for now */
+	if (g_strcmp0 (mime_type, "image/jpeg") != 0) {
+		return FALSE;
+	}
+
+	stream = G_INPUT_STREAM (g_file_read (file, NULL, NULL));
+
+	if (!stream) {
+		return FALSE;
+	}
+
+	if (g_seekable_seek (G_SEEKABLE (stream), 0, G_SEEK_END, NULL, NULL)) {
+		file_size = g_seekable_tell (G_SEEKABLE (stream));
+		retval = tracker_writeback_jpeg_get_metadata_regions (stream, file_size, head_size, tail_size);
+	}
+
+	g_object_unref (stream);
+
+	return retval;
+}
+
 static gboolean
 writeback_xmp_update_file_metadata (TrackerWritebackFile     *wbf,
                                     GFile                    *file,
@@ -32,6 +32,9 @@ import glib
 import dbus
 from dbus.mainloop.glib import DBusGMainLoop
 import time
+import os
+import select
+import struct
 
 GRAPH_UPDATED_SIGNAL = "GraphUpdated"
 
@@ -39,6 +42,7 @@ SIGNALS_PATH = "/org/freedesktop/Tracker1/Resources"
 SIGNALS_IFACE = "org.freedesktop.Tracker1.Resources"
 
 CONTACT_CLASS_URI = "http://www.semanticdesktop.org/ontologies/2007/03/22/nco#PersonContact"
+FULLNAME_URI = "http://www.semanticdesktop.org/ontologies/2007/03/22/nco#fullname"
 
 REASONABLE_TIMEOUT = 10 # Time waiting for the signal to be emitted
 
@@ -185,6 +189,93 @@ class TrackerStoreSignalsTests (CommonTrackerStoreTest):
         self.assertEquals (len (self.results_inserts), 1)
         
 
+class TrackerStoreSubscriptionTests (CommonTrackerStoreTest):
+    """
+    Subscribe to nco:PersonContact changes and check that they are
+    written to the file descriptor, and no longer after unsubscribing
+    """
+    def setUp (self):
+        self.clean_up_list = []
+        self.read_fd, write_fd = os.pipe ()
+        # the store gets its own copy of the write end
+        self.sub_id = self.tracker.get_tracker_iface ().Subscribe (CONTACT_CLASS_URI,
+                                                                  [FULLNAME_URI], "", False,
+                                                                  dbus.types.UnixFd (write_fd))
+        os.close (write_fd)
+
+    def tearDown (self):
+        for uri in self.clean_up_list:
+            self.tracker.update ("DELETE { <%s> a rdfs:Resource }" % uri)
+
+        self.clean_up_list = []
+        os.close (self.read_fd)
+
+    def __read (self, size):
+        """
+        Reads size bytes from the subscription, or less on EOF
+        """
+        data = ""
+        while len (data) < size:
+            ready, _, _ = select.select ([self.read_fd], [], [], REASONABLE_TIMEOUT)
+            if not ready:
+                self.fail ("Timeout, the changes never came!")
+            chunk = os.read (self.read_fd, size - len (data))
+            if not chunk:
+                break
+            data += chunk
+        return data
+
+    def __read_changes (self):
+        """
+        Returns the (insert, graph, subject, predicate, object) tuples of
+        the next emission
+        """
+        n_changes, = struct.unpack ("i", self.__read (4))
+        changes = []
+        for i in range (n_changes):
+            changes.append (struct.unpack ("iiiii", self.__read (20)))
+        return changes
+
+    def test_01_subscribe (self):
+        self.clean_up_list.append ("test://signals-contact-subscribe")
+        self.tracker.update ("""
+            INSERT { <test://signals-contact-subscribe> a nco:PersonContact ;
+                         nco:fullname 'subscribed' ;
+                         nco:nameGiven 'not subscribed' }
+            """)
+
+        # only the subscribed predicate is written
+        changes = self.__read_changes ()
+        self.assertEquals (len (changes), 1)
+        insert, graph, subject, predicate, obj = changes[0]
+        self.assertEquals (insert, 1)
+
+        uri, prop = self.tracker.query ("SELECT tracker:uri (%d) tracker:uri (%d) WHERE {}" % (subject, predicate))[0]
+        self.assertEquals (uri, "test://signals-contact-subscribe")
+        self.assertEquals (prop, FULLNAME_URI)
+
+        self.tracker.update ("""
+            DELETE { <test://signals-contact-subscribe> nco:fullname ?x }
+            WHERE { <test://signals-contact-subscribe> nco:fullname ?x }
+            """)
+
+        changes = self.__read_changes ()
+        self.assertEquals (len (changes), 1)
+        self.assertEquals (changes[0][0], 0)
+
+    def test_02_unsubscribe (self):
+        self.tracker.get_tracker_iface ().Unsubscribe (self.sub_id)
+
+        self.clean_up_list.append ("test://signals-contact-unsubscribe")
+        self.tracker.update ("""
+            INSERT { <test://signals-contact-unsubscribe> a nco:PersonContact ;
+                         nco:fullname 'unsubscribed' }
+            """)
+
+        # the store closed its end, nothing else is written
+        self.assertEquals (self.__read (4), "")
+
+
 if __name__ == "__main__":
     ut.main()
 
@@ -34,8 +34,18 @@
 #include <libtracker-data/tracker-sparql-query.h>
 
 static gint backup_calls = 0;
+static gdouble backup_progress = 0;
 static GMainLoop *loop = NULL;
 
+static void
+backup_progress_cb (gdouble progress, gpointer user_data)
+{
+	/* Progress must be monotonic and reported before finishing */
+	g_assert_cmpfloat (progress, >=, backup_progress);
+	g_assert_cmpint (backup_calls, ==, 0);
+	backup_progress = progress;
+}
+
 static void
 backup_finished_cb (GError *error, gpointer user_data)
 {
@@ -138,6 +148,8 @@ test_backup_and_restore_helper (gboolean journal)
 	g_free (backup_filename);
 	g_free (backup_location);
 	tracker_data_backup_save (backup_file,
+	                          backup_progress_cb,
+	                          NULL,
 	                          backup_finished_cb,
 	                          NULL,
 	                          NULL);
@@ -193,6 +205,7 @@ test_backup_and_restore_helper (gboolean journal)
 	g_free (test_schemas[3]);
 
 	g_assert_cmpint (backup_calls, ==, 1);
+	g_assert_cmpfloat (backup_progress, ==, 1.0);
 
 	tracker_data_manager_shutdown ();
 }
@@ -202,6 +215,7 @@ test_backup_and_restore (void)
 {
 	test_backup_and_restore_helper (FALSE);
 	backup_calls = 0;
+	backup_progress = 0;
 }
 
 static void
@@ -209,6 +223,18 @@ test_journal_then_backup_and_restore (void)
 {
 	test_backup_and_restore_helper (TRUE);
 	backup_calls = 0;
+	backup_progress = 0;
+}
+
+static void
+test_paced_backup_and_restore (void)
+{
+	/* Copy a single page per step with a tight I/O budget */
+	tracker_data_backup_set_pacing (1, 64);
+	test_backup_and_restore_helper (FALSE);
+	tracker_data_backup_set_pacing (100, 8192);
+	backup_calls = 0;
+	backup_progress = 0;
 }
 
 int
@@ -235,6 +261,9 @@ main (int argc, char **argv)
 	g_test_add_func ("/tracker/libtracker-data/backup/save_and_restore",
 	                 test_backup_and_restore);
 
+	g_test_add_func ("/tracker/libtracker-data/backup/paced_save_and_restore",
+	                 test_paced_backup_and_restore);
+
 	/* run tests */
 	result = g_test_run ();
 
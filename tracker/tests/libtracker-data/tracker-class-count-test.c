@@ -0,0 +1,135 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+
+#include "config.h"
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <libtracker-data/tracker-data.h>
+
+#define NMO_EMAIL "http://www.semanticdesktop.org/ontologies/2007/03/22/nmo#Email"
+
+static void
+init_data_manager (TrackerDBManagerFlags flags)
+{
+	GError *error = NULL;
+
+	tracker_data_manager_init (flags,
+	                           NULL,
+	                           NULL,
+	                           FALSE,
+	                           FALSE,
+	                           100,
+	                           100,
+	                           NULL,
+	                           NULL,
+	                           NULL,
+	                           &error);
+
+	g_assert_no_error (error);
+}
+
+static gint
+get_email_count (void)
+{
+	TrackerClass *class;
+
+	class = tracker_ontologies_get_class_by_uri (NMO_EMAIL);
+	g_assert (class != NULL);
+
+	return tracker_class_get_count (class);
+}
+
+static void
+test_class_count_persisted (void)
+{
+	GError *error = NULL;
+
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+
+	init_data_manager (TRACKER_DB_MANAGER_FORCE_REINDEX);
+
+	g_assert_cmpint (get_email_count (), ==, 0);
+
+	tracker_data_update_sparql ("INSERT { <urn:email:1> a nmo:Email . "
+	                            "         <urn:email:2> a nmo:Email . "
+	                            "         <urn:email:3> a nmo:Email }",
+	                            &error);
+	g_assert_no_error (error);
+
+	tracker_data_update_sparql ("DELETE { <urn:email:3> a rdfs:Resource }",
+	                            &error);
+	g_assert_no_error (error);
+
+	/* a failed update must not leave its count changes behind */
+	tracker_data_update_sparql ("INSERT { <urn:email:4> a nmo:Email . "
+	                            "         <urn:email:4> nmo:nonExistingProperty 42 }",
+	                            &error);
+	g_assert (error != NULL);
+	g_clear_error (&error);
+
+	g_assert_cmpint (get_email_count (), ==, 2);
+
+	tracker_data_manager_shutdown ();
+
+	/* counts are loaded from the database, not recounted */
+	init_data_manager (0);
+
+	g_assert_cmpint (get_email_count (), ==, 2);
+	g_assert (tracker_data_manager_check_class_counts ());
+
+	/* a full rebuild must agree with the incrementally maintained counts */
+	tracker_data_manager_rebuild_class_counts (NULL, NULL, NULL, &error);
+	g_assert_no_error (error);
+
+	g_assert_cmpint (get_email_count (), ==, 2);
+
+	tracker_data_manager_shutdown ();
+}
+
+int
+main (int argc, char **argv)
+{
+	gint result;
+	gchar *current_dir;
+
+	g_type_init ();
+
+	g_test_init (&argc, &argv, NULL);
+
+	current_dir = g_get_current_dir ();
+
+	g_setenv ("XDG_DATA_HOME", current_dir, TRUE);
+	g_setenv ("XDG_CACHE_HOME", current_dir, TRUE);
+	g_setenv ("TRACKER_DB_ONTOLOGIES_DIR", TOP_SRCDIR "/data/ontologies/", TRUE);
+
+	g_free (current_dir);
+
+	g_test_add_func ("/libtracker-data/class-count/persisted", test_class_count_persisted);
+
+	/* run tests */
+
+	result = g_test_run ();
+
+	/* clean up */
+	g_print ("Removing temporary data\n");
+	g_spawn_command_line_sync ("rm -R tracker/", NULL, NULL, NULL, NULL);
+
+	return result;
+}
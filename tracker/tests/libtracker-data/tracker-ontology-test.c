@@ -213,6 +213,87 @@ test_ontology_init (void)
 	tracker_data_manager_shutdown ();
 }
 
+#define GVDB_N_THREADS 8
+
+static gpointer
+gvdb_property_thread (gpointer data)
+{
+	TrackerProperty *property = data;
+	TrackerProperty **super_properties;
+
+	/* Every thread has to see the fully loaded property, whichever
+	 * of them ends up loading it */
+	g_assert_cmpstr (tracker_class_get_uri (tracker_property_get_range (property)), ==,
+	                 "http://www.w3.org/2001/XMLSchema#string");
+	g_assert_cmpstr (tracker_class_get_uri (tracker_property_get_domain (property)), ==,
+	                 "http://www.semanticdesktop.org/ontologies/2007/01/19/nie#InformationElement");
+
+	super_properties = tracker_property_get_super_properties (property);
+	g_assert (super_properties[0] != NULL);
+	g_assert_cmpstr (tracker_property_get_uri (super_properties[0]), ==,
+	                 "http://purl.org/dc/elements/1.1/title");
+	g_assert (super_properties[1] == NULL);
+
+	return NULL;
+}
+
+static void
+test_ontology_gvdb_threads (void)
+{
+	TrackerProperty *property;
+	GThread *threads[GVDB_N_THREADS];
+	GError *error = NULL;
+	gint i;
+
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+
+	/* writes the ontology image */
+	tracker_data_manager_init (TRACKER_DB_MANAGER_FORCE_REINDEX,
+	                           NULL,
+	                           NULL,
+	                           FALSE,
+	                           FALSE,
+	                           100,
+	                           100,
+	                           NULL,
+	                           NULL,
+	                           NULL,
+	                           &error);
+
+	g_assert_no_error (error);
+
+	tracker_data_manager_shutdown ();
+
+	/* read-only clients load properties lazily from the image */
+	tracker_data_manager_init (TRACKER_DB_MANAGER_READONLY,
+	                           NULL,
+	                           NULL,
+	                           FALSE,
+	                           FALSE,
+	                           100,
+	                           100,
+	                           NULL,
+	                           NULL,
+	                           NULL,
+	                           &error);
+
+	g_assert_no_error (error);
+
+	property = tracker_ontologies_get_property_by_uri ("http://www.semanticdesktop.org/ontologies/2007/01/19/nie#title");
+	g_assert (property != NULL);
+
+	for (i = 0; i < GVDB_N_THREADS; i++) {
+		threads[i] = g_thread_create (gvdb_property_thread, property, TRUE, &error);
+		g_assert_no_error (error);
+	}
+
+	for (i = 0; i < GVDB_N_THREADS; i++) {
+		g_thread_join (threads[i]);
+	}
+
+	tracker_data_manager_shutdown ();
+}
+
 static void
 test_query (gconstpointer test_data)
 {
@@ -278,6 +359,10 @@ main (int argc, char **argv)
 
 	g_type_init ();
 
+	if (!g_thread_supported ()) {
+		g_thread_init (NULL);
+	}
+
 	g_test_init (&argc, &argv, NULL);
 
 	data_dir = g_build_filename (g_get_current_dir (), "test-cache", NULL);
@@ -293,6 +378,7 @@ main (int argc, char **argv)
 	/* add test cases */
 
 	g_test_add_func ("/libtracker-data/ontology-init", test_ontology_init);
+	g_test_add_func ("/libtracker-data/ontology-gvdb-threads", test_ontology_gvdb_threads);
 
 	for (i = 0; nie_tests[i].test_name; i++) {
 		gchar *testpath;
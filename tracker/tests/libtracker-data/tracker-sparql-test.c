@@ -89,6 +89,10 @@ const TestInfo tests[] = {
 	{ "functions/functions-tracker-1", "functions/data-1", FALSE },
 	{ "functions/functions-tracker-2", "functions/data-2", FALSE },
 	{ "functions/functions-tracker-loc-1", "functions/data-3", FALSE },
+	{ "functions/functions-trigram-1", "functions/data-4", FALSE },
+	{ "functions/functions-trigram-2", "functions/data-4", FALSE },
+	{ "functions/functions-trigram-3", "functions/data-4", FALSE },
+	{ "functions/functions-trigram-4", "functions/data-4", FALSE },
 	{ "functions/functions-xpath-1", "functions/data-1", FALSE },
 	{ "functions/functions-xpath-2", "functions/data-1", FALSE },
 	{ "functions/functions-xpath-3", "functions/data-1", FALSE },
@@ -115,6 +119,8 @@ const TestInfo tests[] = {
 	{ "sort/query-sort-6", "sort/data-sort-4", FALSE },
 	{ "sort/query-sort-7", "sort/data-sort-1", FALSE },
 	{ "sort/query-sort-8", "sort/data-sort-5", FALSE },
+	{ "sort/query-sort-9", "sort/data-sort-6", FALSE },
+	{ "sort/query-sort-10", "sort/data-sort-6", FALSE },
 	{ "subqueries/subqueries-1", "subqueries/data-1", FALSE },
 	{ "subqueries/subqueries-union-1", "subqueries/data-1", FALSE },
 	{ "subqueries/subqueries-union-2", "subqueries/data-1", FALSE },
@@ -317,6 +323,440 @@ test_sparql_query (gconstpointer test_data)
 	tracker_data_manager_shutdown ();
 }
 
+/* Pages through the results of @query_format, which has a %s for the
+ * continuation token returned in the last column. Returns the values
+ * of all columns but the first and the last, which contain no quotes.
+ */
+static gchar *
+query_pages (const gchar *query_format)
+{
+	GString *names;
+	gchar *continuation;
+	GError *error = NULL;
+
+	names = g_string_new ("");
+	continuation = g_strdup ("");
+
+	while (TRUE) {
+		TrackerDBCursor *cursor;
+		gchar *query;
+		gint n_rows = 0;
+
+		query = g_strdup_printf (query_format, continuation);
+		cursor = tracker_data_query_sparql_cursor (query, &error);
+		g_assert_no_error (error);
+		g_free (query);
+
+		while (tracker_db_cursor_iter_next (cursor, NULL, &error)) {
+			guint i, n_columns;
+
+			n_columns = tracker_db_cursor_get_n_columns (cursor);
+			g_assert_cmpint (n_columns, >=, 3);
+
+			for (i = 1; i < n_columns - 1; i++) {
+				const gchar *value;
+
+				value = tracker_db_cursor_get_string (cursor, i, NULL);
+				g_string_append_printf (names, "%s%s",
+				                        i > 1 ? "/" : "",
+				                        value ? value : "-");
+			}
+			g_string_append_c (names, ' ');
+
+			g_free (continuation);
+			continuation = g_strdup (tracker_db_cursor_get_string (cursor, n_columns - 1, NULL));
+			n_rows++;
+		}
+		g_assert_no_error (error);
+		g_object_unref (cursor);
+
+		if (n_rows == 0) {
+			break;
+		}
+	}
+
+	g_free (continuation);
+
+	return g_string_free (names, FALSE);
+}
+
+static void
+keyset_pagination_init (const gchar *data)
+{
+	GError *error = NULL;
+	gchar *data_prefix, *data_filename;
+	const gchar *test_schemas[2] = { NULL, NULL };
+
+	data_prefix = g_build_filename (TOP_SRCDIR, "tests", "libtracker-data", "sort", data, NULL);
+	test_schemas[0] = data_prefix;
+
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+
+	tracker_data_manager_init (TRACKER_DB_MANAGER_FORCE_REINDEX,
+	                           test_schemas,
+	                           NULL, FALSE, FALSE,
+	                           100, 100, NULL, NULL, NULL, &error);
+	g_assert_no_error (error);
+
+	data_filename = g_strconcat (data_prefix, ".ttl", NULL);
+	tracker_turtle_reader_load (data_filename, &error);
+	g_assert_no_error (error);
+
+	g_free (data_filename);
+	g_free (data_prefix);
+}
+
+static void
+assert_query_fails (const gchar *query)
+{
+	GError *error = NULL;
+
+	tracker_data_query_sparql_cursor (query, &error);
+	g_assert (error != NULL);
+	g_clear_error (&error);
+}
+
+static void
+test_sparql_keyset_pagination (void)
+{
+	gchar *names;
+
+	keyset_pagination_init ("data-sort-1");
+
+	names = query_pages ("PREFIX foaf: <http://xmlns.com/foaf/0.1/> "
+	                     "SELECT ?x ?name WHERE { ?x foaf:name ?name } "
+	                     "ORDER BY ASC(?name) LIMIT 1 OFFSET \"%s\"");
+	g_assert_cmpstr (names, ==, "Alice Bob Eve Fred ");
+	g_free (names);
+
+	names = query_pages ("PREFIX foaf: <http://xmlns.com/foaf/0.1/> "
+	                     "SELECT ?x ?name WHERE { ?x foaf:name ?name } "
+	                     "ORDER BY DESC(?name) LIMIT 1 OFFSET \"%s\"");
+	g_assert_cmpstr (names, ==, "Fred Eve Bob Alice ");
+	g_free (names);
+
+	/* tokens are validated */
+	assert_query_fails ("PREFIX foaf: <http://xmlns.com/foaf/0.1/> "
+	                    "SELECT ?x ?name WHERE { ?x foaf:name ?name } "
+	                    "ORDER BY ?name OFFSET \"'Bob'\"");
+
+	tracker_data_manager_shutdown ();
+}
+
+static void
+test_sparql_keyset_pagination_keys (void)
+{
+	gchar *names;
+
+	keyset_pagination_init ("data-sort-7");
+
+	/* Duplicate and NULL sort keys, ties are broken by the selected
+	 * variables, NULL sorts first.
+	 */
+	names = query_pages ("PREFIX foaf: <http://xmlns.com/foaf/0.1/> "
+	                     "PREFIX ex: <http://example.org/things#> "
+	                     "SELECT ?x ?name ?id "
+	                     "WHERE { ?x foaf:name ?name OPTIONAL { ?x ex:empId ?id } } "
+	                     "ORDER BY ASC(?id) LIMIT 1 OFFSET \"%s\"");
+	g_assert_cmpstr (names, ==,
+	                 "Bob/- Carol/- Eve/9 Alice/23 Fred/23 Dan/23 Zed/3000000000 ");
+	g_free (names);
+
+	names = query_pages ("PREFIX foaf: <http://xmlns.com/foaf/0.1/> "
+	                     "PREFIX ex: <http://example.org/things#> "
+	                     "SELECT ?x ?name ?id "
+	                     "WHERE { ?x foaf:name ?name OPTIONAL { ?x ex:empId ?id } } "
+	                     "ORDER BY DESC(?id) LIMIT 2 OFFSET \"%s\"");
+	g_assert_cmpstr (names, ==,
+	                 "Zed/3000000000 Alice/23 Fred/23 Dan/23 Eve/9 Bob/- Carol/- ");
+	g_free (names);
+
+	/* Multi-valued join, the same resource is in several rows */
+	names = query_pages ("PREFIX foaf: <http://xmlns.com/foaf/0.1/> "
+	                     "SELECT ?x ?name ?nick "
+	                     "WHERE { ?x foaf:name ?name ; foaf:nick ?nick } "
+	                     "ORDER BY ?name LIMIT 1 OFFSET \"%s\"");
+	g_assert_cmpstr (names, ==, "Alice/a Eve/e1 Eve/e2 ");
+	g_free (names);
+
+	/* Rows are not unique without ?nick */
+	assert_query_fails ("PREFIX foaf: <http://xmlns.com/foaf/0.1/> "
+	                    "SELECT ?x ?name "
+	                    "WHERE { ?x foaf:name ?name ; foaf:nick ?nick } "
+	                    "ORDER BY ?name OFFSET \"\"");
+
+	/* Nor with UNION */
+	assert_query_fails ("PREFIX foaf: <http://xmlns.com/foaf/0.1/> "
+	                    "SELECT ?x "
+	                    "WHERE { { ?x foaf:name \"Eve\" } UNION { ?x foaf:nick \"e1\" } } "
+	                    "OFFSET \"\"");
+
+	tracker_data_manager_shutdown ();
+}
+
+static void
+test_sparql_explain (void)
+{
+	const gchar *queries[] = {
+		"PREFIX foaf: <http://xmlns.com/foaf/0.1/> "
+		"SELECT ?x WHERE { ?x foaf:name \"Bob\" }",
+		"PREFIX foaf: <http://xmlns.com/foaf/0.1/> "
+		"ASK { ?x foaf:name \"Bob\" }",
+		NULL
+	};
+	TrackerSparqlQuery *query;
+	GError *error = NULL;
+	gchar *plan;
+	gint i;
+
+	keyset_pagination_init ("data-sort-1");
+
+	for (i = 0; queries[i]; i++) {
+		query = tracker_sparql_query_new (queries[i]);
+		plan = tracker_sparql_query_explain (query, &error);
+		g_assert_no_error (error);
+		g_assert (strstr (plan, "SQLite plan:") != NULL);
+
+		g_free (plan);
+		g_object_unref (query);
+	}
+
+	/* Updates can't be explained */
+	query = tracker_sparql_query_new ("INSERT { <urn:x> a rdfs:Resource }");
+	plan = tracker_sparql_query_explain (query, &error);
+	g_assert (plan == NULL);
+	g_assert (error != NULL);
+	g_clear_error (&error);
+	g_object_unref (query);
+
+	tracker_data_manager_shutdown ();
+}
+
+/* Lookups from another thread only see committed data, so neither
+ * the connection nor the caches may hand out uncommitted entries */
+static gpointer
+resource_id_thread (gpointer data)
+{
+	return GINT_TO_POINTER (tracker_data_query_resource_id (data));
+}
+
+static gpointer
+rdf_type_thread (gpointer data)
+{
+	GPtrArray *types;
+	guint len;
+
+	types = tracker_data_query_rdf_type (GPOINTER_TO_INT (data));
+	len = types->len;
+	g_ptr_array_free (types, TRUE);
+
+	return GUINT_TO_POINTER (len);
+}
+
+static gpointer
+run_in_thread (GThreadFunc func,
+               gpointer    data)
+{
+	GThread *thread;
+	GError *error = NULL;
+
+	thread = g_thread_create (func, data, TRUE, &error);
+	g_assert_no_error (error);
+
+	return g_thread_join (thread);
+}
+
+static void
+test_sparql_resource_cache (void)
+{
+	GError *error = NULL;
+	gchar *data_prefix;
+	GPtrArray *types;
+	gint id;
+	const gchar *test_schemas[2] = { NULL, NULL };
+
+	data_prefix = g_build_filename (TOP_SRCDIR, "tests", "libtracker-data", "sort", "data-sort-1", NULL);
+	test_schemas[0] = data_prefix;
+
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+
+	tracker_data_manager_init (TRACKER_DB_MANAGER_FORCE_REINDEX,
+	                           test_schemas,
+	                           NULL, FALSE, FALSE,
+	                           100, 100, NULL, NULL, NULL, &error);
+	g_assert_no_error (error);
+
+	/* resources of rolled back transactions are not kept */
+	tracker_data_begin_transaction (&error);
+	g_assert_no_error (error);
+	tracker_data_insert_statement (NULL, "urn:cache:1", TRACKER_RDF_PREFIX "type",
+	                               "http://www.w3.org/2002/07/owl#Thing", &error);
+	g_assert_no_error (error);
+	tracker_data_update_buffer_flush (&error);
+	g_assert_no_error (error);
+	g_assert_cmpint (tracker_data_query_resource_id ("urn:cache:1"), >, 0);
+	g_assert_cmpint (GPOINTER_TO_INT (run_in_thread (resource_id_thread, "urn:cache:1")), ==, 0);
+	tracker_data_rollback_transaction ();
+
+	g_assert_cmpint (tracker_data_query_resource_id ("urn:cache:1"), ==, 0);
+	g_assert_cmpint (GPOINTER_TO_INT (run_in_thread (resource_id_thread, "urn:cache:1")), ==, 0);
+
+	/* committed types are seen by later transactions */
+	tracker_data_update_sparql ("INSERT { <urn:cache:2> a <http://www.w3.org/2002/07/owl#Thing> }", &error);
+	g_assert_no_error (error);
+
+	id = tracker_data_query_resource_id ("urn:cache:2");
+	g_assert_cmpint (id, >, 0);
+	g_assert_cmpint (GPOINTER_TO_INT (run_in_thread (resource_id_thread, "urn:cache:2")), ==, id);
+
+	types = tracker_data_query_rdf_type (id);
+	g_assert_cmpint (types->len, ==, 2);
+	g_ptr_array_free (types, TRUE);
+
+	tracker_data_update_sparql ("DELETE { <urn:cache:2> a <http://www.w3.org/2002/07/owl#Thing> }", &error);
+	g_assert_no_error (error);
+
+	types = tracker_data_query_rdf_type (id);
+	g_assert_cmpint (types->len, ==, 1);
+	g_ptr_array_free (types, TRUE);
+
+	/* and rolled back types are not */
+	tracker_data_begin_transaction (&error);
+	g_assert_no_error (error);
+	tracker_data_insert_statement (NULL, "urn:cache:2", TRACKER_RDF_PREFIX "type",
+	                               "http://www.w3.org/2002/07/owl#Thing", &error);
+	g_assert_no_error (error);
+	tracker_data_update_buffer_flush (&error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (GPOINTER_TO_UINT (run_in_thread (rdf_type_thread, GINT_TO_POINTER (id))), ==, 1);
+	tracker_data_rollback_transaction ();
+
+	types = tracker_data_query_rdf_type (id);
+	g_assert_cmpint (types->len, ==, 1);
+	g_ptr_array_free (types, TRUE);
+	g_assert_cmpuint (GPOINTER_TO_UINT (run_in_thread (rdf_type_thread, GINT_TO_POINTER (id))), ==, 1);
+
+	/* once committed, the types are published to other threads */
+	tracker_data_update_sparql ("INSERT { <urn:cache:2> a <http://www.w3.org/2002/07/owl#Thing> }", &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (GPOINTER_TO_UINT (run_in_thread (rdf_type_thread, GINT_TO_POINTER (id))), ==, 2);
+
+	g_free (data_prefix);
+
+	tracker_data_manager_shutdown ();
+}
+
+static gchar *
+query_single_row (const gchar *query)
+{
+	TrackerDBCursor *cursor;
+	GError *error = NULL;
+	GString *row;
+	gint col;
+
+	cursor = tracker_data_query_sparql_cursor (query, &error);
+	g_assert_no_error (error);
+
+	g_assert (tracker_db_cursor_iter_next (cursor, NULL, &error));
+	g_assert_no_error (error);
+
+	row = g_string_new ("");
+
+	for (col = 0; col < tracker_db_cursor_get_n_columns (cursor); col++) {
+		const gchar *str;
+
+		if (col > 0) {
+			g_string_append (row, "\t");
+		}
+
+		str = tracker_db_cursor_get_string (cursor, col, NULL);
+		g_string_append (row, str ? str : "(unbound)");
+	}
+
+	g_assert (!tracker_db_cursor_iter_next (cursor, NULL, &error));
+	g_assert_no_error (error);
+	g_object_unref (cursor);
+
+	return g_string_free (row, FALSE);
+}
+
+static void
+assert_update_row (const gchar *expected)
+{
+	gchar *row;
+
+	row = query_single_row ("SELECT ?mime ?lang ?gen ?ver ?legal ?title "
+	                        "WHERE { <urn:update:1> a nie:InformationElement . "
+	                        "OPTIONAL { <urn:update:1> nie:mimeType ?mime } "
+	                        "OPTIONAL { <urn:update:1> nie:language ?lang } "
+	                        "OPTIONAL { <urn:update:1> nie:generator ?gen } "
+	                        "OPTIONAL { <urn:update:1> nie:version ?ver } "
+	                        "OPTIONAL { <urn:update:1> nie:legal ?legal } "
+	                        "OPTIONAL { <urn:update:1> nie:title ?title } }");
+	g_assert_cmpstr (row, ==, expected);
+	g_free (row);
+}
+
+/* Old values of single-valued properties are read for the whole row of
+ * the class table at once, changing several of them for one subject has
+ * to replace exactly the changed ones.
+ */
+static void
+test_sparql_update_class_row (void)
+{
+	GError *error = NULL;
+
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+
+	tracker_data_manager_init (TRACKER_DB_MANAGER_FORCE_REINDEX,
+	                           NULL,
+	                           NULL, FALSE, FALSE,
+	                           100, 100, NULL, NULL, NULL, &error);
+	g_assert_no_error (error);
+
+	tracker_data_update_sparql ("INSERT { <urn:update:1> a nie:InformationElement ; "
+	                            "nie:mimeType \"text/plain\" ; nie:language \"en\" ; "
+	                            "nie:generator \"gen 1\" ; nie:version \"1\" ; "
+	                            "nie:legal \"legal\" ; nie:title \"Title\" }",
+	                            &error);
+	g_assert_no_error (error);
+
+	assert_update_row ("text/plain\ten\tgen 1\t1\tlegal\tTitle");
+
+	/* Several properties of the same row in one transaction, the
+	 * inserts would fail on the cardinality if an old value stayed.
+	 */
+	tracker_data_update_sparql ("DELETE { <urn:update:1> nie:mimeType ?m ; nie:language ?l } "
+	                            "WHERE { <urn:update:1> nie:mimeType ?m ; nie:language ?l } "
+	                            "INSERT { <urn:update:1> nie:mimeType \"text/html\" ; nie:language \"fi\" }",
+	                            &error);
+	g_assert_no_error (error);
+
+	assert_update_row ("text/html\tfi\tgen 1\t1\tlegal\tTitle");
+
+	/* Separate statements of one update, the value modified by the
+	 * first one must not be replaced by the prefetched row.
+	 */
+	tracker_data_update_sparql ("DELETE { <urn:update:1> nie:version ?v } "
+	                            "WHERE { <urn:update:1> nie:version ?v } "
+	                            "INSERT { <urn:update:1> nie:version \"2\" } "
+	                            "DELETE { <urn:update:1> nie:generator ?g ; nie:title ?t } "
+	                            "WHERE { <urn:update:1> nie:generator ?g ; nie:title ?t } "
+	                            "INSERT { <urn:update:1> nie:title \"New title\" }",
+	                            &error);
+	g_assert_no_error (error);
+
+	assert_update_row ("text/html\tfi\t(unbound)\t2\tlegal\tNew title");
+
+	/* A property of the row that was deleted can be set again */
+	tracker_data_update_sparql ("INSERT { <urn:update:1> nie:generator \"gen 2\" }", &error);
+	g_assert_no_error (error);
+
+	assert_update_row ("text/html\tfi\tgen 2\t2\tlegal\tNew title");
+
+	tracker_data_manager_shutdown ();
+}
+
 int
 main (int argc, char **argv)
 {
@@ -326,6 +766,10 @@ main (int argc, char **argv)
 
 	g_type_init ();
 
+	if (!g_thread_supported ()) {
+		g_thread_init (NULL);
+	}
+
 	g_test_init (&argc, &argv, NULL);
 
 	setlocale (LC_COLLATE, "en_US.utf8");
@@ -358,6 +802,12 @@ main (int argc, char **argv)
 		g_free (testpath);
 	}
 
+	g_test_add_func ("/libtracker-data/sparql/keyset-pagination", test_sparql_keyset_pagination);
+	g_test_add_func ("/libtracker-data/sparql/keyset-pagination-keys", test_sparql_keyset_pagination_keys);
+	g_test_add_func ("/libtracker-data/sparql/explain", test_sparql_explain);
+	g_test_add_func ("/libtracker-data/sparql/resource-cache", test_sparql_resource_cache);
+	g_test_add_func ("/libtracker-data/sparql/update-class-row", test_sparql_update_class_row);
+
 	/* run tests */
 	result = g_test_run ();
 
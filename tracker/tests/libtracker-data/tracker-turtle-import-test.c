@@ -0,0 +1,309 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include <libtracker-data/tracker-data.h>
+
+#define TURTLE_PREFIXES \
+	"@prefix nie: <http://www.semanticdesktop.org/ontologies/2007/01/19/nie#> .\n"
+
+#define N_ITEMS 1000
+
+static void
+init_data_manager (void)
+{
+	GError *error = NULL;
+
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+
+	tracker_data_manager_init (TRACKER_DB_MANAGER_FORCE_REINDEX,
+	                           NULL,
+	                           NULL,
+	                           FALSE,
+	                           FALSE,
+	                           100,
+	                           100,
+	                           NULL,
+	                           NULL,
+	                           NULL,
+	                           &error);
+
+	g_assert_no_error (error);
+}
+
+static gchar *
+write_turtle_file (GString *contents)
+{
+	gchar *path;
+
+	path = g_build_filename (g_get_tmp_dir (), "tracker-turtle-import-test.ttl", NULL);
+	g_assert (g_file_set_contents (path, contents->str, contents->len, NULL));
+	g_string_free (contents, TRUE);
+
+	return path;
+}
+
+/* Imports @path, returns the number of ranges it was parsed in */
+static gint
+import_file (const gchar  *path,
+             gsize         min_range_size,
+             gint          batch_size,
+             GError      **error)
+{
+	TrackerTurtleImport *import;
+	gint n_ranges;
+
+	import = tracker_turtle_import_new_with_limits (path, min_range_size, batch_size, error);
+	g_assert_no_error (*error);
+
+	while (tracker_turtle_import_import_batch (import, error))
+		;
+
+	n_ranges = tracker_turtle_import_get_n_ranges (import);
+	g_object_unref (import);
+
+	return n_ranges;
+}
+
+static gint64
+query_count (const gchar *query)
+{
+	TrackerDBCursor *cursor;
+	GError *error = NULL;
+	gint64 count;
+
+	cursor = tracker_data_query_sparql_cursor (query, &error);
+	g_assert_no_error (error);
+
+	g_assert (tracker_db_cursor_iter_next (cursor, NULL, &error));
+	g_assert_no_error (error);
+	count = tracker_db_cursor_get_int (cursor, 0);
+
+	g_object_unref (cursor);
+
+	return count;
+}
+
+static void
+assert_item (const gchar *prefix,
+             gint         i,
+             gboolean     exists)
+{
+	gchar *uri;
+
+	uri = g_strdup_printf ("%s%d", prefix, i);
+
+	if (exists) {
+		g_assert_cmpint (tracker_data_query_resource_id (uri), !=, 0);
+	} else {
+		g_assert_cmpint (tracker_data_query_resource_id (uri), ==, 0);
+	}
+
+	g_free (uri);
+}
+
+static void
+test_turtle_import_ranges (void)
+{
+	GError *error = NULL;
+	GString *contents;
+	gchar *path;
+	gint i;
+
+	init_data_manager ();
+
+	contents = g_string_new (TURTLE_PREFIXES);
+
+	for (i = 0; i < N_ITEMS; i++) {
+		g_string_append_printf (contents,
+		                        "<urn:item:%d> a nie:InformationElement ; nie:title \"Item %d\" .\n",
+		                        i, i);
+	}
+
+	path = write_turtle_file (contents);
+
+	/* The file is split over several parser threads */
+	g_assert_cmpint (import_file (path, 1024, 10, &error), >, 1);
+	g_assert_no_error (error);
+
+	for (i = 0; i < N_ITEMS; i++) {
+		assert_item ("urn:item:", i, TRUE);
+	}
+
+	g_assert_cmpint (query_count ("SELECT COUNT(?r) { ?r nie:title ?t }"), ==, N_ITEMS);
+
+	g_unlink (path);
+	g_free (path);
+
+	tracker_data_manager_shutdown ();
+}
+
+static void
+test_turtle_import_prefix_changed (void)
+{
+	GError *error = NULL;
+	GString *contents;
+	gchar *path;
+	gint i, n_ranges;
+
+	init_data_manager ();
+
+	contents = g_string_new (TURTLE_PREFIXES "@prefix p: <urn:first:> .\n");
+
+	for (i = 0; i < N_ITEMS; i++) {
+		if (i == N_ITEMS / 4) {
+			g_string_append (contents, "@prefix p: <urn:second:> .\n");
+		}
+
+		g_string_append_printf (contents, "p:item%d a nie:InformationElement .\n", i);
+	}
+
+	path = write_turtle_file (contents);
+
+	/* Ranges after the redefinition were started with the old prefix,
+	 * the rest of the file has to be parsed again by a single reader.
+	 */
+	n_ranges = import_file (path, 1024, 10, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (n_ranges, >, 1);
+
+	for (i = 0; i < N_ITEMS; i++) {
+		assert_item ("urn:first:item", i, i < N_ITEMS / 4);
+		assert_item ("urn:second:item", i, i >= N_ITEMS / 4);
+	}
+
+	g_unlink (path);
+	g_free (path);
+
+	tracker_data_manager_shutdown ();
+}
+
+static void
+test_turtle_import_blank_nodes (void)
+{
+	GError *error = NULL;
+	GString *contents;
+	gchar *path;
+	gint i;
+
+	init_data_manager ();
+
+	contents = g_string_new (TURTLE_PREFIXES);
+
+	for (i = 0; i < N_ITEMS; i++) {
+		g_string_append_printf (contents,
+		                        "<urn:item:%d> a nie:InformationElement ; "
+		                        "nie:isLogicalPartOf [ a nie:InformationElement ; "
+		                        "nie:keyword \"a\" ; nie:keyword \"b\" ] .\n",
+		                        i);
+	}
+
+	path = write_turtle_file (contents);
+
+	/* Batches would otherwise end after every statement */
+	import_file (path, 1024, 1, &error);
+	g_assert_no_error (error);
+
+	g_assert_cmpint (query_count ("SELECT COUNT(?b) { ?b nie:keyword \"a\" }"), ==, N_ITEMS);
+	g_assert_cmpint (query_count ("SELECT COUNT(?b) { ?r nie:isLogicalPartOf ?b . "
+	                              "?b nie:keyword \"a\" ; nie:keyword \"b\" }"), ==, N_ITEMS);
+
+	g_unlink (path);
+	g_free (path);
+
+	tracker_data_manager_shutdown ();
+}
+
+static void
+test_turtle_import_parse_error (void)
+{
+	GError *error = NULL;
+	GString *contents;
+	gchar *path;
+	gint i;
+
+	init_data_manager ();
+
+	contents = g_string_new (TURTLE_PREFIXES);
+
+	for (i = 0; i < 25; i++) {
+		g_string_append_printf (contents, "<urn:item:%d> a nie:InformationElement .\n", i);
+	}
+
+	g_string_append (contents, "<urn:item:broken> a .\n");
+
+	path = write_turtle_file (contents);
+
+	import_file (path, G_MAXSIZE, 10, &error);
+	g_assert_error (error, TRACKER_SPARQL_ERROR, TRACKER_SPARQL_ERROR_PARSE);
+	g_clear_error (&error);
+
+	/* The batches before the error stay imported, the one with
+	 * the error is not.
+	 */
+	for (i = 0; i < 25; i++) {
+		assert_item ("urn:item:", i, i < 20);
+	}
+
+	g_unlink (path);
+	g_free (path);
+
+	tracker_data_manager_shutdown ();
+}
+
+int
+main (int argc, char **argv)
+{
+	gint result;
+	gchar *current_dir;
+
+	g_type_init ();
+
+	if (!g_thread_supported ()) {
+		g_thread_init (NULL);
+	}
+
+	g_test_init (&argc, &argv, NULL);
+
+	current_dir = g_get_current_dir ();
+
+	g_setenv ("XDG_DATA_HOME", current_dir, TRUE);
+	g_setenv ("XDG_CACHE_HOME", current_dir, TRUE);
+	g_setenv ("TRACKER_DB_ONTOLOGIES_DIR", TOP_SRCDIR "/data/ontologies/", TRUE);
+
+	g_free (current_dir);
+
+	g_test_add_func ("/libtracker-data/turtle-import/ranges", test_turtle_import_ranges);
+	g_test_add_func ("/libtracker-data/turtle-import/prefix-changed", test_turtle_import_prefix_changed);
+	g_test_add_func ("/libtracker-data/turtle-import/blank-nodes", test_turtle_import_blank_nodes);
+	g_test_add_func ("/libtracker-data/turtle-import/parse-error", test_turtle_import_parse_error);
+
+	/* run tests */
+
+	result = g_test_run ();
+
+	/* clean up */
+	g_print ("Removing temporary data\n");
+	g_spawn_command_line_sync ("rm -R tracker/", NULL, NULL, NULL, NULL);
+
+	return result;
+}
@@ -17,10 +17,49 @@
  * Boston, MA  02110-1301, USA.
  */
 
+#include <string.h>
+
 #include <glib.h>
+#include <glib/gstdio.h>
 
 #include <libtracker-extract/tracker-extract.h>
 
+/* Spans a few pages, so the tail starts in the middle of one */
+#define FILE_VIEW_SIZE 10000
+
+static gchar *
+file_view_contents (void)
+{
+        gchar *contents;
+        gint i;
+
+        contents = g_malloc (FILE_VIEW_SIZE);
+
+        for (i = 0; i < FILE_VIEW_SIZE; i++) {
+                contents[i] = 'a' + i % 26;
+        }
+
+        return contents;
+}
+
+static TrackerExtractInfo *
+file_view_info_new (const gchar *contents,
+                    gsize        length,
+                    gchar      **path)
+{
+        TrackerExtractInfo *info;
+        GFile *file;
+
+        *path = g_build_filename (g_get_tmp_dir (), "tracker-extract-info-test", NULL);
+        g_assert (g_file_set_contents (*path, contents, length, NULL));
+
+        file = g_file_new_for_path (*path);
+        info = tracker_extract_info_new (file, "imaginary/mime", "test-graph");
+        g_object_unref (file);
+
+        return info;
+}
+
 static void
 test_extract_info_setters (void)
 {
@@ -67,6 +106,109 @@ test_extract_info_empty_objects (void)
         g_object_unref (file);
 }
 
+static void
+test_extract_info_file_view (void)
+{
+        TrackerExtractInfo *info;
+        const guchar *data;
+        gchar *contents, *path;
+        gsize length;
+
+        contents = file_view_contents ();
+        info = file_view_info_new (contents, FILE_VIEW_SIZE, &path);
+
+        g_assert_cmpint (tracker_extract_info_get_file_size (info), ==, FILE_VIEW_SIZE);
+
+        data = tracker_extract_info_get_file_head (info, 100, &length);
+        g_assert_cmpuint (length, ==, 100);
+        g_assert (memcmp (data, contents, 100) == 0);
+
+        data = tracker_extract_info_get_file_tail (info, 100, &length);
+        g_assert_cmpuint (length, ==, 100);
+        g_assert (memcmp (data, contents + FILE_VIEW_SIZE - 100, 100) == 0);
+
+        /* Larger ranges than the ones loaded so far */
+        data = tracker_extract_info_get_file_head (info, 5000, &length);
+        g_assert_cmpuint (length, ==, 5000);
+        g_assert (memcmp (data, contents, 5000) == 0);
+
+        data = tracker_extract_info_get_file_tail (info, 5001, &length);
+        g_assert_cmpuint (length, ==, 5001);
+        g_assert (memcmp (data, contents + FILE_VIEW_SIZE - 5001, 5001) == 0);
+
+        /* And smaller ones, within the loaded ranges */
+        data = tracker_extract_info_get_file_head (info, 10, &length);
+        g_assert_cmpuint (length, ==, 10);
+        g_assert (memcmp (data, contents, 10) == 0);
+
+        data = tracker_extract_info_get_file_tail (info, 10, &length);
+        g_assert_cmpuint (length, ==, 10);
+        g_assert (memcmp (data, contents + FILE_VIEW_SIZE - 10, 10) == 0);
+
+        tracker_extract_info_unref (info);
+
+        g_unlink (path);
+        g_free (path);
+        g_free (contents);
+}
+
+static void
+test_extract_info_file_view_small (void)
+{
+        TrackerExtractInfo *info;
+        const guchar *data;
+        gchar *contents, *path;
+        gsize length;
+
+        contents = file_view_contents ();
+        info = file_view_info_new (contents, 50, &path);
+
+        /* The file is smaller than the window asked for */
+        data = tracker_extract_info_get_file_head (info, 4096, &length);
+        g_assert_cmpuint (length, ==, 50);
+        g_assert (memcmp (data, contents, 50) == 0);
+
+        data = tracker_extract_info_get_file_tail (info, 4096, &length);
+        g_assert_cmpuint (length, ==, 50);
+        g_assert (memcmp (data, contents, 50) == 0);
+
+        tracker_extract_info_unref (info);
+        g_free (path);
+
+        /* Empty files have no data at all */
+        info = file_view_info_new (contents, 0, &path);
+
+        g_assert_cmpint (tracker_extract_info_get_file_size (info), ==, 0);
+        g_assert (tracker_extract_info_get_file_head (info, 4096, &length) == NULL);
+        g_assert_cmpuint (length, ==, 0);
+        g_assert (tracker_extract_info_get_file_tail (info, 4096, &length) == NULL);
+        g_assert_cmpuint (length, ==, 0);
+
+        tracker_extract_info_unref (info);
+
+        g_unlink (path);
+        g_free (path);
+        g_free (contents);
+}
+
+static void
+test_extract_info_file_view_missing (void)
+{
+        TrackerExtractInfo *info;
+        GFile *file;
+        gsize length;
+
+        file = g_file_new_for_path ("./imaginary-file");
+        info = tracker_extract_info_new (file, "imaginary/mime", "test-graph");
+
+        g_assert_cmpint (tracker_extract_info_get_file_size (info), ==, -1);
+        g_assert (tracker_extract_info_get_file_head (info, 4096, &length) == NULL);
+        g_assert_cmpuint (length, ==, 0);
+
+        tracker_extract_info_unref (info);
+        g_object_unref (file);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -77,6 +219,12 @@ main (int argc, char **argv)
                          test_extract_info_empty_objects);
         g_test_add_func ("/libtracker-extract/extract-info/setters",
                          test_extract_info_setters);
+        g_test_add_func ("/libtracker-extract/extract-info/file_view",
+                         test_extract_info_file_view);
+        g_test_add_func ("/libtracker-extract/extract-info/file_view_small",
+                         test_extract_info_file_view_small);
+        g_test_add_func ("/libtracker-extract/extract-info/file_view_missing",
+                         test_extract_info_file_view_missing);
 
         return g_test_run ();
 }
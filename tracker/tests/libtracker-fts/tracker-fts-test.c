@@ -173,6 +173,92 @@ test_sparql_query (gconstpointer test_data)
 	tracker_data_manager_shutdown ();
 }
 
+/* Returns the resources matching @text, separated by spaces */
+static gchar *
+fts_match (const gchar *text)
+{
+	TrackerDBCursor *cursor;
+	GError *error = NULL;
+	GString *matches;
+	gchar *query;
+
+	query = g_strdup_printf ("SELECT ?r WHERE { ?r fts:match \"%s\" } ORDER BY ?r", text);
+	cursor = tracker_data_query_sparql_cursor (query, &error);
+	g_assert_no_error (error);
+	g_free (query);
+
+	matches = g_string_new ("");
+
+	while (tracker_db_cursor_iter_next (cursor, NULL, &error)) {
+		if (matches->len > 0) {
+			g_string_append_c (matches, ' ');
+		}
+
+		g_string_append (matches, tracker_db_cursor_get_string (cursor, 0, NULL));
+	}
+
+	g_assert_no_error (error);
+	g_object_unref (cursor);
+
+	return g_string_free (matches, FALSE);
+}
+
+static void
+assert_fts_match (const gchar *text,
+                  const gchar *expected)
+{
+	gchar *matches;
+
+	matches = fts_match (text);
+	g_assert_cmpstr (matches, ==, expected);
+	g_free (matches);
+}
+
+static void
+test_fts_update (void)
+{
+	GError *error = NULL;
+	gchar *prefix, *data_prefix;
+	const gchar *test_schemas[2] = { NULL, NULL };
+
+	prefix = g_build_path (G_DIR_SEPARATOR_S, TOP_SRCDIR, "tests", "libtracker-fts", NULL);
+	data_prefix = g_build_filename (prefix, "data", NULL);
+	g_free (prefix);
+
+	test_schemas[0] = data_prefix;
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+	tracker_data_manager_init (TRACKER_DB_MANAGER_FORCE_REINDEX,
+	                           test_schemas,
+	                           NULL, FALSE, FALSE,
+	                           100, 100, NULL, NULL, NULL, &error);
+
+	g_assert_no_error (error);
+
+	tracker_data_update_sparql ("INSERT { "
+	                            "  test:1 a test:A ; test:p \"alpha beta\" ; test:o \"gamma\" . "
+	                            "  test:2 a test:A ; test:p \"beta\" "
+	                            "}",
+	                            &error);
+	g_assert_no_error (error);
+
+	/* Modified in a later transaction, only test:p of test:1 changes */
+	tracker_data_update_sparql ("DELETE { test:1 test:p ?p } WHERE { test:1 test:p ?p } "
+	                            "INSERT { test:1 test:p \"alpha delta\" }",
+	                            &error);
+	g_assert_no_error (error);
+
+	assert_fts_match ("beta", "http://www.example.org/test#2");
+	assert_fts_match ("delta", "http://www.example.org/test#1");
+	assert_fts_match ("alpha", "http://www.example.org/test#1");
+
+	/* The unchanged column of the same resource */
+	assert_fts_match ("gamma", "http://www.example.org/test#1");
+
+	g_free (data_prefix);
+
+	tracker_data_manager_shutdown ();
+}
+
 int
 main (int argc, char **argv)
 {
@@ -203,6 +289,8 @@ main (int argc, char **argv)
 		g_free (testpath);
 	}
 
+	g_test_add_func ("/libtracker-fts/update", test_fts_update);
+
 	/* run tests */
 	result = g_test_run ();
 
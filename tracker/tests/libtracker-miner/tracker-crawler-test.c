@@ -17,8 +17,21 @@
  * 02110-1301, USA.
  */
 
+#include <stdlib.h>
+#include <time.h>
+
+#include <glib/gstdio.h>
+
 #include <libtracker-miner/tracker-miner.h>
 
+#if GLIB_MINOR_VERSION < 30
+gchar *
+g_mkdtemp (gchar *tmpl)
+{
+	return mkdtemp (tmpl);
+}
+#endif
+
 typedef struct CrawlerTest CrawlerTest;
 
 struct CrawlerTest {
@@ -315,6 +328,228 @@ test_crawler_crawl_n_signals_non_recursive (void)
 	g_object_unref (file);
 }
 
+/* Creates a tree with 3 directories and 3 files, whose directories
+ * were last modified an hour ago, so the crawler adds them to its
+ * snapshot.
+ */
+static GFile *
+snapshot_tree_new (void)
+{
+	const gchar *directories[] = { "a/b", "a", "", NULL };
+	const gchar *files[] = { "file1", "a/file2", "a/b/file3", NULL };
+	gchar *path, *subdirectory;
+	GFile *root;
+	gint i;
+
+	path = g_build_filename (g_get_tmp_dir (), "tracker-crawler-test-XXXXXX", NULL);
+	path = g_mkdtemp (path);
+	g_assert (path != NULL);
+
+	subdirectory = g_build_filename (path, "a", "b", NULL);
+	g_assert_cmpint (g_mkdir_with_parents (subdirectory, 0700), ==, 0);
+	g_free (subdirectory);
+
+	root = g_file_new_for_path (path);
+	g_free (path);
+
+	for (i = 0; files[i]; i++) {
+		GFile *file;
+
+		file = g_file_resolve_relative_path (root, files[i]);
+		g_assert (g_file_replace_contents (file, "x", 1, NULL, FALSE,
+		                                   G_FILE_CREATE_NONE,
+		                                   NULL, NULL, NULL));
+		g_object_unref (file);
+	}
+
+	/* Deepest first, setting the mtime doesn't modify the parent */
+	for (i = 0; directories[i]; i++) {
+		GFile *directory;
+
+		if (*directories[i]) {
+			directory = g_file_resolve_relative_path (root, directories[i]);
+		} else {
+			directory = g_object_ref (root);
+		}
+
+		g_assert (g_file_set_attribute_uint64 (directory,
+		                                       G_FILE_ATTRIBUTE_TIME_MODIFIED,
+		                                       time (NULL) - 3600,
+		                                       G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+		                                       NULL, NULL));
+		g_object_unref (directory);
+	}
+
+	return root;
+}
+
+static void
+snapshot_tree_free (GFile *root)
+{
+	gchar *path, *command;
+
+	path = g_file_get_path (root);
+	command = g_strdup_printf ("rm -rf '%s'", path);
+	g_assert_cmpint (system (command), ==, 0);
+
+	g_free (command);
+	g_free (path);
+	g_object_unref (root);
+}
+
+static TrackerCrawler *
+snapshot_crawler_new (CrawlerTest *test)
+{
+	TrackerCrawler *crawler;
+
+	crawler = tracker_crawler_new ();
+	tracker_crawler_set_file_attributes (crawler, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+
+	g_signal_connect (crawler, "finished",
+			  G_CALLBACK (crawler_finished_cb), test);
+	g_signal_connect (crawler, "directory-crawled",
+			  G_CALLBACK (crawler_directory_crawled_cb), test);
+	g_signal_connect (crawler, "check-file",
+			  G_CALLBACK (crawler_check_file_cb), test);
+
+	return crawler;
+}
+
+static void
+snapshot_crawl (TrackerCrawler *crawler,
+                CrawlerTest    *test,
+                GFile          *root)
+{
+	test->n_check_file = 0;
+	test->main_loop = g_main_loop_new (NULL, FALSE);
+
+	g_assert (tracker_crawler_start (crawler, root, TRUE));
+	g_main_loop_run (test->main_loop);
+
+	g_assert_cmpint (test->interrupted, ==, 0);
+	g_assert_cmpint (test->directories_found, ==, 3);
+
+	g_main_loop_unref (test->main_loop);
+	test->main_loop = NULL;
+}
+
+static void
+test_crawler_snapshot_unchanged (void)
+{
+	TrackerCrawler *crawler;
+	CrawlerTest test = { 0 };
+	GFile *root, *snapshot;
+	gchar *path, *snapshot_path;
+
+	root = snapshot_tree_new ();
+	path = g_file_get_path (root);
+	snapshot_path = g_strconcat (path, ".snapshot", NULL);
+	snapshot = g_file_new_for_path (snapshot_path);
+	g_free (snapshot_path);
+	g_free (path);
+
+	crawler = snapshot_crawler_new (&test);
+	tracker_crawler_set_snapshot_config_hash (crawler, 1);
+
+	snapshot_crawl (crawler, &test, root);
+	g_assert_cmpint (test.n_check_file, ==, 3);
+
+	/* No directory changed, only subdirectories are reported */
+	snapshot_crawl (crawler, &test, root);
+	g_assert_cmpint (test.n_check_file, ==, 0);
+	g_assert (tracker_crawler_get_snapshot_info (crawler, root, NULL, NULL));
+
+	g_assert (tracker_crawler_save_snapshot (crawler, snapshot, NULL));
+	g_object_unref (crawler);
+
+	/* The same goes for a new crawler loading the snapshot */
+	crawler = snapshot_crawler_new (&test);
+	g_assert (tracker_crawler_load_snapshot (crawler, snapshot, NULL));
+	tracker_crawler_set_snapshot_config_hash (crawler, 1);
+
+	snapshot_crawl (crawler, &test, root);
+	g_assert_cmpint (test.n_check_file, ==, 0);
+
+	g_object_unref (crawler);
+	g_file_delete (snapshot, NULL, NULL);
+	g_object_unref (snapshot);
+	snapshot_tree_free (root);
+}
+
+static void
+test_crawler_snapshot_config_changed (void)
+{
+	TrackerIndexingTree *indexing_tree;
+	TrackerCrawler *crawler;
+	CrawlerTest test = { 0 };
+	guint32 config_hash;
+	GFile *root;
+
+	root = snapshot_tree_new ();
+	indexing_tree = tracker_indexing_tree_new ();
+	tracker_indexing_tree_add (indexing_tree, root,
+	                           TRACKER_DIRECTORY_FLAG_RECURSE);
+
+	crawler = snapshot_crawler_new (&test);
+	config_hash = tracker_indexing_tree_get_config_hash (indexing_tree);
+	tracker_crawler_set_snapshot_config_hash (crawler, config_hash);
+
+	snapshot_crawl (crawler, &test, root);
+	g_assert_cmpint (test.n_check_file, ==, 3);
+
+	/* A new filter discards the snapshot */
+	tracker_indexing_tree_add_filter (indexing_tree,
+	                                  TRACKER_FILTER_FILE, "*.foo");
+	g_assert_cmpuint (tracker_indexing_tree_get_config_hash (indexing_tree), !=, config_hash);
+
+	config_hash = tracker_indexing_tree_get_config_hash (indexing_tree);
+	tracker_crawler_set_snapshot_config_hash (crawler, config_hash);
+
+	snapshot_crawl (crawler, &test, root);
+	g_assert_cmpint (test.n_check_file, ==, 3);
+
+	/* But is used again while the configuration is the same */
+	tracker_crawler_set_snapshot_config_hash (crawler, config_hash);
+
+	snapshot_crawl (crawler, &test, root);
+	g_assert_cmpint (test.n_check_file, ==, 0);
+
+	g_object_unref (crawler);
+	g_object_unref (indexing_tree);
+	snapshot_tree_free (root);
+}
+
+static void
+test_crawler_snapshot_disabled (void)
+{
+	TrackerCrawler *crawler;
+	CrawlerTest test = { 0 };
+	GFile *root;
+
+	root = snapshot_tree_new ();
+
+	crawler = snapshot_crawler_new (&test);
+	tracker_crawler_set_snapshot_config_hash (crawler, 1);
+
+	snapshot_crawl (crawler, &test, root);
+	g_assert_cmpint (test.n_check_file, ==, 3);
+
+	/* e.g. mtime checks were requested, everything is enumerated */
+	tracker_crawler_set_use_snapshot (crawler, FALSE);
+
+	snapshot_crawl (crawler, &test, root);
+	g_assert_cmpint (test.n_check_file, ==, 3);
+	g_assert (!tracker_crawler_get_snapshot_info (crawler, root, NULL, NULL));
+
+	tracker_crawler_set_use_snapshot (crawler, TRUE);
+
+	snapshot_crawl (crawler, &test, root);
+	g_assert_cmpint (test.n_check_file, ==, 0);
+
+	g_object_unref (crawler);
+	snapshot_tree_free (root);
+}
+
 int
 main (int    argc,
       char **argv)
@@ -341,5 +576,12 @@ main (int    argc,
 	g_test_add_func ("/libtracker-miner/tracker-crawler/crawl-n-signals-non-recursive",
 	                 test_crawler_crawl_n_signals_non_recursive);
 
+	g_test_add_func ("/libtracker-miner/tracker-crawler/snapshot-unchanged",
+	                 test_crawler_snapshot_unchanged);
+	g_test_add_func ("/libtracker-miner/tracker-crawler/snapshot-config-changed",
+	                 test_crawler_snapshot_config_changed);
+	g_test_add_func ("/libtracker-miner/tracker-crawler/snapshot-disabled",
+	                 test_crawler_snapshot_disabled);
+
 	return g_test_run ();
 }
@@ -0,0 +1,229 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+/* NOTE: We're not including tracker-miner.h here because this is private. */
+#include <libtracker-miner/tracker-directory-snapshot.h>
+
+static GFile *
+snapshot_file_new (void)
+{
+	GFile *file;
+	gchar *basename, *path;
+
+	basename = g_strdup_printf ("tracker-directory-snapshot-test-%d", getpid ());
+	path = g_build_filename (g_get_tmp_dir (), basename, NULL);
+	file = g_file_new_for_path (path);
+
+	g_free (path);
+	g_free (basename);
+
+	return file;
+}
+
+static void
+test_directory_snapshot_save_load (void)
+{
+	TrackerDirectorySnapshot *snapshot;
+	const gchar *subdirectories[] = { "a", "b", NULL };
+	const gchar * const *loaded;
+	GFile *file, *dir;
+	GError *error = NULL;
+	guint64 mtime;
+	guint n_children;
+	guint32 names_hash;
+
+	file = snapshot_file_new ();
+	dir = g_file_new_for_path ("/home/user/Documents");
+
+	snapshot = tracker_directory_snapshot_new ();
+	g_assert (!tracker_directory_snapshot_is_dirty (snapshot));
+
+	tracker_directory_snapshot_set (snapshot, dir, 1234, 5, 42, subdirectories);
+	g_assert (tracker_directory_snapshot_is_dirty (snapshot));
+
+	tracker_directory_snapshot_save (snapshot, file, &error);
+	g_assert_no_error (error);
+	g_assert (!tracker_directory_snapshot_is_dirty (snapshot));
+	tracker_directory_snapshot_free (snapshot);
+
+	snapshot = tracker_directory_snapshot_new ();
+	tracker_directory_snapshot_load (snapshot, file, &error);
+	g_assert_no_error (error);
+
+	g_assert (tracker_directory_snapshot_lookup (snapshot, dir,
+	                                             &mtime, &n_children,
+	                                             &names_hash, &loaded));
+	g_assert_cmpuint (mtime, ==, 1234);
+	g_assert_cmpuint (n_children, ==, 5);
+	g_assert_cmpuint (names_hash, ==, 42);
+	g_assert_cmpstr (loaded[0], ==, "a");
+	g_assert_cmpstr (loaded[1], ==, "b");
+	g_assert (loaded[2] == NULL);
+
+	tracker_directory_snapshot_free (snapshot);
+
+	g_file_delete (file, NULL, NULL);
+	g_object_unref (file);
+	g_object_unref (dir);
+}
+
+static void
+test_directory_snapshot_invalid (void)
+{
+	TrackerDirectorySnapshot *snapshot;
+	GFile *file, *dir;
+	GError *error = NULL;
+
+	file = snapshot_file_new ();
+	dir = g_file_new_for_path ("/home/user/Documents");
+
+	g_file_replace_contents (file, "garbage", 7, NULL, FALSE,
+	                         G_FILE_CREATE_NONE, NULL, NULL, &error);
+	g_assert_no_error (error);
+
+	snapshot = tracker_directory_snapshot_new ();
+	tracker_directory_snapshot_set (snapshot, dir, 1234, 0, 0, NULL);
+
+	/* Loading fails and leaves the snapshot empty */
+	g_assert (!tracker_directory_snapshot_load (snapshot, file, &error));
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_clear_error (&error);
+
+	g_assert (!tracker_directory_snapshot_lookup (snapshot, dir,
+	                                              NULL, NULL, NULL, NULL));
+
+	g_file_delete (file, NULL, NULL);
+
+	g_assert (!tracker_directory_snapshot_load (snapshot, file, &error));
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+	g_clear_error (&error);
+
+	tracker_directory_snapshot_free (snapshot);
+	g_object_unref (file);
+	g_object_unref (dir);
+}
+
+static void
+test_directory_snapshot_remove (void)
+{
+	TrackerDirectorySnapshot *snapshot;
+	GFile *parent, *child, *sibling;
+
+	parent = g_file_new_for_path ("/home/user/Documents");
+	child = g_file_new_for_path ("/home/user/Documents/Work");
+	sibling = g_file_new_for_path ("/home/user/Documents2");
+
+	snapshot = tracker_directory_snapshot_new ();
+	tracker_directory_snapshot_set (snapshot, parent, 1, 0, 0, NULL);
+	tracker_directory_snapshot_set (snapshot, child, 1, 0, 0, NULL);
+	tracker_directory_snapshot_set (snapshot, sibling, 1, 0, 0, NULL);
+
+	tracker_directory_snapshot_remove (snapshot, parent, FALSE);
+	g_assert (!tracker_directory_snapshot_lookup (snapshot, parent, NULL, NULL, NULL, NULL));
+	g_assert (tracker_directory_snapshot_lookup (snapshot, child, NULL, NULL, NULL, NULL));
+
+	tracker_directory_snapshot_set (snapshot, parent, 1, 0, 0, NULL);
+	tracker_directory_snapshot_remove (snapshot, parent, TRUE);
+	g_assert (!tracker_directory_snapshot_lookup (snapshot, parent, NULL, NULL, NULL, NULL));
+	g_assert (!tracker_directory_snapshot_lookup (snapshot, child, NULL, NULL, NULL, NULL));
+	g_assert (tracker_directory_snapshot_lookup (snapshot, sibling, NULL, NULL, NULL, NULL));
+
+	tracker_directory_snapshot_free (snapshot);
+	g_object_unref (parent);
+	g_object_unref (child);
+	g_object_unref (sibling);
+}
+
+static void
+test_directory_snapshot_config_hash (void)
+{
+	TrackerDirectorySnapshot *snapshot;
+	GFile *file, *dir;
+
+	file = snapshot_file_new ();
+	dir = g_file_new_for_path ("/home/user/Documents");
+
+	snapshot = tracker_directory_snapshot_new ();
+	tracker_directory_snapshot_set_config_hash (snapshot, 42);
+	tracker_directory_snapshot_set (snapshot, dir, 1, 0, 0, NULL);
+	g_assert (tracker_directory_snapshot_save (snapshot, file, NULL));
+	tracker_directory_snapshot_free (snapshot);
+
+	snapshot = tracker_directory_snapshot_new ();
+	g_assert (tracker_directory_snapshot_load (snapshot, file, NULL));
+	g_assert_cmpuint (tracker_directory_snapshot_get_config_hash (snapshot), ==, 42);
+
+	/* Same configuration keeps the entries */
+	tracker_directory_snapshot_set_config_hash (snapshot, 42);
+	g_assert (!tracker_directory_snapshot_is_dirty (snapshot));
+	g_assert (tracker_directory_snapshot_lookup (snapshot, dir, NULL, NULL, NULL, NULL));
+
+	/* A different one discards them */
+	tracker_directory_snapshot_set_config_hash (snapshot, 43);
+	g_assert (tracker_directory_snapshot_is_dirty (snapshot));
+	g_assert (!tracker_directory_snapshot_lookup (snapshot, dir, NULL, NULL, NULL, NULL));
+	g_assert_cmpuint (tracker_directory_snapshot_get_config_hash (snapshot), ==, 43);
+
+	tracker_directory_snapshot_free (snapshot);
+	g_file_delete (file, NULL, NULL);
+	g_object_unref (file);
+	g_object_unref (dir);
+}
+
+static void
+test_directory_snapshot_hash_name (void)
+{
+	guint32 hash1, hash2;
+
+	/* Names hash doesn't depend on the order of the children */
+	hash1 = tracker_directory_snapshot_hash_name ("a") +
+		tracker_directory_snapshot_hash_name ("b");
+	hash2 = tracker_directory_snapshot_hash_name ("b") +
+		tracker_directory_snapshot_hash_name ("a");
+	g_assert_cmpuint (hash1, ==, hash2);
+
+	g_assert_cmpuint (tracker_directory_snapshot_hash_name ("a"), !=,
+	                  tracker_directory_snapshot_hash_name ("b"));
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+	g_type_init ();
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_message ("Testing directory snapshot");
+
+	g_test_add_func ("/libtracker-miner/directory-snapshot/save-load",
+	                 test_directory_snapshot_save_load);
+	g_test_add_func ("/libtracker-miner/directory-snapshot/invalid",
+	                 test_directory_snapshot_invalid);
+	g_test_add_func ("/libtracker-miner/directory-snapshot/remove",
+	                 test_directory_snapshot_remove);
+	g_test_add_func ("/libtracker-miner/directory-snapshot/config-hash",
+	                 test_directory_snapshot_config_hash);
+	g_test_add_func ("/libtracker-miner/directory-snapshot/hash-name",
+	                 test_directory_snapshot_hash_name);
+
+	return g_test_run ();
+}
@@ -37,7 +37,8 @@ typedef enum {
 	MONITOR_SIGNAL_ITEM_ATTRIBUTE_UPDATED = 1 << 2,
 	MONITOR_SIGNAL_ITEM_DELETED           = 1 << 3,
 	MONITOR_SIGNAL_ITEM_MOVED_FROM        = 1 << 4,
-	MONITOR_SIGNAL_ITEM_MOVED_TO          = 1 << 5
+	MONITOR_SIGNAL_ITEM_MOVED_TO          = 1 << 5,
+	MONITOR_SIGNAL_DIRECTORY_OVERFLOWED   = 1 << 6
 } MonitorSignal;
 
 /* Fixture object type */
@@ -198,6 +199,26 @@ test_monitor_events_moved_cb (TrackerMonitor *monitor,
 	           MONITOR_SIGNAL_ITEM_MOVED_TO);
 }
 
+static void
+test_monitor_events_overflowed_cb (TrackerMonitor *monitor,
+                                   GFile          *directory,
+                                   gpointer        user_data)
+{
+	gchar *path;
+
+	g_assert (directory != NULL);
+	path = g_file_get_path (directory);
+	g_assert (path != NULL);
+
+	g_debug ("***** '%s' (DIR) (OVERFLOWED)", path);
+
+	g_free (path);
+
+	add_event ((GHashTable *) user_data,
+	           directory,
+	           MONITOR_SIGNAL_DIRECTORY_OVERFLOWED);
+}
+
 static void
 test_monitor_common_setup (TrackerMonitorTestFixture *fixture,
                            gconstpointer              data)
@@ -229,6 +250,9 @@ test_monitor_common_setup (TrackerMonitorTestFixture *fixture,
 	g_signal_connect (fixture->monitor, "item-moved",
 	                  G_CALLBACK (test_monitor_events_moved_cb),
 	                  fixture->events);
+	g_signal_connect (fixture->monitor, "directory-overflowed",
+	                  G_CALLBACK (test_monitor_events_overflowed_cb),
+	                  fixture->events);
 
 	/* Initially, set it disabled */
 	tracker_monitor_set_enabled (fixture->monitor, FALSE);
@@ -1205,6 +1229,137 @@ test_monitor_file_event_blacklisting_attribute_updated_moved (TrackerMonitorTest
 	g_free (dest_path);
 }
 
+static void
+test_monitor_file_event_storm (TrackerMonitorTestFixture *fixture,
+                               gconstpointer              data)
+{
+	GPtrArray *test_files;
+	guint directory_events;
+	guint i;
+
+	/* Set up environment */
+	tracker_monitor_set_enabled (fixture->monitor, TRUE);
+	g_hash_table_insert (fixture->events,
+	                     g_object_ref (fixture->monitored_directory_file),
+	                     GUINT_TO_POINTER (MONITOR_SIGNAL_NONE));
+
+	/* Create lots of files at once */
+	test_files = g_ptr_array_new_with_free_func (g_object_unref);
+
+	for (i = 0; i < 5000; i++) {
+		GFile *test_file;
+		gchar *name;
+
+		name = g_strdup_printf ("storm-%u.txt", i);
+		set_file_contents (fixture->monitored_directory, name, "foo", &test_file);
+		g_assert (test_file != NULL);
+		g_free (name);
+
+		g_hash_table_insert (fixture->events,
+		                     g_object_ref (test_file),
+		                     GUINT_TO_POINTER (MONITOR_SIGNAL_NONE));
+		g_ptr_array_add (test_files, test_file);
+	}
+
+	/* Wait for events */
+	events_wait (fixture);
+
+	/* The monitor may either report each file, or
+	 * ask for the directory to be crawled again.
+	 */
+	directory_events = GPOINTER_TO_UINT (g_hash_table_lookup (fixture->events,
+	                                                          fixture->monitored_directory_file));
+
+	for (i = 0; i < test_files->len; i++) {
+		guint file_events;
+
+		file_events = GPOINTER_TO_UINT (g_hash_table_lookup (fixture->events,
+		                                                     g_ptr_array_index (test_files, i)));
+
+		if ((directory_events & MONITOR_SIGNAL_DIRECTORY_OVERFLOWED) == 0) {
+			g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_CREATED), >, 0);
+		}
+
+		/* Fail if we got a MOVE or DELETE signal */
+		g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_MOVED_FROM), ==, 0);
+		g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_MOVED_TO), ==, 0);
+		g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_DELETED), ==, 0);
+	}
+
+	/* Cleanup environment */
+	tracker_monitor_set_enabled (fixture->monitor, FALSE);
+
+	/* Remove the test files */
+	for (i = 0; i < test_files->len; i++) {
+		g_assert_cmpint (g_file_delete (g_ptr_array_index (test_files, i), NULL, NULL), ==, TRUE);
+	}
+
+	g_ptr_array_unref (test_files);
+}
+
+static void
+test_monitor_file_event_queue_overflow (TrackerMonitorTestFixture *fixture,
+                                        gconstpointer              data)
+{
+	GFile *test_file, *after_file;
+	guint directory_events;
+	guint file_events;
+
+	/* Set up environment */
+	tracker_monitor_set_enabled (fixture->monitor, TRUE);
+	g_hash_table_insert (fixture->events,
+	                     g_object_ref (fixture->monitored_directory_file),
+	                     GUINT_TO_POINTER (MONITOR_SIGNAL_NONE));
+
+	/* Create a file, and overflow the queue before its events are read */
+	set_file_contents (fixture->monitored_directory, "overflow.txt", "foo", &test_file);
+	g_assert (test_file != NULL);
+	g_hash_table_insert (fixture->events,
+	                     g_object_ref (test_file),
+	                     GUINT_TO_POINTER (MONITOR_SIGNAL_NONE));
+
+	if (!tracker_monitor_inject_queue_overflow (fixture->monitor)) {
+		/* GIO monitors deal with overflows themselves */
+		tracker_monitor_set_enabled (fixture->monitor, FALSE);
+		g_assert_cmpint (g_file_delete (test_file, NULL, NULL), ==, TRUE);
+		g_object_unref (test_file);
+		return;
+	}
+
+	/* Wait for events */
+	events_wait (fixture);
+
+	/* The directory must be crawled again... */
+	directory_events = GPOINTER_TO_UINT (g_hash_table_lookup (fixture->events,
+	                                                          fixture->monitored_directory_file));
+	g_assert_cmpuint ((directory_events & MONITOR_SIGNAL_DIRECTORY_OVERFLOWED), >, 0);
+
+	/* ...and that covers the events in it */
+	file_events = GPOINTER_TO_UINT (g_hash_table_lookup (fixture->events, test_file));
+	g_assert_cmpuint (file_events, ==, MONITOR_SIGNAL_NONE);
+
+	/* Events after the recrawl are reported again */
+	set_file_contents (fixture->monitored_directory, "after-overflow.txt", "foo", &after_file);
+	g_assert (after_file != NULL);
+	g_hash_table_insert (fixture->events,
+	                     g_object_ref (after_file),
+	                     GUINT_TO_POINTER (MONITOR_SIGNAL_NONE));
+
+	events_wait (fixture);
+
+	file_events = GPOINTER_TO_UINT (g_hash_table_lookup (fixture->events, after_file));
+	g_assert_cmpuint ((file_events & MONITOR_SIGNAL_ITEM_CREATED), >, 0);
+
+	/* Cleanup environment */
+	tracker_monitor_set_enabled (fixture->monitor, FALSE);
+
+	/* Remove the test files */
+	g_assert_cmpint (g_file_delete (test_file, NULL, NULL), ==, TRUE);
+	g_object_unref (test_file);
+	g_assert_cmpint (g_file_delete (after_file, NULL, NULL), ==, TRUE);
+	g_object_unref (after_file);
+}
+
 /* ----------------------------- DIRECTORY EVENT TESTS --------------------------------- */
 
 static void
@@ -1970,6 +2125,18 @@ main (gint    argc,
 	            test_monitor_common_setup,
 	            test_monitor_file_event_blacklisting_attribute_updated_moved,
 	            test_monitor_common_teardown);
+	g_test_add ("/libtracker-miner/tracker-monitor/file-event/storm",
+	            TrackerMonitorTestFixture,
+	            NULL,
+	            test_monitor_common_setup,
+	            test_monitor_file_event_storm,
+	            test_monitor_common_teardown);
+	g_test_add ("/libtracker-miner/tracker-monitor/file-event/queue-overflow",
+	            TrackerMonitorTestFixture,
+	            NULL,
+	            test_monitor_common_setup,
+	            test_monitor_file_event_queue_overflow,
+	            test_monitor_common_teardown);
 
 	/* Directory Event tests */
 	g_test_add ("/libtracker-miner/tracker-monitor/directory-event/created",
@@ -165,6 +165,71 @@ test_task_pool_foreach (void)
         g_assert_cmpint (counter, ==, 3);
 }
 
+static void
+remove_element_cb (gpointer data,
+                   gpointer user_data)
+{
+        TrackerTaskPool *pool = user_data;
+
+        g_assert (tracker_task_pool_remove (pool, data));
+}
+
+static void
+test_task_pool_foreach_under (void)
+{
+        TrackerTaskPool *pool;
+        GFile *dir;
+        int counter = 0;
+
+        pool = tracker_task_pool_new (10);
+
+        add_task (pool, "/home/user", 1, FALSE);
+        add_task (pool, "/home/user/a", 2, FALSE);
+        add_task (pool, "/home/user/a/b", 3, FALSE);
+        add_task (pool, "/home/user-other", 4, FALSE);
+        add_task (pool, "/home/user2/a", 5, FALSE);
+        add_task (pool, "/home/use", 6, FALSE);
+
+        /* The directory itself and its descendants, not siblings
+         * sharing a name prefix */
+        dir = g_file_new_for_path ("/home/user");
+        tracker_task_pool_foreach_under (pool, dir, count_elements_cb, &counter);
+        g_assert_cmpint (counter, ==, 3);
+
+        /* Tasks can be removed from the callback */
+        tracker_task_pool_foreach_under (pool, dir, remove_element_cb, pool);
+        g_assert_cmpint (tracker_task_pool_get_size (pool), ==, 3);
+        g_object_unref (dir);
+
+        counter = 0;
+        dir = g_file_new_for_path ("/");
+        tracker_task_pool_foreach_under (pool, dir, count_elements_cb, &counter);
+        g_assert_cmpint (counter, ==, 3);
+        g_object_unref (dir);
+
+        g_object_unref (pool);
+}
+
+static void
+test_task_creation_time (void)
+{
+        TrackerTask *task;
+        GFile *file;
+        gint64 before, after;
+
+        file = g_file_new_for_path ("/dev/null");
+
+        before = g_get_monotonic_time ();
+        task = tracker_task_new (file, NULL, NULL);
+        after = g_get_monotonic_time ();
+
+        g_assert_cmpint (tracker_task_get_creation_time (task), >=, before);
+        g_assert_cmpint (tracker_task_get_creation_time (task), <=, after);
+
+        tracker_task_unref (task);
+        g_object_unref (file);
+}
+
 gint
 main (gint argc, gchar **argv)
 {
@@ -183,5 +248,11 @@ main (gint argc, gchar **argv)
         g_test_add_func ("/libtracker-miner/tracker-task-pool/foreach",
                          test_task_pool_foreach);
 
+        g_test_add_func ("/libtracker-miner/tracker-task-pool/foreach_under",
+                         test_task_pool_foreach_under);
+
+        g_test_add_func ("/libtracker-miner/tracker-task-pool/creation_time",
+                         test_task_creation_time);
+
         return g_test_run ();
 }
@@ -117,6 +117,176 @@ test_tracker_sparql_escape_uri_vprintf (void)
 	g_free (result);
 }
 
+static void
+test_tracker_sparql_builder_triples (void)
+{
+	TrackerSparqlBuilder *builder, *update;
+	GVariant *triples, *appended;
+	const gchar *graph, *subject, *predicate, *object, *blank_node;
+	gboolean object_is_iri;
+
+	builder = tracker_sparql_builder_new_embedded_insert ();
+	tracker_sparql_builder_predicate (builder, "a");
+	tracker_sparql_builder_object (builder, "nfo:Document");
+	tracker_sparql_builder_predicate (builder, "nie:title");
+	tracker_sparql_builder_object_string (builder, "A \"title\"");
+	tracker_sparql_builder_predicate (builder, "nco:creator");
+	tracker_sparql_builder_object_blank_open (builder);
+	tracker_sparql_builder_predicate (builder, "a");
+	tracker_sparql_builder_object (builder, "nco:Contact");
+	tracker_sparql_builder_object_blank_close (builder);
+	tracker_sparql_builder_predicate (builder, "nfo:pageCount");
+	tracker_sparql_builder_object_int64 (builder, 12);
+
+	triples = tracker_sparql_builder_get_triples (builder);
+	g_assert (triples != NULL);
+	g_assert_cmpuint (g_variant_n_children (triples), ==, 5);
+
+	g_variant_get_child (triples, 1, "(&s&s&s&sb)", &graph, &subject, &predicate, &object, &object_is_iri);
+	g_assert_cmpstr (subject, ==, "");
+	g_assert_cmpstr (object, ==, "A \"title\"");
+	g_assert (!object_is_iri);
+
+	/* Statements of the blank node come before the link */
+	g_variant_get_child (triples, 2, "(&s&s&s&sb)", &graph, &blank_node, &predicate, &object, &object_is_iri);
+	g_assert (blank_node[0] == ':');
+	g_assert_cmpstr (object, ==, "nco:Contact");
+	g_variant_get_child (triples, 3, "(&s&s&s&sb)", &graph, &subject, &predicate, &object, &object_is_iri);
+	g_assert_cmpstr (subject, ==, "");
+	g_assert_cmpstr (object, ==, blank_node);
+	g_assert (object_is_iri);
+
+	update = tracker_sparql_builder_new_update ();
+	tracker_sparql_builder_append_triples (update, "urn:graph", "<urn:file>", triples);
+	appended = tracker_sparql_builder_get_triples (update);
+	g_assert_cmpuint (g_variant_n_children (appended), ==, 5);
+	g_variant_get_child (appended, 0, "(&s&s&s&sb)", &graph, &subject, &predicate, &object, &object_is_iri);
+	g_assert_cmpstr (graph, ==, "urn:graph");
+	g_assert_cmpstr (subject, ==, "<urn:file>");
+	g_variant_unref (appended);
+	g_object_unref (update);
+
+	/* Raw content can't be represented */
+	tracker_sparql_builder_append (builder, "nie:comment ?c");
+	g_assert (tracker_sparql_builder_get_triples (builder) == NULL);
+
+	g_variant_unref (triples);
+	g_object_unref (builder);
+}
+
+static void
+test_tracker_sparql_update_triples_cb (GObject      *source,
+                                       GAsyncResult *result,
+                                       gpointer      user_data)
+{
+	GPtrArray *errors;
+	GError *error = NULL;
+	guint i;
+
+	errors = tracker_sparql_connection_update_array_with_triples_finish (TRACKER_SPARQL_CONNECTION (source),
+	                                                                     result, &error);
+	g_assert_no_error (error);
+	g_assert (errors != NULL);
+
+	for (i = 0; i < errors->len; i++) {
+		g_assert (g_ptr_array_index (errors, i) == NULL);
+	}
+
+	g_ptr_array_unref (errors);
+	g_main_loop_quit (user_data);
+}
+
+static void
+test_tracker_sparql_update_triples_blank_nodes (void)
+{
+	TrackerSparqlConnection *connection;
+	TrackerSparqlCursor *cursor;
+	GVariantBuilder variant_builder;
+	GMainLoop *loop;
+	GError *error = NULL;
+	gchar *updates[2], *creators[2];
+	gint i;
+
+	connection = tracker_sparql_connection_get (NULL, &error);
+	g_assert_no_error (error);
+
+	g_variant_builder_init (&variant_builder, G_VARIANT_TYPE ("aa(ssssb)"));
+
+	/* Two updates with the same anonymous blank node, which must
+	 * end up as two different resources.
+	 */
+	for (i = 0; i < 2; i++) {
+		TrackerSparqlBuilder *builder, *update;
+		GVariant *triples;
+		gchar *subject;
+
+		updates[i] = g_strdup_printf ("DELETE { <urn:test:triples:%d> a rdfs:Resource } "
+		                              "WHERE { <urn:test:triples:%d> a rdfs:Resource }",
+		                              i, i);
+
+		builder = tracker_sparql_builder_new_embedded_insert ();
+		tracker_sparql_builder_predicate (builder, "a");
+		tracker_sparql_builder_object (builder, "nfo:Document");
+		tracker_sparql_builder_predicate (builder, "nco:creator");
+		tracker_sparql_builder_object_blank_open (builder);
+		tracker_sparql_builder_predicate (builder, "a");
+		tracker_sparql_builder_object (builder, "nco:Contact");
+		tracker_sparql_builder_predicate (builder, "nco:fullname");
+		tracker_sparql_builder_object_string (builder, "Same Author");
+		tracker_sparql_builder_object_blank_close (builder);
+
+		triples = tracker_sparql_builder_get_triples (builder);
+		g_assert (triples != NULL);
+
+		subject = g_strdup_printf ("<urn:test:triples:%d>", i);
+		update = tracker_sparql_builder_new_update ();
+		tracker_sparql_builder_append_triples (update, NULL, subject, triples);
+		g_variant_unref (triples);
+		g_free (subject);
+
+		triples = tracker_sparql_builder_get_triples (update);
+		g_variant_builder_add_value (&variant_builder, triples);
+		g_variant_unref (triples);
+
+		g_object_unref (update);
+		g_object_unref (builder);
+	}
+
+	loop = g_main_loop_new (NULL, FALSE);
+	tracker_sparql_connection_update_array_with_triples_async (connection,
+	                                                           updates, 2,
+	                                                           g_variant_builder_end (&variant_builder),
+	                                                           G_PRIORITY_DEFAULT,
+	                                                           NULL,
+	                                                           test_tracker_sparql_update_triples_cb,
+	                                                           loop);
+	g_main_loop_run (loop);
+	g_main_loop_unref (loop);
+
+	for (i = 0; i < 2; i++) {
+		gchar *query;
+
+		query = g_strdup_printf ("SELECT ?c WHERE { <urn:test:triples:%d> nco:creator ?c }", i);
+		cursor = tracker_sparql_connection_query (connection, query, NULL, &error);
+		g_assert_no_error (error);
+		g_free (query);
+
+		g_assert (tracker_sparql_cursor_next (cursor, NULL, &error));
+		g_assert_no_error (error);
+
+		creators[i] = g_strdup (tracker_sparql_cursor_get_string (cursor, 0, NULL));
+		g_assert (g_str_has_prefix (creators[i], "urn:uuid:"));
+		g_object_unref (cursor);
+		g_free (updates[i]);
+	}
+
+	g_assert_cmpstr (creators[0], !=, creators[1]);
+
+	g_free (creators[0]);
+	g_free (creators[1]);
+	g_object_unref (connection);
+}
+
 #if HAVE_TRACKER_FTS
 
 static void test_tracker_sparql_cursor_next_async_query (gint query);
@@ -352,6 +522,63 @@ test_tracker_sparql_connection_interleaved (void)
 	g_object_unref(cursor1);
 }
 
+static void
+test_tracker_sparql_cursor_next_n (void)
+{
+	GError *error = NULL;
+	TrackerSparqlCursor *cursor, *batch_cursor;
+	TrackerSparqlConnection *connection;
+	TrackerSparqlValueType types[2 * 7];
+	gchar *values[2 * 7] = { NULL, };
+	gint n_rows, row, i;
+	gint total = 0;
+
+	const gchar* query = "SELECT ?prefix ?ns WHERE { ?ns a tracker:Namespace ; tracker:prefix ?prefix }";
+
+	connection = tracker_sparql_connection_get (NULL, &error);
+	g_assert_no_error (error);
+
+	cursor = tracker_sparql_connection_query (connection, query, 0, &error);
+	g_assert_no_error (error);
+
+	batch_cursor = tracker_sparql_connection_query (connection, query, 0, &error);
+	g_assert_no_error (error);
+
+	/* Batches must return the same rows as iterating one by one */
+	do {
+		n_rows = tracker_sparql_cursor_next_n (batch_cursor,
+		                                       values, G_N_ELEMENTS (values),
+		                                       types, G_N_ELEMENTS (types),
+		                                       7, NULL, &error);
+		g_assert_no_error (error);
+		g_assert_cmpint (n_rows, <=, 7);
+
+		for (row = 0; row < n_rows; row++) {
+			g_assert (tracker_sparql_cursor_next (cursor, NULL, &error));
+			g_assert_no_error (error);
+
+			for (i = 0; i < 2; i++) {
+				g_assert_cmpstr (values[i * 7 + row], ==, tracker_sparql_cursor_get_string (cursor, i, NULL));
+				g_assert_cmpint (types[i * 7 + row], ==, tracker_sparql_cursor_get_value_type (cursor, i));
+			}
+		}
+
+		total += n_rows;
+	} while (n_rows == 7);
+
+	g_assert (!tracker_sparql_cursor_next (cursor, NULL, &error));
+	g_assert_no_error (error);
+	g_assert_cmpint (total, >, 0);
+
+	for (i = 0; i < G_N_ELEMENTS (values); i++) {
+		g_free (values[i]);
+	}
+
+	g_object_unref (batch_cursor);
+	g_object_unref (cursor);
+	g_object_unref (connection);
+}
+
 gint
 main (gint argc, gchar **argv)
 {
@@ -374,12 +601,18 @@ main (gint argc, gchar **argv)
 	                 test_tracker_sparql_escape_string);
 	g_test_add_func ("/libtracker-sparql/tracker/tracker_sparql_escape_uri_vprintf",
 	                 test_tracker_sparql_escape_uri_vprintf);
+	g_test_add_func ("/libtracker-sparql/tracker/tracker_sparql_builder_triples",
+	                 test_tracker_sparql_builder_triples);
 	g_test_add_func ("/libtracker-sparql/tracker/tracker_sparql_connection_interleaved",
 	                 test_tracker_sparql_connection_interleaved);
 	g_test_add_func ("/libtracker-sparql/tracker/tracker_sparql_connection_locking_sync",
 	                 test_tracker_sparql_connection_locking_sync);
 	g_test_add_func ("/libtracker-sparql/tracker/tracker_sparql_connection_locking_async",
 	                 test_tracker_sparql_connection_locking_async);
+	g_test_add_func ("/libtracker-sparql/tracker/tracker_sparql_cursor_next_n",
+	                 test_tracker_sparql_cursor_next_n);
+	g_test_add_func ("/libtracker-sparql/tracker/tracker_sparql_update_triples_blank_nodes",
+	                 test_tracker_sparql_update_triples_blank_nodes);
 
 #if HAVE_TRACKER_FTS
 	g_test_add_func ("/libtracker-sparql/tracker/tracker_sparql_cursor_next_async",
@@ -0,0 +1,270 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+
+#include "config.h"
+
+#include <glib/gstdio.h>
+
+#include "tracker-corpus.h"
+
+#define N_ARTISTS 50
+#define N_ALBUMS  200
+
+struct _TrackerCorpus {
+	GRand *rand;
+};
+
+static const gchar *words[] = {
+	"alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel",
+	"india", "juliet", "kilo", "lima", "mike", "november", "oscar", "papa",
+	"quebec", "romeo", "sierra", "tango", "uniform", "victor", "whiskey", "xray",
+	"yankee", "zulu", "river", "mountain", "forest", "desert", "ocean", "valley",
+	"summer", "winter", "autumn", "spring", "morning", "evening", "midnight", "noon",
+	"red", "green", "blue", "yellow", "purple", "orange", "silver", "golden",
+	"piano", "guitar", "violin", "drums", "trumpet", "flute", "cello", "organ",
+	"report", "invoice", "letter", "notes", "budget", "minutes", "draft", "summary"
+};
+
+static const gchar *mime_types[] = {
+	"text/plain", "image/jpeg", "image/png", "application/pdf",
+	"audio/mpeg", "video/mp4", "application/vnd.oasis.opendocument.text"
+};
+
+TrackerCorpus *
+tracker_corpus_new (guint32 seed)
+{
+	TrackerCorpus *corpus;
+
+	corpus = g_slice_new0 (TrackerCorpus);
+	corpus->rand = g_rand_new_with_seed (seed);
+
+	return corpus;
+}
+
+void
+tracker_corpus_free (TrackerCorpus *corpus)
+{
+	g_rand_free (corpus->rand);
+	g_slice_free (TrackerCorpus, corpus);
+}
+
+static const gchar *
+corpus_get_word (TrackerCorpus *corpus)
+{
+	return words[g_rand_int_range (corpus->rand, 0, G_N_ELEMENTS (words))];
+}
+
+/* Names of shared resources only depend on their number, so
+ * inserting them again does not change them */
+static gchar *
+corpus_get_name (guint n)
+{
+	return g_strdup_printf ("%s %s",
+	                        words[n % G_N_ELEMENTS (words)],
+	                        words[(n / G_N_ELEMENTS (words)) % G_N_ELEMENTS (words)]);
+}
+
+static gchar *
+corpus_get_date (TrackerCorpus *corpus)
+{
+	return g_strdup_printf ("%04d-%02d-%02dT%02d:%02d:%02dZ",
+	                        g_rand_int_range (corpus->rand, 2000, 2013),
+	                        g_rand_int_range (corpus->rand, 1, 13),
+	                        g_rand_int_range (corpus->rand, 1, 29),
+	                        g_rand_int_range (corpus->rand, 0, 24),
+	                        g_rand_int_range (corpus->rand, 0, 60),
+	                        g_rand_int_range (corpus->rand, 0, 60));
+}
+
+gchar *
+tracker_corpus_get_words (TrackerCorpus *corpus,
+                          guint          n_words)
+{
+	GString *str;
+	guint i;
+
+	str = g_string_new (NULL);
+
+	for (i = 0; i < n_words; i++) {
+		if (i > 0) {
+			g_string_append_c (str, ' ');
+		}
+
+		g_string_append (str, corpus_get_word (corpus));
+	}
+
+	return g_string_free (str, FALSE);
+}
+
+gchar *
+tracker_corpus_get_file (TrackerCorpus *corpus,
+                         guint          n)
+{
+	gchar *date, *sparql;
+
+	date = corpus_get_date (corpus);
+	sparql = g_strdup_printf ("INSERT { "
+	                          "  <urn:perf:file:%u> a nfo:FileDataObject ; "
+	                          "    nie:url \"file:///perf/dir-%u/file-%u\" ; "
+	                          "    nfo:fileName \"%s-%u\" ; "
+	                          "    nfo:fileSize %d ; "
+	                          "    nfo:fileLastModified \"%s\" ; "
+	                          "    nie:mimeType \"%s\" "
+	                          "}",
+	                          n,
+	                          n / 100, n,
+	                          corpus_get_word (corpus), n,
+	                          g_rand_int_range (corpus->rand, 0, 10 * 1024 * 1024),
+	                          date,
+	                          mime_types[g_rand_int_range (corpus->rand, 0, G_N_ELEMENTS (mime_types))]);
+	g_free (date);
+
+	return sparql;
+}
+
+gchar *
+tracker_corpus_get_file_update (TrackerCorpus *corpus,
+                                guint          n)
+{
+	gchar *date, *sparql;
+
+	date = corpus_get_date (corpus);
+	sparql = g_strdup_printf ("DELETE { "
+	                          "  <urn:perf:file:%u> nfo:fileSize ?size ; nfo:fileLastModified ?modified "
+	                          "} WHERE { "
+	                          "  <urn:perf:file:%u> nfo:fileSize ?size ; nfo:fileLastModified ?modified "
+	                          "} "
+	                          "INSERT { "
+	                          "  <urn:perf:file:%u> nfo:fileSize %d ; nfo:fileLastModified \"%s\" "
+	                          "}",
+	                          n, n, n,
+	                          g_rand_int_range (corpus->rand, 0, 10 * 1024 * 1024),
+	                          date);
+	g_free (date);
+
+	return sparql;
+}
+
+gchar *
+tracker_corpus_get_music (TrackerCorpus *corpus,
+                          guint          n)
+{
+	gchar *artist, *album, *title, *sparql;
+	guint artist_n, album_n;
+
+	artist_n = n % N_ARTISTS;
+	album_n = n % N_ALBUMS;
+
+	artist = corpus_get_name (artist_n);
+	album = corpus_get_name (album_n + N_ARTISTS);
+	title = tracker_corpus_get_words (corpus, g_rand_int_range (corpus->rand, 1, 5));
+
+	sparql = g_strdup_printf ("INSERT { "
+	                          "  <urn:perf:artist:%u> a nmm:Artist ; nmm:artistName \"%s\" . "
+	                          "  <urn:perf:album:%u> a nmm:MusicAlbum ; nmm:albumTitle \"%s\" . "
+	                          "  <urn:perf:music:%u> a nmm:MusicPiece, nfo:FileDataObject ; "
+	                          "    nie:url \"file:///perf/music/track-%u.mp3\" ; "
+	                          "    nie:title \"%s\" ; "
+	                          "    nmm:performer <urn:perf:artist:%u> ; "
+	                          "    nmm:musicAlbum <urn:perf:album:%u> ; "
+	                          "    nmm:trackNumber %u ; "
+	                          "    nfo:duration %d ; "
+	                          "    nfo:genre \"%s\" "
+	                          "}",
+	                          artist_n, artist,
+	                          album_n, album,
+	                          n,
+	                          n,
+	                          title,
+	                          artist_n,
+	                          album_n,
+	                          n / N_ALBUMS + 1,
+	                          g_rand_int_range (corpus->rand, 30, 600),
+	                          corpus_get_word (corpus));
+
+	g_free (artist);
+	g_free (album);
+	g_free (title);
+
+	return sparql;
+}
+
+gchar *
+tracker_corpus_get_text (TrackerCorpus *corpus,
+                         guint          n,
+                         guint          n_words)
+{
+	gchar *text, *sparql;
+
+	text = tracker_corpus_get_words (corpus, n_words);
+	sparql = g_strdup_printf ("INSERT { "
+	                          "  <urn:perf:text:%u> a nfo:PlainTextDocument, nfo:FileDataObject ; "
+	                          "    nie:url \"file:///perf/text/document-%u.txt\" ; "
+	                          "    nie:plainTextContent \"%s\" "
+	                          "}",
+	                          n, n, text);
+	g_free (text);
+
+	return sparql;
+}
+
+guint
+tracker_corpus_create_tree (TrackerCorpus *corpus,
+                            const gchar   *root,
+                            guint          depth,
+                            guint          n_dirs,
+                            guint          n_files)
+{
+	guint i, n_created = 0;
+
+	g_mkdir_with_parents (root, 0700);
+
+	for (i = 0; i < n_files; i++) {
+		gchar *name, *path, *contents;
+
+		name = g_strdup_printf ("%s-%u.txt", corpus_get_word (corpus), i);
+		path = g_build_filename (root, name, NULL);
+		contents = tracker_corpus_get_words (corpus, 16);
+
+		if (g_file_set_contents (path, contents, -1, NULL)) {
+			n_created++;
+		}
+
+		g_free (contents);
+		g_free (path);
+		g_free (name);
+	}
+
+	if (depth == 0) {
+		return n_created;
+	}
+
+	for (i = 0; i < n_dirs; i++) {
+		gchar *name, *path;
+
+		name = g_strdup_printf ("dir-%u", i);
+		path = g_build_filename (root, name, NULL);
+
+		n_created += tracker_corpus_create_tree (corpus, path, depth - 1, n_dirs, n_files);
+
+		g_free (path);
+		g_free (name);
+	}
+
+	return n_created;
+}
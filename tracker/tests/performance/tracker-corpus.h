@@ -0,0 +1,63 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+
+#ifndef __TRACKER_CORPUS_H__
+#define __TRACKER_CORPUS_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Deterministic synthetic data for the benchmarks, the same seed
+ * always produces the same updates and file trees so results of
+ * different builds can be compared.
+ */
+typedef struct _TrackerCorpus TrackerCorpus;
+
+TrackerCorpus *tracker_corpus_new         (guint32        seed);
+void           tracker_corpus_free        (TrackerCorpus *corpus);
+
+gchar *        tracker_corpus_get_words   (TrackerCorpus *corpus,
+                                           guint          n_words);
+
+/* SPARQL updates inserting the n-th item of each kind */
+gchar *        tracker_corpus_get_file    (TrackerCorpus *corpus,
+                                           guint          n);
+gchar *        tracker_corpus_get_music   (TrackerCorpus *corpus,
+                                           guint          n);
+gchar *        tracker_corpus_get_text    (TrackerCorpus *corpus,
+                                           guint          n,
+                                           guint          n_words);
+
+/* SPARQL update modifying the n-th item inserted by
+ * tracker_corpus_get_file() */
+gchar *        tracker_corpus_get_file_update (TrackerCorpus *corpus,
+                                               guint          n);
+
+/* Creates a tree @depth levels deep with @n_dirs subdirectories and
+ * @n_files files per directory, returns the number of files created */
+guint          tracker_corpus_create_tree (TrackerCorpus *corpus,
+                                           const gchar   *root,
+                                           guint          depth,
+                                           guint          n_dirs,
+                                           guint          n_files);
+
+G_END_DECLS
+
+#endif /* __TRACKER_CORPUS_H__ */
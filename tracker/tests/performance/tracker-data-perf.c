@@ -0,0 +1,402 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include <libtracker-common/tracker-common.h>
+
+#include <libtracker-data/tracker-data-manager.h>
+#include <libtracker-data/tracker-data-query.h>
+#include <libtracker-data/tracker-data-update.h>
+#include <libtracker-data/tracker-data.h>
+#include <libtracker-data/tracker-sparql-query.h>
+
+#include "tracker-corpus.h"
+
+/* Benchmarks of libtracker-data on a temporary database. Run with
+ * -m perf (or "make perf-report") for full size runs, results are
+ * reported through g_test_minimized_result() and
+ * g_test_maximized_result() so they end up in the gtester log.
+ */
+
+#define CORPUS_SEED       1
+#define BATCH_SIZE        100
+#define TEXT_WORDS        500
+#define QUERY_REPEATS     10
+
+typedef gchar * (* CorpusFunc) (TrackerCorpus *corpus,
+                                guint          n);
+
+static const gchar *queries[] = {
+	"SELECT ?url WHERE { ?f a nfo:FileDataObject ; nie:url ?url ; nie:mimeType \"text/plain\" }",
+	"SELECT ?title ?name WHERE { ?m a nmm:MusicPiece ; nie:title ?title ; nmm:performer ?a . ?a nmm:artistName ?name } ORDER BY ?name ?title LIMIT 50",
+	"SELECT ?album COUNT(?m) WHERE { ?m a nmm:MusicPiece ; nmm:musicAlbum ?a . ?a nmm:albumTitle ?album } GROUP BY ?album",
+	"SELECT ?f ?s WHERE { ?f a nfo:FileDataObject ; nfo:fileSize ?s FILTER (?s > 5000000) } ORDER BY DESC(?s) LIMIT 20",
+	NULL
+};
+
+static gchar *data_dir;
+static guint n_items;
+
+static void
+data_init (TrackerDBManagerFlags flags,
+           gboolean              journal_check)
+{
+	GError *error = NULL;
+
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+
+	tracker_data_manager_init (flags,
+	                           NULL,
+	                           NULL, journal_check, FALSE,
+	                           100, 100, NULL, NULL, NULL, &error);
+	g_assert_no_error (error);
+}
+
+static gchar *
+corpus_get_text (TrackerCorpus *corpus,
+                 guint          n)
+{
+	return tracker_corpus_get_text (corpus, n, TEXT_WORDS);
+}
+
+/* Runs @n_updates updates in transactions of BATCH_SIZE updates,
+ * like the miners do, returns the time spent in seconds. The
+ * updates are generated before starting the timer.
+ */
+static gdouble
+run_updates (TrackerCorpus *corpus,
+             CorpusFunc     func,
+             guint          n_updates)
+{
+	GPtrArray *batches;
+	GString *batch = NULL;
+	GTimer *timer;
+	gdouble elapsed;
+	guint i;
+
+	batches = g_ptr_array_new_with_free_func (g_free);
+
+	for (i = 0; i < n_updates; i++) {
+		gchar *sparql;
+
+		if (!batch) {
+			batch = g_string_new (NULL);
+		}
+
+		sparql = func (corpus, i);
+		g_string_append (batch, sparql);
+		g_string_append_c (batch, '\n');
+		g_free (sparql);
+
+		if ((i + 1) % BATCH_SIZE == 0 || i == n_updates - 1) {
+			g_ptr_array_add (batches, g_string_free (batch, FALSE));
+			batch = NULL;
+		}
+	}
+
+	timer = g_timer_new ();
+
+	for (i = 0; i < batches->len; i++) {
+		GError *error = NULL;
+
+		tracker_data_update_sparql (g_ptr_array_index (batches, i), &error);
+		g_assert_no_error (error);
+	}
+
+	elapsed = g_timer_elapsed (timer, NULL);
+
+	g_timer_destroy (timer);
+	g_ptr_array_free (batches, TRUE);
+
+	return elapsed;
+}
+
+/* Returns the number of rows */
+static guint
+run_query (const gchar *query)
+{
+	TrackerDBCursor *cursor;
+	GError *error = NULL;
+	guint n_rows = 0;
+
+	cursor = tracker_data_query_sparql_cursor (query, &error);
+	g_assert_no_error (error);
+
+	while (tracker_db_cursor_iter_next (cursor, NULL, &error)) {
+		n_rows++;
+	}
+
+	g_assert_no_error (error);
+	g_object_unref (cursor);
+
+	return n_rows;
+}
+
+static void
+test_insert (void)
+{
+	TrackerCorpus *corpus;
+	gdouble elapsed;
+
+	data_init (TRACKER_DB_MANAGER_FORCE_REINDEX, FALSE);
+	corpus = tracker_corpus_new (CORPUS_SEED);
+
+	elapsed = run_updates (corpus, tracker_corpus_get_file, n_items);
+	g_test_maximized_result (n_items / elapsed,
+	                         "Inserted %u files at %.1f items/s",
+	                         n_items, n_items / elapsed);
+
+	elapsed = run_updates (corpus, tracker_corpus_get_music, n_items);
+	g_test_maximized_result (n_items / elapsed,
+	                         "Inserted %u music pieces at %.1f items/s",
+	                         n_items, n_items / elapsed);
+
+	tracker_corpus_free (corpus);
+	tracker_data_manager_shutdown ();
+}
+
+static void
+test_update (void)
+{
+	TrackerCorpus *corpus;
+	gdouble elapsed;
+
+	data_init (TRACKER_DB_MANAGER_FORCE_REINDEX, FALSE);
+	corpus = tracker_corpus_new (CORPUS_SEED);
+
+	run_updates (corpus, tracker_corpus_get_file, n_items);
+
+	elapsed = run_updates (corpus, tracker_corpus_get_file_update, n_items);
+	g_test_maximized_result (n_items / elapsed,
+	                         "Updated %u files at %.1f items/s",
+	                         n_items, n_items / elapsed);
+
+	tracker_corpus_free (corpus);
+	tracker_data_manager_shutdown ();
+}
+
+#ifndef DISABLE_JOURNAL
+
+static void
+test_journal_replay (void)
+{
+	TrackerCorpus *corpus;
+	GTimer *timer;
+	gdouble elapsed;
+	gchar *path;
+
+	data_init (TRACKER_DB_MANAGER_FORCE_REINDEX, FALSE);
+	corpus = tracker_corpus_new (CORPUS_SEED);
+
+	run_updates (corpus, tracker_corpus_get_file, n_items);
+	run_updates (corpus, tracker_corpus_get_music, n_items);
+
+	tracker_corpus_free (corpus);
+	tracker_data_manager_shutdown ();
+
+	/* Drop the database, keep the journal */
+	path = g_build_filename (data_dir, "tracker", "meta.db", NULL);
+	g_unlink (path);
+	g_free (path);
+
+	path = g_build_filename (data_dir, "tracker", "data", ".meta.isrunning", NULL);
+	g_unlink (path);
+	g_free (path);
+
+	timer = g_timer_new ();
+	data_init (0, TRUE);
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_timer_destroy (timer);
+
+	g_assert_cmpint (run_query ("SELECT ?f WHERE { ?f a nmm:MusicPiece }"), ==, n_items);
+
+	g_test_minimized_result (elapsed,
+	                         "Replayed journal of %u items in %.3f s",
+	                         2 * n_items, elapsed);
+
+	tracker_data_manager_shutdown ();
+}
+
+#endif /* DISABLE_JOURNAL */
+
+#if HAVE_TRACKER_FTS
+
+static void
+test_fts (void)
+{
+	TrackerCorpus *corpus;
+	GTimer *timer;
+	gdouble elapsed;
+	guint n_texts, i;
+
+	data_init (TRACKER_DB_MANAGER_FORCE_REINDEX, FALSE);
+	corpus = tracker_corpus_new (CORPUS_SEED);
+
+	n_texts = MAX (n_items / 10, 1);
+
+	elapsed = run_updates (corpus, corpus_get_text, n_texts);
+	g_test_maximized_result (n_texts / elapsed,
+	                         "Indexed %u texts of %d words at %.1f items/s",
+	                         n_texts, TEXT_WORDS, n_texts / elapsed);
+
+	timer = g_timer_new ();
+
+	for (i = 0; i < QUERY_REPEATS; i++) {
+		gchar *word, *query;
+
+		word = tracker_corpus_get_words (corpus, 1);
+		query = g_strdup_printf ("SELECT ?d WHERE { ?d fts:match \"%s\" } ORDER BY fts:rank(?d) LIMIT 50",
+		                         word);
+		run_query (query);
+		g_free (query);
+		g_free (word);
+	}
+
+	elapsed = g_timer_elapsed (timer, NULL) / QUERY_REPEATS;
+	g_test_minimized_result (elapsed,
+	                         "Full-text queries took %.3f ms",
+	                         elapsed * 1000);
+
+	g_timer_destroy (timer);
+	tracker_corpus_free (corpus);
+	tracker_data_manager_shutdown ();
+}
+
+#endif /* HAVE_TRACKER_FTS */
+
+static void
+test_query (void)
+{
+	TrackerCorpus *corpus;
+	guint i, j;
+
+	data_init (TRACKER_DB_MANAGER_FORCE_REINDEX, FALSE);
+	corpus = tracker_corpus_new (CORPUS_SEED);
+
+	run_updates (corpus, tracker_corpus_get_file, n_items);
+	run_updates (corpus, tracker_corpus_get_music, n_items);
+
+	for (i = 0; queries[i]; i++) {
+		GTimer *timer;
+		gdouble elapsed;
+
+		timer = g_timer_new ();
+
+		for (j = 0; j < QUERY_REPEATS; j++) {
+			run_query (queries[i]);
+		}
+
+		elapsed = g_timer_elapsed (timer, NULL) / QUERY_REPEATS;
+		g_test_minimized_result (elapsed,
+		                         "Query %u took %.3f ms",
+		                         i, elapsed * 1000);
+
+		g_timer_destroy (timer);
+	}
+
+	tracker_corpus_free (corpus);
+	tracker_data_manager_shutdown ();
+}
+
+static void
+test_translate (void)
+{
+	guint i, j;
+
+	data_init (TRACKER_DB_MANAGER_FORCE_REINDEX, FALSE);
+
+	for (i = 0; queries[i]; i++) {
+		gdouble translate_time = 0;
+
+		for (j = 0; j < QUERY_REPEATS; j++) {
+			TrackerSparqlQuery *query;
+			TrackerDBCursor *cursor;
+			GError *error = NULL;
+
+			query = tracker_sparql_query_new (queries[i]);
+			cursor = tracker_sparql_query_execute_cursor (query, FALSE, &error);
+			g_assert_no_error (error);
+
+			translate_time += tracker_sparql_query_get_translate_time (query);
+
+			g_object_unref (cursor);
+			g_object_unref (query);
+		}
+
+		translate_time /= QUERY_REPEATS;
+		g_test_minimized_result (translate_time,
+		                         "Translating query %u took %.3f ms",
+		                         i, translate_time * 1000);
+	}
+
+	tracker_data_manager_shutdown ();
+}
+
+int
+main (int argc, char **argv)
+{
+	gchar *command, *quoted;
+	gint result;
+
+	g_type_init ();
+
+	g_test_init (&argc, &argv, NULL);
+
+	setlocale (LC_COLLATE, "en_US.utf8");
+
+	data_dir = g_build_filename (g_get_tmp_dir (), "tracker-data-perf-XXXXXX", NULL);
+	g_assert (mkdtemp (data_dir) != NULL);
+
+	g_setenv ("XDG_DATA_HOME", data_dir, TRUE);
+	g_setenv ("XDG_CACHE_HOME", data_dir, TRUE);
+	g_setenv ("TRACKER_DB_ONTOLOGIES_DIR", TOP_SRCDIR "/data/ontologies/", TRUE);
+
+	/* Small runs keep the benchmarks working in regular test runs */
+	n_items = g_test_perf () ? 10000 : 200;
+
+	g_test_add_func ("/performance/data/insert", test_insert);
+	g_test_add_func ("/performance/data/update", test_update);
+#ifndef DISABLE_JOURNAL
+	g_test_add_func ("/performance/data/journal-replay", test_journal_replay);
+#endif /* DISABLE_JOURNAL */
+#if HAVE_TRACKER_FTS
+	g_test_add_func ("/performance/data/fts", test_fts);
+#endif /* HAVE_TRACKER_FTS */
+	g_test_add_func ("/performance/data/query", test_query);
+	g_test_add_func ("/performance/data/translate", test_translate);
+
+	result = g_test_run ();
+
+	quoted = g_shell_quote (data_dir);
+	command = g_strdup_printf ("rm -R %s", quoted);
+	g_spawn_command_line_sync (command, NULL, NULL, NULL, NULL);
+	g_free (command);
+	g_free (quoted);
+	g_free (data_dir);
+
+	return result;
+}
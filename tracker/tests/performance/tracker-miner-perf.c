@@ -0,0 +1,146 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <libtracker-miner/tracker-miner.h>
+
+#include "tracker-corpus.h"
+
+/* Benchmark of the filesystem crawler on a generated tree, run with
+ * -m perf (or "make perf-report") for a full size tree.
+ */
+
+#define CORPUS_SEED 1
+
+typedef struct {
+	GMainLoop *main_loop;
+	guint files_found;
+	gboolean interrupted;
+} CrawlerPerf;
+
+static gchar *data_dir;
+
+static void
+crawler_directory_crawled_cb (TrackerCrawler *crawler,
+                              GFile          *directory,
+                              GNode          *tree,
+                              guint           directories_found,
+                              guint           directories_ignored,
+                              guint           files_found,
+                              guint           files_ignored,
+                              gpointer        user_data)
+{
+	CrawlerPerf *perf = user_data;
+
+	perf->files_found += files_found;
+}
+
+static void
+crawler_finished_cb (TrackerCrawler *crawler,
+                     gboolean        interrupted,
+                     gpointer        user_data)
+{
+	CrawlerPerf *perf = user_data;
+
+	perf->interrupted = interrupted;
+	g_main_loop_quit (perf->main_loop);
+}
+
+static void
+test_crawl (void)
+{
+	CrawlerPerf perf = { 0 };
+	TrackerCorpus *corpus;
+	TrackerCrawler *crawler;
+	GTimer *timer;
+	GFile *file;
+	gchar *root;
+	gdouble elapsed;
+	guint n_files;
+
+	root = g_build_filename (data_dir, "tree", NULL);
+	corpus = tracker_corpus_new (CORPUS_SEED);
+
+	if (g_test_perf ()) {
+		n_files = tracker_corpus_create_tree (corpus, root, 3, 8, 20);
+	} else {
+		n_files = tracker_corpus_create_tree (corpus, root, 2, 4, 5);
+	}
+
+	perf.main_loop = g_main_loop_new (NULL, FALSE);
+
+	crawler = tracker_crawler_new ();
+	g_signal_connect (crawler, "directory-crawled",
+	                  G_CALLBACK (crawler_directory_crawled_cb), &perf);
+	g_signal_connect (crawler, "finished",
+	                  G_CALLBACK (crawler_finished_cb), &perf);
+
+	file = g_file_new_for_path (root);
+
+	timer = g_timer_new ();
+	g_assert (tracker_crawler_start (crawler, file, TRUE));
+	g_main_loop_run (perf.main_loop);
+	elapsed = g_timer_elapsed (timer, NULL);
+
+	g_assert (!perf.interrupted);
+	g_assert_cmpuint (perf.files_found, ==, n_files);
+
+	g_test_maximized_result (n_files / elapsed,
+	                         "Crawled %u files at %.1f files/s",
+	                         n_files, n_files / elapsed);
+
+	g_timer_destroy (timer);
+	g_object_unref (file);
+	g_object_unref (crawler);
+	g_main_loop_unref (perf.main_loop);
+	tracker_corpus_free (corpus);
+	g_free (root);
+}
+
+int
+main (int argc, char **argv)
+{
+	gchar *command, *quoted;
+	gint result;
+
+	g_type_init ();
+
+	g_test_init (&argc, &argv, NULL);
+
+	data_dir = g_build_filename (g_get_tmp_dir (), "tracker-miner-perf-XXXXXX", NULL);
+	g_assert (mkdtemp (data_dir) != NULL);
+
+	g_test_add_func ("/performance/miner/crawl", test_crawl);
+
+	result = g_test_run ();
+
+	quoted = g_shell_quote (data_dir);
+	command = g_strdup_printf ("rm -R %s", quoted);
+	g_spawn_command_line_sync (command, NULL, NULL, NULL, NULL);
+	g_free (command);
+	g_free (quoted);
+	g_free (data_dir);
+
+	return result;
+}
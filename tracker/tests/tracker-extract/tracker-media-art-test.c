@@ -0,0 +1,230 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <string.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include <libtracker-common/tracker-media-art.h>
+
+#include <tracker-extract/tracker-media-art.h>
+#include <tracker-extract/tracker-media-art-generic.h>
+
+static gchar *test_dir;
+static gchar *track_path;
+static gchar *track_uri;
+static time_t track_mtime = 100000;
+static guint n_conversions;
+
+/*
+ * Overrides, the media art is only written as is and no
+ * downloads are requested over D-Bus.
+ */
+GDBusConnection *
+g_bus_get_sync (GBusType       bus_type,
+                GCancellable  *cancellable,
+                GError       **error)
+{
+	return (GDBusConnection *) g_object_new (G_TYPE_OBJECT, NULL);
+}
+
+void
+tracker_media_art_plugin_init (void)
+{
+}
+
+void
+tracker_media_art_plugin_shutdown (void)
+{
+}
+
+gboolean
+tracker_media_art_file_to_jpeg (const gchar *filename,
+                                const gchar *target)
+{
+	return FALSE;
+}
+
+gboolean
+tracker_media_art_buffer_to_jpeg (const unsigned char *buffer,
+                                  size_t               len,
+                                  const gchar         *buffer_mime,
+                                  const gchar         *target)
+{
+	n_conversions++;
+
+	return g_file_set_contents (target, (const gchar *) buffer, len, NULL);
+}
+
+static void
+media_art_setup (void)
+{
+	n_conversions = 0;
+	g_assert (tracker_media_art_init ());
+}
+
+static void
+media_art_teardown (void)
+{
+	tracker_media_art_shutdown ();
+}
+
+static gchar *
+media_art_get_path (const gchar *title)
+{
+	gchar *path;
+
+	tracker_media_art_get_path (NULL, title, "album", NULL, &path, NULL);
+
+	return path;
+}
+
+/* Processes the image embedded in a track of @title, the track is
+ * always newer than the media art made for the previous one.
+ */
+static void
+process_embedded (const gchar *title,
+                  const gchar *image)
+{
+	struct utimbuf buf;
+
+	track_mtime += 10;
+	buf.actime = buf.modtime = track_mtime;
+	g_assert_cmpint (utime (track_path, &buf), ==, 0);
+
+	g_assert (tracker_media_art_process ((const unsigned char *) image,
+	                                     strlen (image),
+	                                     "image/png",
+	                                     TRACKER_MEDIA_ART_ALBUM,
+	                                     NULL,
+	                                     title,
+	                                     track_uri));
+}
+
+static void
+test_media_art_embedded (void)
+{
+	gchar *path;
+
+	media_art_setup ();
+
+	process_embedded ("Album", "first image");
+	g_assert_cmpuint (n_conversions, ==, 1);
+
+	/* Other tracks of the album embed the same image */
+	process_embedded ("Album", "first image");
+	process_embedded ("Album", "first image");
+	g_assert_cmpuint (n_conversions, ==, 1);
+
+	/* A different image is converted again */
+	process_embedded ("Album", "second image");
+	g_assert_cmpuint (n_conversions, ==, 2);
+
+	process_embedded ("Album", "second image");
+	g_assert_cmpuint (n_conversions, ==, 2);
+
+	/* The media art was removed behind our back */
+	path = media_art_get_path ("Album");
+	g_assert_cmpint (g_unlink (path), ==, 0);
+
+	process_embedded ("Album", "second image");
+	g_assert_cmpuint (n_conversions, ==, 3);
+	g_assert (g_file_test (path, G_FILE_TEST_EXISTS));
+
+	g_free (path);
+
+	media_art_teardown ();
+}
+
+static void
+test_media_art_embedded_lru (void)
+{
+	gchar *title;
+	gint i;
+
+	media_art_setup ();
+
+	for (i = 0; i < TRACKER_MEDIA_ART_MAX_CACHED; i++) {
+		title = g_strdup_printf ("Album %d", i);
+		process_embedded (title, "image");
+		g_free (title);
+	}
+
+	g_assert_cmpuint (n_conversions, ==, TRACKER_MEDIA_ART_MAX_CACHED);
+
+	/* Used again, so the least recently used one is now "Album 1" */
+	process_embedded ("Album 0", "image");
+	g_assert_cmpuint (n_conversions, ==, TRACKER_MEDIA_ART_MAX_CACHED);
+
+	title = g_strdup_printf ("Album %d", TRACKER_MEDIA_ART_MAX_CACHED);
+	process_embedded (title, "image");
+	g_assert_cmpuint (n_conversions, ==, TRACKER_MEDIA_ART_MAX_CACHED + 1);
+	g_free (title);
+
+	process_embedded ("Album 0", "image");
+	g_assert_cmpuint (n_conversions, ==, TRACKER_MEDIA_ART_MAX_CACHED + 1);
+
+	/* Dropped from the cache, the image is converted again */
+	process_embedded ("Album 1", "image");
+	g_assert_cmpuint (n_conversions, ==, TRACKER_MEDIA_ART_MAX_CACHED + 2);
+
+	media_art_teardown ();
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+	gchar *basename, *command;
+	gint result;
+
+	/* Keeps the media art out of the user's cache */
+	basename = g_strdup_printf ("tracker-media-art-test-%d", getpid ());
+	test_dir = g_build_filename (g_get_tmp_dir (), basename, NULL);
+	g_free (basename);
+
+	g_setenv ("XDG_CACHE_HOME", test_dir, TRUE);
+
+	g_type_init ();
+	g_test_init (&argc, &argv, NULL);
+
+	g_assert_cmpint (g_mkdir_with_parents (test_dir, 0700), ==, 0);
+
+	track_path = g_build_filename (test_dir, "track.mp3", NULL);
+	track_uri = g_filename_to_uri (track_path, NULL, NULL);
+	g_assert (g_file_set_contents (track_path, "", -1, NULL));
+
+	g_test_add_func ("/tracker-extract/media-art/embedded",
+	                 test_media_art_embedded);
+	g_test_add_func ("/tracker-extract/media-art/embedded-lru",
+	                 test_media_art_embedded_lru);
+
+	result = g_test_run ();
+
+	command = g_strdup_printf ("rm -R %s", test_dir);
+	g_spawn_command_line_sync (command, NULL, NULL, NULL, NULL);
+	g_free (command);
+
+	g_free (track_uri);
+	g_free (track_path);
+	g_free (test_dir);
+
+	return result;
+}
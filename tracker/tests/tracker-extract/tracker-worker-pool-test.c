@@ -0,0 +1,158 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <sys/types.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include <tracker-extract/tracker-worker-pool.h>
+
+#define TIMEOUT 1
+
+/* Run in the helper processes, the URI says what to do */
+static gchar *
+worker_func (const gchar *uri,
+             gsize        max_bytes)
+{
+	if (strcmp (uri, "hang") == 0) {
+		while (TRUE) {
+			pause ();
+		}
+	} else if (strcmp (uri, "crash") == 0) {
+		kill (getpid (), SIGKILL);
+	}
+
+	/* the pid tells which helper handled the document */
+	return g_strdup_printf ("%d", (gint) getpid ());
+}
+
+static pid_t
+run_get_pid (TrackerWorkerPool *pool)
+{
+	gchar *text;
+	pid_t pid;
+
+	text = tracker_worker_pool_run (pool, "pid", 100);
+	g_assert (text != NULL);
+
+	pid = atoi (text);
+	g_assert_cmpint (pid, >, 0);
+	g_assert_cmpint (pid, !=, getpid ());
+
+	g_free (text);
+
+	return pid;
+}
+
+static gboolean
+process_exists (pid_t pid)
+{
+	return kill (pid, 0) == 0 || errno != ESRCH;
+}
+
+static void
+test_worker_pool_timeout (void)
+{
+	TrackerWorkerPool *pool;
+	gint64 start, elapsed;
+	pid_t pid;
+
+	pool = tracker_worker_pool_new (worker_func, 1, 100, TIMEOUT);
+
+	pid = run_get_pid (pool);
+
+	start = g_get_monotonic_time ();
+	g_assert (tracker_worker_pool_run (pool, "hang", 100) == NULL);
+	elapsed = g_get_monotonic_time () - start;
+
+	/* Killed once the timeout is over, not before */
+	g_assert_cmpint (elapsed, >=, TIMEOUT * G_USEC_PER_SEC);
+	g_assert_cmpint (elapsed, <, (TIMEOUT + 5) * G_USEC_PER_SEC);
+	g_assert (!process_exists (pid));
+
+	/* A new helper takes the next document */
+	g_assert_cmpint (run_get_pid (pool), !=, pid);
+
+	tracker_worker_pool_free (pool);
+}
+
+static void
+test_worker_pool_crash (void)
+{
+	TrackerWorkerPool *pool;
+	pid_t pid, new_pid;
+
+	pool = tracker_worker_pool_new (worker_func, 1, 100, TIMEOUT);
+
+	pid = run_get_pid (pool);
+
+	g_assert (tracker_worker_pool_run (pool, "crash", 100) == NULL);
+	g_assert (!process_exists (pid));
+
+	/* The next document is not lost, a new helper handles it */
+	new_pid = run_get_pid (pool);
+	g_assert_cmpint (new_pid, !=, pid);
+	g_assert_cmpint (run_get_pid (pool), ==, new_pid);
+
+	tracker_worker_pool_free (pool);
+}
+
+static void
+test_worker_pool_recycle (void)
+{
+	TrackerWorkerPool *pool;
+	pid_t pid, new_pid;
+
+	pool = tracker_worker_pool_new (worker_func, 1, 3, TIMEOUT);
+
+	pid = run_get_pid (pool);
+	g_assert_cmpint (run_get_pid (pool), ==, pid);
+	g_assert_cmpint (run_get_pid (pool), ==, pid);
+
+	/* Replaced after max_documents, the old helper exited */
+	g_assert (!process_exists (pid));
+
+	new_pid = run_get_pid (pool);
+	g_assert_cmpint (new_pid, !=, pid);
+	g_assert_cmpint (run_get_pid (pool), ==, new_pid);
+
+	tracker_worker_pool_free (pool);
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+	if (!g_thread_supported ()) {
+		g_thread_init (NULL);
+	}
+
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/tracker-extract/worker-pool/timeout",
+	                 test_worker_pool_timeout);
+	g_test_add_func ("/tracker-extract/worker-pool/crash",
+	                 test_worker_pool_crash);
+	g_test_add_func ("/tracker-extract/worker-pool/recycle",
+	                 test_worker_pool_recycle);
+
+	return g_test_run ();
+}
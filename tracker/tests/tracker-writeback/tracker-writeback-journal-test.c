@@ -0,0 +1,353 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <tracker-writeback/tracker-writeback-journal.h>
+
+#define FILE_CONTENTS "head-of-file|payload payload payload|tail-of-file"
+#define NEW_CONTENTS  "HEAD-OF-FILE|payload payload payload|TAIL-OF-FILE"
+#define HEAD_SIZE 12
+#define TAIL_SIZE 12
+
+typedef struct {
+	gchar *dir;
+	gchar *journal_dir;
+	gchar *path;
+} JournalFixture;
+
+static void
+journal_fixture_setup (JournalFixture *fixture,
+                       gconstpointer   data)
+{
+	gchar *basename;
+
+	basename = g_strdup_printf ("tracker-writeback-journal-test-%d", getpid ());
+	fixture->dir = g_build_filename (g_get_tmp_dir (), basename, NULL);
+	fixture->journal_dir = g_build_filename (fixture->dir, "journal", NULL);
+	fixture->path = g_build_filename (fixture->dir, "file", NULL);
+	g_free (basename);
+
+	g_assert_cmpint (g_mkdir_with_parents (fixture->dir, 0700), ==, 0);
+	g_assert (g_file_set_contents (fixture->path, FILE_CONTENTS, -1, NULL));
+}
+
+static void
+journal_fixture_teardown (JournalFixture *fixture,
+                          gconstpointer   data)
+{
+	GDir *dir;
+	const gchar *name;
+
+	dir = g_dir_open (fixture->journal_dir, 0, NULL);
+
+	if (dir) {
+		while ((name = g_dir_read_name (dir)) != NULL) {
+			gchar *path;
+
+			path = g_build_filename (fixture->journal_dir, name, NULL);
+			g_unlink (path);
+			g_free (path);
+		}
+
+		g_dir_close (dir);
+		g_rmdir (fixture->journal_dir);
+	}
+
+	g_unlink (fixture->path);
+	g_rmdir (fixture->dir);
+
+	g_free (fixture->path);
+	g_free (fixture->journal_dir);
+	g_free (fixture->dir);
+}
+
+static gchar *
+journal_create (JournalFixture *fixture)
+{
+	const gchar *contents = FILE_CONTENTS;
+	const gchar *new_contents = NEW_CONTENTS;
+	guchar old_data[HEAD_SIZE + TAIL_SIZE];
+	guchar new_data[HEAD_SIZE + TAIL_SIZE];
+	GError *error = NULL;
+	gchar *journal_path;
+
+	memcpy (old_data, contents, HEAD_SIZE);
+	memcpy (old_data + HEAD_SIZE, contents + strlen (contents) - TAIL_SIZE, TAIL_SIZE);
+	memcpy (new_data, new_contents, HEAD_SIZE);
+	memcpy (new_data + HEAD_SIZE, new_contents + strlen (new_contents) - TAIL_SIZE, TAIL_SIZE);
+
+	journal_path = tracker_writeback_journal_create (fixture->journal_dir,
+	                                                 fixture->path,
+	                                                 strlen (contents),
+	                                                 old_data,
+	                                                 new_data,
+	                                                 HEAD_SIZE,
+	                                                 TAIL_SIZE,
+	                                                 &error);
+	g_assert_no_error (error);
+	g_assert (journal_path != NULL);
+	g_assert (g_file_test (journal_path, G_FILE_TEST_EXISTS));
+
+	return journal_path;
+}
+
+static void
+assert_file_contents (const gchar *path,
+                      const gchar *expected)
+{
+	gchar *contents;
+
+	g_assert (g_file_get_contents (path, &contents, NULL, NULL));
+	g_assert_cmpstr (contents, ==, expected);
+	g_free (contents);
+}
+
+static void
+write_changed_region (const gchar *path,
+                      goffset      offset,
+                      const gchar *old_data,
+                      const gchar *new_data)
+{
+	GError *error = NULL;
+	gint fd;
+
+	fd = g_open (path, O_WRONLY, 0);
+	g_assert_cmpint (fd, !=, -1);
+
+	g_assert (tracker_writeback_write_changed_region (fd, offset,
+	                                                  (const guchar *) old_data,
+	                                                  (const guchar *) new_data,
+	                                                  strlen (old_data),
+	                                                  &error));
+	g_assert_no_error (error);
+
+	close (fd);
+}
+
+static void
+test_write_changed_region (JournalFixture *fixture,
+                           gconstpointer   data)
+{
+	g_assert (g_file_set_contents (fixture->path, "AAAAAAAAAA", -1, NULL));
+
+	/* Only the span that differs is written */
+	write_changed_region (fixture->path, 0, "0123456789", "0123XY6789");
+	assert_file_contents (fixture->path, "AAAAXYAAAA");
+
+	write_changed_region (fixture->path, 6, "6789", "Z78Z");
+	assert_file_contents (fixture->path, "AAAAXYZAAZ");
+}
+
+static void
+test_write_changed_region_unchanged (JournalFixture *fixture,
+                                     gconstpointer   data)
+{
+	g_assert (g_file_set_contents (fixture->path, "AAAAAAAAAA", -1, NULL));
+
+	write_changed_region (fixture->path, 0, "0123456789", "0123456789");
+	assert_file_contents (fixture->path, "AAAAAAAAAA");
+}
+
+static void
+test_journal_remove (JournalFixture *fixture,
+                     gconstpointer   data)
+{
+	GError *error = NULL;
+	gchar *journal_path;
+
+	journal_path = journal_create (fixture);
+
+	g_assert (tracker_writeback_journal_remove (journal_path, &error));
+	g_assert_no_error (error);
+	g_assert (!g_file_test (journal_path, G_FILE_TEST_EXISTS));
+
+	/* A finished update is left alone */
+	g_assert (g_file_set_contents (fixture->path,
+	                               "head-of-FILE|payload payload payload|tail-of-FILE",
+	                               -1, NULL));
+	g_assert_cmpuint (tracker_writeback_journal_rollback (fixture->journal_dir), ==, 0);
+	assert_file_contents (fixture->path,
+	                      "head-of-FILE|payload payload payload|tail-of-FILE");
+
+	g_free (journal_path);
+}
+
+static void
+test_journal_rollback (JournalFixture *fixture,
+                       gconstpointer   data)
+{
+	gchar *journal_path;
+
+	journal_path = journal_create (fixture);
+
+	/* Crashed after writing the head, halfway through the tail */
+	g_assert (g_file_set_contents (fixture->path,
+	                               "HEAD-OF-FILE|payload payload payload|tail-OF-FILE",
+	                               -1, NULL));
+
+	g_assert_cmpuint (tracker_writeback_journal_rollback (fixture->journal_dir), ==, 1);
+	assert_file_contents (fixture->path, FILE_CONTENTS);
+	g_assert (!g_file_test (journal_path, G_FILE_TEST_EXISTS));
+
+	g_free (journal_path);
+}
+
+static void
+test_journal_incomplete (JournalFixture *fixture,
+                         gconstpointer   data)
+{
+	gchar *journal_path, *contents;
+	gsize length;
+
+	journal_path = journal_create (fixture);
+
+	/* Crashed while writing the journal, the file wasn't touched */
+	g_assert (g_file_get_contents (journal_path, &contents, &length, NULL));
+	g_assert (g_file_set_contents (journal_path, contents, length - 4, NULL));
+	g_free (contents);
+
+	g_assert (g_file_set_contents (fixture->path,
+	                               "head-of-FILE|payload payload payload|tail-of-FILE",
+	                               -1, NULL));
+
+	g_assert_cmpuint (tracker_writeback_journal_rollback (fixture->journal_dir), ==, 1);
+	assert_file_contents (fixture->path,
+	                      "head-of-FILE|payload payload payload|tail-of-FILE");
+	g_assert (!g_file_test (journal_path, G_FILE_TEST_EXISTS));
+
+	g_free (journal_path);
+}
+
+static void
+test_journal_size_changed (JournalFixture *fixture,
+                           gconstpointer   data)
+{
+	gchar *journal_path;
+
+	journal_path = journal_create (fixture);
+
+	/* Replaced through the copy path since */
+	g_assert (g_file_set_contents (fixture->path, "something else", -1, NULL));
+
+	g_assert_cmpuint (tracker_writeback_journal_rollback (fixture->journal_dir), ==, 1);
+	assert_file_contents (fixture->path, "something else");
+	g_assert (!g_file_test (journal_path, G_FILE_TEST_EXISTS));
+
+	g_free (journal_path);
+}
+
+static void
+test_journal_rollback_finished (JournalFixture *fixture,
+                                gconstpointer   data)
+{
+	gchar *journal_path;
+
+	journal_path = journal_create (fixture);
+
+	/* Crashed after syncing, before removing the journal */
+	g_assert (g_file_set_contents (fixture->path, NEW_CONTENTS, -1, NULL));
+
+	g_assert_cmpuint (tracker_writeback_journal_rollback (fixture->journal_dir), ==, 1);
+	assert_file_contents (fixture->path, FILE_CONTENTS);
+	g_assert (!g_file_test (journal_path, G_FILE_TEST_EXISTS));
+
+	g_free (journal_path);
+}
+
+static void
+test_journal_modified (JournalFixture *fixture,
+                       gconstpointer   data)
+{
+	gchar *journal_path;
+
+	journal_path = journal_create (fixture);
+
+	/* Same size, but the tail was written by something else since */
+	g_assert (g_file_set_contents (fixture->path,
+	                               "HEAD-OF-FILE|payload payload payload|tail-of-xxxx",
+	                               -1, NULL));
+
+	g_assert_cmpuint (tracker_writeback_journal_rollback (fixture->journal_dir), ==, 1);
+	assert_file_contents (fixture->path,
+	                      "HEAD-OF-FILE|payload payload payload|tail-of-xxxx");
+	g_assert (!g_file_test (journal_path, G_FILE_TEST_EXISTS));
+
+	g_free (journal_path);
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add ("/tracker-writeback/journal/write-changed-region",
+	            JournalFixture,
+	            NULL,
+	            journal_fixture_setup,
+	            test_write_changed_region,
+	            journal_fixture_teardown);
+	g_test_add ("/tracker-writeback/journal/write-changed-region-unchanged",
+	            JournalFixture,
+	            NULL,
+	            journal_fixture_setup,
+	            test_write_changed_region_unchanged,
+	            journal_fixture_teardown);
+	g_test_add ("/tracker-writeback/journal/remove",
+	            JournalFixture,
+	            NULL,
+	            journal_fixture_setup,
+	            test_journal_remove,
+	            journal_fixture_teardown);
+	g_test_add ("/tracker-writeback/journal/rollback",
+	            JournalFixture,
+	            NULL,
+	            journal_fixture_setup,
+	            test_journal_rollback,
+	            journal_fixture_teardown);
+	g_test_add ("/tracker-writeback/journal/incomplete",
+	            JournalFixture,
+	            NULL,
+	            journal_fixture_setup,
+	            test_journal_incomplete,
+	            journal_fixture_teardown);
+	g_test_add ("/tracker-writeback/journal/size-changed",
+	            JournalFixture,
+	            NULL,
+	            journal_fixture_setup,
+	            test_journal_size_changed,
+	            journal_fixture_teardown);
+	g_test_add ("/tracker-writeback/journal/rollback-finished",
+	            JournalFixture,
+	            NULL,
+	            journal_fixture_setup,
+	            test_journal_rollback_finished,
+	            journal_fixture_teardown);
+	g_test_add ("/tracker-writeback/journal/modified",
+	            JournalFixture,
+	            NULL,
+	            journal_fixture_setup,
+	            test_journal_modified,
+	            journal_fixture_teardown);
+
+	return g_test_run ();
+}
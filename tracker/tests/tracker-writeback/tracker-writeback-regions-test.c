@@ -0,0 +1,187 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <tracker-writeback/tracker-writeback-regions.h>
+
+typedef gboolean (* GetRegionsFunc) (GInputStream *stream,
+                                     goffset       file_size,
+                                     goffset      *head_size,
+                                     goffset      *tail_size);
+
+/* Fixture contents, followed by @extra_size zeroes of payload */
+static GInputStream *
+fixture_open (const gchar *name,
+              gsize        extra_size,
+              goffset     *file_size)
+{
+	gchar *path, *contents, *data;
+	gsize length;
+
+	path = g_build_filename (TEST_DATA_DIR, name, NULL);
+
+	if (!g_file_get_contents (path, &contents, &length, NULL)) {
+		g_error ("Could not load fixture '%s'", path);
+	}
+
+	g_free (path);
+
+	if (extra_size > 0) {
+		data = g_malloc0 (length + extra_size);
+		memcpy (data, contents, length);
+		g_free (contents);
+		contents = data;
+		length += extra_size;
+	}
+
+	*file_size = length;
+
+	return g_memory_input_stream_new_from_data (contents, length, g_free);
+}
+
+static void
+assert_regions (GetRegionsFunc  func,
+                const gchar    *name,
+                gsize           extra_size,
+                goffset         expected_head_size,
+                goffset         expected_tail_size)
+{
+	GInputStream *stream;
+	goffset file_size, head_size = -1, tail_size = -1;
+
+	stream = fixture_open (name, extra_size, &file_size);
+
+	g_assert (func (stream, file_size, &head_size, &tail_size));
+	g_assert_cmpint (head_size, ==, expected_head_size);
+	g_assert_cmpint (tail_size, ==, expected_tail_size);
+
+	g_object_unref (stream);
+}
+
+static void
+assert_no_regions (GetRegionsFunc  func,
+                   const gchar    *name)
+{
+	GInputStream *stream;
+	goffset file_size, head_size, tail_size;
+
+	stream = fixture_open (name, 0, &file_size);
+
+	g_assert (!func (stream, file_size, &head_size, &tail_size));
+
+	g_object_unref (stream);
+}
+
+static void
+test_regions_mpeg (void)
+{
+	/* 74 bytes of ID3v2 tag, 200 of audio, 128 of ID3v1 tag */
+	assert_regions (tracker_writeback_mpeg_get_metadata_regions,
+	                "inplace-id3v2-id3v1.mp3", 0,
+	                274, 128);
+}
+
+static void
+test_regions_mpeg_no_id3v1 (void)
+{
+	/* TagLib would append an ID3v1 tag */
+	assert_no_regions (tracker_writeback_mpeg_get_metadata_regions,
+	                   "inplace-id3v2.mp3");
+	assert_no_regions (tracker_writeback_mpeg_get_metadata_regions,
+	                   "inplace-padding.flac");
+}
+
+static void
+test_regions_flac (void)
+{
+	/* 161 bytes of metadata blocks, 50 of audio */
+	assert_regions (tracker_writeback_flac_get_metadata_regions,
+	                "inplace-padding.flac", 0,
+	                211, 0);
+	assert_regions (tracker_writeback_flac_get_metadata_regions,
+	                "inplace-padding-id3v1.flac", 0,
+	                211, 128);
+}
+
+static void
+test_regions_flac_sample (void)
+{
+	/* Only a sample of the audio frames is kept */
+	assert_regions (tracker_writeback_flac_get_metadata_regions,
+	                "inplace-padding.flac", 2 * TRACKER_WRITEBACK_AUDIO_SAMPLE_SIZE,
+	                161 + TRACKER_WRITEBACK_AUDIO_SAMPLE_SIZE, 0);
+}
+
+static void
+test_regions_flac_truncated (void)
+{
+	/* The padding block claims to go past the end of the file */
+	assert_no_regions (tracker_writeback_flac_get_metadata_regions,
+	                   "inplace-truncated.flac");
+	assert_no_regions (tracker_writeback_flac_get_metadata_regions,
+	                   "inplace-id3v2-id3v1.mp3");
+}
+
+static void
+test_regions_jpeg (void)
+{
+	/* Start of scan segment ends at 284, 102 bytes of scan data */
+	assert_regions (tracker_writeback_jpeg_get_metadata_regions,
+	                "inplace-xmp.jpg", 0,
+	                386, 0);
+	assert_regions (tracker_writeback_jpeg_get_metadata_regions,
+	                "inplace-xmp.jpg", 2 * TRACKER_WRITEBACK_JPEG_SAMPLE_SIZE,
+	                284 + TRACKER_WRITEBACK_JPEG_SAMPLE_SIZE, 0);
+}
+
+static void
+test_regions_jpeg_no_xmp (void)
+{
+	/* Exempi would insert a new XMP packet */
+	assert_no_regions (tracker_writeback_jpeg_get_metadata_regions,
+	                   "test01.jpg");
+	assert_no_regions (tracker_writeback_jpeg_get_metadata_regions,
+	                   "inplace-padding.flac");
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+	g_type_init ();
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/tracker-writeback/regions/mpeg",
+	                 test_regions_mpeg);
+	g_test_add_func ("/tracker-writeback/regions/mpeg-no-id3v1",
+	                 test_regions_mpeg_no_id3v1);
+	g_test_add_func ("/tracker-writeback/regions/flac",
+	                 test_regions_flac);
+	g_test_add_func ("/tracker-writeback/regions/flac-sample",
+	                 test_regions_flac_sample);
+	g_test_add_func ("/tracker-writeback/regions/flac-truncated",
+	                 test_regions_flac_truncated);
+	g_test_add_func ("/tracker-writeback/regions/jpeg",
+	                 test_regions_jpeg);
+	g_test_add_func ("/tracker-writeback/regions/jpeg-no-xmp",
+	                 test_regions_jpeg_no_xmp);
+
+	return g_test_run ();
+}